@@ -0,0 +1,355 @@
+/**
+ * Implements the SD card sector cache.
+ *
+ * @date   2019
+ */
+#include <string.h>
+#include "sdcache.h"
+
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+
+#define SDCACHE_NO_SECTOR  0xFFFFFFFFu
+
+
+  /**
+   * Defines a cache entry.
+   */
+  typedef struct SDCacheEntry
+  {
+    DWORD    sector;    ///< The sector's address. SDCACHE_NO_SECTOR if the entry is free.
+    uint32_t last_use;  ///< The value of the use counter when the entry was last used.
+    uint32_t epoch;     ///< The barrier epoch of the sector's last write. Only meaningful if the entry is dirty.
+    bool     is_dirty;  ///< Has the sector to be written to the card?
+    BYTE     data[SDCACHE_SECTOR_SIZE] __attribute__((aligned(4)));  ///< The sector's data.
+  }
+  SDCacheEntry;
+
+
+  static SDCacheEntry     _sdcache_entries[SDCACHE_NB_SECTORS];  ///< The cache entries.
+  static uint32_t         _sdcache_use_counter;                  ///< Incremented at each access; used for LRU.
+  static uint32_t         _sdcache_epoch;                        ///< Incremented at each barrier.
+  static SDCacheReadFunc  _sdcache_pf_read  = NULL;              ///< The function used to read from the card.
+  static SDCacheWriteFunc _sdcache_pf_write = NULL;              ///< The function used to write to the card.
+  static SDCacheStats     _sdcache_stats;                        ///< The statistics.
+  static DWORD            _sdcache_last_erase_block = SDCACHE_NO_SECTOR;  ///< The erase block last written to.
+
+  static SDCacheEntry *sdcache_find(      DWORD sector);
+  static SDCacheEntry *sdcache_allocate(  DWORD sector);
+  static DRESULT       sdcache_write_back(SDCacheEntry *pv_entry);
+  static DRESULT       sdcache_write_back_epochs(uint32_t age_min);
+  static void          sdcache_count_written(DWORD sector, UINT count);
+
+
+  /**
+   * Initialise the cache. All entries are set as free.
+   *
+   * @param[in] pf_read  the function used to read sectors from the card.  MUST be NOT NULL.
+   * @param[in] pf_write the function used to write sectors to the card. MUST be NOT NULL.
+   */
+  void sdcache_init(SDCacheReadFunc pf_read, SDCacheWriteFunc pf_write)
+  {
+    _sdcache_pf_read  = pf_read;
+    _sdcache_pf_write = pf_write;
+    sdcache_invalidate();
+  }
+
+  /**
+   * Forget all the cached sectors, without writing the dirty ones.
+   */
+  void sdcache_invalidate(void)
+  {
+    for(uint8_t i = 0; i < SDCACHE_NB_SECTORS; i++)
+    {
+      _sdcache_entries[i].sector   = SDCACHE_NO_SECTOR;
+      _sdcache_entries[i].is_dirty = false;
+    }
+  }
+
+
+  /**
+   * Find a sector in the cache.
+   *
+   * @param[in] sector the sector's address.
+   *
+   * @return the cache entry.
+   * @return NULL if the sector is not in the cache.
+   */
+  static SDCacheEntry *sdcache_find(DWORD sector)
+  {
+    for(uint8_t i = 0; i < SDCACHE_NB_SECTORS; i++)
+    {
+      if(_sdcache_entries[i].sector == sector) { return &_sdcache_entries[i]; }
+    }
+
+    return NULL;
+  }
+
+  /**
+   * Get an entry for a sector that is not in the cache.
+   * The least recently used clean entry is used, or the least recently used entry if they are
+   * all dirty; a dirty entry is written back first, after the dirty sectors of the previous epochs.
+   *
+   * @param[in] sector the sector's address.
+   *
+   * @return the entry.
+   * @return NULL if the evicted sector could not be written back.
+   */
+  static SDCacheEntry *sdcache_allocate(DWORD sector)
+  {
+    SDCacheEntry *pv_entry = &_sdcache_entries[0];
+
+    for(uint8_t i = 0; i < SDCACHE_NB_SECTORS; i++)
+    {
+      if(_sdcache_entries[i].sector == SDCACHE_NO_SECTOR) { pv_entry = &_sdcache_entries[i]; break; }
+      if(_sdcache_entries[i].is_dirty != pv_entry->is_dirty)
+      {
+	if(!_sdcache_entries[i].is_dirty) { pv_entry = &_sdcache_entries[i]; }
+      }
+      else if(_sdcache_use_counter - _sdcache_entries[i].last_use >
+	      _sdcache_use_counter - pv_entry->last_use) { pv_entry = &_sdcache_entries[i]; }
+    }
+    if(pv_entry->is_dirty &&
+       sdcache_write_back_epochs(_sdcache_epoch - pv_entry->epoch + 1) != RES_OK) { return NULL; }
+    if(sdcache_write_back(pv_entry) != RES_OK) { return NULL; }
+
+    pv_entry->sector = sector;
+    return pv_entry;
+  }
+
+  /**
+   * Write a cache entry to the card, if it is dirty.
+   *
+   * @param[in] pv_entry the entry. MUST be NOT NULL.
+   *
+   * @return RES_OK on success.
+   * @return the write function's error otherwise.
+   */
+  static DRESULT sdcache_write_back(SDCacheEntry *pv_entry)
+  {
+    DRESULT res;
+
+    if(!pv_entry->is_dirty) { return RES_OK; }
+
+    if((res = _sdcache_pf_write(pv_entry->data, pv_entry->sector, 1)) == RES_OK)
+    {
+      pv_entry->is_dirty = false;
+      sdcache_count_written(pv_entry->sector, 1);
+    }
+
+    return res;
+  }
+
+  /**
+   * Write the dirty sectors of the epochs that are at least a given number of barriers old:
+   * the oldest epoch first and, in an epoch, in increasing address order.
+   *
+   * @param[in] age_min the number of barriers since the most recent epoch to write.
+   *                    0 to write all the dirty sectors.
+   *
+   * @return RES_OK on success.
+   * @return the write function's error otherwise; the sector that could not be written,
+   *         and the ones that come after it, remain dirty.
+   */
+  static DRESULT sdcache_write_back_epochs(uint32_t age_min)
+  {
+    SDCacheEntry *pv_entry, *pv_next;
+    DRESULT       res;
+
+    while(true)
+    {
+      pv_next = NULL;
+      for(uint8_t i = 0; i < SDCACHE_NB_SECTORS; i++)
+      {
+	pv_entry = &_sdcache_entries[i];
+	if(!pv_entry->is_dirty || _sdcache_epoch - pv_entry->epoch < age_min) { continue; }
+	if(!pv_next ||
+	   _sdcache_epoch - pv_entry->epoch >  _sdcache_epoch - pv_next->epoch ||
+	   (pv_entry->epoch == pv_next->epoch && pv_entry->sector < pv_next->sector)) { pv_next = pv_entry; }
+      }
+      if(!pv_next) { return RES_OK; }
+
+      if((res = sdcache_write_back(pv_next)) != RES_OK) { return res; }
+    }
+  }
+
+  /**
+   * Update the statistics after sectors have been written to the card.
+   *
+   * @param[in] sector the first sector's address.
+   * @param[in] count  the number of sectors written.
+   */
+  static void sdcache_count_written(DWORD sector, UINT count)
+  {
+    DWORD first = sector               / SDCACHE_ERASE_BLOCK_NB_SECTORS;
+    DWORD last  = (sector + count - 1) / SDCACHE_ERASE_BLOCK_NB_SECTORS;
+
+    _sdcache_stats.nb_sectors_written      += count;
+    _sdcache_stats.nb_erase_blocks_written += last - first + (first != _sdcache_last_erase_block ? 1 : 0);
+    _sdcache_last_erase_block               = last;
+  }
+
+
+  /**
+   * Read sectors.
+   *
+   * Single sector reads go through the cache. Multiple sector reads are read from the card
+   * and the cached sectors, which may be more recent, are then copied over them.
+   *
+   * @param[out] pu8_buffer where the data are written to. MUST be NOT NULL.
+   * @param[in]  sector     the first sector's address.
+   * @param[in]  count      the number of sectors to read.
+   *
+   * @return RES_OK on success.
+   * @return an error code otherwise.
+   */
+  DRESULT sdcache_read(BYTE *pu8_buffer, DWORD sector, UINT count)
+  {
+    SDCacheEntry *pv_entry;
+    DRESULT       res;
+
+    _sdcache_use_counter++;
+    if(count == 1)
+    {
+      if(!(pv_entry = sdcache_find(sector)))
+      {
+	_sdcache_stats.nb_misses++;
+	if(!(pv_entry = sdcache_allocate(sector))) { return RES_ERROR; }
+	if((res = _sdcache_pf_read(pv_entry->data, sector, 1)) != RES_OK)
+	{
+	  pv_entry->sector = SDCACHE_NO_SECTOR;
+	  return res;
+	}
+	_sdcache_stats.nb_sectors_read++;
+      }
+      else { _sdcache_stats.nb_hits++; }
+      pv_entry->last_use = _sdcache_use_counter;
+      memcpy(pu8_buffer, pv_entry->data, SDCACHE_SECTOR_SIZE);
+      return RES_OK;
+    }
+
+    _sdcache_stats.nb_misses++;
+    if((res = _sdcache_pf_read(pu8_buffer, sector, count)) != RES_OK) { return res; }
+    _sdcache_stats.nb_sectors_read += count;
+    for(uint8_t i = 0; i < SDCACHE_NB_SECTORS; i++)
+    {
+      pv_entry = &_sdcache_entries[i];
+      if(pv_entry->sector != SDCACHE_NO_SECTOR &&
+	 pv_entry->sector >= sector && pv_entry->sector - sector < count)
+      {
+	memcpy(pu8_buffer + (pv_entry->sector - sector) * SDCACHE_SECTOR_SIZE,
+	       pv_entry->data, SDCACHE_SECTOR_SIZE);
+      }
+    }
+
+    return RES_OK;
+  }
+
+  /**
+   * Write sectors.
+   *
+   * Single sector writes are only written to the cache. Multiple sector writes are
+   * written directly to the card, after the dirty sectors of the previous epochs,
+   * and the cached copies of these sectors are updated.
+   *
+   * @param[in] pu8_data the data to write. MUST be NOT NULL.
+   * @param[in] sector   the first sector's address.
+   * @param[in] count    the number of sectors to write.
+   *
+   * @return RES_OK on success.
+   * @return an error code otherwise.
+   */
+  DRESULT sdcache_write(const BYTE *pu8_data, DWORD sector, UINT count)
+  {
+    SDCacheEntry *pv_entry;
+    DRESULT       res;
+
+    _sdcache_use_counter++;
+    if(count == 1)
+    {
+      // The whole sector is overwritten, so there is no need to read it first.
+      if(!(pv_entry = sdcache_find(sector)))
+      {
+	_sdcache_stats.nb_misses++;
+	if(!(pv_entry = sdcache_allocate(sector))) { return RES_ERROR; }
+      }
+      else { _sdcache_stats.nb_hits++; }
+      memcpy(pv_entry->data, pu8_data, SDCACHE_SECTOR_SIZE);
+      pv_entry->is_dirty = true;
+      pv_entry->epoch    = _sdcache_epoch;
+      pv_entry->last_use = _sdcache_use_counter;
+      return RES_OK;
+    }
+
+    // Written now, so after the previous epochs.
+    _sdcache_stats.nb_misses++;
+    if((res = sdcache_write_back_epochs(1))                 != RES_OK) { return res; }
+    if((res = _sdcache_pf_write(pu8_data, sector, count)) != RES_OK) { return res; }
+    sdcache_count_written(sector, count);
+    for(uint8_t i = 0; i < SDCACHE_NB_SECTORS; i++)
+    {
+      pv_entry = &_sdcache_entries[i];
+      if(pv_entry->sector != SDCACHE_NO_SECTOR &&
+	 pv_entry->sector >= sector && pv_entry->sector - sector < count)
+      {
+	memcpy(pv_entry->data, pu8_data + (pv_entry->sector - sector) * SDCACHE_SECTOR_SIZE,
+	       SDCACHE_SECTOR_SIZE);
+	pv_entry->is_dirty = false;
+      }
+    }
+
+    return RES_OK;
+  }
+
+  /**
+   * Start a new epoch: the sectors written after the call will be written to the card after
+   * the ones written before it. Nothing is written to the card now.
+   *
+   * A sector written again after the barrier, while it is still dirty, moves to the new epoch;
+   * its previous content is not written on its own.
+   */
+  void sdcache_barrier(void)
+  {
+    _sdcache_epoch++;
+  }
+
+  /**
+   * Write all the dirty sectors to the card; epoch by epoch, in increasing address order in each one.
+   *
+   * All the writes issued before the call are on the card when it returns.
+   *
+   * @return RES_OK on success.
+   * @return an error code otherwise; the sector that could not be written, and the ones that
+   *         come after it, remain dirty.
+   */
+  DRESULT sdcache_flush(void)
+  {
+    return sdcache_write_back_epochs(0);
+  }
+
+
+  /**
+   * Get the statistics.
+   *
+   * @return the statistics.
+   */
+  const SDCacheStats *sdcache_stats(void)
+  {
+    return &_sdcache_stats;
+  }
+
+  /**
+   * Reset the statistics.
+   */
+  void sdcache_stats_reset(void)
+  {
+    memset(&_sdcache_stats, 0, sizeof(_sdcache_stats));
+  }
+
+
+#ifdef __cplusplus
+}
+#endif
@@ -0,0 +1,71 @@
+/**
+ * Header for the SD card sector cache.
+ *
+ * A small write-back cache placed between the FAT layer and the SD card.
+ * Sectors are replaced using a least recently used policy, clean sectors first. Dirty sectors
+ * are only written to the card when they are evicted or when the cache is flushed.
+ *
+ * Barriers order the writes without writing anything: the sectors written between two barriers
+ * form an epoch, and the epochs are written to the card in order, whether by a flush or
+ * because one of their sectors is evicted. A sector written again in a later epoch, while it
+ * is still dirty, is only written once, with the later epoch.
+ *
+ * @date   2019
+ */
+#ifndef MODULES_SD_SDCACHE_H_
+#define MODULES_SD_SDCACHE_H_
+
+#include "defs.h"
+#include "ff.h"
+#include "diskio.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+
+#ifndef SDCACHE_NB_SECTORS
+#define SDCACHE_NB_SECTORS  8  ///< The number of sectors in the cache.
+#endif
+#ifndef SDCACHE_ERASE_BLOCK_NB_SECTORS
+#define SDCACHE_ERASE_BLOCK_NB_SECTORS  64  ///< The assumed card's erase block size, in sectors. Only used for statistics.
+#endif
+#define SDCACHE_SECTOR_SIZE  FF_MAX_SS
+
+
+  /**
+   * Defines the functions used to actually access the card.
+   * Any storage backend can be used, as long as it provides these functions.
+   */
+  typedef DRESULT (*SDCacheReadFunc)( BYTE       *pu8_buffer, DWORD sector, UINT count);
+  typedef DRESULT (*SDCacheWriteFunc)(const BYTE *pu8_data,   DWORD sector, UINT count);
+
+  /**
+   * Defines the cache statistics.
+   */
+  typedef struct SDCacheStats
+  {
+    uint32_t nb_sectors_read;     ///< The number of sectors read from the card.
+    uint32_t nb_sectors_written;  ///< The number of sectors written to the card.
+    uint32_t nb_hits;             ///< The number of sector requests served by the cache.
+    uint32_t nb_misses;           ///< The number of sector requests that had to access the card.
+    uint32_t nb_erase_blocks_written;  ///< The number of erase blocks written to; an estimate of the card's wear.
+  }
+  SDCacheStats;
+
+
+  extern void    sdcache_init(      SDCacheReadFunc pf_read, SDCacheWriteFunc pf_write);
+  extern DRESULT sdcache_read(      BYTE       *pu8_buffer, DWORD sector, UINT count);
+  extern DRESULT sdcache_write(     const BYTE *pu8_data,   DWORD sector, UINT count);
+  extern void    sdcache_barrier(   void);
+  extern DRESULT sdcache_flush(     void);
+  extern void    sdcache_invalidate(void);
+
+  extern const SDCacheStats *sdcache_stats(      void);
+  extern void                sdcache_stats_reset(void);
+
+
+#ifdef __cplusplus
+}
+#endif
+#endif /* MODULES_SD_SDCACHE_H_ */
@@ -6,8 +6,12 @@
  */
 #include <string.h>
 #include "sdcard.h"
+#include "sdcache.h"
 #include "ff_gen_drv.h"
 #include "gpio.h"
+#include "trace.h"
+#include "perfcounters.h"
+#include "powerandclocks.h"
 
 
 #ifdef __cplusplus
@@ -34,10 +38,16 @@ extern "C" {
   static SD_HandleTypeDef _sdcard_periph;  ///< The SD/MMC peripheral object
 
   static FATFS _sdcard_fatfs; ///< The FAT file system object for the SD card logical drive
+  static char  _sdcard_drive_path[4];  ///< The logical drive's path, set by the FatFs driver linking.
   static bool  _sdcard_ios_have_been_initialised   = false;
   static bool  _sdcard_periph_has_been_initialised = false;
   static bool  _sdcard_fat_has_been_initialised    = false;
 
+  static SDCardSeekStats _sdcard_seek_stats;  ///< The seek statistics.
+
+  /// The SDMMC kernel clock is the MSI; the bus clock dividers are computed for its 48 MHz.
+  static PwrClkRequirement _sdcard_pwrclk_req = { "SD card", PWRCLK_CLOCK_MSI, 0, NULL };
+
   static bool  sdcard_init_ios(     void);
   static void  sdcard_deinit_ios(   void);
   static bool  sdcard_init_periph(  void);
@@ -57,6 +67,8 @@ extern "C" {
 #if _USE_WRITE == 1
   DRESULT sdcard_diskio_write(BYTE lun, const BYTE *pu8_buffer, DWORD sector, UINT count);
 #endif
+  static DRESULT sdcard_read_sectors( BYTE       *pu8_buffer, DWORD sector, UINT count);
+  static DRESULT sdcard_write_sectors(const BYTE *pu8_data,   DWORD sector, UINT count);
 #if _USE_IOCTL == 1
   DRESULT sdcard_diskio_ioctl(BYTE lun, BYTE cmd, void *pv_buff);
 #endif
@@ -126,6 +138,7 @@ extern "C" {
    */
   void sdcard_deinit()
   {
+    sdcache_flush();
     sdcard_deinit_fat();
     sdcard_deinit_ios();
     sdcard_deinit_periph();
@@ -136,6 +149,9 @@ extern "C" {
    */
   void sdcard_sleep()
   {
+    // Write the cached sectors
+    sdcache_flush();
+
     // Gate SD peripheral clock.
     __HAL_RCC_SDMMC1_CLK_DISABLE();
 
@@ -147,6 +163,10 @@ extern "C" {
    */
   bool sdcard_wakeup()
   {
+    // Statistics are per wake.
+    sdcache_stats_reset();
+    sdcard_seek_stats_reset();
+
     // Enable peripheral clock
     __HAL_RCC_SDMMC1_CLK_ENABLE();
 
@@ -234,6 +254,7 @@ extern "C" {
     if(!sdcard_card_is_detected()) { goto error_exit; }
 
     // Enable peripheral clock
+    pwrclk_require(&_sdcard_pwrclk_req, PWRCLK_CLOCK_MSI, sdcard_periph_clock_freq_hz());
     __HAL_RCC_SDMMC1_CLK_ENABLE();
 
     // Set up NVIC for SDMMC1 interruptions
@@ -260,11 +281,13 @@ extern "C" {
     // The DMA channel will be initialised when needed.
 
     _sdcard_periph_has_been_initialised = true;
+    pwrclk_release(&_sdcard_pwrclk_req);
 
     exit:
     return true;
 
     error_exit:
+    pwrclk_release(&_sdcard_pwrclk_req);
     return false;
   }
 
@@ -573,7 +596,7 @@ extern "C" {
   }
 
   /**
-   * Read data from the SD card.
+   * Read data from the SD card, through the sector cache.
    *
    * @param[in]  lun        not used.
    * @param[out] pu8_buffer the buffer where the data are written to. MUST be NOT NULL.
@@ -585,10 +608,30 @@ extern "C" {
    * @return RES_ERROR otherwise.
    */
   DRESULT sdcard_diskio_read(BYTE lun, BYTE *pu8_buffer, DWORD sector, UINT count)
+  {
+    UNUSED(lun);
+
+    return sdcache_read(pu8_buffer, sector, count);
+  }
+
+  /**
+   * Actually read data from the SD card.
+   *
+   * @param[out] pu8_buffer the buffer where the data are written to. MUST be NOT NULL.
+   *                        MUST be big enough to receive all data.
+   * @param[in]  sector     sector address (LBA).
+   * @param[in]  count      number of sectors to read [1..128]
+   *
+   * @return RES_OK    on success.
+   * @return RES_ERROR otherwise.
+   */
+  static DRESULT sdcard_read_sectors(BYTE *pu8_buffer, DWORD sector, UINT count)
   {
     uint32_t ts_ref;
     uint32_t timeout_ms = count * 1000;
-    UNUSED(lun);
+    DRESULT  res        = RES_ERROR;
+
+    pwrclk_require(&_sdcard_pwrclk_req, PWRCLK_CLOCK_MSI, sdcard_periph_clock_freq_hz());
 
     // Read
     ts_ref = board_ms_now();
@@ -626,29 +669,50 @@ extern "C" {
     {
       if(board_is_timeout(ts_ref, timeout_ms)) { goto error_exit; }
     }
-    return RES_OK;
+    res = RES_OK;
 
     error_exit:
-    return RES_ERROR;
+    pwrclk_release(&_sdcard_pwrclk_req);
+    return res;
   }
 
 #if _USE_WRITE == 1
   /**
-   * Write data to the SD card
+   * Write data to the SD card, through the sector cache.
    *
    * @param[in] lun      unused.
    * @param[in] pu8_data the data to write. MUST be NOT NULL.
    * @param[in] sector   sector address (LBA).
    * @param[in] count    the number of sectors to write [1..128].
-   *g
+   *
    * @return RES_OK    on success.
    * @return RES_ERROR otherwise.
    */
   DRESULT sdcard_diskio_write(BYTE lun, const BYTE *pu8_data, DWORD sector, UINT count)
+  {
+    UNUSED(lun);
+
+    return sdcache_write(pu8_data, sector, count);
+  }
+#endif
+
+  /**
+   * Actually write data to the SD card.
+   *
+   * @param[in] pu8_data the data to write. MUST be NOT NULL.
+   * @param[in] sector   sector address (LBA).
+   * @param[in] count    the number of sectors to write [1..128].
+   *
+   * @return RES_OK    on success.
+   * @return RES_ERROR otherwise.
+   */
+  static DRESULT sdcard_write_sectors(const BYTE *pu8_data, DWORD sector, UINT count)
   {
     uint32_t ts_ref;
     uint32_t timeout_ms = count * 1000;
-    UNUSED(lun);
+    DRESULT  res        = RES_ERROR;
+
+    pwrclk_require(&_sdcard_pwrclk_req, PWRCLK_CLOCK_MSI, sdcard_periph_clock_freq_hz());
 
     // Write
     ts_ref = board_ms_now();
@@ -685,12 +749,12 @@ extern "C" {
     {
       if(board_is_timeout(ts_ref, timeout_ms)) { goto error_exit; }
     }
-    return RES_OK;
+    res = RES_OK;
 
     error_exit:
-    return RES_ERROR;
+    pwrclk_release(&_sdcard_pwrclk_req);
+    return res;
   }
-#endif
 
 #if _USE_IOCTL == 1
   /**
@@ -721,8 +785,9 @@ extern "C" {
     HAL_SD_GetCardInfo(&_sdcard_periph, &infos);
     switch(cmd)
     {
-      case CTRL_SYNC:        // Make sure that no pending write process
-	break;  // Do nothing
+      case CTRL_SYNC:        // Order the file's writes before the next ones; written at the latest when going to sleep
+	sdcache_barrier();
+	break;
 
       case GET_SECTOR_COUNT: // Get number of sectors on the disk (DWORD)
 	*(DWORD *)pv_buff = infos.LogBlockNbr;
@@ -758,7 +823,8 @@ extern "C" {
     if(_sdcard_fat_has_been_initialised) { goto exit; }
 
     // Link the drivers
-    if(FATFS_LinkDriver((Diskio_drvTypeDef *)&_sdcard_diskio, SDCARD_VOLUME_NAME) != 0)
+    sdcache_init(sdcard_read_sectors, sdcard_write_sectors);
+    if(FATFS_LinkDriver((Diskio_drvTypeDef *)&_sdcard_diskio, _sdcard_drive_path) != 0)
     {
       // Failed
       goto error_exit;
@@ -791,7 +857,9 @@ extern "C" {
       f_mount(NULL, SDCARD_VOLUME_NAME, 0);
 
       // Unregister drivers
-      FATFS_UnLinkDriver(SDCARD_VOLUME_NAME);
+      FATFS_UnLinkDriver(_sdcard_drive_path);
+
+      _sdcard_fat_has_been_initialised = false;
     }
   }
 
@@ -813,6 +881,21 @@ extern "C" {
     return f_stat(ps_filename, NULL) == FR_OK;
   }
 
+  /**
+   * Get a file's or a directory's information.
+   *
+   * @param[in]  ps_filename the name of the file or of the directory.
+   *                         MUST be NOT NULL and NOT EMPTY.
+   * @param[out] pv_info     where the information is written to. MUST be NOT NULL.
+   *
+   * @return true  on success.
+   * @return false if the file or the directory does not exist.
+   */
+  bool sdcard_stat(const char *ps_filename, FileInfo *pv_info)
+  {
+    return f_stat(ps_filename, pv_info) == FR_OK;
+  }
+
   /**
    * Create a directory.
    *
@@ -980,7 +1063,13 @@ extern "C" {
    */
   bool sdcard_fopen(File *pv_file, const char *ps_filename, FileOpenMode mode)
   {
-    return f_open(pv_file, ps_filename, sdcard_file_access_to_ff_file_access(mode)) == FR_OK;
+    bool res;
+
+    TRACE_BEGIN(TRACE_ID_SDCARD_OPEN);
+    res = f_open(pv_file, ps_filename, sdcard_file_access_to_ff_file_access(mode)) == FR_OK;
+    TRACE_END(  TRACE_ID_SDCARD_OPEN);
+
+    return res;
   }
 
   /**
@@ -1011,8 +1100,13 @@ extern "C" {
   bool sdcard_fread(File *pv_file, uint8_t *pu8_dest, uint32_t nb_to_read)
   {
     UINT nb_read;
+    bool res;
 
-    return f_read(pv_file, pu8_dest, nb_to_read, &nb_read) == FR_OK && nb_read == nb_to_read;
+    TRACE_BEGIN(TRACE_ID_SDCARD_READ);
+    res = f_read(pv_file, pu8_dest, nb_to_read, &nb_read) == FR_OK && nb_read == nb_to_read;
+    TRACE_END(  TRACE_ID_SDCARD_READ);
+
+    return res;
   }
 
   /**
@@ -1112,8 +1206,14 @@ extern "C" {
   bool sdcard_fwrite(File *pv_file, const uint8_t *pu8_data, uint32_t size)
   {
     UINT nb_written;
+    bool res;
+
+    TRACE_BEGIN(TRACE_ID_SDCARD_WRITE);
+    res = f_write(pv_file, pu8_data, size, &nb_written) == FR_OK && nb_written == size;
+    TRACE_END(  TRACE_ID_SDCARD_WRITE);
+    perfcounters_add(PERF_COUNTER_SD_BYTES_WRITTEN, nb_written);
 
-    return f_write(pv_file, pu8_data, size, &nb_written) == FR_OK && nb_written == size;
+    return res;
   }
 
   /**
@@ -1142,12 +1242,20 @@ extern "C" {
   bool sdcard_fwrite_byte(File *pv_file, uint8_t b)
   {
     UINT nb_written;
+    bool res;
+
+    res = f_write(pv_file, &b, 1, &nb_written) == FR_OK && nb_written == 1;
+    perfcounters_add(PERF_COUNTER_SD_BYTES_WRITTEN, nb_written);
 
-    return f_write(pv_file, &b, 1, &nb_written) == FR_OK && nb_written == 1;
+    return res;
   }
 
   /**
-   * Flushes the cache.
+   * Flushes the file's cached data and meta data.
+   *
+   * The sectors are written to the sector cache, followed by a barrier: they will be on the card
+   * before any sector written after the call, and at the latest once the card has gone to sleep,
+   * or on sdcard_flush().
    *
    * @param[in] pv_file the file descriptor to use. MUST be NOT NULL.
    *
@@ -1156,7 +1264,14 @@ extern "C" {
    */
   bool sdcard_fsync(File *pv_file)
   {
-    return f_sync(pv_file) == FR_OK;
+    bool res;
+
+    TRACE_BEGIN(TRACE_ID_SDCARD_SYNC);
+    res = f_sync(pv_file) == FR_OK;
+    TRACE_END(  TRACE_ID_SDCARD_SYNC);
+    perfcounters_add(PERF_COUNTER_SD_SYNCS, 1);
+
+    return res;
   }
 
   /**
@@ -1211,7 +1326,16 @@ extern "C" {
    */
   bool sdcard_fseek_abs(File *pv_file, uint32_t pos)
   {
-    return f_lseek(pv_file, pos) == FR_OK;
+    uint32_t start = HAL_GetTick();
+    bool     res   = f_lseek(pv_file, pos) == FR_OK;
+
+    _sdcard_seek_stats.nb_seeks++;
+#if FF_USE_FASTSEEK
+    if(pv_file->cltbl) { _sdcard_seek_stats.nb_fast_seeks++; }
+#endif
+    _sdcard_seek_stats.duration_ms += HAL_GetTick() - start;
+
+    return res;
   }
 
   /**
@@ -1235,6 +1359,93 @@ extern "C" {
     return sdcard_fseek_abs(pv_file, current_pos + step);
   }
 
+  /**
+   * Write all the sectors held in the cache to the card.
+   *
+   * The data written using files that have been synced are on the card when the call returns.
+   * Done when the card goes to sleep.
+   *
+   * @return true  on success.
+   * @return false otherwise.
+   */
+  bool sdcard_flush(void)
+  {
+    return sdcache_flush() == RES_OK;
+  }
+
+  /**
+   * Expand an empty file to a given size, using contiguous clusters.
+   *
+   * The expanded section is filled with UNKNOWN data.
+   *
+   * @param[in,out] pv_file the file descriptor to use. MUST be NOT NULL.
+   *                        The file MUST be empty and opened in write mode.
+   * @param[in]     size    the file's new size.
+   *
+   * @return true  on success.
+   * @return false if there is no contiguous space large enough, or in case of error.
+   */
+  bool sdcard_fexpand(File *pv_file, uint32_t size)
+  {
+#if FF_USE_EXPAND
+    return f_expand(pv_file, size, 1) == FR_OK;
+#else
+    (void)pv_file;
+    (void)size;
+    return false;
+#endif
+  }
+
+  /**
+   * Enable the fast seek mode on a file.
+   *
+   * In this mode a map of the file's cluster chain is used, so that seeks do not have to
+   * follow the chain in the FAT. The file's size cannot be expanded while in this mode.
+   * The mode is disabled when the file is closed.
+   *
+   * @param[in,out] pv_file      the file descriptor to use. MUST be NOT NULL.
+   * @param[out]    pu32_linkmap the buffer the cluster link map is written to.
+   *                             MUST be NOT NULL and MUST remain valid while the file is opened.
+   * @param[in]     size         the link map buffer's size, in number of items.
+   *                             2 items per file fragment, plus 1, are needed.
+   *
+   * @return true  on success.
+   * @return false if the buffer is too small or in case of error. Then the file is used normally.
+   */
+  bool sdcard_fenable_fast_seek(File *pv_file, DWORD *pu32_linkmap, uint32_t size)
+  {
+#if FF_USE_FASTSEEK
+    pv_file->cltbl  = pu32_linkmap;
+    pu32_linkmap[0] = size;
+    if(f_lseek(pv_file, CREATE_LINKMAP) == FR_OK) { return true; }
+    pv_file->cltbl  = NULL;
+#else
+    (void)pv_file;
+    (void)pu32_linkmap;
+    (void)size;
+#endif
+    return false;
+  }
+
+
+  /**
+   * Get the seek statistics.
+   *
+   * @return the statistics.
+   */
+  const SDCardSeekStats *sdcard_seek_stats(void)
+  {
+    return &_sdcard_seek_stats;
+  }
+
+  /**
+   * Reset the seek statistics.
+   */
+  void sdcard_seek_stats_reset(void)
+  {
+    memset(&_sdcard_seek_stats, 0, sizeof(_sdcard_seek_stats));
+  }
+
 
   /**
    * Find the first file, or directory, matching a given pattern
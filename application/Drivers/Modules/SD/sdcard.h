@@ -36,6 +36,17 @@ extern "C" {
   typedef DIR     Dir;
   typedef FILINFO FileInfo;
 
+  /**
+   * Defines the seek statistics; used to evaluate the cost of the seeks.
+   */
+  typedef struct SDCardSeekStats
+  {
+    uint32_t nb_seeks;       ///< The number of seeks.
+    uint32_t nb_fast_seeks;  ///< The number of seeks performed using a cluster link map.
+    uint32_t duration_ms;    ///< The total time spent seeking, in milliseconds.
+  }
+  SDCardSeekStats;
+
 
   extern bool sdcard_init();
   extern void sdcard_deinit();
@@ -44,6 +55,7 @@ extern "C" {
   extern bool sdcard_wakeup();
 
   extern bool sdcard_exists(              const char *ps_filename);
+  extern bool sdcard_stat(                const char *ps_filename, FileInfo *pv_info);
   extern bool sdcard_mkdir(               const char *ps_dirname);
   extern bool sdcard_check_and_mkdir(     const char *ps_dirname);
   extern bool sdcard_remove(              const char *ps_filename);
@@ -79,6 +91,12 @@ extern "C" {
   extern bool     sdcard_fseek_abs(    File *pv_file, uint32_t pos);
   extern bool     sdcard_fseek_rel(    File *pv_file, int32_t  step);
 #define sdcard_rewind(pv_file)  sdcard_fseek_abs(pv_file, 0)
+  extern bool     sdcard_flush(        void);
+  extern bool     sdcard_fexpand(      File *pv_file, uint32_t size);
+  extern bool     sdcard_fenable_fast_seek(File *pv_file, DWORD *pu32_linkmap, uint32_t size);
+
+  extern const SDCardSeekStats *sdcard_seek_stats(      void);
+  extern void                   sdcard_seek_stats_reset(void);
 
   extern const char *sdcard_ffind_first(Dir        *pv_dir,
 				        FileInfo   *pv_info,
@@ -244,16 +244,18 @@ void AlgadeAERTTSerial::receivedData(USART *pv_usart, uint8_t *pu8_data, uint32_
 bool AlgadeAERTTSerial::process()
 {
   ts2000_t ts2000;
+  uint16_t ms;
   bool     res = SensorUART::process();
 
   if(this->_hasDataToProcess)
   {
     // Save the interruption timestamp as soon as possible to avoid it to be overwritten.
     ts2000 = interruptionTimestamp();
+    ms     = interruptionTimestampMs();
     if(parseDataFrame(this->_dataBuffer, sizeof(this->_dataBuffer)))
     {
       setHasNewData();
-      ConnecSenS::instance()->saveSensorData(this, ts2000);
+      ConnecSenS::instance()->saveSensorData(this, ts2000, ms);
       log_debug_sensor(logger,
 		       "Received new data. Interruption timestamp = %lu, readings timestamp = %lu.",
 		       ts2000, readingsTimestamp());
@@ -433,12 +435,16 @@ const char **AlgadeAERTTSerial::csvHeaderValues()
 int32_t AlgadeAERTTSerial::csvDataSpecific(char *ps_data, uint32_t size)
 {
   uint32_t len;
+  char     temperature[STR_FIXED_SIZE_MAX];
+  char     voltage[    STR_FIXED_SIZE_MAX];
 
-  len = snprintf(ps_data, size, "%d%c%.1f%c%d%c%.2f%c%s",
+  len = snprintf(ps_data, size, "%d%c%s%c%d%c%s%c%s",
 		 (int)this->_radioactivityBqm3, OUTPUT_DATA_CSV_SEP,
-		 this->_airTemperatureDegC,     OUTPUT_DATA_CSV_SEP,
+		 strn_float_to_string(temperature, this->_airTemperatureDegC, 1, sizeof(temperature), false),
+		 OUTPUT_DATA_CSV_SEP,
 		 this->_airRelHumidityPercent,  OUTPUT_DATA_CSV_SEP,
-		 this->_voltageV,               OUTPUT_DATA_CSV_SEP,
+		 strn_float_to_string(voltage,     this->_voltageV,           2, sizeof(voltage),     false),
+		 OUTPUT_DATA_CSV_SEP,
 		 this->_heaterIsOn ? "ON" : "OFF");
 
   return len >= size ? -1 : (int32_t)len;
@@ -6,6 +6,7 @@
 
 #include <string.h>
 #include "batteryadc.hpp"
+#include "utils.h"
 #ifdef USE_SENSOR_BATTERY_ADC
 #include "cnssrf-dt_battvoltage.h"
 
@@ -105,12 +106,16 @@ bool BatteryADC::jsonSpecificHandler(const JsonObject& json)
 
 bool BatteryADC::readSpecific()
 {
+  char value[STR_FIXED_SIZE_MAX];
+
   if(!SensorADC::readSpecific()) { return false; }
 
   battery_set_voltage_mv(&this->_battery,
 			 (uint32_t)(adcValueMV(this->_adcLine) * this->_voltageDivider));
 
-  log_info_sensor(logger, "Battery voltage: %.2fV.", (float)battery_voltage_mv(&this->_battery) / 1000.0);
+  log_info_sensor(logger, "Battery voltage: %sV.",
+		  strn_double_to_string(value, battery_voltage_mv(&this->_battery) / 1000.0, 2, sizeof(value), false));
+  log_debug_sensor(logger, "ADC peak to peak noise: %umV.", (unsigned int)adcNoiseMV(this->_adcLine));
 
   return true;
 }
@@ -133,11 +138,11 @@ const char **BatteryADC::csvHeaderValues()
 
 int32_t BatteryADC::csvDataSpecific(char *ps_data, uint32_t size)
 {
-  uint32_t len;
+  char *pc;
 
-  len = snprintf(ps_data, size, "%.3f", battery_voltage_mv(&this->_battery) / 1000.0);
+  pc = strn_fixed_to_string(ps_data, battery_voltage_mv(&this->_battery), 3, size, true);
 
-  return len >= size ? -1 : (int32_t)len;
+  return pc == ps_data ? -1 : (int32_t)(pc - ps_data);
 }
 
 
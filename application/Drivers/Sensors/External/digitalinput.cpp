@@ -7,9 +7,14 @@
 #include "digitalinput.hpp"
 #ifdef USE_SENSOR_DIGITAL_INPUT
 #include <string.h>
+#include <math.h>
 #include "gpio.h"
 #include "board.h"
 #include "cnssrf-dt_gpio.h"
+#include "pulsecounter.h"
+
+
+#define DIGITAL_INPUT_PULSES_IRQ_PRIORITY  14
 
 
   CREATE_LOGGER(digitalinput);
@@ -26,6 +31,14 @@ const char *DigitalInput::_CSV_HEADER_VALUES[] =
     NULL
 };
 
+const char *DigitalInput::_CSV_HEADER_VALUES_PULSES[] =
+{
+    "digitalInput-id",
+    "digitalInput-state",
+    "digitalInput-pulses",
+    NULL
+};
+
 
 
 DigitalInput::DigitalInput() : Sensor(POWER_NONE, POWER_NONE, FEATURE_BASE)
@@ -33,11 +46,16 @@ DigitalInput::DigitalInput() : Sensor(POWER_NONE, POWER_NONE, FEATURE_BASE)
   this->_id        = 0;
   this->_state     = false;
   this->_pvExtPort = NULL;
+
+  this->_pulsesCounting = PULSES_COUNTING_NONE;
+  this->_pulses         = 0;
+  this->_lastPulseCount = 0;
+  this->_irqPulses      = 0;
 }
 
 DigitalInput::~DigitalInput()
 {
-  // Do nothing
+  stopCountingPulses();
 }
 
 Sensor *DigitalInput::getNewInstance()
@@ -55,14 +73,21 @@ bool DigitalInput::jsonSpecificHandler(const JsonObject& json)
 {
   const char *ps;
   int32_t     i32;
+  bool        countPulses;
+
+  stopCountingPulses();
+  countPulses = json["countPulses"].as<bool>();
 
-  // Get the GPIO pin to use
+  // Get the GPIO pin to use.
+  // When counting the pulses, the pins that can be used with the hardware pulse counter are also accepted.
   if(!(ps = json["useEXTPin"].as<const char *>()))
   {
     log_error_sensor(logger, "You must specify the configuration parameter 'useEXTPin'.");
     goto error_exit;
   }
-  if(!(this->_pvExtPort = extport_get_pininfos_with_functions(ps, EXTPORT_PIN_FN_DIGITAL_INPUT)))
+  this->_pvExtPort = countPulses ? extport_get_pininfos_with_functions(ps, EXTPORT_PIN_FN_PULSE_COUNTER) : NULL;
+  if(!this->_pvExtPort &&
+     !(this->_pvExtPort = extport_get_pininfos_with_functions(ps, EXTPORT_PIN_FN_DIGITAL_INPUT)))
   {
     log_error_sensor(logger, "There is no GPIO called '%s' that can be used as a digital input.", ps);
     goto error_exit;
@@ -85,6 +110,39 @@ bool DigitalInput::jsonSpecificHandler(const JsonObject& json)
     this->_id = (uint8_t)i32;
   }
 
+  // Count the pulses?
+  // They are not debounced, whatever the counting method; only for sources with clean edges.
+  if(countPulses)
+  {
+    // Use the hardware pulse counter if the pin can; the node is then not woken up by each pulse.
+    if((this->_pvExtPort->functions & EXTPORT_PIN_FN_PULSE_COUNTER) &&
+       pulsecounter_start(this->_pvExtPort->gpio, PULSE_COUNTER_EDGE_RISING, GPIO_NOPULL))
+    {
+      this->_pulsesCounting = PULSES_COUNTING_HARDWARE;
+      this->_lastPulseCount = 0;
+    }
+    else if(this->_pvExtPort->functions & EXTPORT_PIN_FN_INT_EDGE_RISING)
+    {
+      GPIO_InitTypeDef init;
+
+      gpio_use_gpio_with_id(this->_pvExtPort->gpio);
+      init.Alternate = 0;
+      init.Mode      = GPIO_MODE_IT_RISING;
+      init.Pull      = GPIO_NOPULL;
+      init.Speed     = GPIO_SPEED_FREQ_LOW;
+      HAL_GPIO_Init(gpio_hal_port_and_pin_from_id(this->_pvExtPort->gpio, &init.Pin), &init);
+      this->_irqPulses      = 0;
+      this->_pulsesCounting = PULSES_COUNTING_INTERRUPTION;
+      gpio_set_irq_handler_with_arg(this->_pvExtPort->gpio, DIGITAL_INPUT_PULSES_IRQ_PRIORITY,
+				    pulseIrqHandler, this);
+    }
+    else
+    {
+      log_error_sensor(logger, "The pulses on GPIO '%s' cannot be counted.", ps);
+      goto error_exit;
+    }
+  }
+
   return true;
 
   error_exit:
@@ -92,6 +150,39 @@ bool DigitalInput::jsonSpecificHandler(const JsonObject& json)
 }
 
 
+/**
+ * Stop counting the input's pulses.
+ */
+void DigitalInput::stopCountingPulses()
+{
+  switch(this->_pulsesCounting)
+  {
+    case PULSES_COUNTING_HARDWARE:
+      pulsecounter_stop(this->_pvExtPort->gpio);
+      break;
+
+    case PULSES_COUNTING_INTERRUPTION:
+      gpio_remove_irq_handler(this->_pvExtPort->gpio);
+      gpio_free_gpio_with_id( this->_pvExtPort->gpio);
+      break;
+
+    default:
+      break;
+  }
+  this->_pulsesCounting = PULSES_COUNTING_NONE;
+}
+
+/**
+ * Interruption handler called on each pulse, when the pulses are counted using the interruption.
+ *
+ * @param[in] pvArg the DigitalInput object.
+ */
+void DigitalInput::pulseIrqHandler(void *pvArg)
+{
+  ((DigitalInput *)pvArg)->_irqPulses++;
+}
+
+
 bool DigitalInput::openSpecific()
 {
   GPIO_InitTypeDef init;
@@ -100,6 +191,8 @@ bool DigitalInput::openSpecific()
   bool             ok = false;
 
   if(!_pvExtPort) { goto exit; }
+  // When the pulses are counted the pin is configured for it, and can already be read
+  if(this->_pulsesCounting != PULSES_COUNTING_NONE) { ok = true; goto exit; }
 
   // Configure GPIO as input
   pvPort         = gpio_hal_port_and_pin_from_id(this->_pvExtPort->gpio, &pin);
@@ -120,7 +213,7 @@ void DigitalInput::closeSpecific()
   GPIO_TypeDef *pvPort;
   uint32_t      pin;
 
-  if(!_pvExtPort) { goto exit; }
+  if(!_pvExtPort || this->_pulsesCounting != PULSES_COUNTING_NONE) { goto exit; }
 
   // Configure GPIO as input
   pvPort = gpio_hal_port_and_pin_from_id(this->_pvExtPort->gpio, &pin);
@@ -133,7 +226,7 @@ void DigitalInput::closeSpecific()
 bool DigitalInput::readSpecific()
 {
   GPIO_TypeDef *pvPort;
-  uint32_t      pin;
+  uint32_t      pin, count, primask;
   bool          ok = false;
 
   if(!_pvExtPort) { goto exit; }
@@ -143,11 +236,62 @@ bool DigitalInput::readSpecific()
   this->_state = (bool)HAL_GPIO_ReadPin(pvPort, pin);
   ok           = true;
 
+  // Get the pulses counted since the last reading
+  switch(this->_pulsesCounting)
+  {
+    case PULSES_COUNTING_HARDWARE:
+      count                 = pulsecounter_count(this->_pvExtPort->gpio);
+      this->_pulses         = count - this->_lastPulseCount;
+      this->_lastPulseCount = count;
+      break;
+
+    case PULSES_COUNTING_INTERRUPTION:
+      primask          = __get_PRIMASK();
+      __disable_irq();
+      this->_pulses    = this->_irqPulses;
+      this->_irqPulses = 0;
+      __set_PRIMASK(primask);
+      break;
+
+    default:
+      break;
+  }
+  if(this->_pulsesCounting != PULSES_COUNTING_NONE)
+  {
+    log_debug_sensor(logger, "%u pulses counted.", (unsigned int)this->_pulses);
+  }
+
   exit:
   return ok;
 }
 
 
+uint8_t DigitalInput::readingValues(float *pfValues, Aggregator::ValueKind *pvKinds, uint8_t nbMax)
+{
+  if(!nbMax) { return 0; }
+
+  pfValues[0] = this->_state ? 1.0 : 0.0;
+  pvKinds[0]  = Aggregator::VALUE_KIND_SCALAR;
+  if(this->_pulsesCounting == PULSES_COUNTING_NONE || nbMax < 2) { return 1; }
+
+  pfValues[1] = this->_pulses;
+  pvKinds[1]  = Aggregator::VALUE_KIND_COUNTER;
+
+  return 2;
+}
+
+void DigitalInput::setAggregatedValues(const float *pfValues, uint8_t nb)
+{
+  // With the mean the state is the one the input has been in most of the time;
+  // with the maximum the state is high if the input has been high at least once.
+  if(nb && !isnan(pfValues[0])) { this->_state = pfValues[0] >= 0.5; }
+  if(nb >= 2 && !isnan(pfValues[1]) && this->_pulsesCounting != PULSES_COUNTING_NONE)
+  {
+    this->_pulses = (uint32_t)pfValues[1];
+  }
+}
+
+
 bool DigitalInput::writeDataToCNSSRFDataFrameSpecific(CNSSRFDataFrame  *pvFrame)
 {
   return cnssrf_dt_gpio_write_state_single_with_id(pvFrame, this->_id, this->_state);
@@ -156,16 +300,26 @@ bool DigitalInput::writeDataToCNSSRFDataFrameSpecific(CNSSRFDataFrame  *pvFrame)
 
 const char **DigitalInput::csvHeaderValues()
 {
-  return _CSV_HEADER_VALUES;
+  return this->_pulsesCounting != PULSES_COUNTING_NONE ? _CSV_HEADER_VALUES_PULSES : _CSV_HEADER_VALUES;
 }
 
 int32_t DigitalInput::csvDataSpecific(char *ps_data, uint32_t size)
 {
   int32_t len;
 
-  len = snprintf(ps_data, size,
-		 "%u%c%u",
-		 this->_id, OUTPUT_DATA_CSV_SEP, (uint8_t)this->_state);
+  if(this->_pulsesCounting != PULSES_COUNTING_NONE)
+  {
+    len = snprintf(ps_data, size,
+		   "%u%c%u%c%u",
+		   this->_id, OUTPUT_DATA_CSV_SEP, (uint8_t)this->_state,
+		   OUTPUT_DATA_CSV_SEP, (unsigned int)this->_pulses);
+  }
+  else
+  {
+    len = snprintf(ps_data, size,
+		   "%u%c%u",
+		   this->_id, OUTPUT_DATA_CSV_SEP, (uint8_t)this->_state);
+  }
 
   return (uint32_t)len >= size ? -1 : len;
 }
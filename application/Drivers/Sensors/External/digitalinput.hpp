@@ -26,12 +26,18 @@ public:
 
 
 private:
+  void stopCountingPulses();
+  static void pulseIrqHandler(void *pvArg);
+
   bool openSpecific();
   void closeSpecific();
   bool readSpecific();
   bool jsonSpecificHandler(               const JsonObject& json);
   bool writeDataToCNSSRFDataFrameSpecific(CNSSRFDataFrame  *pvFrame);
 
+  uint8_t readingValues(      float *pfValues, Aggregator::ValueKind *pvKinds, uint8_t nbMax);
+  void    setAggregatedValues(const float *pfValues, uint8_t nb);
+
   const char **csvHeaderValues();
   int32_t      csvDataSpecific(char *ps_data, uint32_t size);
 
@@ -41,7 +47,24 @@ private:
   bool              _state;      ///< The input's state.
   const ExtPortPin *_pvExtPort;  ///< The node extension port used as digital input.
 
-  static const char *_CSV_HEADER_VALUES[];  ///< The CSV header values.
+  /**
+   * Defines how the input's pulses are counted.
+   */
+  typedef enum PulsesCounting
+  {
+    PULSES_COUNTING_NONE,        ///< The pulses are not counted.
+    PULSES_COUNTING_HARDWARE,    ///< The pulses are counted by the hardware pulse counter.
+    PULSES_COUNTING_INTERRUPTION ///< The pulses are counted using an interruption on each pulse.
+  }
+  PulsesCounting;
+
+  PulsesCounting    _pulsesCounting;   ///< How the pulses are counted.
+  uint32_t          _pulses;           ///< The number of pulses counted during the last reading period.
+  uint32_t          _lastPulseCount;   ///< The hardware pulse counter's value at the last reading.
+  volatile uint32_t _irqPulses;        ///< The number of pulses counted using the interruption since the last reading.
+
+  static const char *_CSV_HEADER_VALUES[];         ///< The CSV header values.
+  static const char *_CSV_HEADER_VALUES_PULSES[];  ///< The CSV header values, when the pulses are counted.
 };
 
 #endif // USE_SENSOR_DIGITAL_INPUT
@@ -8,8 +8,10 @@
 #include "gillmaximetsdi12.h"
 #ifdef USE_SENSOR_GILL_MAXIMET_SDI12
 #include <string.h>
+#include <math.h>
 #include "sdi12gen_standardcommands.h"
 #include "rtc.h"
+#include "utils.h"
 
 #define STATE_VERSION  2
 
@@ -413,6 +415,7 @@ bool GillMaximMetSDI12::readSpecific()
   uint8_t                 i;
   uint32_t                secsToMidnight, sensorDate;
   float                   precipitationMM;
+  char                    value[STR_FIXED_SIZE_MAX];
   CommandMId              cmdId;
   CommandMFlag            cmdFlag;
   StateSpecific          *pvState;
@@ -473,10 +476,10 @@ bool GillMaximMetSDI12::readSpecific()
   if(measurements & M_TOTAL_PRECIPITATION)
   {
     log_info_sensor(logger,
-		    "Time: %04d-%02d-%02dT%02d:%02d:%02d, Precipitation: %0.2fmm.",
+		    "Time: %04d-%02d-%02dT%02d:%02d:%02d, Precipitation: %smm.",
 		    this->_datetime.year,  this->_datetime.month,   this->_datetime.day,
 		    this->_datetime.hours, this->_datetime.minutes, this->_datetime.seconds,
-		    this->_precipitationMM);
+		    strn_float_to_string(value, this->_precipitationMM, 2, sizeof(value), false));
     precipitationMM = this->_precipitationMM;
     sensorDate      = this->_datetime.year * 10000 + this->_datetime.month * 100 + this->_datetime.day;
 
@@ -630,6 +633,87 @@ bool GillMaximMetSDI12::getMeasurementsFromCmdResponse(CommandMId          cmdId
 
 
 
+/**
+ * The measurements that can be aggregated, in the order used by readingValues().
+ * The precipitation is used twice: for the amount then for the period.
+ */
+const GillMaximMetSDI12::Measurements
+GillMaximMetSDI12::_AggregationMeasurements[GILL_MAXIMET_SDI12_NB_AGGREGATION_VALUES] =
+{
+    M_TEMPERATURE,              M_RELATIVE_HUMIDITY,       M_PRESSURE,
+    M_RELATIVE_WIND_DIRECTION,  M_RELATIVE_WIND_SPEED,
+    M_CORRECTED_WIND_DIRECTION, M_CORRECTED_WIND_SPEED,
+    M_TOTAL_PRECIPITATION,      M_TOTAL_PRECIPITATION,     M_SOLAR_RADIATION
+};
+
+/**
+ * How each of the values from readingValues() is aggregated.
+ */
+const Aggregator::ValueKind
+GillMaximMetSDI12::_AggregationKinds[GILL_MAXIMET_SDI12_NB_AGGREGATION_VALUES] =
+{
+    Aggregator::VALUE_KIND_SCALAR,        Aggregator::VALUE_KIND_SCALAR,  Aggregator::VALUE_KIND_SCALAR,
+    Aggregator::VALUE_KIND_DIRECTION_DEG, Aggregator::VALUE_KIND_SCALAR,
+    Aggregator::VALUE_KIND_DIRECTION_DEG, Aggregator::VALUE_KIND_SCALAR,
+    Aggregator::VALUE_KIND_COUNTER,       Aggregator::VALUE_KIND_DURATION, Aggregator::VALUE_KIND_SCALAR
+};
+
+uint8_t GillMaximMetSDI12::readingValues(float                 *pfValues,
+					 Aggregator::ValueKind *pvKinds,
+					     uint8_t                nbMax)
+{
+  uint8_t i;
+
+  if(nbMax < GILL_MAXIMET_SDI12_NB_AGGREGATION_VALUES) { return 0; }
+
+  pfValues[0] = this->_temperatureDegC;
+  pfValues[1] = this->_relHumidityPercent;
+  pfValues[2] = this->_pressureHPa;
+  pfValues[3] = this->_windDirectionDegRelative;
+  pfValues[4] = this->_windSpeedMPerSecRelative;
+  pfValues[5] = this->_windDirectionDegCorrected;
+  pfValues[6] = this->_windSpeedMPerSecCorrected;
+  pfValues[7] = this->_precipitationMM;
+  pfValues[8] = this->_precipitationPeriodSec;
+  pfValues[9] = this->_solarRadiationWPerM2;
+  for(i = 0; i < GILL_MAXIMET_SDI12_NB_AGGREGATION_VALUES; i++)
+  {
+    if(!(this->_measurementsWeGot & _AggregationMeasurements[i])) { pfValues[i] = NAN; }
+    pvKinds[i] = _AggregationKinds[i];
+  }
+
+  return GILL_MAXIMET_SDI12_NB_AGGREGATION_VALUES;
+}
+
+void GillMaximMetSDI12::setAggregatedValues(const float *pfValues, uint8_t nb)
+{
+  uint8_t i;
+
+  if(nb < GILL_MAXIMET_SDI12_NB_AGGREGATION_VALUES) { return; }
+
+  // Only keep the measurements we have got at least once during the aggregation window.
+  this->_measurementsWeGot = M_NONE;
+  for(i = 0; i < GILL_MAXIMET_SDI12_NB_AGGREGATION_VALUES; i++)
+  {
+    if(!isnan(pfValues[i])) { this->_measurementsWeGot |= _AggregationMeasurements[i]; }
+  }
+
+  if(this->_measurementsWeGot & M_TEMPERATURE)              { this->_temperatureDegC           = pfValues[0]; }
+  if(this->_measurementsWeGot & M_RELATIVE_HUMIDITY)        { this->_relHumidityPercent        = (uint8_t) (pfValues[1] + 0.5);       }
+  if(this->_measurementsWeGot & M_PRESSURE)                 { this->_pressureHPa               = pfValues[2]; }
+  if(this->_measurementsWeGot & M_RELATIVE_WIND_DIRECTION)  { this->_windDirectionDegRelative  = (uint16_t)(pfValues[3] + 0.5) % 360; }
+  if(this->_measurementsWeGot & M_RELATIVE_WIND_SPEED)      { this->_windSpeedMPerSecRelative  = pfValues[4]; }
+  if(this->_measurementsWeGot & M_CORRECTED_WIND_DIRECTION) { this->_windDirectionDegCorrected = (uint16_t)(pfValues[5] + 0.5) % 360; }
+  if(this->_measurementsWeGot & M_CORRECTED_WIND_SPEED)     { this->_windSpeedMPerSecCorrected = pfValues[6]; }
+  if(this->_measurementsWeGot & M_TOTAL_PRECIPITATION)
+  {
+    this->_precipitationMM        = pfValues[7];
+    this->_precipitationPeriodSec = (uint32_t)pfValues[8];
+  }
+  if(this->_measurementsWeGot & M_SOLAR_RADIATION)          { this->_solarRadiationWPerM2      = (uint32_t)(pfValues[9] + 0.5);       }
+}
+
+
 bool GillMaximMetSDI12::writeDataToCNSSRFDataFrameSpecific(CNSSRFDataFrame *pvFrame)
 {
   bool res = true;
@@ -775,7 +859,7 @@ int32_t GillMaximMetSDI12::csvDataSpecific(char *ps_data, uint32_t size)
   {
     if(this->_measurementsWeGot & M_TEMPERATURE)
     {
-      sprintf(values[len], "%.1f", this->_temperatureDegC);
+      strn_float_to_string(values[len], this->_temperatureDegC, 1, sizeof(values[0]), false);
     }
     len++;
   }
@@ -791,7 +875,7 @@ int32_t GillMaximMetSDI12::csvDataSpecific(char *ps_data, uint32_t size)
   {
     if(this->_measurementsWeGot & M_PRESSURE)
     {
-      sprintf(values[len], "%.3f", this->_pressureHPa);
+      strn_float_to_string(values[len], this->_pressureHPa, 3, sizeof(values[0]), false);
     }
     len++;
   }
@@ -807,7 +891,7 @@ int32_t GillMaximMetSDI12::csvDataSpecific(char *ps_data, uint32_t size)
   {
     if(this->_measurementsWeGot & M_RELATIVE_WIND_SPEED)
     {
-      sprintf(values[len], "%.3f", this->_windSpeedMPerSecRelative);
+      strn_float_to_string(values[len], this->_windSpeedMPerSecRelative, 3, sizeof(values[0]), false);
     }
     len++;
   }
@@ -823,7 +907,7 @@ int32_t GillMaximMetSDI12::csvDataSpecific(char *ps_data, uint32_t size)
   {
     if(this->_measurementsWeGot & M_CORRECTED_WIND_SPEED)
     {
-      sprintf(values[len], "%.3f", this->_windSpeedMPerSecCorrected);
+      strn_float_to_string(values[len], this->_windSpeedMPerSecCorrected, 3, sizeof(values[0]), false);
     }
     len++;
   }
@@ -831,7 +915,7 @@ int32_t GillMaximMetSDI12::csvDataSpecific(char *ps_data, uint32_t size)
   {
     if(this->_measurementsWeGot & M_TOTAL_PRECIPITATION)
     {
-      sprintf(values[len++], "%.2f", this->_precipitationMM);
+      strn_float_to_string(values[len++], this->_precipitationMM, 2, sizeof(values[0]), false);
       sprintf(values[len++], "%u",   (unsigned int)this->_precipitationPeriodSec);
     }
     else { len += 2; }
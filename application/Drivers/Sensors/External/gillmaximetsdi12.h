@@ -127,6 +127,8 @@ private:
 
 #define GILL_MAXIMET_SDI12_TYPE_SIZE   16  ///< The type returned by the sensor: "Gill-GMXxxx" or "Gill-GMXxxx-GPS"
 
+#define GILL_MAXIMET_SDI12_NB_AGGREGATION_VALUES  10  ///< The number of values that can be aggregated.
+
   /**
    * Defines the data type stored in the sensor's state file
    */
@@ -168,6 +170,9 @@ private:
   bool readSpecific();
   bool writeDataToCNSSRFDataFrameSpecific(CNSSRFDataFrame *pvFrame);
 
+  uint8_t readingValues(      float *pfValues, Aggregator::ValueKind *pvKinds, uint8_t nbMax);
+  void    setAggregatedValues(const float *pfValues, uint8_t nb);
+
   const char **csvHeaderValues();
   int32_t      csvDataSpecific(char *ps_data, uint32_t size);
 
@@ -199,6 +204,9 @@ private:
 
   StateSpecific _state;  ///< The sensor's state.
 
+  static const Measurements          _AggregationMeasurements[GILL_MAXIMET_SDI12_NB_AGGREGATION_VALUES];
+  static const Aggregator::ValueKind _AggregationKinds[       GILL_MAXIMET_SDI12_NB_AGGREGATION_VALUES];
+
   /**
    * List the measurements' infos.
    */
@@ -9,6 +9,7 @@
 #ifdef USE_SENSOR_INSITU_AQUATROLL_200_SDI12
 #include "sdi12gen_standardcommands.h"
 #include "units.h"
+#include "utils.h"
 #include "cnssrf-dt_solutionconductivity.h"
 #include "cnssrf-dt_pressure.h"
 #include "cnssrf-dt_temperature.h"
@@ -389,7 +390,7 @@ int32_t InSituAquaTROLL200SDI12::csvDataSpecific(char *ps_data, uint32_t size)
   len = 0;
   if(this->_readingFlags & READING_FLAG_TEMPERATURE)
   {
-    sprintf(values[len], "%.1f", this->_tempDegC);
+    strn_float_to_string(values[len], this->_tempDegC, 1, sizeof(values[0]), false);
   }
   len++;
   if(this->_readingFlags & READING_FLAG_CONDUCTIVITY)
@@ -397,12 +398,12 @@ int32_t InSituAquaTROLL200SDI12::csvDataSpecific(char *ps_data, uint32_t size)
     switch(this->_conductivityType)
     {
       case CNSSRF_DT_SOLUTION_CONDUCTIVITY_USCM:
-	sprintf(values[len],   "%.3f", this->_conductivity);
+	strn_float_to_string(values[len],   this->_conductivity, 3, sizeof(values[0]), false);
 	len += 2;
 	break;
 
       case CNSSRF_DT_SOLUTION_CONDUCTIVITY_MSCM:
-	sprintf(values[++len], "%.3f", this->_conductivity);
+	strn_float_to_string(values[++len], this->_conductivity, 3, sizeof(values[0]), false);
 	len++;
 	break;
 
@@ -417,12 +418,12 @@ int32_t InSituAquaTROLL200SDI12::csvDataSpecific(char *ps_data, uint32_t size)
     switch(this->_specificConductivityType)
     {
       case CNSSRF_DT_SOLUTION_SPECIFIC_CONDUCTIVITY_USCM:
-	sprintf(values[len],   "%.3f", this->_specificConductivity);
+	strn_float_to_string(values[len],   this->_specificConductivity, 3, sizeof(values[0]), false);
 	len += 2;
 	break;
 
       case CNSSRF_DT_SOLUTION_SPECIFIC_CONDUCTIVITY_MSCM:
-	sprintf(values[++len], "%.3f", this->_specificConductivity);
+	strn_float_to_string(values[++len], this->_specificConductivity, 3, sizeof(values[0]), false);
 	len++;
 	break;
 
@@ -434,12 +435,12 @@ int32_t InSituAquaTROLL200SDI12::csvDataSpecific(char *ps_data, uint32_t size)
   else { len += 2; }
   if(this->_readingFlags & READING_FLAG_LEVEL)
   {
-    sprintf(values[len], "%.3f", this->_levelM);
+    strn_float_to_string(values[len], this->_levelM, 3, sizeof(values[0]), false);
   }
   len++;
   if(this->_readingFlags & READING_FLAG_PRESSURE)
   {
-    sprintf(values[len++], "%.4f", this->_pressKPa);
+    strn_double_to_string(values[len++], this->_pressKPa, 4, sizeof(values[0]), false);
     strcpy( values[len++], this->_pressAbs ? "True" : "False");
   }
   else { len += 2; }
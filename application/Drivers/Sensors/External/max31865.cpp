@@ -11,6 +11,7 @@
 #include "max31865.hpp"
 #ifdef USE_SENSOR_MAX31865
 #include "logger.h"
+#include "utils.h"
 
 CREATE_LOGGER(  max31865);
 #undef  _logger
@@ -140,6 +141,7 @@ bool MAX31865::readSpecific() {
   uint8_t  u8, tryNum;
   uint16_t u16;
   float    rtdOhms;
+  char     value[STR_FIXED_SIZE_MAX];
 
   // Turn on VBias and clear faults
   u8 = this->_regConfig;
@@ -184,12 +186,14 @@ bool MAX31865::readSpecific() {
   // Compute RTD resistance
   u16   >>= 1; // Remove fault bit.
   rtdOhms = (((float)u16) / 32768.0) * refOhms();
-  log_debug_sensor(_logger, "RTD resistance is: %f Ohms.", rtdOhms);
+  log_debug_sensor(_logger, "RTD resistance is: %s Ohms.",
+		   strn_float_to_string(value, rtdOhms, 6, sizeof(value), false));
   // Convert resistance to temperature.
   if(!setRTDResistance(rtdOhms))  // Function is from parent class.
   {
     log_error_sensor(_logger, "Failed to convert RTD resistance of "
-		     "%f Ohms to temperature.", rtdOhms);
+		     "%s Ohms to temperature.",
+		     strn_float_to_string(value, rtdOhms, 6, sizeof(value), false));
     goto error_exit;
   }
 
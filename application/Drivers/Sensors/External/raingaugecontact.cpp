@@ -10,6 +10,7 @@
 #include "sdcard.h"
 #include "rtc.h"
 #include "cnssrf-dt_rain.h"
+#include "pulsecounter.h"
 
 
 #define STATE_VERSION  1
@@ -34,12 +35,19 @@ RainGaugeContact::RainGaugeContact() : Sensor(POWER_EXTERNAL_INT, POWER_EXTERNAL
   this->_readingMM          = 0.0;
   this->_readingDurationSec = 0;
   this->_tickIntFlag        = CNSSInt::INT_FLAG_NONE;
+  this->_pvTickPin          = NULL;
+  this->_lastTickCount      = 0;
 
   this->_hasAlarmSet               = false;
   this->_thresholdSetMMPerMinute   = 0.0;
   this->_thresholdClearMMPerMinute = 0.0;
 }
 
+RainGaugeContact::~RainGaugeContact()
+{
+  if(this->_pvTickPin) { pulsecounter_stop(this->_pvTickPin->gpio); }
+}
+
 Sensor *RainGaugeContact::getNewInstance()
 {
   return new RainGaugeContact();
@@ -74,21 +82,42 @@ Sensor::State *RainGaugeContact::defaultState(uint32_t *pu32_size)
  * @return false otherwise.
  */
 bool RainGaugeContact::checkIfIsInAlarmRange(StateSpecific &state, ts2000_t tsNow)
+{
+  // Get now timestamp if need; the rate is the one of the last tick.
+  if(!tsNow) { tsNow =  rtc_get_date_as_secs_since_2000(); }
+
+  return checkIfRateIsInAlarmRange(state, 1, state.tsLastTick, tsNow);
+}
+
+/**
+ * Check if the rain rate given by a number of ticks over a period of time is in the alarm range or not.
+ *
+ * @param[in,out] state   the state object containing the informations we need.
+ *                        The state object is updated to match the current alarm status.
+ * @param[in]     nbTicks the number of ticks.
+ * @param[in]     tsFrom  the timestamp of the period's start.
+ * @param[in]     tsNow   the timestamp for now; the period's end.
+ *
+ * @return true  if the rain rate is in the alarm range.
+ * @return false otherwise.
+ */
+bool RainGaugeContact::checkIfRateIsInAlarmRange(StateSpecific& state,
+						 uint32_t       nbTicks,
+						 ts2000_t       tsFrom,
+						 ts2000_t       tsNow)
 {
   bool alarm;
 
   if(!this->_hasAlarmSet) { return false; }
 
-  // Get now timestamp if need and check it against last tick.
-  if(!tsNow) { tsNow =  rtc_get_date_as_secs_since_2000(); }
-  if(tsNow <= state.tsLastTick)
+  if(tsNow <= tsFrom)
   {
     // Well keep the current state
     return state.base.isInAlarm;
   }
 
   // Compute rain rate and compare it to the alarm thresholds
-  float   rateMMPerMinute = (this->_mmPerTick * 60) / (tsNow - state.tsLastTick);
+  float   rateMMPerMinute = (nbTicks * this->_mmPerTick * 60) / (tsNow - tsFrom);
   alarm = rateMMPerMinute >  this->_thresholdSetMMPerMinute ||
       (   rateMMPerMinute >  this->_thresholdClearMMPerMinute && state.base.isInAlarm);
 
@@ -117,11 +146,19 @@ bool RainGaugeContact::readSpecific()
   StateSpecific *pvState;
   if(!(pvState = (StateSpecific *)state())) { return false; }
 
+  // Get the ticks counted by the hardware
+  if(this->_pvTickPin) { addCountedTicks(*pvState, tsNow); }
+
   // Update the reading values and the alarm
   bool res;
   if((res = updateReadings(*pvState, tsNow)))
   {
-    checkIfIsInAlarmRange( *pvState, tsNow);
+    if(this->_pvTickPin)
+    {
+      // The ticks are not timestamped; use the mean rate over the reading period.
+      checkIfRateIsInAlarmRange(*pvState, pvState->nbTicks, pvState->tsLastRead, tsNow);
+    }
+    else { checkIfIsInAlarmRange(*pvState, tsNow); }
   }
 
   // Update the state object
@@ -132,6 +169,25 @@ bool RainGaugeContact::readSpecific()
   return res;
 }
 
+/**
+ * Add the ticks counted by the hardware pulse counter since the last time to the state.
+ *
+ * @param[in,out] state the State object to update.
+ * @param[in]     tsNow the timestamp for now.
+ */
+void RainGaugeContact::addCountedTicks(StateSpecific& state, ts2000_t tsNow)
+{
+  uint32_t count = pulsecounter_count(this->_pvTickPin->gpio);
+  uint32_t nb    = count - this->_lastTickCount;
+
+  this->_lastTickCount = count;
+  if(nb)
+  {
+    state.nbTicks    += nb;
+    state.tsLastTick  = tsNow;
+  }
+}
+
 /**
  * Update the reading values using a State object contents.
  *
@@ -204,17 +260,6 @@ bool RainGaugeContact::jsonSpecificHandler(const JsonObject& json)
     log_error_sensor(logger, "The sensor specific parameter 'tickInterrupt' is required.");
     return false;
   }
-  CNSSInt::IntFlag tickFlag = CNSSInt::getFlagUsingName(psTickItName);
-  if(tickFlag == CNSSInt::INT_FLAG_NONE)
-  {
-    log_error_sensor(logger, "Unknown interrupt '%s' for parameter 'tickInterrupt'.", psTickItName);
-    return false;
-  }
-  if(isTriggerableBy(tickFlag))
-  {
-    log_error_sensor(logger, "The interruption '%s' set for 'tickInterrupt' cannot be one of these set by 'interruptChannel' or 'interruptChannels'.", psTickItName);
-    return false;
-  }
 
   // The debounce time
   if(!json["tickDebounceMs"].success())
@@ -224,6 +269,40 @@ bool RainGaugeContact::jsonSpecificHandler(const JsonObject& json)
   }
   uint32_t debounceMs = json["tickDebounceMs"].as<uint32_t>();
 
+  // The ticks are counted by the hardware pulse counter if the pin can be used with it
+  // and if they do not need debouncing; the node is then not woken up by each tick.
+  // The counter's glitch filter is far shorter than a contact's bounces, so the ticks
+  // of a contact, that must be debounced, are counted using interruptions.
+  const ExtPortPin *pvTickPin = extport_get_pininfos_with_functions(psTickItName, EXTPORT_PIN_FN_PULSE_COUNTER);
+  CNSSInt::IntFlag  tickFlag  = CNSSInt::INT_FLAG_NONE;
+  if(pvTickPin)
+  {
+    if(debounceMs)
+    {
+      log_error_sensor(logger, "The ticks on '%s' cannot be debounced; set 'tickDebounceMs' to 0 for a gauge with clean edges, or use an interruption.", psTickItName);
+      return false;
+    }
+    if(pvTickPin != this->_pvTickPin && !pulsecounter_is_available(pvTickPin->gpio))
+    {
+      log_error_sensor(logger, "The pulse counter for 'tickInterrupt' '%s' is already used.", psTickItName);
+      return false;
+    }
+  }
+  else
+  {
+    tickFlag = CNSSInt::getFlagUsingName(psTickItName);
+    if(tickFlag == CNSSInt::INT_FLAG_NONE)
+    {
+      log_error_sensor(logger, "Unknown interrupt '%s' for parameter 'tickInterrupt'.", psTickItName);
+      return false;
+    }
+    if(isTriggerableBy(tickFlag))
+    {
+      log_error_sensor(logger, "The interruption '%s' set for 'tickInterrupt' cannot be one of these set by 'interruptChannel' or 'interruptChannels'.", psTickItName);
+      return false;
+    }
+  }
+
   // The mm per tick
   if(!json["rainMMPerTick"].success())
   {
@@ -241,8 +320,29 @@ bool RainGaugeContact::jsonSpecificHandler(const JsonObject& json)
   // Set up the object.
   this->_mmPerTick   = mmPerTick;
   this->_tickIntFlag = tickFlag;
-  CNSSInt::instance()->setDebounce(CNSSInt::getIdUsingName(psTickItName), debounceMs);
-  setSpecificIntSensitivity(this->_tickIntFlag);
+  if(this->_pvTickPin && pvTickPin != this->_pvTickPin)
+  {
+    pulsecounter_stop(this->_pvTickPin->gpio);
+    this->_pvTickPin = NULL;
+  }
+  if(pvTickPin && pvTickPin == this->_pvTickPin) { /* Already counting */ }
+  else if(pvTickPin)
+  {
+    // The output pulls to the ground; the count starts from 0.
+    if(!pulsecounter_start(pvTickPin->gpio, PULSE_COUNTER_EDGE_FALLING, GPIO_PULLUP))
+    {
+      log_error_sensor(logger, "Failed to start the pulse counter.");
+      return false;
+    }
+    this->_pvTickPin     = pvTickPin;
+    this->_lastTickCount = 0;
+    log_info_sensor(logger, "Ticks on '%s' are counted by the hardware.", psTickItName);
+  }
+  else
+  {
+    CNSSInt::instance()->setDebounce(CNSSInt::getIdUsingName(psTickItName), debounceMs);
+    setSpecificIntSensitivity(this->_tickIntFlag);
+  }
 
   return true;
 }
@@ -296,13 +396,14 @@ const char **RainGaugeContact::csvHeaderValues()
 
 int32_t RainGaugeContact::csvDataSpecific(char *ps_data, uint32_t size)
 {
+  int32_t  res;
   uint32_t len;
 
-  len = snprintf(ps_data, size, "%.2f%c%u",
-		 this->_readingMM, OUTPUT_DATA_CSV_SEP,
-		 (unsigned int)this->_readingDurationSec);
+  if((res = csvMakeStringUsingFloatValues(ps_data, size, &this->_readingMM, 1, 2)) < 0) { return -1; }
+  len = snprintf(ps_data + res, size - res, "%c%u",
+		 OUTPUT_DATA_CSV_SEP, (unsigned int)this->_readingDurationSec);
 
-  return len >= size ? -1 : (int32_t)len;
+  return len >= size - res ? -1 : res + (int32_t)len;
 }
 
 
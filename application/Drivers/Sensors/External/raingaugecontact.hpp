@@ -2,6 +2,14 @@
  * Sensor class for rain gauges that use a contact to count rain amounts,
  * like tipping buckets rain gauges.
  *
+ * Sensor specific configuration parameters:
+ *  - 'tickInterrupt':  the interruption, or the extension port pin, the gauge's output is wired to;
+ *  - 'tickDebounceMs': the ticks' debounce time, in milliseconds;
+ *  - 'rainMMPerTick':  the rain amount per tick, in mm.
+ * The ticks are only counted by the hardware pulse counter, without waking the node up, if 'tickInterrupt'
+ * is the pulse counter's pin, 'ANA1', and 'tickDebounceMs' is 0; that is for gauges with clean edges only.
+ * A contact bounces and must be debounced: the node is then woken up at every tip, to count it.
+ *
  *  Created on: 29 mai 2018
  *      Author: Jérôme FUCHET
  */
@@ -11,6 +19,7 @@
 #include "config.h"
 #ifdef USE_SENSOR_RAIN_GAUGE_CONTACT
 #include "sensor.hpp"
+#include "extensionport.h"
 
 class RainGaugeContact : public Sensor
 {
@@ -35,6 +44,7 @@ private:
 
 public:
   RainGaugeContact();
+  ~RainGaugeContact();
   static Sensor *getNewInstance();
   const char    *type();
 
@@ -42,7 +52,9 @@ public:
 private:
   State *defaultState(uint32_t *pu32_size);
   bool   checkIfIsInAlarmRange(StateSpecific& state, ts2000_t tsNow = 0);
+  bool   checkIfRateIsInAlarmRange(StateSpecific& state, uint32_t nbTicks, ts2000_t tsFrom, ts2000_t tsNow);
   bool   updateReadings( const StateSpecific& state, ts2000_t tsNow = 0);
+  void   addCountedTicks(StateSpecific& state, ts2000_t tsNow);
 
   bool openSpecific();
   void closeSpecific();
@@ -62,6 +74,8 @@ private:
   float            _readingMM;          ///< The current reading, in millimeters of rain.
   uint32_t         _readingDurationSec; ///< The amount of time, in seconds, the rain amount corresponds to.
   CNSSInt::IntFlag _tickIntFlag;        ///< The tick interruption flag.
+  const ExtPortPin *_pvTickPin;         ///< The pin whose ticks are counted by the hardware pulse counter. NULL if the ticks are counted using interruptions.
+  uint32_t          _lastTickCount;     ///< The pulse counter's value when the ticks were last added to the state.
 
   bool  _hasAlarmSet;                ///< Indicate if an alarm is configured or not.
   float _thresholdSetMMPerMinute;    ///< The alarm threshold set rain intensity in millimeters per minute. Set to 0.0 if no threshold.
@@ -8,6 +8,7 @@
 #ifdef USE_SENSOR_SOIL_MOISTURE_WATERMARK_I2C
 #include "cnssrf-dt_soilmoisture.h"
 #include "sdcard.h"
+#include "utils.h"
 
 #define I2C_ADDRESS                                    0x20
 #define TIME_TO_WAIT_BETWEEN_READ_CMD_AND_RESPONSE_MS  2000
@@ -283,6 +284,7 @@ const char **SoilMoistureWatermakI2C::csvHeaderValues()
 int32_t SoilMoistureWatermakI2C::csvDataSpecific(char *ps_data, uint32_t size)
 {
   uint32_t    l, s;
+  char        temperature[STR_FIXED_SIZE_MAX];
   SensorData *pvSensorData;
   bool        firstValue;
   uint8_t     i;
@@ -297,10 +299,11 @@ int32_t SoilMoistureWatermakI2C::csvDataSpecific(char *ps_data, uint32_t size)
     }
 
     pvSensorData = &this->_sensorData[i];
-    l = snprintf(ps_data, s, "%u%c%u%c%.1f%c%u",
+    l = snprintf(ps_data, s, "%u%c%u%c%s%c%u",
 		 pvSensorData->depthCm,   OUTPUT_DATA_CSV_SEP,
 		 pvSensorData->centibars, OUTPUT_DATA_CSV_SEP,
-		 pvSensorData->tempDegC,  OUTPUT_DATA_CSV_SEP,
+		 strn_float_to_string(temperature, pvSensorData->tempDegC, 1, sizeof(temperature), false),
+		 OUTPUT_DATA_CSV_SEP,
 		 (unsigned int)pvSensorData->freqHz);
     if(l >= s) { goto error_exit; }
     ps_data   += l;
@@ -7,6 +7,7 @@
 #include "truebnersmt100sdi12.hpp"
 #ifdef USE_SENSOR_TRUEBNER_SMT100_SDI12
 #include "sdi12gen_standardcommands.h"
+#include "utils.h"
 
 #define TRUEBNER_RAW_DATA_TYPE_ID   0x1F
 
@@ -330,18 +331,18 @@ int32_t TruebnerSMT100SDI12::csvDataSpecific(char *ps_data, uint32_t size)
   len = 0;
   if(this->_measurementsToGet & MEASUREMENT_ID_WATER)
   {
-    sprintf(values[len], "%.1f", this->_waterPercent);
+    strn_float_to_string(values[len], this->_waterPercent, 1, sizeof(values[0]), false);
   }
 
   len++;
   if(this->_measurementsToGet & MEASUREMENT_ID_TEMPERATURE)
   {
-    sprintf(values[len], "%.2f", this->_temperatureDegC);
+    strn_float_to_string(values[len], this->_temperatureDegC, 2, sizeof(values[0]), false);
   }
   len++;
   if(this->_measurementsToGet & MEASUREMENT_ID_PERMITTIVITY)
   {
-    sprintf(values[len], "%.2f", this->_dielectricPermittivity);
+    strn_float_to_string(values[len], this->_dielectricPermittivity, 2, sizeof(values[0]), false);
   }
   len++;
   if(this->_measurementsToGet & MEASUREMENT_ID_RAW)
@@ -351,7 +352,7 @@ int32_t TruebnerSMT100SDI12::csvDataSpecific(char *ps_data, uint32_t size)
   len++;
   if(this->_measurementsToGet & MEASUREMENT_ID_VOLTAGE)
   {
-    sprintf(values[len], "%.2f", this->_voltageV);
+    strn_float_to_string(values[len], this->_voltageV, 2, sizeof(values[0]), false);
   }
   len++;
 
@@ -1,11 +1,18 @@
 
 #include <string.h>
+#include <math.h>
 #include "lis3dh.hpp"
 #include "connecsens.hpp"
 #include "board.h"
 
 #define LIS3DH_I2C_ADDRESS  0x32
 
+#define LIS3DH_FIFO_SIZE  32  // In samples
+
+#ifndef LIS3DH_FIFO_WATERMARK
+#define LIS3DH_FIFO_WATERMARK  24  // The FIFO level, in samples, that triggers the watermark interruption.
+#endif
+
 /**************************** REGISTER MAP ****************************/
 #define LIS3DH_REG_STATUS_REG_AUX                	0x07
 #define LIS3DH_REG_OUT_ADC1_L                    	0x08
@@ -122,6 +129,21 @@
 #define LIS3DH_CTRL_REG6_INT_ACTIVE_HIGH                        0x00
 #define LIS3DH_CTRL_REG6_INT_ACTIVE_LOW                         LIS3DH_CTRL_REG6_INT_POLARITY
 
+/************************* FIFO_CTRL_REG MASK ************************/
+#define LIS3DH_FIFO_CTRL_REG_BYPASS                             0x00
+#define LIS3DH_FIFO_CTRL_REG_FIFO                               0x40
+#define LIS3DH_FIFO_CTRL_REG_STREAM                             0x80
+#define LIS3DH_FIFO_CTRL_REG_STREAM_TO_FIFO                     0xC0
+#define LIS3DH_FIFO_CTRL_REG_TR_INT1                            0x00
+#define LIS3DH_FIFO_CTRL_REG_TR_INT2                            0x20
+#define LIS3DH_FIFO_CTRL_REG_FTH_MASK                           0x1F
+
+/************************** FIFO_SRC_REG MASK ************************/
+#define LIS3DH_FIFO_SRC_REG_WTM                                 0x80
+#define LIS3DH_FIFO_SRC_REG_OVRN_FIFO                           0x40
+#define LIS3DH_FIFO_SRC_REG_EMPTY                               0x20
+#define LIS3DH_FIFO_SRC_REG_FSS_MASK                            0x1F
+
 /*************************** STATUS_REG MASK *************************/
 #define LIS3DH_STATUS_REG_ZYXOR                			0x80
 #define LIS3DH_STATUS_REG_ZOR                  			0x40
@@ -195,6 +217,11 @@
 #define DEFAULT_SCALE  SCALE_2G
 
 
+  CREATE_LOGGER(lis3dh);
+#undef  logger
+#define logger  lis3dh
+
+
 /**
  * The CTRL configuration when no alarm is used.
  */
@@ -225,6 +252,22 @@ const uint8_t LIS3DH::_ctrlAlarm[8] =
     LIS3DH_CTRL_REG6_I2_NONE      | LIS3DH_CTRL_REG6_INT_ACTIVE_HIGH
 };
 
+/**
+ * The CTRL configuration when the stream mode is used.
+ * The data rate is set at runtime.
+ */
+const uint8_t LIS3DH::_ctrlStream[8] =
+{
+    0x10,   // CTRL_REG0: disable SDO/SA0 pull-up
+    0x00,   // TEMP_CFG_REG: no ADC, no temperature sensor.
+    LIS3DH_CTRL_REG1_POWER_DOWN  | LIS3DH_CTRL_REG1_ALL_AXIS,
+    LIS3DH_CTRL_REG2_HPM_NORMAL,
+    LIS3DH_CTRL_REG3_I1_WTM,
+    LIS3DH_CTRL_REG4_BLOCK       | LIS3DH_CTRL_REG4_BLE_LITTLE_ENDIAN | LIS3DH_CTRL_REG4_HIGHRES,
+    LIS3DH_CTRL_REG5_FIFO_ENABLE,
+    LIS3DH_CTRL_REG6_I2_NONE     | LIS3DH_CTRL_REG6_INT_ACTIVE_HIGH
+};
+
 /**
  * Get THS Step using Scale.
  */
@@ -237,6 +280,14 @@ const char *LIS3DH::_CSV_HEADER_VALUES[] =
     "xAccelerationG", "yAccelerationG", "zAccelerationG", NULL
 };
 
+const char *LIS3DH::_CSV_HEADER_VALUES_STREAM[] =
+{
+    "xMinAccelerationG", "yMinAccelerationG", "zMinAccelerationG",
+    "xMaxAccelerationG", "yMaxAccelerationG", "zMaxAccelerationG",
+    "xRMSAccelerationG", "yRMSAccelerationG", "zRMSAccelerationG",
+    "nbSamples",         "nbPeaks",           NULL
+};
+
 
 LIS3DH::LIS3DH() : SensorInternal(LIS3DH_I2C_ADDRESS, LITTLE_ENDIAN)
 {
@@ -244,6 +295,14 @@ LIS3DH::LIS3DH() : SensorInternal(LIS3DH_I2C_ADDRESS, LITTLE_ENDIAN)
   this->_alarmThresholdMg = 0;
   this->_scale            = DEFAULT_SCALE;
   this->_x_accel          = this->_y_accel = this->_z_accel = 0.0;
+
+  this->_streamODR             = 0;
+  this->_streamPeakThresholdMg = 0;
+  this->_nbSamples             = 0;
+  this->_nbPeaks               = 0;
+  memset(this->_minAccel, 0, sizeof(this->_minAccel));
+  memset(this->_maxAccel, 0, sizeof(this->_maxAccel));
+  memset(this->_rmsAccel, 0, sizeof(this->_rmsAccel));
 }
 
 Sensor *LIS3DH::getNewInstance()
@@ -263,15 +322,25 @@ bool LIS3DH::openSpecific()
   uint8_t data[8];
 
   // Copy the configuration adapted to the situation
-  if(this->_motionDetection) { memcpy(data, _ctrlAlarm,   sizeof(data)); }
-  else                       { memcpy(data, _ctrlNoAlarm, sizeof(data)); }
+  if(this->_streamODR)
+  {
+    memcpy(data, _ctrlStream, sizeof(data));
+    data[2] |= this->_streamODR;
+  }
+  else if(this->_motionDetection) { memcpy(data, _ctrlAlarm,   sizeof(data)); }
+  else                            { memcpy(data, _ctrlNoAlarm, sizeof(data)); }
 
   // Set the scale to use
   data[5] |= this->_scale << 4;
 
   // Configure device
-  if(!SensorI2C::openSpecific() || !iamLIS3DH() ||
-      !i2cMemWrite(LIS3DH_REG_CTRL_REG0 | LIS2DH_REG_ADDRESS_AUTO_INCREMENT, 1, data, sizeof(data)))
+  if(!SensorI2C::openSpecific() || !iamLIS3DH()) { goto error_exit; }
+  if(this->_streamODR)
+  {
+    if(!openStream(data)) { goto error_exit; }
+    return true;
+  }
+  if(!i2cMemWrite(LIS3DH_REG_CTRL_REG0 | LIS2DH_REG_ADDRESS_AUTO_INCREMENT, 1, data, sizeof(data)))
   { goto error_exit; }
 
   // Set up the alarm
@@ -288,14 +357,47 @@ bool LIS3DH::openSpecific()
   return true;
 
   error_exit:
+  SensorI2C::closeSpecific();
   return false;
 }
 
+/**
+ * Configure the device in stream mode.
+ *
+ * If the device is already streaming using the same configuration then it is left untouched,
+ * so that we do not lose the samples waiting in the FIFO.
+ *
+ * @param[in] pu8Ctrl the 8 CTRL registers values to use, from CTRL_REG0 to CTRL_REG6.
+ *
+ * @return true  on success.
+ * @return false otherwise.
+ */
+bool LIS3DH::openStream(uint8_t *pu8Ctrl)
+{
+  uint8_t current[8];
+  uint8_t v;
+  uint8_t fifoCtrl = LIS3DH_FIFO_CTRL_REG_STREAM | LIS3DH_FIFO_CTRL_REG_TR_INT1 |
+      (LIS3DH_FIFO_WATERMARK & LIS3DH_FIFO_CTRL_REG_FTH_MASK);
+
+  if(i2cMemRead(LIS3DH_REG_CTRL_REG0 | LIS2DH_REG_ADDRESS_AUTO_INCREMENT, 1, current, sizeof(current)) &&
+      memcmp(current, pu8Ctrl, sizeof(current)) == 0 &&
+      i2cReadByteFromRegister(LIS3DH_REG_FIFO_CTRL_REG, &v) && v == fifoCtrl)
+  {
+    return true;
+  }
+
+  // Configure the device then go through bypass mode to empty the FIFO before streaming.
+  this->_streamStats.reset();
+  return i2cMemWrite(LIS3DH_REG_CTRL_REG0 | LIS2DH_REG_ADDRESS_AUTO_INCREMENT, 1, pu8Ctrl, sizeof(current)) &&
+      i2cWriteByteToRegister(LIS3DH_REG_FIFO_CTRL_REG, LIS3DH_FIFO_CTRL_REG_BYPASS) &&
+      i2cWriteByteToRegister(LIS3DH_REG_FIFO_CTRL_REG, fifoCtrl);
+}
+
 void LIS3DH::closeSpecific()
 {
   uint8_t v;
 
-  if(!this->_motionDetection)
+  if(!this->_motionDetection && !this->_streamODR)
   {
     // Read from REFERENCE register before switching to power-down mode
     i2cReadByteFromRegister(LIS3DH_REG_REFERENCE, &v);
@@ -314,6 +416,13 @@ bool LIS3DH::readSpecific()
   uint16_t values[3];
   uint8_t  v;
 
+  if(this->_streamODR)
+  {
+    // Get the samples still in the FIFO then compute the statistics for the period.
+    if(!readFIFO()) { goto error_exit; }
+    return computeStreamStats();
+  }
+
   if(!this->_motionDetection)
   {
     // Set active
@@ -360,6 +469,89 @@ float LIS3DH::convertValueToAcceleration(uint16_t v)
   return res;
 }
 
+/**
+ * Convert a 12 bits value, in sensor counts, to an acceleration.
+ *
+ * @param[in] counts the value, in counts. Can be non integer, for RMS values for example.
+ *
+ * @return the acceleration, in g.
+ */
+float LIS3DH::convertCountsToAcceleration(float counts)
+{
+  return counts * (2u << this->_scale) / 2047.0;
+}
+
+
+/**
+ * Empty the FIFO and add its samples to the stream statistics.
+ *
+ * The FIFO is read using a single I2C transfer.
+ *
+ * @return true  on success.
+ * @return false otherwise.
+ */
+bool LIS3DH::readFIFO()
+{
+  int16_t samples[LIS3DH_FIFO_SIZE][3];
+  uint8_t src, nb, i;
+
+  if(!i2cReadByteFromRegister(LIS3DH_REG_FIFO_SRC_REG, &src)) { return false; }
+  if(src & LIS3DH_FIFO_SRC_REG_OVRN_FIFO)
+  {
+    // Some samples have been lost
+    this->_streamStats.addOverrun();
+    nb = LIS3DH_FIFO_SIZE;
+  }
+  else { nb = src & LIS3DH_FIFO_SRC_REG_FSS_MASK; }
+  if(!nb) { return true; }
+
+  // When the FIFO is enabled the register address wraps around from OUT_Z_H to OUT_X_L,
+  // so all the samples can be read in one go.
+  if(!i2cMemRead(LIS3DH_REG_OUT_X_L | LIS2DH_REG_ADDRESS_AUTO_INCREMENT, 1,
+		 (uint8_t *)samples, nb * sizeof(samples[0]))) { return false; }
+  for(i = 0; i < nb; i++) { this->_streamStats.add(samples[i]); }
+
+  // Keep the last sample as the current acceleration
+  this->_x_accel = convertValueToAcceleration((uint16_t)samples[nb - 1][0]);
+  this->_y_accel = convertValueToAcceleration((uint16_t)samples[nb - 1][1]);
+  this->_z_accel = convertValueToAcceleration((uint16_t)samples[nb - 1][2]);
+
+  return true;
+}
+
+/**
+ * Compute the reading values from the stream statistics then reset the statistics.
+ *
+ * @return true  on success.
+ * @return false if there is no sample to compute statistics from.
+ */
+bool LIS3DH::computeStreamStats()
+{
+  if(!this->_streamStats.nbSamples())
+  {
+    log_warn_sensor(logger, "No sample has been streamed since the last reading.");
+    return false;
+  }
+  if(this->_streamStats.nbOverruns())
+  {
+    log_warn_sensor(logger, "The FIFO has overflowed %u times; some samples have been lost.",
+		    (unsigned int)this->_streamStats.nbOverruns());
+  }
+
+  for(uint8_t i = 0; i < 3; i++)
+  {
+    this->_minAccel[i] = convertValueToAcceleration((uint16_t)this->_streamStats.min(i));
+    this->_maxAccel[i] = convertValueToAcceleration((uint16_t)this->_streamStats.max(i));
+    this->_rmsAccel[i] = convertCountsToAcceleration(this->_streamStats.rmsCounts(i));
+  }
+  this->_nbSamples = this->_streamStats.nbSamples() > UINT16_MAX ? UINT16_MAX : this->_streamStats.nbSamples();
+  this->_nbPeaks   = this->_streamStats.nbPeaks()   > UINT16_MAX ? UINT16_MAX : this->_streamStats.nbPeaks();
+
+  this->_streamStats.reset();
+  return true;
+}
+
+
 bool LIS3DH::iamLIS3DH()
 {
   uint8_t v;
@@ -385,9 +577,83 @@ bool LIS3DH::jsonAlarmSpecific(const JsonObject& json, CNSSInt::Interruptions *p
   return         this->_motionDetection;
 }
 
+bool LIS3DH::jsonSpecificHandler(const JsonObject& json)
+{
+  this->_streamODR = 0;
+  if(!json["streamRateHz"].success()) { return true; }
+
+  // Get the stream data rate
+  switch(json["streamRateHz"].as<uint32_t>())
+  {
+    case 1:   this->_streamODR = LIS3DH_CTRL_REG1_1HZ;   break;
+    case 10:  this->_streamODR = LIS3DH_CTRL_REG1_10HZ;  break;
+    case 25:  this->_streamODR = LIS3DH_CTRL_REG1_25HZ;  break;
+    case 50:  this->_streamODR = LIS3DH_CTRL_REG1_50HZ;  break;
+    case 100: this->_streamODR = LIS3DH_CTRL_REG1_100HZ; break;
+    case 200: this->_streamODR = LIS3DH_CTRL_REG1_200HZ; break;
+    case 400: this->_streamODR = LIS3DH_CTRL_REG1_400HZ; break;
+    default:
+      log_error_sensor(logger, "Parameter 'streamRateHz' must be one of 1, 10, 25, 50, 100, 200 or 400.");
+      return false;
+  }
+  if(this->_motionDetection)
+  {
+    log_error_sensor(logger, "The stream mode and the motion detection cannot be used at the same time.");
+    this->_streamODR = 0;
+    return false;
+  }
+
+  // Get the peak detection threshold
+  this->_streamPeakThresholdMg = json["peakThresholdMg"].as<uint16_t>();
+  this->_streamStats.setPeakThreshold(this->_streamPeakThresholdMg, 2u << this->_scale);
+  this->_streamStats.reset();
+
+  // The FIFO watermark interruption is used to empty the FIFO
+  setSpecificIntSensitivity(CNSSInt::LIS3DH_FLAG);
+
+  return true;
+}
+
+void LIS3DH::processInterruptionSpecific(CNSSInt::Interruptions ints)
+{
+  if(!this->_streamODR || !(ints & CNSSInt::LIS3DH_FLAG)) { return; }
+
+  if(!open() || !readFIFO()) { log_error_sensor(logger, "Failed to read the FIFO."); }
+  close();
+}
+
+
+uint8_t LIS3DH::readingValues(float *pfValues, Aggregator::ValueKind *pvKinds, uint8_t nbMax)
+{
+  // In stream mode the readings already are statistics over the reading period.
+  if(this->_streamODR || nbMax < 3) { return 0; }
+
+  pfValues[0] = this->_x_accel;
+  pfValues[1] = this->_y_accel;
+  pfValues[2] = this->_z_accel;
+  pvKinds[0]  = pvKinds[1] = pvKinds[2] = Aggregator::VALUE_KIND_SCALAR;
+
+  return 3;
+}
+
+void LIS3DH::setAggregatedValues(const float *pfValues, uint8_t nb)
+{
+  if(nb < 3) { return; }
+
+  this->_x_accel = pfValues[0];
+  this->_y_accel = pfValues[1];
+  this->_z_accel = pfValues[2];
+}
+
 
 bool LIS3DH::writeDataToCNSSRFDataFrameSpecific(CNSSRFDataFrame *pvFrame)
 {
+  if(this->_streamODR)
+  {
+    return cnssrf_dt_acceleration_write_3dg_stats_to_frame(
+	pvFrame, this->_minAccel, this->_maxAccel, this->_rmsAccel, this->_nbSamples, this->_nbPeaks);
+  }
+
   return cnssrf_dt_acceleration_write_3dg_to_frame(
       pvFrame, this->_x_accel, this->_y_accel, this->_z_accel);
 }
@@ -395,19 +661,33 @@ bool LIS3DH::writeDataToCNSSRFDataFrameSpecific(CNSSRFDataFrame *pvFrame)
 
 const char **LIS3DH::csvHeaderValues()
 {
-  return _CSV_HEADER_VALUES;
+  return this->_streamODR ? _CSV_HEADER_VALUES_STREAM : _CSV_HEADER_VALUES;
 }
 
 int32_t LIS3DH::csvDataSpecific(char *ps_data, uint32_t size)
 {
+  int32_t  res;
   uint32_t len;
 
-  len = snprintf(ps_data, size, "%f%c%f%c%f",
-		 this->_x_accel, OUTPUT_DATA_CSV_SEP,
-		 this->_y_accel, OUTPUT_DATA_CSV_SEP,
-		 this->_z_accel);
+  if(this->_streamODR)
+  {
+    float values[9] =
+    {
+	this->_minAccel[0], this->_minAccel[1], this->_minAccel[2],
+	this->_maxAccel[0], this->_maxAccel[1], this->_maxAccel[2],
+	this->_rmsAccel[0], this->_rmsAccel[1], this->_rmsAccel[2]
+    };
+
+    if((res = csvMakeStringUsingFloatValues(ps_data, size, values, 9, 6)) < 0) { return -1; }
+    len = snprintf(ps_data + res, size - res, "%c%u%c%u",
+		   OUTPUT_DATA_CSV_SEP, (unsigned int)this->_nbSamples,
+		   OUTPUT_DATA_CSV_SEP, (unsigned int)this->_nbPeaks);
+    return len >= size - res ? -1 : res + (int32_t)len;
+  }
+
+  float values[3] = { this->_x_accel, this->_y_accel, this->_z_accel };
 
-  return len >= size ? -1 : (int32_t)len;
+  return csvMakeStringUsingFloatValues(ps_data, size, values, 3, 6);
 }
 
 
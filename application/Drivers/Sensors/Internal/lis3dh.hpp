@@ -15,6 +15,7 @@
 #pragma once
 
 #include "sensor_internal.hpp"
+#include "lis3dhstreamstats.hpp"
 
 
 class LIS3DH : public SensorInternal
@@ -45,14 +46,24 @@ private:
   bool readSpecific();
   bool jsonAlarmSpecific(                 const JsonObject&       json,
 					  CNSSInt::Interruptions *pvAlarmInts);
+  bool jsonSpecificHandler(               const JsonObject&       json);
+  void processInterruptionSpecific(       CNSSInt::Interruptions  ints);
   bool writeDataToCNSSRFDataFrameSpecific(CNSSRFDataFrame        *pvFrame);
 
+  uint8_t readingValues(      float *pfValues, Aggregator::ValueKind *pvKinds, uint8_t nbMax);
+  void    setAggregatedValues(const float *pfValues, uint8_t nb);
+
   const char **csvHeaderValues();
   int32_t      csvDataSpecific(char *ps_data, uint32_t size);
 
   bool iamLIS3DH();
   void readIntRegister();
   float convertValueToAcceleration(uint16_t v);
+  float convertCountsToAcceleration(float counts);
+
+  bool openStream(uint8_t *pu8Ctrl);
+  bool readFIFO();
+  bool computeStreamStats();
 
 
 public:
@@ -65,12 +76,23 @@ private:
   float    _z_accel;
   bool     _motionDetection;
   uint16_t _alarmThresholdMg; ///< The alarm threshold in mg
+
+  uint8_t   _streamODR;              ///< The CTRL_REG1 data rate bits used in stream mode. 0 if stream mode is not used.
+  uint16_t  _streamPeakThresholdMg;  ///< A sample is counted as a peak if its norm differs from 1 g by more than this value, in mg.
+  LIS3DHStreamStats _streamStats;    ///< The statistics accumulated since the last reading.
+  float     _minAccel[3];            ///< The minimum accelerations, in g, computed at the last reading.
+  float     _maxAccel[3];            ///< The maximum accelerations, in g, computed at the last reading.
+  float     _rmsAccel[3];            ///< The RMS accelerations, in g, computed at the last reading.
+  uint16_t  _nbSamples;              ///< The number of samples used to compute the last reading's statistics.
+  uint16_t  _nbPeaks;                ///< The number of peaks counted for the last reading.
   I2C_HandleTypeDef hi2c;
 
   static const uint8_t _ctrlNoAlarm[8];
   static const uint8_t _ctrlAlarm[8];
+  static const uint8_t _ctrlStream[8];
   static const uint8_t _scaleToTHSStep[4];
 
   static const char   *_CSV_HEADER_VALUES[];
+  static const char   *_CSV_HEADER_VALUES_STREAM[];
 };
 
@@ -0,0 +1,89 @@
+/**
+ * Statistics of the accelerations streamed from the LIS3DH's FIFO.
+ *
+ * @date   2019
+ */
+#include <math.h>
+#include "lis3dhstreamstats.hpp"
+
+
+/**
+ * Set the peak detection threshold.
+ *
+ * @param[in] thresholdMg a sample is a peak if its norm differs from 1 g by more than this value, in mg.
+ *                        0 to not count any peak.
+ * @param[in] fullScaleG  the device's full scale, in g: 2, 4, 8 or 16.
+ */
+void LIS3DHStreamStats::setPeakThreshold(uint16_t thresholdMg, uint8_t fullScaleG)
+{
+  float countsPerMg, low, high;
+
+  if(!thresholdMg)
+  {
+    this->_peakLowSq  = 0;
+    this->_peakHighSq = UINT32_MAX;
+    return;
+  }
+
+  countsPerMg       = 2047.0 / fullScaleG / 1000.0;
+  low               = (1000.0 - thresholdMg) * countsPerMg;
+  high              = (1000.0 + thresholdMg) * countsPerMg;
+  this->_peakLowSq  = low < 0 ? 0 : (uint32_t)(low * low);
+  this->_peakHighSq = (uint32_t)(high * high);
+}
+
+/**
+ * Reset the statistics. The peak detection threshold is kept.
+ */
+void LIS3DHStreamStats::reset()
+{
+  for(uint8_t i = 0; i < 3; i++)
+  {
+    this->_axes[i].min          = INT16_MAX;
+    this->_axes[i].max          = INT16_MIN;
+    this->_axes[i].sumOfSquares = 0;
+  }
+  this->_nbSamples  = 0;
+  this->_nbPeaks    = 0;
+  this->_nbOverruns = 0;
+}
+
+/**
+ * Add a sample to the statistics.
+ *
+ * @param[in] ps16Sample the X, Y and Z raw values, as read from the device. MUST be NOT NULL.
+ */
+void LIS3DHStreamStats::add(const int16_t *ps16Sample)
+{
+  int32_t  v;
+  uint32_t normSq = 0;
+
+  for(uint8_t i = 0; i < 3; i++)
+  {
+    AxisStats *pvStats = &this->_axes[i];
+
+    if(ps16Sample[i] < pvStats->min) { pvStats->min = ps16Sample[i]; }
+    if(ps16Sample[i] > pvStats->max) { pvStats->max = ps16Sample[i]; }
+
+    v                      = ps16Sample[i] >> 4;  // The data are 12 bits left aligned
+    pvStats->sumOfSquares += (uint32_t)(v * v);
+    normSq                += (uint32_t)(v * v);
+  }
+  if(normSq < this->_peakLowSq || normSq > this->_peakHighSq) { this->_nbPeaks++; }
+  this->_nbSamples++;
+}
+
+/**
+ * Get the RMS value of an axis.
+ *
+ * @param[in] axis the axis: 0 for X, 1 for Y and 2 for Z.
+ *
+ * @return the RMS value, in 12 bits counts.
+ * @return 0 if there is no sample.
+ */
+float LIS3DHStreamStats::rmsCounts(uint8_t axis) const
+{
+  if(!this->_nbSamples) { return 0.0; }
+  return sqrtf((float)this->_axes[axis].sumOfSquares / this->_nbSamples);
+}
+
@@ -0,0 +1,57 @@
+/**
+ * Statistics of the accelerations streamed from the LIS3DH's FIFO.
+ *
+ * Kept apart from the driver so that they can be checked on the host.
+ *
+ * @date   2019
+ */
+#pragma once
+
+#include "defs.h"
+
+
+/**
+ * Minimum, maximum and RMS values, per axis, and number of peaks of a stream of LIS3DH samples.
+ *
+ * The samples are the raw X, Y and Z values read from the device: 12 bits values, left aligned.
+ * A sample is a peak if its norm differs from 1 g by more than a threshold;
+ * the comparison uses the squared norm, in counts, so that no square root is computed per sample.
+ */
+class LIS3DHStreamStats
+{
+public:
+  LIS3DHStreamStats() { setPeakThreshold(0, 2); reset(); }
+
+  void     setPeakThreshold(uint16_t thresholdMg, uint8_t fullScaleG);
+  void     reset();
+  void     add(const int16_t *ps16Sample);
+  void     addOverrun() { this->_nbOverruns++; }
+
+  uint32_t nbSamples()             const { return this->_nbSamples;  }
+  uint32_t nbPeaks()               const { return this->_nbPeaks;    }
+  uint32_t nbOverruns()            const { return this->_nbOverruns; }
+  int16_t  min(uint8_t axis)       const { return this->_axes[axis].min; }
+  int16_t  max(uint8_t axis)       const { return this->_axes[axis].max; }
+  float    rmsCounts(uint8_t axis) const;
+
+
+private:
+  /**
+   * Statistics accumulated, for one axis, over the samples.
+   */
+  typedef struct AxisStats
+  {
+    int16_t  min;          ///< The minimum raw value.
+    int16_t  max;          ///< The maximum raw value.
+    uint64_t sumOfSquares; ///< The sum of the squares of the 12 bits values.
+  }
+  AxisStats;
+
+  AxisStats _axes[3];     ///< The statistics for each axis.
+  uint32_t  _nbSamples;   ///< The number of samples.
+  uint32_t  _nbPeaks;     ///< The number of peaks.
+  uint32_t  _nbOverruns;  ///< The number of times the FIFO has overflowed.
+  uint32_t  _peakLowSq;   ///< Squared norm, in counts, under which a sample is a peak.
+  uint32_t  _peakHighSq;  ///< Squared norm, in counts, over which a sample is a peak.
+};
+
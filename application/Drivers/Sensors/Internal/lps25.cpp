@@ -58,18 +58,42 @@ const char *LPS25::type()
 }
 
 
+/**
+ * Trigger a one-shot measurement.
+ *
+ * @return true  on success.
+ * @return false otherwise.
+ */
+bool LPS25::startMeasurementSpecific()
+{
+  /* Reference absolue */
+  //  2. Turn on the pressure sensor analog front end in single shot mode  � WriteByte(CTRL_REG1_ADDR = 0x84); // @0x20 = 0x84
+  //  3. Run one-shot measurement (temperature and pressure), the set bit will be reset by the sensor itself after execution (self-clearing bit) � WriteByte(CTRL_REG2_ADDR = 0x01); // @0x21 = 0x01
+  return i2cWrite2BytesToRegister(LPS25_REG_RPDS_L | LPS25_REG_ADDRESS_AUTO_INCREMENT, 0) &&
+      i2cWriteByteToRegister(     LPS25_REG_CTRL1, 0x86)                                  &&
+      i2cWriteByteToRegister(     LPS25_REG_CTRL2, 0x01);
+}
+
+/**
+ * Indicate if the one-shot measurement is done.
+ *
+ * @return true  if it is done, or if we failed to communicate with the sensor.
+ * @return false if the measurement is in progress.
+ */
+bool LPS25::isReadySpecific()
+{
+  uint8_t u8;
+
+  return !i2cReadByteFromRegister(LPS25_REG_CTRL2, &u8) || !(u8 & 0x01);
+}
+
 bool LPS25::readSpecific()
 {
   uint32_t tickStart;
   uint8_t  temp        = 0xFF;
   uint32_t rawPressure = 0;
 
-  /* Reference absolue */
-  //  2. Turn on the pressure sensor analog front end in single shot mode  � WriteByte(CTRL_REG1_ADDR = 0x84); // @0x20 = 0x84
-  //  3. Run one-shot measurement (temperature and pressure), the set bit will be reset by the sensor itself after execution (self-clearing bit) � WriteByte(CTRL_REG2_ADDR = 0x01); // @0x21 = 0x01
-  if(!i2cWrite2BytesToRegister(LPS25_REG_RPDS_L | LPS25_REG_ADDRESS_AUTO_INCREMENT, 0) ||
-      !i2cWriteByteToRegister( LPS25_REG_CTRL1, 0x86)                                  ||
-      !i2cWriteByteToRegister( LPS25_REG_CTRL2, 0x01)) { goto error_exit; }
+  if(!measurementHasBeenStarted() && !startMeasurementSpecific()) { goto error_exit; }
 
   tickStart = HAL_GetTick();
   while(1)
@@ -158,11 +182,7 @@ const char **LPS25::csvHeaderValues()
 
 int32_t LPS25::csvDataSpecific(char *ps_data, uint32_t size)
 {
-  uint32_t len;
-
-  len = snprintf(ps_data, size, "%.3f", this->pressure);
-
-  return len >= size ? -1 : (int32_t)len;
+  return csvMakeStringUsingFloatValues(ps_data, size, &this->pressure, 1, 3);
 }
 
 
@@ -31,6 +31,8 @@ private:
   bool WhoAmI();
 
   bool readSpecific();
+  bool startMeasurementSpecific();
+  bool isReadySpecific();
   bool configAlertSpecific();
   bool jsonAlarmSpecific(                 const JsonObject&       json,
 					  CNSSInt::Interruptions *pvAlarmInts);
@@ -11,6 +11,7 @@
 #include "nodeinfo.h"
 #include "connecsens.hpp"
 #include "cnssrf.h"
+#include "utils.h"
 
 
 #ifndef BATT_VOLTAGE_LOW_THRESHOLD_V
@@ -189,10 +190,10 @@ const char **NodeBattery::csvHeaderValues()
 
 int32_t NodeBattery::csvDataSpecific(char *ps_data, uint32_t size)
 {
-  uint32_t len;
+  char *pc;
 
-  len = snprintf(ps_data, size, "%.3f", this->_voltageMV / 1000.0);
+  pc = strn_fixed_to_string(ps_data, this->_voltageMV, 3, size, true);
 
-  return len >= size ? -1 : (int32_t)len;
+  return pc == ps_data ? -1 : (int32_t)(pc - ps_data);
 }
 
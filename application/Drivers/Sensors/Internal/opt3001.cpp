@@ -97,6 +97,7 @@ const char *OPT3001::_CSV_HEADER_VALUES[] = { "illuminanceLux", NULL };
 OPT3001::OPT3001() : SensorInternal(I2C_ADDRESS, BIG_ENDIAN)
 {
   this->_illuminanceLux    = 0.0;
+  this->_conversionIsReady = false;
   this->_regCFGBase        =
       CFG_RANGE_AUTOMATIC     | CFG_CONV_TIME_800_MS | DEFAULT_FAULT_COUNT |
       CFG_INT_POL_ACTIVE_HIGH | CFG_INT_MODE_HYSTERESIS;
@@ -135,7 +136,46 @@ Sensor::State *OPT3001::defaultState(uint32_t *pu32_size)
 
 bool OPT3001::openSpecific()
 {
-  return SensorI2C::openSpecific() && iAmOPT3001();
+  if(SensorI2C::openSpecific() && iAmOPT3001()) { return true; }
+
+  SensorI2C::closeSpecific();
+  return false;
+}
+
+/**
+ * Trigger a conversion, if the sensor is not in continuous conversion mode.
+ *
+ * @return true  on success.
+ * @return false otherwise.
+ */
+bool OPT3001::startMeasurementSpecific()
+{
+  this->_conversionIsReady = false;
+
+  // Not continuous mode, so trigger conversion.
+  return (this->_regCFGBase & CFG_CONV_MODE_CONTINUOUS) ||
+      i2cWrite2BytesToRegister(REG_CONFIGURE, this->_regCFGBase | CFG_CONV_MODE_SINGLE_SHOT);
+}
+
+/**
+ * Indicate if the conversion is done.
+ *
+ * Reading the configuration register clears the conversion ready flag,
+ * so remember that we have seen it.
+ *
+ * @return true  if the conversion is done.
+ * @return false otherwise.
+ */
+bool OPT3001::isReadySpecific()
+{
+  uint16_t u16;
+
+  if(!this->_conversionIsReady)
+  {
+    this->_conversionIsReady = i2cRead2BytesFromRegister(REG_CONFIGURE, &u16) && (u16 & CFG_CONV_READY_FLAG);
+  }
+
+  return this->_conversionIsReady;
 }
 
 bool OPT3001::readSpecific()
@@ -146,19 +186,15 @@ bool OPT3001::readSpecific()
   this->_illuminanceLux = 0.0;
 
   // Start reading
-  if(!(this->_regCFGBase & CFG_CONV_MODE_CONTINUOUS))
-  {
-    // Not continuous mode, so trigger conversion.
-    if(!i2cWrite2BytesToRegister(REG_CONFIGURE, this->_regCFGBase | CFG_CONV_MODE_SINGLE_SHOT))
-    { goto error_exit; }
-  }
+  if(!measurementHasBeenStarted() && !startMeasurementSpecific()) { goto error_exit; }
 
   // Wait for result
   for(tickStart = HAL_GetTick(); 1; HAL_Delay(1))
   {
-    if(i2cRead2BytesFromRegister(REG_CONFIGURE, &u16) && (u16 & CFG_CONV_READY_FLAG)) { break; }
+    if(isReadySpecific()) { break; }
     if(HAL_GetTick() - tickStart > GET_READING_TIMEOUT_MS) { goto error_exit; }
   }
+  this->_conversionIsReady = false;
 
   // Get result
   if(!i2cRead2BytesFromRegister(REG_RESULT, &u16)) { goto error_exit; }
@@ -390,11 +426,7 @@ const char **OPT3001::csvHeaderValues()
 
 int32_t OPT3001::csvDataSpecific(char *ps_data, uint32_t size)
 {
-  uint32_t len;
-
-  len = snprintf(ps_data, size, "%.1f", this->_illuminanceLux);
-
-  return len >= size ? -1 : (int32_t)len;
+  return csvMakeStringUsingFloatValues(ps_data, size, &this->_illuminanceLux, 1, 1);
 }
 
 
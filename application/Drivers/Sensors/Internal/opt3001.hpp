@@ -31,6 +31,8 @@ public :
 private:
   bool openSpecific();
   bool readSpecific();
+  bool startMeasurementSpecific();
+  bool isReadySpecific();
   bool jsonAlarmSpecific(                 const JsonObject&       json,
 					  CNSSInt::Interruptions *pvAlarmInts);
   void processAlarmInterruption(          CNSSInt::Interruptions  ints);
@@ -57,6 +59,7 @@ private:
   bool      _useAlarm;            ///< Do we use the alarm functionality or not?
   bool      _useLowAlarm;         ///< Do we have low alarm parameters set?
   bool      _useHighAlarm;        ///< Do we have high alarm parameters set?
+  bool      _conversionIsReady;   ///< Has the conversion ready flag been seen since the conversion started?
   uint32_t  _regCFGBase;          ///< The base value for the OPT3001's configuration register.
   State     _state;               ///< The sensor's state object.
 
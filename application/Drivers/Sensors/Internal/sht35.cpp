@@ -8,6 +8,7 @@
 #define SHT35_I2C_ADDRESS  (0x44 << 1)
 #define repeatability      REPEATAB_MEDIUM
 #define SHT35_TIMEOUT      50
+#define SHT35_MEASUREMENT_DURATION_MS  7  // Maximum measurement duration for medium repeatability.
 #define frequency          FREQUENCY_HZ5
 #define mode               MODE_CLKSTRETCH
 
@@ -59,7 +60,8 @@ const char *SHT35::_CSV_HEADER_VALUES[] =
 SHT35::SHT35() : SensorInternal(SHT35_I2C_ADDRESS, BIG_ENDIAN)
 {
   this->_temperature  = this->_humidity = 0.0;
-  this->_serialNumber = 0;
+  this->_serialNumber       = 0;
+  this->_measurementStartMs = 0;
 }
 
 Sensor *SHT35::getNewInstance()
@@ -119,10 +121,13 @@ const char *SHT35::uniqueId()
 
 bool SHT35::openSpecific()
 {
-  return SensorI2C::openSpecific()         &&
+  if(SensorI2C::openSpecific()           &&
       readSerialNumber()                   &&
       setAlertLimits(&_DISABLE_THRESHOLDS) &&
-      clearAllAlertFlags();
+      clearAllAlertFlags()) { return true; }
+
+  SensorI2C::closeSpecific();
+  return false;
 }
 
 
@@ -130,10 +135,33 @@ bool SHT35::readSpecific()
 {
   bool res;
 
-  if((res = readPolling())) { setHasNewData(); }
+  res = measurementHasBeenStarted() ? fetchTempAndHumiPolling() : readPolling();
+  if(res) { setHasNewData(); }
   return res;
 }
 
+/**
+ * Start a measurement in polling mode; the I2C bus is not held during the conversion.
+ *
+ * @return true  on success.
+ * @return false otherwise.
+ */
+bool SHT35::startMeasurementSpecific()
+{
+  return startTempAndHumiPolling();
+}
+
+/**
+ * Indicate if the measurement is done, using the maximum measurement duration.
+ *
+ * @return true  if the measurement duration has elapsed.
+ * @return false otherwise.
+ */
+bool SHT35::isReadySpecific()
+{
+  return board_is_timeout(this->_measurementStartMs, SHT35_MEASUREMENT_DURATION_MS);
+}
+
 //=============================================================================
 // Puts SHT in AlertMode by setting thresholds and activate Periodic Measurement.
 //-----------------------------------------------------------------------------
@@ -190,13 +218,9 @@ const char **SHT35::csvHeaderValues()
 
 int32_t SHT35::csvDataSpecific(char *ps_data, uint32_t size)
 {
-  uint32_t len;
-
-  len = snprintf(ps_data, size, "%.1f%c%.1f",
-		 this->_temperature, OUTPUT_DATA_CSV_SEP,
-		 this->_humidity);
+  float values[2] = { this->_temperature, this->_humidity };
 
-  return len >= size ? -1 : (int32_t)len;
+  return csvMakeStringUsingFloatValues(ps_data, size, values, 2, 1);
 }
 
 
@@ -344,9 +368,18 @@ bool SHT35::getTempAndHumiClkStretch()
  */
 bool SHT35::getTempAndHumiPolling()
 {
-  Command  cmd;
-  uint8_t  to;
-  uint16_t data[2];
+  return startTempAndHumiPolling() && fetchTempAndHumiPolling();
+}
+
+/**
+ * Start a temperature and humidity measurement in polling mode.
+ *
+ * @return true  on success.
+ * @return false otherwise.
+ */
+bool SHT35::startTempAndHumiPolling()
+{
+  Command cmd;
 
   // start measurement in polling mode
   // use depending on the required repeatability, the corresponding command
@@ -355,9 +388,25 @@ bool SHT35::getTempAndHumiPolling()
     case REPEATAB_LOW:    cmd = CMD_MEAS_POLLING_L; break;
     case REPEATAB_MEDIUM: cmd = CMD_MEAS_POLLING_M; break;
     case REPEATAB_HIGH:   cmd = CMD_MEAS_POLLING_H; break;
-    default: goto error_exit;
+    default: return false;
   }
-  if(!writeCommand(cmd)) { goto error_exit; }
+  this->_measurementStartMs = board_ms_now();
+
+  return writeCommand(cmd);
+}
+
+/**
+ * Get the result of a measurement started with startTempAndHumiPolling().
+ *
+ * This function polls every 1ms until measurement is ready.
+ *
+ * @return true  on success.
+ * @return false otherwise.
+ */
+bool SHT35::fetchTempAndHumiPolling()
+{
+  uint8_t  to;
+  uint16_t data[2];
 
   // Poll every 1ms for measurement ready until timeout
   for(to = SHT35_TIMEOUT; to--; )
@@ -372,7 +421,6 @@ bool SHT35::getTempAndHumiPolling()
     HAL_Delay(1);
   }
 
-  error_exit:
   return false;
 }
 
@@ -144,6 +144,8 @@ public:
 private:
   bool openSpecific();
   bool readSpecific();
+  bool startMeasurementSpecific();
+  bool isReadySpecific();
   bool configAlertSpecific();
   bool jsonAlarmSpecific(                 const JsonObject&       json,
 					  CNSSInt::Interruptions *pvAlarmInts);
@@ -159,6 +161,8 @@ private:
   bool     readStatus(Status *pvStatus);
   bool     getTempAndHumiClkStretch();
   bool     getTempAndHumiPolling();
+  bool     startTempAndHumiPolling();
+  bool     fetchTempAndHumiPolling();
   bool     startPeriodicMeasurement();
   bool     enableHeater();
   bool     disableHeater();
@@ -183,6 +187,7 @@ private:
   float       _temperature;
   float       _humidity;
   AlertLimits _thresholds;
+  uint32_t    _measurementStartMs;  ///< When the last polling mode measurement has been started, in ms.
 
   static const char   *_CSV_HEADER_VALUES[];
 
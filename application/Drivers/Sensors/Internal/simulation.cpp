@@ -66,11 +66,7 @@ const char **Simulation::csvHeaderValues()
 
 int32_t Simulation::csvDataSpecific(char *ps_data, uint32_t size)
 {
-  uint32_t len;
+  float values[2] = { this->_temperatureDegC, this->_humidity };
 
-  len = snprintf(ps_data, size, "%.1f%c%.1f",
-		 this->_temperatureDegC, OUTPUT_DATA_CSV_SEP,
-		 this->_humidity);
-
-  return len >= size ? -1 : (int32_t)len;
+  return csvMakeStringUsingFloatValues(ps_data, size, values, 2, 1);
 }
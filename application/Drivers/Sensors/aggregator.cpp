@@ -0,0 +1,254 @@
+/**
+ * Aggregation of a sensor's readings over a time window.
+ *
+ * @date   2019
+ */
+#include <string.h>
+#include <math.h>
+#include "aggregator.hpp"
+#include "connecsens.hpp"
+#include "logger.h"
+
+
+  CREATE_LOGGER(aggregator);
+#undef  logger
+#define logger  aggregator
+
+
+/**
+ * Constructor.
+ */
+Aggregator::Aggregator()
+{
+  this->_function     = FUNCTION_MEAN;
+  this->_percentile   = 0.5;
+  this->_windowSec    = 0;
+  this->_windowEndTs  = 0;
+  this->_nbValues     = 0;
+  this->_pvStats      = NULL;
+  this->_pvDirections = NULL;
+  this->_pvQuantiles  = NULL;
+}
+
+/**
+ * Destructor.
+ */
+Aggregator::~Aggregator()
+{
+  release();
+}
+
+
+/**
+ * Set the configuration using a JSON object.
+ *
+ * The JSON object contains:
+ * - the window duration: windowSec, windowMn, windowHr or windowDay;
+ * - function:   "mean" (default), "min", "max", "stddev", "sum", "median" or "percentile";
+ * - percentile: the percentile to compute, in range [0..100], if function is "percentile".
+ *
+ * @param[in] json the JSON configuration object.
+ *
+ * @return true  on success.
+ * @return false otherwise.
+ */
+bool Aggregator::setConfiguration(const JsonObject& json)
+{
+  const char *psFunction;
+  float       percentile = 0.5;
+
+  release();
+  this->_windowSec = ConnecSenS::getPeriodSec(json, 0, NULL, "window");
+  if(!this->_windowSec)
+  {
+    log_error(logger, "The aggregation window duration is missing or is 0.");
+    goto error_exit;
+  }
+
+  psFunction = json["function"].as<const char *>();
+  if(     !psFunction || !*psFunction ||
+          strcasecmp(psFunction, "mean")   == 0) { this->_function = FUNCTION_MEAN;   }
+  else if(strcasecmp(psFunction, "min")    == 0) { this->_function = FUNCTION_MIN;    }
+  else if(strcasecmp(psFunction, "max")    == 0) { this->_function = FUNCTION_MAX;    }
+  else if(strcasecmp(psFunction, "stddev") == 0) { this->_function = FUNCTION_STDDEV; }
+  else if(strcasecmp(psFunction, "sum")    == 0) { this->_function = FUNCTION_SUM;    }
+  else if(strcasecmp(psFunction, "median") == 0) { this->_function = FUNCTION_PERCENTILE; }
+  else if(strcasecmp(psFunction, "percentile") == 0)
+  {
+    this->_function = FUNCTION_PERCENTILE;
+    percentile      = json["percentile"].as<float>();
+    if(!json["percentile"].success() || percentile < 0 || percentile > 100)
+    {
+      log_error(logger, "Aggregation parameter 'percentile' is mandatory and must be in range [0..100].");
+      goto error_exit;
+    }
+    percentile /= 100.0;
+  }
+  else
+  {
+    log_error(logger, "Unknown aggregation function '%s'.", psFunction);
+    goto error_exit;
+  }
+  this->_percentile = percentile;
+
+  return true;
+
+  error_exit:
+  return false;
+}
+
+
+/**
+ * Allocate the statistics objects for a given number of values.
+ *
+ * @param[in] nb the number of values.
+ *
+ * @return true  on success.
+ * @return false otherwise.
+ */
+bool Aggregator::allocate(uint8_t nb)
+{
+  if(nb == this->_nbValues && this->_pvStats) { return true; }
+
+  release();
+  if(nb > AGGREGATOR_NB_VALUES_MAX) { goto error_exit; }
+
+  this->_pvStats      = new RunningStats[  nb];
+  this->_pvDirections = new DirectionStats[nb];
+  if(this->_function == FUNCTION_PERCENTILE)
+  {
+    this->_pvQuantiles = new P2Quantile[nb];
+    if(!this->_pvQuantiles) { goto error_exit; }
+    for(uint8_t i = 0; i < nb; i++) { this->_pvQuantiles[i].setQuantile(this->_percentile); }
+  }
+  if(!this->_pvStats || !this->_pvDirections) { goto error_exit; }
+  this->_nbValues = nb;
+
+  return true;
+
+  error_exit:
+  log_error(logger, "Failed to allocate the aggregation for %u values.", nb);
+  release();
+  return false;
+}
+
+/**
+ * Release the statistics objects.
+ */
+void Aggregator::release()
+{
+  if(this->_pvStats)      { delete[] this->_pvStats;      this->_pvStats      = NULL; }
+  if(this->_pvDirections) { delete[] this->_pvDirections; this->_pvDirections = NULL; }
+  if(this->_pvQuantiles)  { delete[] this->_pvQuantiles;  this->_pvQuantiles  = NULL; }
+  this->_nbValues    = 0;
+  this->_windowEndTs = 0;
+}
+
+
+/**
+ * Forget the values accumulated and the current window.
+ */
+void Aggregator::reset()
+{
+  for(uint8_t i = 0; i < this->_nbValues; i++)
+  {
+    this->_pvStats[     i].reset();
+    this->_pvDirections[i].reset();
+    if(this->_pvQuantiles) { this->_pvQuantiles[i].reset(); }
+  }
+  this->_windowEndTs = 0;
+}
+
+/**
+ * Add a set of reading values.
+ *
+ * @param[in] pfValues the values. A NaN value means that the value is not available. MUST be NOT NULL.
+ * @param[in] pvKinds  the values' kinds. MUST be NOT NULL.
+ * @param[in] nb       the number of values. MUST be the same for each call.
+ * @param[in] ts       the readings' timestamp.
+ */
+void Aggregator::add(const float *pfValues, const ValueKind *pvKinds, uint8_t nb, ts2000_t ts)
+{
+  if(!allocate(nb)) { return; }
+
+  // Start a new window if there is none, or if we have missed the end of the current one.
+  if(!this->_windowEndTs || ts >= this->_windowEndTs + this->_windowSec)
+  {
+    reset();
+    this->_windowEndTs = ts + this->_windowSec;
+  }
+
+  for(uint8_t i = 0; i < nb; i++)
+  {
+    this->_kinds[i] = pvKinds[i];
+    if(pvKinds[i] == VALUE_KIND_DIRECTION_DEG) { this->_pvDirections[i].add(pfValues[i]); }
+    else                                       { this->_pvStats[     i].add(pfValues[i]); }
+    if(this->_pvQuantiles)                     { this->_pvQuantiles[ i].add(pfValues[i]); }
+  }
+}
+
+/**
+ * Indicate if the current window is over.
+ *
+ * @param[in] ts the timestamp for now.
+ *
+ * @return true  if the window is over.
+ * @return false otherwise, or if no window has been started.
+ */
+bool Aggregator::windowIsOver(ts2000_t ts) const
+{
+  return this->_windowEndTs && ts >= this->_windowEndTs;
+}
+
+/**
+ * Get the aggregated values then start the next window.
+ *
+ * @param[out] pfValues where the aggregated values are written to. A value is NaN if
+ *                      no reading was available for it in the window. MUST be NOT NULL.
+ * @param[in]  nbMax    the maximum number of values that can be written to pfValues.
+ *
+ * @return the number of values written.
+ */
+uint8_t Aggregator::results(float *pfValues, uint8_t nbMax)
+{
+  uint8_t i;
+
+  for(i = 0; i < this->_nbValues && i < nbMax; i++)
+  {
+    const RunningStats& stats = this->_pvStats[i];
+
+    switch(this->_kinds[i])
+    {
+      case VALUE_KIND_DIRECTION_DEG:
+	pfValues[i] = this->_function == FUNCTION_STDDEV ?
+	    this->_pvDirections[i].stddev() : this->_pvDirections[i].mean();
+	break;
+
+      case VALUE_KIND_COUNTER:
+      case VALUE_KIND_DURATION:
+	pfValues[i] = stats.count() ? stats.sum() : NAN;
+	break;
+
+      default:
+	switch(this->_function)
+	{
+	  case FUNCTION_MIN:        pfValues[i] = stats.min();                     break;
+	  case FUNCTION_MAX:        pfValues[i] = stats.max();                     break;
+	  case FUNCTION_STDDEV:     pfValues[i] = stats.stddev();                  break;
+	  case FUNCTION_SUM:        pfValues[i] = stats.count() ? stats.sum() : NAN; break;
+	  case FUNCTION_PERCENTILE: pfValues[i] = this->_pvQuantiles[i].value();   break;
+	  default:                  pfValues[i] = stats.mean();                    break;
+	}
+	break;
+    }
+  }
+  log_debug(logger, "%u values aggregated over %u seconds.",
+	    (unsigned int)i, (unsigned int)this->_windowSec);
+
+  // Start the next window right after the current one, to stay aligned.
+  ts2000_t nextEndTs = this->_windowEndTs + this->_windowSec;
+  reset();
+  this->_windowEndTs = nextEndTs;
+
+  return i;
+}
@@ -0,0 +1,82 @@
+/**
+ * Aggregation of a sensor's readings over a time window.
+ *
+ * The readings are accumulated using constant memory statistics and, at the end of the window,
+ * a single aggregated value is produced for each reading value.
+ *
+ * @date   2019
+ */
+#ifndef SENSORS_AGGREGATOR_HPP_
+#define SENSORS_AGGREGATOR_HPP_
+
+#include "defs.h"
+#include "json.hpp"
+#include "datetime.h"
+#include "runningstats.hpp"
+
+
+#define AGGREGATOR_NB_VALUES_MAX  12  ///< The maximum number of values a sensor can aggregate.
+
+
+class Aggregator
+{
+public:
+  /**
+   * Defines the aggregation functions.
+   */
+  typedef enum Function
+  {
+    FUNCTION_MEAN,
+    FUNCTION_MIN,
+    FUNCTION_MAX,
+    FUNCTION_STDDEV,
+    FUNCTION_SUM,
+    FUNCTION_PERCENTILE   ///< Also used for the median.
+  }
+  Function;
+
+  /**
+   * Defines how a reading value is to be aggregated.
+   */
+  typedef enum ValueKind
+  {
+    VALUE_KIND_SCALAR,         ///< Aggregated using the configured function.
+    VALUE_KIND_DIRECTION_DEG,  ///< A direction, in degrees. Vector averaged, or its standard deviation.
+    VALUE_KIND_COUNTER,        ///< An amount or a count. Always summed. Always reported when not 0.
+    VALUE_KIND_DURATION        ///< The duration a counter corresponds to. Always summed.
+  }
+  ValueKind;
+
+
+public:
+  Aggregator();
+  ~Aggregator();
+
+  bool     setConfiguration(const JsonObject& json);
+  uint32_t windowSec() const { return this->_windowSec; }
+  Function function()  const { return this->_function;  }
+
+  void     reset();
+  void     add(const float *pfValues, const ValueKind *pvKinds, uint8_t nb, ts2000_t ts);
+  bool     windowIsOver(ts2000_t ts) const;
+  uint8_t  results(float *pfValues, uint8_t nbMax);
+
+
+private:
+  bool     allocate(uint8_t nb);
+  void     release();
+
+
+private:
+  Function        _function;     ///< The aggregation function.
+  float           _percentile;   ///< The percentile to compute, in range [0..1], if function is FUNCTION_PERCENTILE.
+  uint32_t        _windowSec;    ///< The aggregation window's duration, in seconds.
+  ts2000_t        _windowEndTs;  ///< The current window's end timestamp. 0 if no window has been started.
+  uint8_t         _nbValues;     ///< The number of values aggregated.
+  ValueKind       _kinds[AGGREGATOR_NB_VALUES_MAX]; ///< The kind of each value.
+  RunningStats   *_pvStats;      ///< The scalar statistics; one per value.
+  DirectionStats *_pvDirections; ///< The direction statistics; one per value.
+  P2Quantile     *_pvQuantiles;  ///< The quantile estimators; one per value. Only used with FUNCTION_PERCENTILE.
+};
+
+#endif /* SENSORS_AGGREGATOR_HPP_ */
@@ -18,8 +18,13 @@ public:
   bool setOhmsAt0DegCUsingName(const char    *psName);
   bool updateTemperatureUsingResistance(float ohms);
 
+private:
+  static float degCUsingRatioTable(   float ratio);
+  static float degCUsingRationalPoly(float ratio);
+
 private:
   float _ohmsAt0DegC;  // Sensor's resistance at 0C.
+  float _ratioPerOhm;  // 1 / _ohmsAt0DegC; to normalise without dividing. 0 if _ohmsAt0DegC is not set.
 };
 
 
@@ -9,6 +9,7 @@
 #include "rtdsensor.hpp"
 #include "rtd_pt.hpp"
 #include "logger.h"
+#include "utils.h"
 #include "cnssrf-dt_temperature.h"
 
 CREATE_LOGGER(  rtdsensor);  // Create logger
@@ -134,13 +135,14 @@ bool RTDSensor::jsonSpecificHandler(const JsonObject& json)
 bool RTDSensor::setRTDResistance(float ohms)
 {
   bool res;
+  char value[STR_FIXED_SIZE_MAX];
 
   // Update temperature using resistance value
   res = this->_pvRTD &&
         this->_pvRTD->updateTemperatureUsingResistance(ohms);
   if(res) {
-    log_debug_sensor(_logger, "Temperature is: %.1fC",
-                     this->_pvRTD->temperatureDegC());
+    log_debug_sensor(_logger, "Temperature is: %sC",
+                     strn_float_to_string(value, this->_pvRTD->temperatureDegC(), 1, sizeof(value), false));
   }
 
   return res;
@@ -160,14 +162,16 @@ const char **RTDSensor::csvHeaderValues() { return _CSV_HEADER_VALUES; }
 
 
 int32_t RTDSensor::csvDataSpecific(char *psData, uint32_t size) {
-  uint32_t len;
+  float   temperature = this->_pvRTD->temperatureDegC();
+  int32_t len;
 
-  len = snprintf(psData, size, "%.1f%c%c",  // No deltaT to write yet.
-                 this->_pvRTD->temperatureDegC(),
-                 OUTPUT_DATA_CSV_SEP,
-                 OUTPUT_DATA_CSV_SEP);
+  len = csvMakeStringUsingFloatValues(psData, size, &temperature, 1, 1);
+  if(len < 0 || size - len < 3) { return -1; }
+  psData[len++] = OUTPUT_DATA_CSV_SEP;  // No deltaT to write yet.
+  psData[len++] = OUTPUT_DATA_CSV_SEP;
+  psData[len]   = '\0';
 
-  return len >= size ? -1 : (int32_t)len;
+  return len;
 }
 
 
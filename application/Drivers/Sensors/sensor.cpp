@@ -6,7 +6,9 @@
  */
 #include <string.h>
 #include <stdlib.h>
+#include <math.h>
 #include "sensor.hpp"
+#include "sensorstatestore.hpp"
 #include "cnssint.hpp"
 #include "connecsens.hpp"
 #include "sdcard.h"
@@ -14,6 +16,7 @@
 #include "cnssrf-dt_hash.h"
 #include "board.h"
 #include "rtc.h"
+#include "utils.h"
 
 
 #ifndef SENSOR_CNSSRF_WRITE_SENSOR_TYPE_HASH
@@ -55,6 +58,14 @@ Sensor::Sensor(Power power, Power powerSleep, Features features)
   this->_hasNewData             = false;
   this->_dataChannel            = CNSSRF_DATA_CHANNEL_UNDEFINED;
   this->_isOpened               = false;
+  this->_measurementStarted     = false;
+  this->_pvAggregator           = NULL;
+  this->_readingsWithheld       = false;
+  this->_reportOnChange         = false;
+  this->_reportThreshold        = 0.0;
+  this->_reportThresholdRel     = 0.0;
+  this->_reportMaxSilenceSec    = 0;
+  this->_pvReportState          = NULL;
   this->_hasAlarmToSet          = false;
   this->_alarmStatusJustChanged = false;
   this->_pvState                = NULL;
@@ -64,6 +75,7 @@ Sensor::Sensor(Power power, Power powerSleep, Features features)
   this->_periodAlarmSec         = 0;
   this->_readingsTs2000         = 0;
   this->_interruptionTs2000     = 0;
+  this->_interruptionMs         = 0;
   this->_typeHash               = 0;
   this->_writeTypeHashToCNSSRF  = SENSOR_CNSSRF_WRITE_SENSOR_TYPE_HASH;
   this->_typeHashComputed       = false;
@@ -78,6 +90,8 @@ Sensor::~Sensor()
   close();
   if(this->_psStateFilename) { delete this->_psStateFilename; this->_psStateFilename = NULL; }
   if(this->_pu8StateRef)     { delete this->_pu8StateRef;     this->_pu8StateRef     = NULL; }
+  if(this->_pvAggregator)    { delete this->_pvAggregator;    this->_pvAggregator    = NULL; }
+  if(this->_pvReportState)   { delete this->_pvReportState;   this->_pvReportState   = NULL; }
 }
 
 
@@ -221,6 +235,21 @@ bool Sensor::setConfiguration(const JsonObject& json)
   // Process Interruption power forced usage.
   if(json["useInt3V3WhenActive"].as<bool>()) { this->_power  |= POWER_EXTERNAL_INT; }
 
+  // Process the report on change part.
+  this->_reportOnChange = json["reportOnChange"].success();
+  if(this->_reportOnChange)
+  {
+    const JsonObject &report   = json["reportOnChange"];
+    this->_reportThreshold     = report["threshold"]       .as<float>();
+    this->_reportThresholdRel  = report["thresholdPercent"].as<float>() / 100.0;
+    this->_reportMaxSilenceSec = ConnecSenS::getPeriodSec(report, 0, NULL, "maxSilence");
+    if(this->_reportThreshold < 0 || this->_reportThresholdRel < 0)
+    {
+      log_error_sensor(logger, "Report on change thresholds cannot be negative.");
+      goto error_exit;
+    }
+  }
+
   // Process the alarm part
   if(json["alarm"].success())
   {
@@ -243,6 +272,44 @@ bool Sensor::setConfiguration(const JsonObject& json)
   // Sensor specific initialisation from JSON
   res &= jsonSpecificHandler(json);
 
+  // Aggregation of the readings
+  if(this->_pvAggregator) { delete this->_pvAggregator; this->_pvAggregator = NULL; }
+  this->_readingsWithheld = false;
+  if(json["aggregation"].success())
+  {
+    float                 values[AGGREGATOR_NB_VALUES_MAX];
+    Aggregator::ValueKind kinds[ AGGREGATOR_NB_VALUES_MAX];
+
+    if(!readingValues(values, kinds, AGGREGATOR_NB_VALUES_MAX))
+    {
+      log_error_sensor(logger, "This sensor does not support the aggregation of its readings.");
+      goto error_exit;
+    }
+    this->_pvAggregator = new Aggregator();
+    if(!this->_pvAggregator || !this->_pvAggregator->setConfiguration(json["aggregation"]))
+    {
+      log_error_sensor(logger, "Invalid 'aggregation' configuration.");
+      goto error_exit;
+    }
+  }
+  if(this->_reportOnChange)
+  {
+    float                 values[SENSOR_REPORT_NB_VALUES_MAX];
+    Aggregator::ValueKind kinds[ SENSOR_REPORT_NB_VALUES_MAX];
+
+    if(!readingValues(values, kinds, SENSOR_REPORT_NB_VALUES_MAX))
+    {
+      log_error_sensor(logger, "This sensor does not support the report on change mode.");
+      goto error_exit;
+    }
+    if(!loadReportState())
+    {
+      log_error_sensor(logger, "Failed to get the report on change mode's reference.");
+      goto error_exit;
+    }
+  }
+  else if(this->_pvReportState) { delete this->_pvReportState; this->_pvReportState = NULL; }
+
   // If the sensor can react to interruption then we still have some stuff to set up.
   if(res && isTriggerable())
   {
@@ -392,9 +459,70 @@ void Sensor::setSpecificIntSensitivity(CNSSInt::Interruptions sensitivity)
  */
 bool Sensor::removeAllStates()
 {
+  SensorStateStore::instance()->releaseAll();
+
   return sdcard_remove_using_pattern(SENSOR_STATE_DIR, "*" SENSOR_STATE_FILENAME_EXT);
 }
 
+/**
+ * Claim the sensor's slot in the sensors' state store, so that it is kept
+ * when the slots of the sensors that are not configured anymore are released.
+ */
+void Sensor::claimState()
+{
+  SensorStateStore::instance()->claim(typeHash(), (uint8_t)this->_dataChannel, stateIdHash());
+  if(this->_pvReportState)
+  {
+    SensorStateStore::instance()->claim(reportStateTypeHash(), (uint8_t)this->_dataChannel, stateIdHash());
+  }
+}
+
+/**
+ * Get the type hash that identifies the report on change mode's reference in the state store.
+ * It is the sensor type's hash computed with another seed, so that it does not collide with the state's one.
+ *
+ * @return the hash.
+ */
+uint32_t Sensor::reportStateTypeHash()
+{
+  const char *psType = type();
+
+  return mm3_32((const uint8_t *)psType, strlen(psType), SENSOR_REPORT_STATE_SEED);
+}
+
+/**
+ * Allocate the report on change mode's reference, and get it from the state store.
+ * If it is not there then nothing has been reported yet.
+ *
+ * @return true  on success.
+ * @return false if failed to allocate it.
+ */
+bool Sensor::loadReportState()
+{
+  if(!this->_pvReportState && !(this->_pvReportState = new ReportState)) { return false; }
+
+  if(SensorStateStore::instance()->load(reportStateTypeHash(), (uint8_t)this->_dataChannel, stateIdHash(),
+					(uint8_t *)this->_pvReportState, sizeof(ReportState)) &&
+     this->_pvReportState->version == SENSOR_REPORT_STATE_VERSION) { return true; }
+
+  memset(this->_pvReportState, 0, sizeof(ReportState));
+  this->_pvReportState->version = SENSOR_REPORT_STATE_VERSION;
+
+  return true;
+}
+
+/**
+ * Get the hash of the sensor's unique identifier, that identifies its state in the state store,
+ * along with its type and its data channel; like the unique identifier used to be part of its state file's name.
+ *
+ * @return the hash.
+ * @return 0 if the sensor has no unique identifier.
+ */
+uint32_t Sensor::stateIdHash()
+{
+  return hasUniqueId() ? mm3_32_cnss((const uint8_t *)uniqueId(), strlen(uniqueId())) : 0;
+}
+
 /**
  * Get the name of the file used to store the sensor's state.
  *
@@ -450,37 +578,79 @@ Sensor::State *Sensor::defaultState(uint32_t *pu32_size)
   return NULL;
 }
 
+/**
+ * Use the sensor's default state.
+ *
+ * @return the default state.
+ * @return NULL if the sensor do not use state.
+ */
+Sensor::State *Sensor::useDefaultState()
+{
+  if((this->_pvState = defaultState(&this->_stateSize)))
+  {
+    this->_pvState->isInAlarm = false;
+  }
+
+  return this->_pvState;
+}
+
 /**
  * Read the sensor's state.
  *
+ * The state is read from the sensors' state store.
+ * If it is not there then we look for a state file written by a previous firmware version.
+ *
  * @return the sensor's state.
  * @return NULL if the sensor do not use state.
  * @return NULL we could not get the state.
  */
 Sensor::State *Sensor::state()
 {
-  const char *psStateFilename;
-  uint8_t     u8;
-  File        file;
+  uint8_t version;
 
-  if( this->_pvState) { goto exit; }
-  if((this->_pvState = defaultState(&this->_stateSize)))
+  if( this->_pvState)    { goto exit; }
+  if(!useDefaultState()) { goto exit; }
+  version = this->_pvState->version;
+
+  if(!SensorStateStore::instance()->load(typeHash(), (uint8_t)this->_dataChannel, stateIdHash(),
+					 (uint8_t *)this->_pvState, this->_stateSize))
   {
-    this->_pvState->isInAlarm = false;
+    readLegacyStateFile();
+    goto exit;
   }
-  else { goto exit; }
-  if(!(psStateFilename = getStateFilename(false))) { goto exit; }
-
-  // Open the file
-  if(!sdcard_exists(psStateFilename))
+  if(this->_pvState->version != version)
   {
-    log_info_sensor(logger, "Sensor's state file does not exist; use default state.");
+    log_info_sensor(logger, "Sensor's stored state version does not match; use default state.");
+    useDefaultState();
     goto exit;
   }
+  setCurrentStateAsReference();
+
+  exit:
+  return this->_pvState;
+}
+
+/**
+ * Read the sensor's state from the state file used by previous firmware versions.
+ * If found, the state is then saved to the sensors' state store.
+ *
+ * @pre the sensor's default state MUST have been set.
+ */
+void Sensor::readLegacyStateFile()
+{
+  const char *psStateFilename;
+  uint8_t     u8;
+  File        file;
+
+  if(!(psStateFilename = getStateFilename(false)) || !sdcard_exists(psStateFilename))
+  {
+    log_info_sensor(logger, "Sensor's state has not been stored yet; use default state.");
+    return;
+  }
   if(!sdcard_fopen(&file, psStateFilename, FILE_OPEN | FILE_READ))
   {
     log_error_sensor(logger, "Failed to open sensor's state file in read mode. Use default state.");
-    goto exit;
+    return;
   }
 
   // Check the file size and the version
@@ -488,64 +658,43 @@ Sensor::State *Sensor::state()
       !sdcard_fread(&file, &u8, 1)             || ((State *)&u8)->version != this->_pvState->version)
   {
     log_info(logger, "Sensor's state object size or version do not match; use default state.");
-    sdcard_fclose(&file);
-    sdcard_remove(psStateFilename);
-    goto exit;
   }
-
-  // Read the file
-  if(!sdcard_rewind(&file) || !sdcard_fread(&file, (uint8_t *)this->_pvState, this->_stateSize))
+  else if(!sdcard_rewind(&file) || !sdcard_fread(&file, (uint8_t *)this->_pvState, this->_stateSize))
   {
-    log_error_sensor(logger, "Failed to read sensor's state file '%s'. Use default state");
-    sdcard_fclose(&file);
-    this->_pvState            = defaultState(&this->_stateSize); // To be sure that we have the default state
-    this->_pvState->isInAlarm = false;
-    goto exit;
+    log_error_sensor(logger, "Failed to read sensor's state file '%s'. Use default state", psStateFilename);
+    useDefaultState(); // To be sure that we have the default state
   }
-  else { setCurrentStateAsReference(); }
+  else { saveState(true); }
   sdcard_fclose(&file);
-
-  exit:
-  return this->_pvState;
+  sdcard_remove(psStateFilename);
 }
 
 /**
  * Save the current sensor's state.
  *
+ * The state is saved to the sensors' state store, which writes it to disk before going to sleep.
+ *
  * @param[in] force  force state save, even if no changes have been detected?
  *
  * @return true on success.
  * @return false if the state has not been read.
  * @return false it the sensor do not use state.
- * @return false if failed to write state to disk.
+ * @return false if failed to save the state.
  */
 bool Sensor::saveState(bool force)
 {
-  const char *psStateFilename;
-  File        file;
-  bool        res = false;
+  if(!force && !stateHasChanged()) { return true; }
+  if(!this->_pvState)              { return false; }
 
-  if(!force && !stateHasChanged()) { res = true; goto exit; }
-
-  if(!this->_pvState || !(psStateFilename = getStateFilename(false))) { goto exit; }
-
-  // Open the file
-  if(!sdcard_fopen(&file, psStateFilename, FILE_OPEN_OR_CREATE| FILE_TRUNCATE | FILE_WRITE))
+  if(!SensorStateStore::instance()->save(typeHash(), (uint8_t)this->_dataChannel, stateIdHash(),
+					 (uint8_t *)this->_pvState, this->_stateSize))
   {
-    log_error_sensor(logger, "Failed to open sensor's state file in write mode.");
-    goto exit;
+    log_error_sensor(logger, "Failed to save sensor's state.");
+    return false;
   }
+  setCurrentStateAsReference();
 
-  // Write to file
-  if(!(res = sdcard_fwrite(&file, (uint8_t *)this->_pvState, this->_stateSize)))
-  {
-    log_error_sensor(logger, "Failed to write sensor's state to file '%s'.", psStateFilename);
-  }
-  else { setCurrentStateAsReference(); }
-  sdcard_fclose(&file);
-
-  exit:
-  return res;
+  return true;
 }
 
 /**
@@ -649,6 +798,7 @@ bool Sensor::open()
  */
 void Sensor::close()
 {
+  this->_measurementStarted = false;
   if(this->_isOpened)
   {
     this->_isOpened = false;
@@ -672,11 +822,16 @@ void Sensor::setReadingsTimestamp(ts2000_t ts)
  * Set the interruption timestamp.
  *
  * @param[in] ts The new timestamp, in seconds since 2000-01-01T00:00:00.
- *               O means use current time.
+ *               O means use current time, with the milliseconds.
  */
 void Sensor::setInterruptionTimestamp(ts2000_t ts)
 {
-  this->_interruptionTs2000 = ts ? ts : rtc_get_date_as_secs_since_2000();
+  if(ts)
+  {
+    this->_interruptionTs2000 = ts;
+    this->_interruptionMs     = 0;
+  }
+  else { this->_interruptionTs2000 = rtc_get_date_as_secs_and_ms_since_2000(&this->_interruptionMs); }
 }
 
 void Sensor::setHasNewData(bool hasNewData)
@@ -696,10 +851,26 @@ bool Sensor::read()
   bool res;
 
   setHasNewData(false);
+  this->_readingsWithheld = false;
   log_debug_sensor(logger, "Reading...", name());
   if((res = readSpecific()))
   {
+    if(this->_pvAggregator && !aggregateReadings())
+    {
+      // Nothing to output until the end of the aggregation window.
+      setIsInAlarm(currentValuesAreInAlarmRange());
+      log_info_sensor(logger, "Reading done and aggregated.");
+      return true;
+    }
     setHasNewData();
+    if(this->_reportOnChange && !alarmStatusHasJustChanged(false) && !readingsHaveToBeReported())
+    {
+      // The readings are too close to the last reported ones.
+      setHasNewData(false);
+      this->_readingsWithheld = true;
+      log_info_sensor(logger, "Reading done; within the deadband, not reported.");
+      return true;
+    }
     log_info_sensor(logger, "Reading done.");
   }
   else { log_error_sensor(logger, "Failed to read sensor."); }
@@ -707,6 +878,141 @@ bool Sensor::read()
   return res;
 }
 
+/**
+ * Add the current readings to the aggregation window.
+ * If the window is over then the readings are replaced with the aggregated values.
+ *
+ * @return true  if the readings have been replaced with the aggregated values.
+ * @return false if the window is not over yet.
+ */
+bool Sensor::aggregateReadings()
+{
+  float                 values[AGGREGATOR_NB_VALUES_MAX];
+  Aggregator::ValueKind kinds[ AGGREGATOR_NB_VALUES_MAX];
+  uint8_t               nb;
+  ts2000_t              tsNow = rtc_get_date_as_secs_since_2000();
+
+  if(!(nb = readingValues(values, kinds, AGGREGATOR_NB_VALUES_MAX))) { return true; }
+
+  this->_pvAggregator->add(values, kinds, nb, tsNow);
+  if(!this->_pvAggregator->windowIsOver(tsNow))
+  {
+    this->_readingsWithheld = true;
+    return false;
+  }
+
+  nb = this->_pvAggregator->results(values, AGGREGATOR_NB_VALUES_MAX);
+  setAggregatedValues(values, nb);
+
+  return true;
+}
+
+/**
+ * Indicate if the current readings have to be reported, when the report on change mode is used.
+ *
+ * They have to be if nothing has been reported yet, if nothing has been reported for
+ * the maximum silence duration, if a counter is not 0 or if a value differs enough from
+ * the last reported one. Durations are not compared.
+ * If the readings have to be reported then they become the new reference.
+ *
+ * @return true  if the readings have to be reported.
+ * @return false otherwise.
+ */
+bool Sensor::readingsHaveToBeReported()
+{
+  float                 values[SENSOR_REPORT_NB_VALUES_MAX];
+  Aggregator::ValueKind kinds[ SENSOR_REPORT_NB_VALUES_MAX];
+  float                 ref, delta;
+  uint8_t               nb, i;
+  bool                  report;
+  ts2000_t              tsNow   = rtc_get_date_as_secs_since_2000();
+  ReportState          *pvState = this->_pvReportState;
+
+  if(!pvState || !(nb = readingValues(values, kinds, SENSOR_REPORT_NB_VALUES_MAX))) { return true; }
+
+  report = !pvState->hasReport ||
+      (this->_reportMaxSilenceSec && tsNow >= pvState->tsLastReport + this->_reportMaxSilenceSec);
+  for(i = 0; !report && i < nb; i++)
+  {
+    ref = pvState->lastReportedValues[i];
+    if(kinds[i] == Aggregator::VALUE_KIND_DURATION) { continue; }
+    if(kinds[i] == Aggregator::VALUE_KIND_COUNTER)  { report = !isnan(values[i]) && values[i] != 0; continue; }
+    if(isnan(values[i]) || isnan(ref))              { report = isnan(values[i]) != isnan(ref);       continue; }
+
+    delta = kinds[i] == Aggregator::VALUE_KIND_DIRECTION_DEG ?
+	fabsf(fmodf(values[i] - ref + 540.0f, 360.0f) - 180.0f) : fabsf(values[i] - ref);
+    report = (this->_reportThreshold    && delta >= this->_reportThreshold) ||
+	     (this->_reportThresholdRel && delta >= this->_reportThresholdRel * fabsf(ref));
+  }
+  if(!report) { return false; }
+
+  // The readings become the reference
+  for(i = 0; i < nb; i++) { pvState->lastReportedValues[i] = values[i]; }
+  pvState->tsLastReport = tsNow;
+  pvState->hasReport    = true;
+  if(!SensorStateStore::instance()->save(reportStateTypeHash(), (uint8_t)this->_dataChannel, stateIdHash(),
+					 (uint8_t *)pvState, sizeof(ReportState)))
+  {
+    log_error_sensor(logger, "Failed to save the report on change mode's reference.");
+  }
+
+  return true;
+}
+
+/**
+ * Start a measurement and return without waiting for its result.
+ *
+ * This is the first step of a split-phase reading: startMeasurement(), then isReady()
+ * until it returns true, then collect().
+ * It allows several sensors to perform their conversions at the same time.
+ *
+ * @pre the sensor MUST be opened.
+ *
+ * @return true  if a measurement has been started.
+ * @return false if the sensor cannot start a measurement by itself. In this case collect()
+ *               still performs a complete, blocking, reading.
+ */
+bool Sensor::startMeasurement()
+{
+  this->_measurementStarted = false;
+  if(!this->_isOpened) { return false; }
+
+  if((this->_measurementStarted = startMeasurementSpecific()))
+  {
+    log_debug_sensor(logger, "Measurement started.");
+  }
+
+  return this->_measurementStarted;
+}
+
+/**
+ * Indicate if the result of the measurement started with startMeasurement() can be collected.
+ *
+ * @return true  if the result is available.
+ * @return true  if no measurement has been started.
+ * @return false if the measurement is still in progress.
+ */
+bool Sensor::isReady()
+{
+  return !this->_measurementStarted || isReadySpecific();
+}
+
+/**
+ * Collect the result of a measurement started with startMeasurement().
+ *
+ * If no measurement has been started then a complete reading is performed.
+ *
+ * @return true  on success.
+ * @return false otherwise.
+ */
+bool Sensor::collect()
+{
+  bool res = read();
+
+  this->_measurementStarted = false;
+  return res;
+}
+
 /**
  * Configure the sensor to generate alerts
  */
@@ -974,6 +1280,52 @@ int32_t Sensor::csvMakeStringUsingStringValues(char         *ps_data,
   return -1;
 }
 
+/**
+ * Create a CSV string using float values, all written with the same number of decimals.
+ * The values are written as printf("%.<nb_decimals>f") would, but without using floating point
+ * operations; see strn_float_to_string().
+ *
+ * The result is: "<V1><CSV_SEP><V2><CSV_SEP>...<Vn>"
+ *
+ * @param[out] ps_data     where the CSV string is written to. MUST be NOT NULL.
+ * @param[in]  size        ps_data's size.
+ * @param[in]  pf_values   the values. MUST be NOT NULL.
+ * @param[in]  nb_values   the number of values. Can be lower than csvNbValues(), to write the beginning of a line.
+ * @param[in]  nb_decimals the number of decimals to write. MUST be <= STR_FIXED_DECIMALS_MAX.
+ *
+ * @return the CSV string length.
+ * @return -1 if ps_data is too small.
+ */
+int32_t Sensor::csvMakeStringUsingFloatValues(char        *ps_data,
+					      uint32_t     size,
+					      const float *pf_values,
+					      uint32_t     nb_values,
+					      uint8_t      nb_decimals)
+{
+  uint32_t i, s;
+  char    *pc;
+
+  for(i = 0, s = size; i < nb_values; i++)
+  {
+    if(i)
+    {
+      if(s <= 1) { goto error_exit; }
+      *ps_data++ = OUTPUT_DATA_CSV_SEP;
+      s--;
+    }
+
+    pc = strn_float_to_string(ps_data, pf_values[i], nb_decimals, s, true);
+    if(pc == ps_data) { goto error_exit; }
+    s      -= pc - ps_data;
+    ps_data = pc;
+  }
+
+  return size - s;
+
+  error_exit:
+  return -1;
+}
+
 
 
 // ================== Default implementation for optional virtual functions
@@ -1016,3 +1368,30 @@ bool Sensor::currentValuesAreInAlarmRange()
   return isInAlarm();  // So that the alarm status does not change.
 }
 
+uint8_t Sensor::readingValues(float *pfValues, Aggregator::ValueKind *pvKinds, uint8_t nbMax)
+{
+  UNUSED(pfValues);
+  UNUSED(pvKinds);
+  UNUSED(nbMax);
+  // Aggregation is not supported by default
+  return 0;
+}
+
+void Sensor::setAggregatedValues(const float *pfValues, uint8_t nb)
+{
+  UNUSED(pfValues);
+  UNUSED(nb);
+  // Do nothing
+}
+
+bool Sensor::startMeasurementSpecific()
+{
+  // The reading cannot be split; it is all done by readSpecific().
+  return false;
+}
+
+bool Sensor::isReadySpecific()
+{
+  return true;
+}
+
@@ -19,6 +19,7 @@
 #include "json.hpp"
 #include "cnssrf.h"
 #include "cnssintclient.hpp"
+#include "aggregator.hpp"
 #include "logger.h"
 #include "board.h"
 
@@ -26,6 +27,9 @@
 #define SENSOR_STATE_FILENAME_SIZE_MAX    48
 #define SENSOR_UNIQUE_ID_SIZE_MAX         (CNSSRF_DT_CONFIG_VALUE_LEN_MAX + 1)
 #define SENSOR_FIRMWARE_VERSION_SIZE_MAX  (CNSSRF_DT_CONFIG_VALUE_LEN_MAX + 1)
+#define SENSOR_REPORT_NB_VALUES_MAX       AGGREGATOR_NB_VALUES_MAX  ///< The maximum number of values compared by the report on change mode.
+#define SENSOR_REPORT_STATE_VERSION       1                         ///< The report on change mode's reference format version.
+#define SENSOR_REPORT_STATE_SEED          0x52505254                ///< The seed of the hash identifying the report on change mode's reference in the state store.
 
 // Define some logging macros dedicated to sensors so that the sensor's name is is automatically added.
 #define log_fatal_sensor(nm, msg, ...)  log_fatal(nm, "%s: " msg, name() _VARGS_(__VA_ARGS__))
@@ -114,11 +118,13 @@ public :
   Power           powerConfigSleep() const                            { return  this->_powerSleep;                   }
   bool            usePower(Power power) const                         { return (this->_power & power) != POWER_NONE; }
   bool            hasNewData() const                                  { return  this->_hasNewData;                   }
+  bool            readingsAreWithheld() const                         { return  this->_readingsWithheld;             }
   void            clearHasNewData()                                   { this->_hasNewData = false;                   }
   bool            isOpened() const                                    { return  this->_isOpened;                     }
   bool            needsToBeConstantlyOpened() const                   { return  this->_periodType == PERIOD_TYPE_AT_SENSOR_S_FLOW; }
   ts2000_t        readingsTimestamp() const                           { return  this->_readingsTs2000;               }
   ts2000_t        interruptionTimestamp() const                       { return this->_interruptionTs2000;            }
+  uint16_t        interruptionTimestampMs() const                     { return this->_interruptionMs;                }
   void            clearInterruptionTimestamp()                        { this->_interruptionTs2000 = 0;               }
   bool            isInAlarm();
   bool            alarmStatusHasJustChanged(bool clear = true);
@@ -133,6 +139,7 @@ public :
 
   const char *getStateFilename(bool create = false);
   static bool removeAllStates();
+  void        claimState();
 
   PeriodType periodType() const { return this->_periodType; }
   void       setPeriodSec(uint32_t secs);
@@ -152,6 +159,10 @@ public :
   bool read();
   bool configAlert();
 
+  bool startMeasurement();
+  bool isReady();
+  bool collect();
+
   virtual void        processInterruption(CNSSInt::Interruptions ints);
 
   TypeHash            typeHash(bool *pb_ok = NULL);
@@ -181,15 +192,30 @@ protected:
   State *state();
   bool   saveState(bool force = false);
 
+  bool   measurementHasBeenStarted() const { return this->_measurementStarted; }
+
+  bool   aggregateReadings();
+  bool   readingsHaveToBeReported();
+
   uint8_t csvNbValues() const { return this->_csvNbValues; }
   int32_t csvMakeStringUsingStringValues(char        *ps_data,
 					 uint32_t     size,
 					 const char **pps_values,
 					 uint32_t     nb_values);
+  int32_t csvMakeStringUsingFloatValues( char        *ps_data,
+					 uint32_t     size,
+					 const float *pf_values,
+					 uint32_t     nb_values,
+					 uint8_t      nb_decimals);
 
 
 private:
   void  setIntSensitivity(CNSSInt::Interruptions sensitivity, bool append);
+  State *useDefaultState();
+  uint32_t stateIdHash();
+  uint32_t reportStateTypeHash();
+  bool  loadReportState();
+  void  readLegacyStateFile();
   void  setCurrentStateAsReference();
   bool  stateHasChanged();
 
@@ -201,6 +227,54 @@ private:
   virtual void processInterruptionSpecific( CNSSInt::Interruptions  ints);
   virtual bool currentValuesAreInAlarmRange();
 
+  /**
+   * Start a measurement without waiting for its result.
+   *
+   * The result will be retrieved later by readSpecific(), once isReadySpecific() returns true.
+   * Sensors that cannot split their reading in two phases do not overwrite this function;
+   * their whole reading is then performed by readSpecific().
+   *
+   * @return true  if a measurement has been started.
+   * @return false otherwise.
+   */
+  virtual bool startMeasurementSpecific();
+
+  /**
+   * Indicate if the measurement started with startMeasurementSpecific() is done.
+   *
+   * @return true  if the result is available, or if we cannot tell.
+   * @return false if the measurement is still in progress.
+   */
+  virtual bool isReadySpecific();
+
+  /**
+   * Get the current reading values so that they can be aggregated,
+   * or compared to the last reported ones.
+   *
+   * Sensors that do not support aggregation nor report on change do not overwrite this function.
+   *
+   * @param[out] pfValues where the values are written to. Use NaN for an unavailable value.
+   *                      Is not NULL.
+   * @param[out] pvKinds  where the values' kinds are written to. Is not NULL.
+   * @param[in]  nbMax    the maximum number of values that can be written.
+   *
+   * @return the number of values. Must always be the same for a given configuration.
+   * @return 0 if the sensor does not support aggregation nor report on change.
+   */
+  virtual uint8_t readingValues(float                 *pfValues,
+				Aggregator::ValueKind *pvKinds,
+				uint8_t                nbMax);
+
+  /**
+   * Replace the current reading values with aggregated values.
+   *
+   * @param[in] pfValues the aggregated values, in the order used by readingValues().
+   *                     A NaN value means that no reading was available for this value.
+   *                     Is not NULL.
+   * @param[in] nb       the number of values.
+   */
+  virtual void setAggregatedValues(const float *pfValues, uint8_t nb);
+
   /**
    * This function returns the state object to use as default state object.
    *
@@ -248,6 +322,21 @@ protected:
   virtual int32_t csvDataSpecific(char *ps_data, uint32_t size) = 0;
 
 
+private:
+  /**
+   * Defines the report on change mode's reference; stored apart from the sensor's state.
+   */
+  typedef struct ReportState
+  {
+    uint8_t  version   : 4;  ///< The format version.
+    uint8_t  hasReport : 1;  ///< Has a reading been reported?
+    uint8_t  unused    : 3;  ///< Unused bits; reserved for future needs.
+    ts2000_t tsLastReport;   ///< The last reported reading's timestamp.
+    float    lastReportedValues[SENSOR_REPORT_NB_VALUES_MAX];  ///< The last reported values.
+  }
+  ReportState;
+
+
 private:
   Features               _features;               ///< The sensor's features.
   char 	                 _name[SENSOR_NAME_MAX_SIZE];
@@ -269,6 +358,14 @@ private:
   bool                   _hasNewData;             ///< Indicate if new data have been red from the sensor
   CNSSRFDataChannel      _dataChannel;            ///< The ConnecSenS RF format data channel assigned to this sensor.
   bool                   _isOpened;               ///< Indicate if the sensor is opened or not.
+  bool                   _measurementStarted;     ///< Has a measurement been started and not collected yet?
+  Aggregator            *_pvAggregator;           ///< The readings' aggregator. NULL if the readings are not aggregated.
+  bool                   _reportOnChange;         ///< Only report readings that differ enough from the last reported ones?
+  float                  _reportThreshold;        ///< Report if a value differs from the last reported one by at least this amount. 0 to ignore.
+  float                  _reportThresholdRel;     ///< Report if a value differs from the last reported one by at least this ratio of it. 0 to ignore.
+  uint32_t               _reportMaxSilenceSec;    ///< Report anyway if nothing has been reported for this duration. 0 to ignore.
+  ReportState           *_pvReportState;          ///< The report on change mode's reference. NULL if the mode is not used.
+  bool                   _readingsWithheld;       ///< Has the last reading been kept from the output? Aggregated or within the deadband.
   bool                   _hasAlarmToSet;          ///< Is there an alarm to set?
   bool                   _alarmStatusJustChanged; ///< Has the alarm status just changed?
   State                 *_pvState;                ///< The sensor's state.
@@ -278,6 +375,7 @@ private:
   uint32_t               _periodAlarmSec;         ///< The sensor's period, in seconds, when it is in alarm.
   ts2000_t               _readingsTs2000;         ///< The last reading's timestamp. 0 if no timestamp.
   ts2000_t               _interruptionTs2000;     ///< Timestamp of the last interruption. 0 mean no timestamp.
+  uint16_t               _interruptionMs;         ///< The milliseconds part of the last interruption's timestamp, [0..999].
   TypeHash               _typeHash;               ///< The sensor's type hash.
   bool                   _writeTypeHashToCNSSRF;  ///< Write the sensor's type hash to CNSSRF frames?
   bool                   _typeHashComputed;       ///< Indicate if the sensor's type hash has been computed or not.
@@ -6,10 +6,27 @@
 
 #include <string.h>
 #include "sensor_adc.hpp"
+#include "rtc.h"
 
 
 #define ADC_CONV_TIMEOUT_MS  1000
 
+#ifndef SENSOR_ADC_OVERSAMPLING_RATIO
+#define SENSOR_ADC_OVERSAMPLING_RATIO       ADC_OVERSAMPLING_RATIO_16  ///< The hardware oversampler's ratio.
+#endif
+#ifndef SENSOR_ADC_OVERSAMPLING_SHIFT
+#define SENSOR_ADC_OVERSAMPLING_SHIFT       ADC_RIGHTBITSHIFT_4        ///< The oversampler's right shift. Must match the ratio to keep 12 bits results.
+#endif
+#ifndef SENSOR_ADC_NB_SEQUENCES
+#define SENSOR_ADC_NB_SEQUENCES             4      ///< The number of scan sequences converted at each read; the values are averaged over them.
+#endif
+#ifndef SENSOR_ADC_CALIBRATION_MAX_AGE_SEC
+#define SENSOR_ADC_CALIBRATION_MAX_AGE_SEC  86400  ///< A cached calibration factor older than this is renewed, to follow the temperature drift.
+#endif
+
+#define ADC_DMA_ENABLE_CLOCK()  PASTER3(__HAL_RCC_DMA, ADC_DMA_NUM, _CLK_ENABLE)()
+#define ADC_DMA_CHANNEL         PASTER4(DMA, ADC_DMA_NUM, _Channel, ADC_DMA_CHANNEL_NUM)
+
 
 const SensorADC::ADCLineDesc SensorADC::_adcDescs[SENSOR_ADC_LINES_COUNT] =
 {
@@ -30,6 +47,9 @@ const SensorADC::ADCLineDesc SensorADC::_adcDescs[SENSOR_ADC_LINES_COUNT] =
     }
 };
 
+ADCCalibrationCache SensorADC::_calibrations(SENSOR_ADC_CALIBRATION_MAX_AGE_SEC);
+DMA_HandleTypeDef   SensorADC::_hdma;
+
 
 
 /**
@@ -72,6 +92,7 @@ void SensorADC::init(ADCLineFlags adcLines)
   for(i = 0; i < SENSOR_ADC_LINES_COUNT; i++)
   {
     this->_adcValuesMV[i]    = 0;
+    this->_adcNoiseMV[i]     = 0;
     this->_hadcs[i].Instance = NULL;
   }
 }
@@ -167,9 +188,18 @@ ADC_HandleTypeDef *SensorADC::getADCHandleForLineDesc(const ADCLineDesc *pvDesc,
 }
 
 
+/**
+ * Open the ADC(s).
+ *
+ * Each ADC is set up to convert all the sensor's lines it serves in a single scan sequence,
+ * using the hardware oversampler. The ADC calibration is only run if there is no recent
+ * calibration factor cached for the ADC; the deep power down mode, used when closing, loses it.
+ *
+ * @return true  on success.
+ * @return false otherwise.
+ */
 bool SensorADC::openSpecific()
 {
-  ADC_MultiModeTypeDef multimode;
   GPIO_InitTypeDef     init;
   ADC_HandleTypeDef    *pvADC;
   uint8_t              i;
@@ -198,27 +228,125 @@ bool SensorADC::openSpecific()
     pvADC->Init.ClockPrescaler        = ADC_CLOCK_ASYNC_DIV1;
     pvADC->Init.Resolution            = ADC_RESOLUTION_12B;
     pvADC->Init.DataAlign             = ADC_DATAALIGN_RIGHT;
-    pvADC->Init.ScanConvMode          = ADC_SCAN_DISABLE;
-    pvADC->Init.EOCSelection          = ADC_EOC_SINGLE_CONV;
     pvADC->Init.LowPowerAutoWait      = DISABLE;
-    pvADC->Init.ContinuousConvMode    = DISABLE;
-    pvADC->Init.NbrOfConversion       = 1;
     pvADC->Init.DiscontinuousConvMode = DISABLE;
     pvADC->Init.NbrOfDiscConversion   = 1;
     pvADC->Init.ExternalTrigConv      = ADC_SOFTWARE_START;
     pvADC->Init.ExternalTrigConvEdge  = ADC_EXTERNALTRIGCONVEDGE_NONE;
     pvADC->Init.DMAContinuousRequests = DISABLE;
     pvADC->Init.Overrun               = ADC_OVR_DATA_PRESERVED;
-    pvADC->Init.OversamplingMode      = DISABLE;
-    multimode.Mode                    = ADC_MODE_INDEPENDENT;
-    HAL_ADC_Init(                    pvADC);
-    HAL_ADCEx_MultiModeConfigChannel(pvADC, &multimode);
+  }
+
+  // Set up the scan sequences and the calibrations
+  for(i = 0; i < SENSOR_ADC_LINES_COUNT; i++)
+  {
+    pvADC = &this->_hadcs[i];
+    if(!pvADC->Instance) continue;
+
+    if(!configureSequence( pvADC) ||
+       !restoreCalibration(pvADC)) { goto error_exit; }
+  }
+
+  return true;
+
+  error_exit:
+  closeSpecific();
+  return false;
+}
+
+/**
+ * Initialise an ADC and configure its scan sequence.
+ *
+ * The sequence converts, in the order of the lines descriptions, all the sensor's lines using this ADC.
+ * It is converted continuously, so that several sequences can be read in a single DMA transfer.
+ *
+ * @param[in] pvADC the ADC handle. MUST be NOT NULL, with its base configuration set.
+ *
+ * @return true  on success.
+ * @return false otherwise.
+ */
+bool SensorADC::configureSequence(ADC_HandleTypeDef *pvADC)
+{
+  static const uint32_t  ranks[SENSOR_ADC_LINES_COUNT] =
+  {
+      ADC_REGULAR_RANK_1, ADC_REGULAR_RANK_2, ADC_REGULAR_RANK_3
+  };
+  ADC_MultiModeTypeDef   multimode;
+  ADC_ChannelConfTypeDef channelConfig;
+  uint8_t                i, nb;
+
+  // Count the lines in the sequence
+  for(i = 0, nb = 0; i < SENSOR_ADC_LINES_COUNT; i++)
+  {
+    if((_adcDescs[i].idFlag & this->_adcLines) && _adcDescs[i].pvADC == pvADC->Instance) { nb++; }
+  }
+
+  // Initialise the ADC
+  pvADC->Init.ScanConvMode                       = nb > 1 ? ADC_SCAN_ENABLE : ADC_SCAN_DISABLE;
+  pvADC->Init.NbrOfConversion                    = nb;
+  pvADC->Init.EOCSelection                       = ADC_EOC_SEQ_CONV;
+  pvADC->Init.ContinuousConvMode                 = ENABLE;
+  pvADC->Init.OversamplingMode                   = ENABLE;
+  pvADC->Init.Oversampling.Ratio                 = SENSOR_ADC_OVERSAMPLING_RATIO;
+  pvADC->Init.Oversampling.RightBitShift         = SENSOR_ADC_OVERSAMPLING_SHIFT;
+  pvADC->Init.Oversampling.TriggeredMode         = ADC_TRIGGEREDMODE_SINGLE_TRIGGER;
+  pvADC->Init.Oversampling.OversamplingStopReset = ADC_REGOVERSAMPLING_CONTINUED_MODE;
+  multimode.Mode                                 = ADC_MODE_INDEPENDENT;
+  if(HAL_ADC_Init(                    pvADC)             != HAL_OK ||
+     HAL_ADCEx_MultiModeConfigChannel(pvADC, &multimode) != HAL_OK) { goto error_exit; }
+
+  // Configure the channels
+  channelConfig.SamplingTime = ADC_SAMPLETIME_640CYCLES_5;
+  channelConfig.SingleDiff   = ADC_SINGLE_ENDED;
+  channelConfig.OffsetNumber = ADC_OFFSET_NONE;
+  channelConfig.Offset       = 0;
+  for(i = 0, nb = 0; i < SENSOR_ADC_LINES_COUNT; i++)
+  {
+    const ADCLineDesc *pvDesc = &_adcDescs[i];
+    if(!(pvDesc->idFlag & this->_adcLines) || pvDesc->pvADC != pvADC->Instance) continue;
+
+    channelConfig.Channel = pvDesc->adcChannel;
+    channelConfig.Rank    = ranks[nb++];
+    if(HAL_ADC_ConfigChannel(pvADC, &channelConfig) != HAL_OK) { goto error_exit; }
+  }
+
+  return true;
+
+  error_exit:
+  return false;
+}
 
-    // Start ADC calibration
-    HAL_ADCEx_Calibration_Start(pvADC, ADC_SINGLE_ENDED);
+/**
+ * Calibrate an ADC, or restore its cached calibration factor if it is recent enough.
+ *
+ * @param[in] pvADC the ADC handle. MUST be NOT NULL, and the ADC initialised and disabled.
+ *
+ * @return true  on success.
+ * @return false otherwise.
+ */
+bool SensorADC::restoreCalibration(ADC_HandleTypeDef *pvADC)
+{
+  uint32_t now, factor;
+
+  now = rtc_get_date_as_secs_since_2000();
+  if(_calibrations.get(pvADC->Instance, now, &factor))
+  {
+    // The factor can only be set when the ADC is enabled
+    if(ADC_Enable(                    pvADC)                           != HAL_OK ||
+       HAL_ADCEx_Calibration_SetValue(pvADC, ADC_SINGLE_ENDED, factor) != HAL_OK) { goto error_exit; }
+  }
+  else
+  {
+    if(HAL_ADCEx_Calibration_Start(pvADC, ADC_SINGLE_ENDED) != HAL_OK) { goto error_exit; }
+    // Should never fail; there is an entry per ADC line.
+    if(!_calibrations.set(pvADC->Instance, now,
+			  HAL_ADCEx_Calibration_GetValue(pvADC, ADC_SINGLE_ENDED))) { goto error_exit; }
   }
 
   return true;
+
+  error_exit:
+  return false;
 }
 
 /**
@@ -250,39 +378,83 @@ void SensorADC::closeSpecific()
 
 /**
  * Read the values.
+ *
+ * @return true  on success.
+ * @return false otherwise.
  */
 bool SensorADC::readSpecific()
 {
-  ADC_HandleTypeDef     *pvADC;
-  ADC_ChannelConfTypeDef channelConfig;
-  uint8_t                i;
-  uint32_t               v;
+  uint8_t i;
 
-  // Base configuration for all ADCs
   for(i = 0; i < SENSOR_ADC_LINES_COUNT; i++)
   {
-    const ADCLineDesc *pvDesc = &_adcDescs[i];
-    if(!(pvDesc->idFlag & this->_adcLines)) continue;
+    if(this->_hadcs[i].Instance && !readSequence(&this->_hadcs[i])) { goto error_exit; }
+  }
 
-    pvADC = getADCHandleForLineDesc(pvDesc, false);
-    if(!pvADC || !pvADC->Instance) continue;
+  return true;
+
+  error_exit:
+  return false;
+}
+
+/**
+ * Convert an ADC's scan sequence SENSOR_ADC_NB_SEQUENCES times in a single DMA transfer,
+ * then compute each line's average value and peak to peak noise.
+ *
+ * The DMA transfer is polled; its interrupt is not used.
+ *
+ * @param[in] pvADC the ADC handle. MUST be NOT NULL, and its sequence configured.
+ *
+ * @return true  on success.
+ * @return false otherwise.
+ */
+bool SensorADC::readSequence(ADC_HandleTypeDef *pvADC)
+{
+  uint16_t     samples[SENSOR_ADC_LINES_COUNT * SENSOR_ADC_NB_SEQUENCES];
+  ADCLineStats stats;
+  uint32_t     start;
+  uint8_t      i, rank, nb;
+
+  nb = (uint8_t)pvADC->Init.NbrOfConversion;
+
+  // Set up the DMA channel for this ADC
+  ADC_DMA_ENABLE_CLOCK();
+  _hdma.Instance                 = ADC_DMA_CHANNEL;
+  _hdma.Init.Request             = ADC_DMA_REQUEST;
+  _hdma.Init.Direction           = DMA_PERIPH_TO_MEMORY;
+  _hdma.Init.PeriphInc           = DMA_PINC_DISABLE;
+  _hdma.Init.MemInc              = DMA_MINC_ENABLE;
+  _hdma.Init.PeriphDataAlignment = DMA_PDATAALIGN_HALFWORD;
+  _hdma.Init.MemDataAlignment    = DMA_MDATAALIGN_HALFWORD;
+  _hdma.Init.Mode                = DMA_NORMAL;
+  _hdma.Init.Priority            = DMA_PRIORITY_MEDIUM;
+  if(HAL_DMA_Init(&_hdma) != HAL_OK) { goto error_exit; }
+  __HAL_LINKDMA(pvADC, DMA_Handle, _hdma);
+
+  // Convert the sequences
+  if(HAL_ADC_Start_DMA(pvADC, (uint32_t *)samples, nb * SENSOR_ADC_NB_SEQUENCES) != HAL_OK) { goto error_exit; }
+  start = HAL_GetTick();
+  while(!__HAL_DMA_GET_FLAG(&_hdma, __HAL_DMA_GET_TC_FLAG_INDEX(&_hdma)))
+  {
+    if(HAL_GetTick() - start >= ADC_CONV_TIMEOUT_MS)
+    {
+      HAL_ADC_Stop_DMA(pvADC);
+      goto error_exit;
+    }
+  }
+  // The ADC converts continuously until it is stopped; the DMA is still seen as busy, so it is aborted cleanly
+  HAL_ADC_Stop_DMA(pvADC);
+
+  // Compute the statistics
+  for(i = 0, rank = 0; i < SENSOR_ADC_LINES_COUNT; i++)
+  {
+    const ADCLineDesc *pvDesc = &_adcDescs[i];
+    if(!(pvDesc->idFlag & this->_adcLines) || pvDesc->pvADC != pvADC->Instance) continue;
 
-    // Configure the channel
-    channelConfig.Channel      = pvDesc->adcChannel;
-    channelConfig.Rank         = ADC_REGULAR_RANK_1;
-    channelConfig.SamplingTime = ADC_SAMPLETIME_640CYCLES_5;
-    channelConfig.SingleDiff   = ADC_SINGLE_ENDED;
-    channelConfig.OffsetNumber = ADC_OFFSET_NONE;
-    channelConfig.Offset       = 0;
-
-    // Start conversion
-    if( HAL_ADC_ConfigChannel(    pvADC, &channelConfig)      != HAL_OK ||
-	HAL_ADC_Start(            pvADC)                      != HAL_OK ||
-	HAL_ADC_PollForConversion(pvADC, ADC_CONV_TIMEOUT_MS) != HAL_OK) { goto error_exit; }
-
-    // Compute voltage
-    v = HAL_ADC_GetValue(pvADC);
-    this->_adcValuesMV[pvDesc->id - 1] = (v * VDDA_VOLTAGE_MV) / 4095;
+    stats.reset();
+    stats.addFromSequences(samples, SENSOR_ADC_NB_SEQUENCES, nb, rank++);
+    this->_adcValuesMV[pvDesc->id - 1] = stats.valueMV(VDDA_VOLTAGE_MV);
+    this->_adcNoiseMV[ pvDesc->id - 1] = stats.noiseMV(VDDA_VOLTAGE_MV);
   }
 
   return true;
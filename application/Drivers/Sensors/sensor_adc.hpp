@@ -8,6 +8,7 @@
 #define SENSORS_SENSOR_ADC_HPP_
 
 #include "sensor.hpp"
+#include "sensor_adc_stats.hpp"
 #include "board.h"
 
 
@@ -65,6 +66,7 @@ protected:
   void         setADCLine( ADCLine      adcLine);
   ADCLineFlags adcLines() const               { return this->_adcLines;                          }
   uint32_t     adcValueMV(ADCLine line) const { return this->_adcValuesMV[line - ADC_LINE_ANA1]; }
+  uint32_t     adcNoiseMV(ADCLine line) const { return this->_adcNoiseMV[ line - ADC_LINE_ANA1]; }
 
   static const ADCLineDesc *lineDescUsingName(const char *psName);
 
@@ -77,14 +79,20 @@ private:
   void init(ADCLineFlags adcLines);
 
   ADC_HandleTypeDef *getADCHandleForLineDesc(const ADCLineDesc *pvDesc, bool create);
+  bool               configureSequence(      ADC_HandleTypeDef *pvADC);
+  bool               restoreCalibration(     ADC_HandleTypeDef *pvADC);
+  bool               readSequence(           ADC_HandleTypeDef *pvADC);
 
 
 private:
   ADCLineFlags      _adcLines;                            ///< The ADC lines used by the sensor.
-  uint32_t          _adcValuesMV[SENSOR_ADC_LINES_COUNT]; ///< The ADC values, in millivolts.
+  uint32_t          _adcValuesMV[SENSOR_ADC_LINES_COUNT]; ///< The ADC values, in millivolts; averaged over the scan sequences.
+  uint32_t          _adcNoiseMV[ SENSOR_ADC_LINES_COUNT]; ///< The ADC values' peak to peak noise, in millivolts, over the scan sequences.
   ADC_HandleTypeDef _hadcs[      SENSOR_ADC_LINES_COUNT]; ///< The ADC handles.
 
-  static const ADCLineDesc _adcDescs[SENSOR_ADC_LINES_COUNT]; ///< Descriptions of the ADC lines.
+  static const ADCLineDesc   _adcDescs[SENSOR_ADC_LINES_COUNT]; ///< Descriptions of the ADC lines.
+  static ADCCalibrationCache _calibrations;                     ///< The calibration factors, shared by all the sensors.
+  static DMA_HandleTypeDef   _hdma;                             ///< The DMA channel used to read the scan sequences.
 };
 
 
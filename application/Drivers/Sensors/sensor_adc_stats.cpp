@@ -0,0 +1,146 @@
+/**
+ * Statistics of the ADC scan sequences, and cache of the ADC calibration factors, used by SensorADC.
+ *
+ * @date   2019
+ */
+#include <string.h>
+#include "sensor_adc_stats.hpp"
+
+
+/**
+ * Reset the statistics.
+ */
+void ADCLineStats::reset()
+{
+  this->_sum       = 0;
+  this->_min       = 0xFFFF;
+  this->_max       = 0;
+  this->_nbSamples = 0;
+}
+
+/**
+ * Add a value to the statistics.
+ *
+ * @param[in] value the 12 bits value.
+ */
+void ADCLineStats::add(uint16_t value)
+{
+  this->_sum += value;
+  if(value < this->_min) { this->_min = value; }
+  if(value > this->_max) { this->_max = value; }
+  this->_nbSamples++;
+}
+
+/**
+ * Add a line's values from scan sequences converted in a single DMA transfer.
+ *
+ * The transfer's buffer holds the sequences one after the other,
+ * each one with a value per line, in the sequence's rank order.
+ *
+ * @param[in] pu16Samples the DMA buffer. MUST be NOT NULL, with nbSequences * nbRanks values.
+ * @param[in] nbSequences the number of sequences in the buffer.
+ * @param[in] nbRanks     the number of lines in a sequence.
+ * @param[in] rank        the line's rank in the sequence, from 0. MUST be < nbRanks.
+ */
+void ADCLineStats::addFromSequences(const uint16_t *pu16Samples, uint8_t nbSequences, uint8_t nbRanks, uint8_t rank)
+{
+  for(uint8_t seq = 0; seq < nbSequences; seq++) { add(pu16Samples[seq * nbRanks + rank]); }
+}
+
+/**
+ * Get the average value.
+ *
+ * @param[in] vrefMV the ADC's reference voltage, in millivolts.
+ *
+ * @return the average value, in millivolts, rounded to the nearest millivolt.
+ * @return 0 if there is no value.
+ */
+uint32_t ADCLineStats::valueMV(uint32_t vrefMV) const
+{
+  if(!this->_nbSamples) { return 0; }
+  return (this->_sum * vrefMV + this->_nbSamples * ADC_FULL_SCALE / 2) / (this->_nbSamples * ADC_FULL_SCALE);
+}
+
+/**
+ * Get the peak to peak noise.
+ *
+ * @param[in] vrefMV the ADC's reference voltage, in millivolts.
+ *
+ * @return the difference between the maximum and the minimum values, in millivolts.
+ * @return 0 if there is no value.
+ */
+uint32_t ADCLineStats::noiseMV(uint32_t vrefMV) const
+{
+  if(!this->_nbSamples) { return 0; }
+  return ((uint32_t)(this->_max - this->_min) * vrefMV) / ADC_FULL_SCALE;
+}
+
+
+/**
+ * Empty the cache.
+ */
+void ADCCalibrationCache::clear()
+{
+  memset(this->_entries, 0, sizeof(this->_entries));
+}
+
+/**
+ * Get the entry used by an ADC.
+ *
+ * @param[in] pvADC the ADC. MUST be NOT NULL.
+ *
+ * @return the ADC's entry.
+ * @return the first unused entry if the ADC has none.
+ * @return NULL if the ADC has no entry and all of them are used.
+ */
+const ADCCalibrationCache::Entry *ADCCalibrationCache::entryForADC(const void *pvADC) const
+{
+  for(uint8_t i = 0; i < ADC_CALIBRATION_CACHE_NB_ENTRIES_MAX; i++)
+  {
+    if(!this->_entries[i].pvADC || this->_entries[i].pvADC == pvADC) { return &this->_entries[i]; }
+  }
+
+  return NULL;
+}
+
+/**
+ * Get an ADC's calibration factor, if it is recent enough.
+ *
+ * @param[in]  pvADC      the ADC. MUST be NOT NULL.
+ * @param[in]  now        the current date, in seconds since 2000-01-01 00:00:00.
+ * @param[out] pu32Factor where the factor is written to. MUST be NOT NULL.
+ *
+ * @return true  if a factor younger than the maximum age has been found.
+ * @return false otherwise.
+ */
+bool ADCCalibrationCache::get(const void *pvADC, uint32_t now, uint32_t *pu32Factor) const
+{
+  const Entry *pvEntry = entryForADC(pvADC);
+
+  if(!pvEntry || !pvEntry->pvADC || now - pvEntry->ts >= this->_maxAgeSec) { return false; }
+
+  *pu32Factor = pvEntry->factor;
+  return true;
+}
+
+/**
+ * Store an ADC's new calibration factor.
+ *
+ * @param[in] pvADC  the ADC. MUST be NOT NULL.
+ * @param[in] now    the current date, in seconds since 2000-01-01 00:00:00.
+ * @param[in] factor the factor.
+ *
+ * @return true  on success.
+ * @return false if the ADC has no entry and all of them are used.
+ */
+bool ADCCalibrationCache::set(const void *pvADC, uint32_t now, uint32_t factor)
+{
+  Entry *pvEntry = (Entry *)entryForADC(pvADC);
+
+  if(!pvEntry) { return false; }
+
+  pvEntry->pvADC  = pvADC;
+  pvEntry->factor = factor;
+  pvEntry->ts     = now;
+  return true;
+}
@@ -0,0 +1,80 @@
+/**
+ * Statistics of the ADC scan sequences, and cache of the ADC calibration factors, used by SensorADC.
+ *
+ * Kept apart from the sensor so that they can be checked on the host.
+ *
+ * @date   2019
+ */
+#pragma once
+
+#include "defs.h"
+
+
+#define ADC_FULL_SCALE                       4095  ///< The 12 bits ADC's full scale value.
+#define ADC_CALIBRATION_CACHE_NB_ENTRIES_MAX 3     ///< The maximum number of ADCs whose factor can be cached.
+
+
+/**
+ * Average value and peak to peak noise, in millivolts, of an ADC line over several scan sequences.
+ *
+ * The values are the 12 bits results, after the hardware oversampler's shift.
+ * The average is rounded to the nearest millivolt, the noise is truncated.
+ * The sum is computed on 32 bits: up to 300 samples can be added with a 3.5 V reference.
+ */
+class ADCLineStats
+{
+public:
+  ADCLineStats() { reset(); }
+
+  void     reset();
+  void     add(uint16_t value);
+  void     addFromSequences(const uint16_t *pu16Samples, uint8_t nbSequences, uint8_t nbRanks, uint8_t rank);
+
+  uint16_t nbSamples()               const { return this->_nbSamples; }
+  uint32_t valueMV(uint32_t vrefMV)  const;
+  uint32_t noiseMV(uint32_t vrefMV)  const;
+
+
+private:
+  uint32_t _sum;        ///< The sum of the values.
+  uint16_t _min;        ///< The minimum value.
+  uint16_t _max;        ///< The maximum value.
+  uint16_t _nbSamples;  ///< The number of values.
+};
+
+
+/**
+ * The ADC calibration factors, cached per ADC, with the date they were computed at.
+ *
+ * A factor older than the maximum age is not returned, so that the ADC is calibrated again.
+ * The ages are computed modulo 2^32 seconds; a factor dated in the future, because the RTC has been
+ * set back, is seen as very old.
+ * The entries are used in order and never freed.
+ */
+class ADCCalibrationCache
+{
+public:
+  ADCCalibrationCache(uint32_t maxAgeSec) : _maxAgeSec(maxAgeSec) { clear(); }
+
+  void clear();
+  bool get(const void *pvADC, uint32_t now, uint32_t *pu32Factor) const;
+  bool set(const void *pvADC, uint32_t now, uint32_t  factor);
+
+
+private:
+  /**
+   * Defines a cached ADC calibration factor.
+   */
+  typedef struct Entry
+  {
+    const void *pvADC;   ///< The ADC the factor is for. NULL if the entry is not used.
+    uint32_t    factor;  ///< The calibration factor.
+    uint32_t    ts;      ///< When the calibration was done, in seconds since 2000-01-01 00:00:00.
+  }
+  Entry;
+
+  const Entry *entryForADC(const void *pvADC) const;
+
+  Entry    _entries[ADC_CALIBRATION_CACHE_NB_ENTRIES_MAX];  ///< The entries.
+  uint32_t _maxAgeSec;                                      ///< The maximum age of a factor, in seconds.
+};
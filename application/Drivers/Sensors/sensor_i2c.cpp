@@ -16,6 +16,11 @@
 #define logger  sensor_i2c
 
 
+// Several sensors can be opened at the same time on a same interface, during overlapped acquisitions.
+// The interface is only set up by the first one, and released by the last one.
+uint8_t SensorI2C::_nbBusUsers[INTERFACE_COUNT] = { 0 };
+
+
 /**
  * Constructor.
  *
@@ -38,8 +43,9 @@ Sensor(power, powerSleep, features)
 {
   this->_interface  = interface;
   this->_address    = baseAddress;
-  this->_endianness = endianness;
-  this->_options    = options;
+  this->_endianness  = endianness;
+  this->_options     = options;
+  this->_busIsOpened = false;
 }
 
 /**
@@ -78,6 +84,16 @@ bool SensorI2C::openSpecific()
 {
   GPIO_InitTypeDef init;
 
+  if(this->_interface >= INTERFACE_COUNT)
+  {
+    log_error_sensor(logger, "Unknown I2C interface '%d'.", this->_interface);
+    goto error_exit;
+  }
+
+  // Only set up the interface if no other sensor is using it;
+  // resetting it would break the other sensors' transfers.
+  if(this->_busIsOpened || _nbBusUsers[this->_interface]) { goto init_handle; }
+
   // Configure GPIOs
   init.Mode  = GPIO_MODE_AF_OD;
   init.Pull  = GPIO_NOPULL;
@@ -102,8 +118,6 @@ bool SensorI2C::openSpecific()
       // Configure I2C module stuff
       HAL_I2CEx_ConfigAnalogFilter( &this->_hi2c, I2C_INTERNAL_FILTER_ANALOG);
       HAL_I2CEx_ConfigDigitalFilter(&this->_hi2c, I2C_INTERNAL_FILTER_DIGITAL);
-      this->_hi2c.Instance    = PASTER2(I2C, I2C_INTERNAL_ID);
-      this->_hi2c.Init.Timing = I2C_INTERNAL_TIMING;
       break;
 
     case INTERFACE_EXTERNAL:
@@ -122,15 +136,28 @@ bool SensorI2C::openSpecific()
       // Configure I2C module stuff
       HAL_I2CEx_ConfigAnalogFilter( &this->_hi2c,  I2C_EXTERNAL_FILTER_ANALOG);
       HAL_I2CEx_ConfigDigitalFilter(&this->_hi2c,  I2C_EXTERNAL_FILTER_DIGITAL);
-      this->_hi2c.Instance    = PASTER2(I2C, I2C_EXTERNAL_ID);
-      this->_hi2c.Init.Timing = I2C_EXTERNAL_TIMING;
       break;
 
     default:
-      log_error_sensor(logger, "Unknown I2C interface '%d'.", this->_interface);
-      goto error_exit;
+      ; // Cannot happen; checked above.
   }
 
+  init_handle:
+  if(this->_interface == INTERFACE_INTERNAL)
+  {
+    this->_hi2c.Instance    = PASTER2(I2C, I2C_INTERNAL_ID);
+    this->_hi2c.Init.Timing = I2C_INTERNAL_TIMING;
+  }
+  else
+  {
+    this->_hi2c.Instance    = PASTER2(I2C, I2C_EXTERNAL_ID);
+    this->_hi2c.Init.Timing = I2C_EXTERNAL_TIMING;
+  }
+  if(!this->_busIsOpened)
+  {
+    _nbBusUsers[this->_interface]++;
+    this->_busIsOpened = true;
+  }
 
   // Init I2C module
   this->_hi2c.Init.OwnAddress1      = 0;
@@ -153,6 +180,11 @@ bool SensorI2C::openSpecific()
  */
 void SensorI2C::closeSpecific()
 {
+  // Only release the interface once the last sensor using it is closed.
+  if(!this->_busIsOpened) { return; }
+  this->_busIsOpened = false;
+  if(--_nbBusUsers[this->_interface]) { return; }
+
   HAL_I2C_DeInit(&this->_hi2c);
   switch(this->_interface)
   {
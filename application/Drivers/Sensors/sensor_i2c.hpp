@@ -23,7 +23,8 @@ protected:
   typedef enum Interface
   {
     INTERFACE_INTERNAL,
-    INTERFACE_EXTERNAL
+    INTERFACE_EXTERNAL,
+    INTERFACE_COUNT      ///< Not an actual interface; used to count them.
   }
   Interface;
 
@@ -112,6 +113,9 @@ private:
   I2CAddress        _address;     ///< The sensor's i2C address.
   Endianness        _endianness;  ///< The order of the data bytes in the device's registers.
   Options           _options;     ///< The I2C sensor's options.
+  bool              _busIsOpened; ///< Does this sensor hold a reference on its interface?
+
+  static uint8_t    _nbBusUsers[INTERFACE_COUNT];  ///< The number of sensors holding a reference on each interface.
 };
 
 
@@ -0,0 +1,425 @@
+/**
+ * Store for the sensors' states.
+ *
+ * @date   2019
+ */
+#include <string.h>
+#include <stddef.h>
+#include "sensorstatestore.hpp"
+#include "sdcard.h"
+#include "murmur3.h"
+#include "logger.h"
+
+
+  CREATE_LOGGER(sensorstatestore);
+#undef  logger
+#define logger  sensorstatestore
+
+
+#define SENSOR_STATE_STORE_FILE_SIZE        (SENSOR_STATE_STORE_NB_SLOTS * 2 * sizeof(Record))
+#define SENSOR_STATE_STORE_RETENTION_MAGIC  0x53535402  // "SST" and format version 2.
+
+
+SensorStateStore::Retained SensorStateStore::_retained RETAINED;
+SensorStateStore         *SensorStateStore::_pvInstance = NULL;
+
+
+/**
+ * Get the store's unique instance.
+ *
+ * @return the instance.
+ */
+SensorStateStore *SensorStateStore::instance()
+{
+  if(!_pvInstance) { _pvInstance = new SensorStateStore(); }
+
+  return _pvInstance;
+}
+
+/**
+ * Constructor.
+ */
+SensorStateStore::SensorStateStore()
+{
+  this->_isOpened = false;
+}
+
+/**
+ * Seal the retained slots; to be called each time they are modified.
+ */
+void SensorStateStore::seal()
+{
+  retention_seal(&_retained.header, _retained.slots, sizeof(_retained.slots),
+		 SENSOR_STATE_STORE_RETENTION_MAGIC);
+}
+
+
+/**
+ * Compute a record's checksum.
+ *
+ * @param[in] pvRecord the record. MUST be NOT NULL and its size MUST be valid.
+ *
+ * @return the checksum.
+ */
+uint32_t SensorStateStore::recordCheck(const Record *pvRecord)
+{
+  MM332Stream stream;
+
+  mm3_32_stream_init_cnss(&stream);
+  mm3_32_stream_digest(   &stream, (const uint8_t *)pvRecord, offsetof(Record, check));
+  mm3_32_stream_digest(   &stream, pvRecord->data,            pvRecord->size);
+
+  return mm3_32_stream_finish(&stream);
+}
+
+/**
+ * Get a record's position in the store's file.
+ *
+ * @param[in] slot the slot's index.
+ * @param[in] copy the record's index in the slot: 0 or 1.
+ *
+ * @return the position, in bytes.
+ */
+uint32_t SensorStateStore::recordOffset(uint8_t slot, uint8_t copy)
+{
+  return (slot * 2 + copy) * sizeof(Record);
+}
+
+
+/**
+ * Restore the slots from the retained memory or, if it is not valid, read them from disk.
+ * Only done once.
+ *
+ * On disk, for each slot, the valid record with the most recent sequence number is used.
+ *
+ * @return true  on success, or if the store's file does not exist yet.
+ * @return false otherwise.
+ */
+bool SensorStateStore::open()
+{
+  File    file;
+  Record  record;
+  Slot   *pvSlot;
+  uint8_t i, c;
+  bool    res = true;
+
+  if(this->_isOpened) { return true; }
+  this->_isOpened = true;
+
+  if(retention_is_valid(&_retained.header, _retained.slots, sizeof(_retained.slots),
+			SENSOR_STATE_STORE_RETENTION_MAGIC))
+  {
+    log_info(logger, "Sensors' states restored from retained memory.");
+    return true;
+  }
+  memset(_retained.slots, 0, sizeof(_retained.slots));
+
+  if(!sdcard_exists(SENSOR_STATE_STORE_FILENAME))
+  {
+    log_info(logger, "Sensors' state store does not exist yet.");
+    goto exit;
+  }
+  if(!sdcard_fopen(&file, SENSOR_STATE_STORE_FILENAME, FILE_OPEN | FILE_READ))
+  {
+    log_error(logger, "Failed to open sensors' state store in read mode.");
+    res = false;
+    goto exit;
+  }
+
+  for(i = 0; i < SENSOR_STATE_STORE_NB_SLOTS; i++)
+  {
+    pvSlot = &_retained.slots[i];
+    for(c = 0; c < 2; c++)
+    {
+      if(!sdcard_fread(&file, (uint8_t *)&record, sizeof(record))) { goto read_done; }
+
+      if(!record.size || record.size > SENSOR_STATE_STORE_SLOT_DATA_SIZE_MAX ||
+	 record.check != recordCheck(&record)) { continue; }
+      if(pvSlot->used && (int8_t)(record.seq - pvSlot->record.seq) <= 0) { continue; }
+
+      pvSlot->record = record;
+      pvSlot->copy   = c;
+      pvSlot->used   = true;
+    }
+  }
+  read_done:
+  sdcard_fclose(&file);
+
+  exit:
+  seal();
+  return res;
+}
+
+/**
+ * Find the slot used by a sensor.
+ *
+ * @param[in] typeHash the sensor's type hash.
+ * @param[in] channel  the sensor's data channel.
+ * @param[in] idHash   the sensor's unique identifier's hash.
+ * @param[in] allocate allocate a free slot if the sensor does not have one yet?
+ *
+ * @return the slot.
+ * @return NULL if not found and no slot could be allocated.
+ */
+SensorStateStore::Slot *SensorStateStore::findSlot(uint32_t typeHash,
+						   uint8_t  channel,
+						   uint32_t idHash,
+						   bool     allocate)
+{
+  Slot   *pvFree = NULL;
+  uint8_t i;
+
+  for(i = 0; i < SENSOR_STATE_STORE_NB_SLOTS; i++)
+  {
+    Slot *pvSlot = &_retained.slots[i];
+
+    if(!pvSlot->used) { if(!pvFree) { pvFree = pvSlot; } continue; }
+    if(pvSlot->record.typeHash == typeHash &&
+       pvSlot->record.channel  == channel  &&
+       pvSlot->record.idHash   == idHash) { return pvSlot; }
+  }
+  if(!allocate || !pvFree) { return NULL; }
+
+  pvFree->used            = true;
+  pvFree->claimed         = true;
+  pvFree->record.typeHash = typeHash;
+  pvFree->record.idHash   = idHash;
+  pvFree->record.channel  = channel;
+  pvFree->record.size     = 0;
+
+  return pvFree;
+}
+
+/**
+ * Release a slot. Its records on disk are wiped by the next flush().
+ *
+ * @param[in] pvSlot the slot. MUST be NOT NULL.
+ */
+void SensorStateStore::release(Slot *pvSlot)
+{
+  memset(&pvSlot->record, 0, sizeof(pvSlot->record));
+  pvSlot->used    = false;
+  pvSlot->claimed = false;
+  pvSlot->stale   = true;
+  pvSlot->dirty   = true;
+}
+
+
+/**
+ * Start the claims of the configured sensors; all the slots are unclaimed.
+ * To be followed by a call to claim() for each sensor, then by releaseUnclaimed().
+ */
+void SensorStateStore::startClaims()
+{
+  open();
+  for(uint8_t i = 0; i < SENSOR_STATE_STORE_NB_SLOTS; i++) { _retained.slots[i].claimed = false; }
+}
+
+/**
+ * Claim a sensor's slot, if it has one, so that it is not released by releaseUnclaimed().
+ *
+ * @param[in] typeHash the sensor's type hash.
+ * @param[in] channel  the sensor's data channel.
+ * @param[in] idHash   the sensor's unique identifier's hash.
+ */
+void SensorStateStore::claim(uint32_t typeHash, uint8_t channel, uint32_t idHash)
+{
+  Slot *pvSlot;
+
+  if((pvSlot = findSlot(typeHash, channel, idHash, false))) { pvSlot->claimed = true; }
+}
+
+/**
+ * Release the slots that have not been claimed since the last call to startClaims(),
+ * so that the states of the sensors that have been removed from the configuration
+ * do not use the slots forever.
+ */
+void SensorStateStore::releaseUnclaimed()
+{
+  uint8_t i, nb = 0;
+
+  for(i = 0; i < SENSOR_STATE_STORE_NB_SLOTS; i++)
+  {
+    if(_retained.slots[i].used && !_retained.slots[i].claimed) { release(&_retained.slots[i]); nb++; }
+  }
+  if(nb)
+  {
+    log_info(logger, "%u sensors' states are not used anymore and have been released.", nb);
+    seal();
+  }
+}
+
+/**
+ * Release all the slots.
+ */
+void SensorStateStore::releaseAll()
+{
+  open();
+  for(uint8_t i = 0; i < SENSOR_STATE_STORE_NB_SLOTS; i++)
+  {
+    if(_retained.slots[i].used) { release(&_retained.slots[i]); }
+  }
+  seal();
+}
+
+
+/**
+ * Get a sensor's state.
+ *
+ * @param[in]  typeHash the sensor's type hash.
+ * @param[in]  channel  the sensor's data channel.
+ * @param[in]  idHash   the sensor's unique identifier's hash.
+ * @param[out] pu8Data  where the state is written to. MUST be NOT NULL.
+ * @param[in]  size     the state's size, in bytes.
+ *
+ * @return true  on success.
+ * @return false if there is no state for this sensor, or if the stored state's size does not match.
+ */
+bool SensorStateStore::load(uint32_t typeHash, uint8_t channel, uint32_t idHash, uint8_t *pu8Data, uint32_t size)
+{
+  Slot *pvSlot;
+
+  open();
+  if(!(pvSlot = findSlot(typeHash, channel, idHash, false)) || pvSlot->record.size != size) { return false; }
+
+  memcpy(pu8Data, pvSlot->record.data, size);
+  return true;
+}
+
+/**
+ * Set a sensor's state.
+ *
+ * The state is only written to disk by flush().
+ *
+ * @param[in] typeHash the sensor's type hash.
+ * @param[in] channel  the sensor's data channel.
+ * @param[in] idHash   the sensor's unique identifier's hash.
+ * @param[in] pu8Data  the state. MUST be NOT NULL.
+ * @param[in] size     the state's size, in bytes.
+ *
+ * @return true  on success.
+ * @return false if the state is too big or if there is no slot available.
+ */
+bool SensorStateStore::save(uint32_t       typeHash,
+			    uint8_t        channel,
+			    uint32_t       idHash,
+			    const uint8_t *pu8Data,
+			    uint32_t       size)
+{
+  Slot *pvSlot;
+
+  if(!size || size > SENSOR_STATE_STORE_SLOT_DATA_SIZE_MAX)
+  {
+    log_error(logger, "Sensor state's size (%u bytes) is not supported.", (unsigned int)size);
+    return false;
+  }
+  open();
+  if(!(pvSlot = findSlot(typeHash, channel, idHash, true)))
+  {
+    log_error(logger, "No slot available in the sensors' state store.");
+    return false;
+  }
+
+  if(pvSlot->record.size == size && memcmp(pvSlot->record.data, pu8Data, size) == 0) { return true; }
+  memcpy(pvSlot->record.data, pu8Data, size);
+  pvSlot->record.size = size;
+  pvSlot->dirty       = true;
+  seal();
+
+  return true;
+}
+
+/**
+ * Indicate if some states have to be written to disk.
+ *
+ * @return true  if at least one state has to be written.
+ * @return false otherwise.
+ */
+bool SensorStateStore::hasDirtySlots() const
+{
+  for(uint8_t i = 0; i < SENSOR_STATE_STORE_NB_SLOTS; i++)
+  {
+    if(_retained.slots[i].dirty) { return true; }
+  }
+
+  return false;
+}
+
+/**
+ * Write the states that have changed to disk, in one pass.
+ *
+ * Each state is written over its slot's older record; the current one is left untouched
+ * until the new one has been written.
+ * Both records of a released slot are wiped first.
+ *
+ * @return true  on success, or if there was nothing to write.
+ * @return false otherwise.
+ */
+bool SensorStateStore::flush()
+{
+  File    file;
+  Slot   *pvSlot;
+  Record  blank;
+  uint8_t i, copy;
+  bool    res = true;
+
+  if(!hasDirtySlots()) { goto exit; }
+  memset(&blank, 0, sizeof(blank));
+
+  if(!sdcard_fopen(&file, SENSOR_STATE_STORE_FILENAME, FILE_OPEN_OR_CREATE | FILE_READ_WRITE))
+  {
+    log_error(logger, "Failed to open sensors' state store in write mode.");
+    res = false;
+    goto exit;
+  }
+  // Allocate the whole file at once, so that writing a record never changes the FAT.
+  if(sdcard_fsize(&file) < SENSOR_STATE_STORE_FILE_SIZE &&
+     !sdcard_ftruncateTo(&file, SENSOR_STATE_STORE_FILE_SIZE, true))
+  {
+    log_error(logger, "Failed to allocate sensors' state store.");
+    res = false;
+    goto close_exit;
+  }
+
+  for(i = 0; i < SENSOR_STATE_STORE_NB_SLOTS; i++)
+  {
+    pvSlot = &_retained.slots[i];
+    if(!pvSlot->dirty) { continue; }
+
+    if(pvSlot->stale)
+    {
+      if(!sdcard_fseek_abs(&file, recordOffset(i, 0))                 ||
+	 !sdcard_fwrite(   &file, (uint8_t *)&blank, sizeof(Record))  ||
+	 !sdcard_fwrite(   &file, (uint8_t *)&blank, sizeof(Record)))
+      {
+	log_error(logger, "Failed to wipe released slot %u.", i);
+	res = false;
+	continue;
+      }
+      pvSlot->stale = false;
+      if(!pvSlot->used) { pvSlot->dirty = false; continue; }
+    }
+
+    copy                 = pvSlot->copy ^ 1;
+    pvSlot->record.seq++;
+    pvSlot->record.check = recordCheck(&pvSlot->record);
+    if(!sdcard_fseek_abs(&file, recordOffset(i, copy)) ||
+       !sdcard_fwrite(   &file, (uint8_t *)&pvSlot->record, sizeof(Record)))
+    {
+      log_error(logger, "Failed to write sensor's state to slot %u.", i);
+      pvSlot->record.seq--;
+      res = false;
+      continue;
+    }
+    pvSlot->copy  = copy;
+    pvSlot->dirty = false;
+  }
+  res &= sdcard_fsync(&file);
+  seal();
+
+  close_exit:
+  sdcard_fclose(&file);
+
+  exit:
+  return res;
+}
@@ -0,0 +1,117 @@
+/**
+ * Store for the sensors' states.
+ *
+ * All the states are kept in a single file made of fixed size slots.
+ * Each slot is identified by a sensor's type hash, data channel and unique identifier's hash,
+ * like the per-sensor state files used to be named, and is double-buffered:
+ * it has two records on disk, each one with a sequence number and a checksum.
+ * A new state is always written over the older record, so a power loss during a write
+ * never corrupts the last valid state.
+ *
+ * The states are cached in RAM. Saving a state only marks its slot as dirty;
+ * the dirty slots are written in one pass by flush(), before going to sleep.
+ * The cache is retained in SRAM2, so after a reset the states, including the ones not
+ * written to disk yet, are not read again from disk.
+ *
+ * The slots that no configured sensor claims anymore are released when the configuration is loaded;
+ * their records are wiped from disk at the next flush.
+ *
+ * @date   2019
+ */
+#ifndef SENSORS_SENSORSTATESTORE_HPP_
+#define SENSORS_SENSORSTATESTORE_HPP_
+
+#include "defs.h"
+#include "config.h"
+#include "retention.h"
+#include "cnssrf-dataframe.h"
+
+
+/**
+ * The maximum number of states that can be stored: a state and a report on change reference
+ * for each sensor of a fully configured node, on the data channels 1 to 15 (CONNECSENS_NB_SENSOR_MAX).
+ */
+#ifndef SENSOR_STATE_STORE_NB_SLOTS
+#define SENSOR_STATE_STORE_NB_SLOTS              (CNSSRF_DATA_CHANNEL_15 * 2)
+#endif
+#ifndef SENSOR_STATE_STORE_SLOT_DATA_SIZE_MAX
+#define SENSOR_STATE_STORE_SLOT_DATA_SIZE_MAX    96  ///< The maximum size of a state, in bytes.
+#endif
+
+
+class SensorStateStore
+{
+public:
+  static SensorStateStore *instance();
+
+  bool load( uint32_t typeHash, uint8_t channel, uint32_t idHash,       uint8_t *pu8Data, uint32_t size);
+  bool save( uint32_t typeHash, uint8_t channel, uint32_t idHash, const uint8_t *pu8Data, uint32_t size);
+  bool flush();
+  bool hasDirtySlots() const;
+
+  void startClaims();
+  void claim(uint32_t typeHash, uint8_t channel, uint32_t idHash);
+  void releaseUnclaimed();
+  void releaseAll();
+
+
+private:
+  /**
+   * Defines a slot's record, as written to disk.
+   */
+  typedef struct Record
+  {
+    uint32_t typeHash;  ///< The sensor's type hash.
+    uint32_t idHash;    ///< The sensor's unique identifier's hash. 0 if the sensor has no unique identifier.
+    uint8_t  channel;   ///< The sensor's data channel.
+    uint8_t  seq;       ///< The sequence number. The valid record with the most recent one is the current one.
+    uint16_t size;      ///< The state's size, in bytes. 0 if the record is not used.
+    uint32_t check;     ///< The record's checksum. Computed on the fields above and on the state.
+    uint8_t  data[SENSOR_STATE_STORE_SLOT_DATA_SIZE_MAX];  ///< The state.
+  }
+  Record;
+
+  /**
+   * Defines a slot, as stored in RAM.
+   */
+  typedef struct Slot
+  {
+    Record  record;       ///< The current record.
+    uint8_t copy    : 1;  ///< The index of the current record on disk.
+    uint8_t used    : 1;  ///< Is the slot used?
+    uint8_t dirty   : 1;  ///< Has the record to be written to disk?
+    uint8_t claimed : 1;  ///< Has the slot been claimed by a configured sensor?
+    uint8_t stale   : 1;  ///< Have the slot's records on disk to be wiped, as it has been released?
+  }
+  Slot;
+
+  /**
+   * Defines the store's data retained in SRAM2.
+   */
+  typedef struct Retained
+  {
+    RetentionHeader header;                             ///< The retention header.
+    Slot            slots[SENSOR_STATE_STORE_NB_SLOTS]; ///< The slots.
+  }
+  Retained;
+
+
+private:
+  SensorStateStore();
+
+  bool            open();
+  Slot           *findSlot(uint32_t typeHash, uint8_t channel, uint32_t idHash, bool allocate);
+  void            release( Slot *pvSlot);
+  static uint32_t recordCheck( const Record *pvRecord);
+  static uint32_t recordOffset(uint8_t slot, uint8_t copy);
+  static void     seal();
+
+
+private:
+  bool  _isOpened;                       ///< Have the slots been restored or read from disk?
+
+  static Retained          _retained;    ///< The slots, retained in SRAM2.
+  static SensorStateStore *_pvInstance;  ///< The unique instance of this class.
+};
+
+#endif /* SENSORS_SENSORSTATESTORE_HPP_ */
@@ -76,9 +76,14 @@
 //#define LOGGER_DISABLE_LEVEL_TRACE
 
 
+//==================== Tracing ==========================
+//#define TRACE_CATEGORIES  TRACE_CATEGORY_ALL  // Define this to trace execution to LOG_DIRECTORY_NAME "/trace.bin". See trace.h.
+
+
 //==================== Sensors ==========================
 
 #define SENSOR_STATE_DIR     PRIVATE_DATA_DIRECTORY_NAME "/sensors"
+#define SENSOR_STATE_STORE_FILENAME  SENSOR_STATE_DIR "/states.bin"
 
 //===================== Datalog files ===================
 #define DATALOG_DIR          ENV_DIRECTORY_NAME "/datalogs"
@@ -101,6 +106,10 @@
 #define SDCARD_USE_DMA
 
 
+//==================== LoRa radio =====================
+#define LORA_RADIO_SPI_USE_DMA  // Use DMA for the radio's large SPI transfers, like the FIFO's.
+
+
 // Serial debug
 #define DEBUG_SERIAL_BAUDRATE 115200
 
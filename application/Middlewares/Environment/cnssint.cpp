@@ -9,6 +9,7 @@
 #include "board.h"
 #include "cnssintclient.hpp"
 #include "logger.h"
+#include "perfcounters.h"
 #include "rtc.h"
 
 
@@ -56,7 +57,9 @@ const CNSSInt::IntConfig CNSSInt::_intConfigs[INTERRUPTION_COUNT + 1] =
 };
 
 
-CNSSInt *CNSSInt::_pvInstance = NULL;
+CNSSInt          *CNSSInt::_pvInstance = NULL;
+volatile uint32_t CNSSInt::_irqTsMs    = 0;
+volatile bool     CNSSInt::_irqPending = false;
 
 
 /**
@@ -83,6 +86,7 @@ CNSSInt::CNSSInt()
     pv_ip->flag               = (IntFlag)(1u << i);
     pv_ip->debounceMs         = CNSSINT_DEBOUNCE_TIME_MS_DEFAULT;
     pv_ip->lastActivationTsMs = 0;
+    this->_dispatchTable[i]   = 0;
   }
 
   // Initialise physical lines
@@ -327,6 +331,7 @@ bool CNSSInt::registerClient(CNSSIntClient &client, Interruptions sensitivityMas
     pvClient->pvClient        = &client;
     pvClient->sensitivityMask = sensitivityMask;
   }
+  buildDispatchTable();
 
   // Activate hardware interruptions if we need to
   if(containsExternalInterrupt(sensitivityMask) && !this->_sensitiveToExternalInterruption)
@@ -389,6 +394,7 @@ void CNSSInt::unregisterClient(CNSSIntClient &client)
     this->_clients[i].pvClient        = this->_clients[i + 1].pvClient;
     this->_clients[i].sensitivityMask = this->_clients[i + 1].sensitivityMask;
   }
+  buildDispatchTable();
 
   // See if we have to de-activate a hardware interruption
   Interruptions sensitivityMask = INT_FLAG_NONE;
@@ -411,6 +417,24 @@ void CNSSInt::unregisterClient(CNSSIntClient &client)
 }
 
 
+/**
+ * Build the dispatch table, that gives, for each interruption, the clients listening to it.
+ * Must be called each time the client list or a client's sensitivity changes.
+ */
+void CNSSInt::buildDispatchTable()
+{
+  for(uint8_t id = 0; id < INTERRUPTION_COUNT; id++)
+  {
+    uint32_t clients = 0;
+    for(uint16_t i = 0; i < this->_nbClients; i++)
+    {
+      if(this->_clients[i].sensitivityMask & (1u << id)) { clients |= 1u << i; }
+    }
+    this->_dispatchTable[id] = clients;
+  }
+}
+
+
 /**
  * Return the name corresponding to the alias.
  *
@@ -573,11 +597,17 @@ bool CNSSInt::containsInternalInterrupt(Interruptions ints)
  */
 bool CNSSInt::processInterruptions()
 {
-  uint32_t      pin;
+  uint32_t      pin, pending, clients, irqTsMs;
   bool          internalInterruption;
   bool          externalInterruption;
+  bool          hasIrqTs;
   Interruptions ints = INT_FLAG_NONE;
 
+  // Get the wake up IRQ's timestamp, to measure the interruptions' processing latency
+  irqTsMs     = _irqTsMs;
+  hasIrqTs    = _irqPending;
+  _irqPending = false;
+
   // First process interruptions in a loop to handle rapid bounces
   do
   {
@@ -596,9 +626,11 @@ bool CNSSInt::processInterruptions()
     }
     if(!internalInterruption && !externalInterruption) break;
 
-    // Get individual interruptions
+    // Get individual interruptions; only read the lines of the group(s) that signalled something
     for(const IntConfig *pvIntCfg = _intConfigs; pvIntCfg->psName; pvIntCfg++)
     {
+      if(!(pvIntCfg->internal ? internalInterruption : externalInterruption)) { continue; }
+
       if(HAL_GPIO_ReadPin(gpio_hal_port_and_pin_from_id(pvIntCfg->gpio, &pin), pin) == GPIO_PIN_SET)
       {
 	// Do we need to debounce this interruption?
@@ -639,11 +671,25 @@ bool CNSSInt::processInterruptions()
     return false;
   }
 
-  // Now transmit interruptions to the clients
-  for(uint16_t i = 0; i < this->_nbClients; i++)
+  // Get the clients listening to the interruptions, using the dispatch table
+  clients = 0;
+  for(pending = ints; pending; pending &= pending - 1)
+  {
+    clients |= this->_dispatchTable[__CLZ(__RBIT(pending))];
+  }
+
+  if(clients && hasIrqTs)
   {
-    Client *pvClient = &this->_clients[i];
-    if(pvClient->sensitivityMask & ints) { pvClient->pvClient->processInterruption(ints); }
+    uint32_t latencyMs = board_ms_diff(irqTsMs, board_ms_now());
+    perfcounters_add(PERF_COUNTER_INTERRUPTIONS,   1);
+    perfcounters_add(PERF_COUNTER_INT_LATENCY_MS, latencyMs);
+    log_debug(logger, "Interruptions are dispatched %u ms after the IRQ.", (unsigned int)latencyMs);
+  }
+
+  // Now transmit interruptions to the clients, in the registration order
+  for( ; clients; clients &= clients - 1)
+  {
+    this->_clients[__CLZ(__RBIT(clients))].pvClient->processInterruption(ints);
   }
 
   return true;
@@ -716,6 +762,11 @@ void CNSSInt::USBIrqHandler(void)
  */
 void CNSSInt::dummyIrqHandler(void)
 {
-  // Do nothing; waking up from sleep is enough.
+  // Waking up from sleep is enough; only note when it happened, to measure the processing latency.
+  if(!_irqPending)
+  {
+    _irqTsMs    = board_ms_now();
+    _irqPending = true;
+  }
 }
 
@@ -18,6 +18,9 @@ class CNSSIntClient;  // So that we can use it.
 #ifndef CNSSIT_CLIENT_COUNT_MAX
 #define CNSSIT_CLIENT_COUNT_MAX 20
 #endif
+#if CNSSIT_CLIENT_COUNT_MAX > 32
+#error "CNSSIT_CLIENT_COUNT_MAX cannot be greater than 32; the dispatch table uses 32 bits bit fields."
+#endif
 
 class CNSSInt
 {
@@ -143,6 +146,7 @@ public:
 private:
   CNSSInt();
   void initInterruptLines();
+  void buildDispatchTable();
   void clearInterruptions(GPIOId readGPIO, GPIOId clearGPIO, int32_t clearLevel);
   bool setConfigurationForInterruption(      const char *psName, const JsonObject &json);
   static const char *     resolveAlias(      const char *psName);
@@ -155,12 +159,15 @@ private:
   Client    _clients[CNSSIT_CLIENT_COUNT_MAX]; ///< The list of clients.
   uint32_t  _nbClients;                        ///< The number of registered clients.
   IntParams _intParams[INTERRUPTION_COUNT];    ///< The interruption parameters, in the same order as their identifiers.
+  uint32_t  _dispatchTable[INTERRUPTION_COUNT];///< For each interruption, the bit field of the indexes, in _clients, of the clients listening to it.
   bool      _sensitiveToExternalInterruption;  ///< Are we sensitive to external interruptions?
   bool      _sensitiveToInternalInterruption;  ///< Are we sensitive to internal interruptions?
 
   static const Alias     _aliases[];                          ///< The lists of aliases. End of list indicated with a NULL psAlias.
   static const IntConfig _intConfigs[INTERRUPTION_COUNT + 1]; ///< The list of interrupt configuration. There is a configuration with a NULL psName at the end of the table.
   static CNSSInt        *_pvInstance;                         ///< The unique instance of this class.
+  static volatile uint32_t _irqTsMs;                          ///< Timestamp, in milliseconds, of the first wake up IRQ not processed yet.
+  static volatile bool     _irqPending;                       ///< Is there a wake up IRQ that has not been processed yet?
 };
 
 
@@ -12,7 +12,8 @@
 #include "murmur3.h"
 
 
-#define REFERENCE_FILE                   PRIVATE_DATA_DIRECTORY_NAME "/config.json.ref"
+#define REFERENCE_FILE                   PRIVATE_DATA_DIRECTORY_NAME "/config.json.ref"       ///< Copy of the reference configuration. Only read, to migrate to REFERENCE_HASH_FILE.
+#define REFERENCE_HASH_FILE              PRIVATE_DATA_DIRECTORY_NAME "/config.json.mm3.ref"   ///< Size and murmur3 32 bits hash of the reference configuration.
 #define MANUAL_TIME_REFERENCE_FILE       PRIVATE_DATA_DIRECTORY_NAME "/config.json.manual_time.ref"
 #define TIME_SYNC_METHOD_REFERENCE_FILE  PRIVATE_DATA_DIRECTORY_NAME "/config.json.time_sync_method.ref"
 
@@ -23,8 +24,12 @@ extern "C" {
 #endif
 
 
-  static bool     _config_monitor_hash_mm3_32_is_set;  ///< Has the configuration's murmur3 32 bits hash already been computed?
+  static bool     _config_monitor_hash_mm3_32_is_set;  ///< Has the configuration's murmur3 32 bits hash been set?
   static uint32_t _config_monitor_hash_mm3_32;         ///< The configuration's murmur3 32 bits hash.
+  static uint32_t _config_monitor_size;                ///< The configuration's size, in bytes. Set along with the hash.
+
+
+  static bool config_monitor_hash_file_mm3_32(const char *ps_filename, uint32_t *pu32_size, uint32_t *pu32_hash);
 
 
 
@@ -39,69 +44,65 @@ extern "C" {
   /**
    * Indicate if the configuration file has changed or not.
    *
-   * @param[in] pu8_cfg  the configuration file's data. MUST be NOT NULL.
-   * @param[in] size     the configuration file's size (the amount of data).
-   * @param[in] save     make pu8_cfg the new reference configuration (true), or not (false).
-   *                     If set to true then the next comparison will be done with the data in pu8_cfg.
-   *                     If set to false then the next comparison will be done with the current data.
+   * The comparison is done using the configuration's size and murmur3 32 bits hash.
+   * If there is no hash reference yet, but there is a copy of the reference configuration,
+   * as written by previous versions, then the copy's hash is used.
+   *
+   * @param[in] save make the current configuration the new reference (true), or not (false).
    *
    * @return true  if the configuration file has changed.
    * @return false otherwise.
+   * @return false if the current configuration's hash cannot be computed.
    */
-  bool config_monitor_config_has_changed(const uint8_t *pu8_cfg, uint32_t size, bool save)
+  bool config_monitor_config_has_changed(bool save)
   {
-    File           file;
-    bool           fileOpened, ok;
-    uint8_t        buffer[200];
-    const uint8_t *pu8;
-    uint32_t       nb_read;
-    uint32_t       current_size = 0;
-    bool           res          = false;
-
-    // Open the reference file and get it's size
-    if((fileOpened   = sdcard_fopen( &file, REFERENCE_FILE, FILE_OPEN | FILE_READ)))
-    {
-      current_size   = sdcard_fsize(&file);
-    }
-    if(current_size != size) { res = true; goto exit; }
+    File     file;
+    uint32_t hash, ref[2];
+    bool     res = false;
+
+    if(!config_monitor_hash_mm3_32(&hash)) { goto exit; }
 
-    // Compare the data byte to byte
-    for(pu8 = pu8_cfg, nb_read = 1; nb_read; pu8 += nb_read)
+    // Get the reference
+    if(sdcard_fopen(&file, REFERENCE_HASH_FILE, FILE_OPEN | FILE_READ))
     {
-      // Read a chunk of the reference file
-      nb_read = sdcard_fread_at_most(&file, buffer, sizeof(buffer), &ok);
-      if(!ok || memcmp(pu8, buffer, nb_read) != 0) { res = true; goto exit; }
+      if(!sdcard_fread(&file, (uint8_t *)ref, sizeof(ref))) { ref[0] = ref[1] = 0; }
+      sdcard_fclose(&file);
     }
+    else if(!config_monitor_hash_file_mm3_32(REFERENCE_FILE, &ref[0], &ref[1])) { ref[0] = ref[1] = 0; }
+
+    res = ref[0] != _config_monitor_size || ref[1] != hash;
+
+    if(save && !config_monitor_save_config()) { sdcard_remove(REFERENCE_HASH_FILE); }
 
     exit:
-    if(fileOpened)                                         { sdcard_fclose(&file);          }
-    if(save && !config_monitor_save_config(pu8_cfg, size)) { sdcard_remove(REFERENCE_FILE); }
     return res;
   }
 
 
   /**
-   * Set the configuration reference's data.
-   *
-   * @param[in] pu8_cfg the data to save. MUST be NOT NULL.
-   * @param[in] size    the amount of data to save.
+   * Make the current configuration the reference.
    *
    * @return true  on success.
-   * @return false if size is 0.
+   * @return false if the current configuration's hash cannot be computed.
    * @return false if failed to write to disk.
    */
-  bool config_monitor_save_config(const uint8_t *pu8_cfg, uint32_t size)
-
+  bool config_monitor_save_config(void)
   {
-    File file;
-    bool res;
+    File     file;
+    uint32_t ref[2];
+    bool     res;
 
-    if(!pu8_cfg || !size || !sdcard_fopen(&file, REFERENCE_FILE, FILE_TRUNCATE | FILE_WRITE))
+    if(!config_monitor_hash_mm3_32(&ref[1]) ||
+       !sdcard_fopen(&file, REFERENCE_HASH_FILE, FILE_TRUNCATE | FILE_WRITE))
     { res = false; goto exit; }
+    ref[0] = _config_monitor_size;
 
-    res = sdcard_fwrite(&file, pu8_cfg, size);
+    res = sdcard_fwrite(&file, (const uint8_t *)ref, sizeof(ref));
     sdcard_fclose(      &file);
 
+    // The copy used by previous versions is not needed anymore.
+    if(res && sdcard_exists(REFERENCE_FILE)) { sdcard_remove(REFERENCE_FILE); }
+
     exit:
     return res;
   }
@@ -207,14 +208,49 @@ extern "C" {
 
 
   /**
-   * Computes the configuration's murmur3 32 bits hash.
+   * Set the configuration's size and murmur3 32 bits hash,
+   * when they have been computed while reading the configuration file.
+   *
+   * @param[in] size the configuration's size, in bytes.
+   * @param[in] hash the configuration's hash.
+   */
+  void config_monitor_set_hash_mm3_32(uint32_t size, uint32_t hash)
+  {
+    _config_monitor_size               = size;
+    _config_monitor_hash_mm3_32        = hash;
+    _config_monitor_hash_mm3_32_is_set = true;
+  }
+
+  /**
+   * Get the configuration's murmur3 32 bits hash.
+   *
+   * The hash is the one computed by the configuration reader while checking the file;
+   * the file is not read again.
    *
    * @param[out] pu32_hash where the hash value is written to. MUST be NOT NULL.
    *
    * @return true  on success.
+   * @return false if the hash has not been set.
+   */
+  bool config_monitor_hash_mm3_32(uint32_t *pu32_hash)
+  {
+    *pu32_hash = _config_monitor_hash_mm3_32;
+
+    return _config_monitor_hash_mm3_32_is_set;
+  }
+
+  /**
+   * Computes a file's murmur3 32 bits hash.
+   * Only used for the copy of the reference configuration written by previous versions.
+   *
+   * @param[in]  ps_filename the file's name. MUST be NOT NULL.
+   * @param[out] pu32_size   where the file's size is written to. MUST be NOT NULL.
+   * @param[out] pu32_hash   where the hash value is written to. MUST be NOT NULL.
+   *
+   * @return true  on success.
    * @return false otherwise.
    */
-  extern bool config_monitor_hash_mm3_32(uint32_t *pu32_hash)
+  static bool config_monitor_hash_file_mm3_32(const char *ps_filename, uint32_t *pu32_size, uint32_t *pu32_hash)
   {
     MM332Stream stream;
     uint32_t    size;
@@ -222,24 +258,18 @@ extern "C" {
     File        file;
     bool        res = true;
 
-    // If hash already has been computed then return previous value
-    if(_config_monitor_hash_mm3_32_is_set)
-    {
-     *pu32_hash = _config_monitor_hash_mm3_32;
-      goto exit;
-    }
-
-    // Open configuration file
-    if(!sdcard_fopen(&file, CONFIG_FILE_NAME, FILE_READ)) { res = false; goto exit; }
+    // Open the file
+    if(!sdcard_fopen(&file, ps_filename, FILE_OPEN | FILE_READ)) { res = false; goto exit; }
 
-    // Read the configuration fire chunk by chunk and compute hash
+    // Read the file chunk by chunk and compute hash
+    *pu32_size = 0;
     mm3_32_stream_init_cnss(&stream);
     while((size = sdcard_fread_at_most(&file, buffer, sizeof(buffer), &res)) && res)
     {
       mm3_32_stream_digest(&stream, buffer, size);
+      *pu32_size += size;
     }
-    *pu32_hash = _config_monitor_hash_mm3_32 = mm3_32_stream_finish(&stream);
-    _config_monitor_hash_mm3_32_is_set       = res;
+    *pu32_hash = mm3_32_stream_finish(&stream);
     sdcard_fclose(&file);
 
     exit:
@@ -0,0 +1,347 @@
+/**
+ * Streaming reader for the JSON configuration file.
+ *
+ * @date   2019
+ */
+#include <string.h>
+#include "configreader.hpp"
+#include "sdcard.h"
+#include "murmur3.h"
+#include "logger.h"
+
+
+  CREATE_LOGGER(configreader);
+#undef  logger
+#define logger  configreader
+
+
+/**
+ * Constructor.
+ *
+ * @param[in] pcBuffer the buffer used to capture a member, or an item. MUST be NOT NULL.
+ * @param[in] capacity the buffer's capacity, in bytes.
+ */
+ConfigReader::ConfigReader(char *pcBuffer, uint32_t capacity)
+{
+  this->_pcBuffer        = pcBuffer;
+  this->_capacity        = capacity;
+  this->_phase           = PHASE_CHECK;
+  this->_length          = 0;
+  this->_overflow        = false;
+  this->_state           = STATE_START;
+  this->_depth           = 0;
+  this->_inString        = false;
+  this->_escape          = false;
+  this->_key[0]          = '\0';
+  this->_keyLength       = 0;
+  this->_psStreamedArray = NULL;
+  this->_itemIndex       = 0;
+  this->_pvClient        = NULL;
+  this->_res             = true;
+  this->_offset          = 0;
+  this->_size            = 0;
+  this->_hash            = 0;
+}
+
+
+/**
+ * Read a configuration file and hand over its members, and its streamed array's items,
+ * to a client.
+ *
+ * The file is checked first; nothing is handed over if it has a syntax error, or if one of
+ * its members or items cannot be parsed. Then all the members are handed over before the items.
+ *
+ * @param[in] psFilename      the file's name. MUST be NOT NULL.
+ * @param[in] psStreamedArray the key of the top-level array whose items are handed over one by one.
+ *                            Can be NULL.
+ * @param[in] pvClient        the client. MUST be NOT NULL.
+ *
+ * @return true  on success.
+ * @return false if failed to read the file, if there is a syntax error,
+ *               or if the client failed to handle a member or an item.
+ *               The file's size and hash are still valid if there is a syntax error.
+ */
+bool ConfigReader::read(const char *psFilename, const char *psStreamedArray, Client *pvClient)
+{
+  this->_psStreamedArray = psStreamedArray;
+  this->_pvClient        = pvClient;
+
+  // Check the whole file before handing anything over.
+  this->_phase = PHASE_CHECK;
+  if(!readFile(psFilename)) { return false; }
+
+  // The file is small and its sectors are still in the SD card's cache: reading it again
+  // costs less than keeping the parsed members and items.
+  this->_phase = PHASE_MEMBERS;
+  if(!readFile(psFilename)) { return false; }
+  this->_phase = PHASE_ITEMS;
+  return readFile(psFilename);
+}
+
+/**
+ * Read the configuration file.
+ *
+ * @param[in] psFilename the file's name. MUST be NOT NULL.
+ *
+ * @return true  on success.
+ * @return false otherwise.
+ */
+bool ConfigReader::readFile(const char *psFilename)
+{
+  File        file;
+  MM332Stream stream;
+  uint8_t     chunk[CONFIG_READER_CHUNK_SIZE];
+  uint32_t    size, i;
+  bool        ok, hashing;
+
+  this->_state    = STATE_START;
+  this->_depth    = 0;
+  this->_inString = false;
+  this->_escape   = false;
+  this->_res      = true;
+  this->_offset   = 0;
+  if(this->_phase == PHASE_CHECK) { this->_size = 0; }
+
+  if(!sdcard_fopen(&file, psFilename, FILE_OPEN | FILE_READ))
+  {
+    log_error(logger, "Failed to open configuration file '%s'.", psFilename);
+    return false;
+  }
+
+  // The check pass also hashes the file; after a syntax error it is still read to the end, to get the hash.
+  // The next passes only hand over.
+  hashing = this->_phase == PHASE_CHECK;
+  if(hashing) { mm3_32_stream_init_cnss(&stream); }
+  while((size = sdcard_fread_at_most(&file, chunk, sizeof(chunk), &ok)) && ok)
+  {
+    if(hashing) { mm3_32_stream_digest(&stream, chunk, size); this->_size += size; }
+    for(i = 0; i < size && this->_state != STATE_ERROR; i++, this->_offset++)
+    {
+      parse((char)chunk[i]);
+    }
+  }
+  if(hashing) { this->_hash = mm3_32_stream_finish(&stream); }
+  sdcard_fclose(&file);
+
+  if(!ok)
+  {
+    log_error(logger, "Failed to read configuration file '%s'.", psFilename);
+    return false;
+  }
+  if(this->_state != STATE_END)
+  {
+    log_error(logger, "Configuration file syntax error at byte %u.", (unsigned int)this->_offset);
+    return false;
+  }
+
+  return this->_res;
+}
+
+
+/**
+ * Start capturing a member, or an item.
+ *
+ * @param[in] c the first character to capture.
+ */
+void ConfigReader::startCapture(char c)
+{
+  this->_length   = 0;
+  this->_overflow = false;
+  capture('{');
+  if(c != '{') { capture(c); }  // Members are wrapped in an object; items already are objects.
+}
+
+/**
+ * Add a character to the current capture.
+ *
+ * @param[in] c the character.
+ */
+void ConfigReader::capture(char c)
+{
+  // Keep room for the wrapping object's closing brace and for the ending null character.
+  if(this->_length + 2 >= this->_capacity) { this->_overflow = true; return; }
+  this->_pcBuffer[this->_length++] = c;
+}
+
+/**
+ * Complete the current capture then hand it over to the client.
+ *
+ * @return true  on success.
+ * @return false otherwise.
+ */
+bool ConfigReader::dispatch()
+{
+  bool isItem = this->_state == STATE_ITEM;
+
+  if(this->_overflow)
+  {
+    if(isItem) { log_error(logger, "Configuration '%s' item %u is too big.", this->_key, this->_itemIndex); }
+    else       { log_error(logger, "Configuration member '%s' is too big.",  this->_key); }
+    return false;
+  }
+  if(!isItem) { this->_pcBuffer[this->_length++] = '}'; }
+  this->_pcBuffer[this->_length] = '\0';
+
+  return handOver(isItem);
+}
+
+/**
+ * Parse the current capture then hand it over to the client, if it is handed over during the current phase.
+ *
+ * When checking the file, the capture is only parsed.
+ *
+ * @param[in] isItem is the capture an item?
+ *
+ * @return true  on success.
+ * @return false otherwise.
+ */
+bool ConfigReader::handOver(bool isItem)
+{
+  StaticJsonBuffer<CONFIG_READER_JSON_BUFFER_SIZE> jsonBuffer;
+
+  if(this->_phase != PHASE_CHECK && isItem != (this->_phase == PHASE_ITEMS)) { return true; }
+
+  JsonObject& object = jsonBuffer.parseObject(this->_pcBuffer);
+  if(object == JsonObject::invalid())
+  {
+    log_error(logger, "Failed to parse configuration member '%s'.", this->_key);
+    return false;
+  }
+  if(this->_phase == PHASE_CHECK) { return true; }
+
+  return isItem ?
+      this->_pvClient->configItemRead(  this->_key, this->_itemIndex, object) :
+      this->_pvClient->configMemberRead(this->_key, object);
+}
+
+
+/**
+ * Process the next character of the file.
+ *
+ * Whitespaces outside of strings are not captured, so that the buffer is only used by meaningful data.
+ *
+ * @param[in] c the character.
+ */
+void ConfigReader::parse(char c)
+{
+  if(this->_inString)
+  {
+    if(this->_state == STATE_KEY && !this->_escape && c == '"')
+    {
+      this->_key[this->_keyLength] = '\0';
+      this->_state                 = STATE_EXPECT_COLON;
+    }
+    else if(this->_state == STATE_KEY)
+    {
+      if(this->_keyLength >= sizeof(this->_key) - 1) { this->_state = STATE_ERROR; return; }
+      this->_key[this->_keyLength++] = c;
+    }
+    capture(c);
+
+    if(     this->_escape) { this->_escape   = false; }
+    else if(c == '\\')     { this->_escape   = true;  }
+    else if(c == '"')      { this->_inString = false; }
+    return;
+  }
+
+  switch(c)
+  {
+    case ' ': case '\t': case '\r': case '\n':
+      break;
+
+    case '"':
+      this->_inString = true;
+      if(this->_depth == 1 && this->_state == STATE_EXPECT_KEY)
+      {
+	this->_state     = STATE_KEY;
+	this->_keyLength = 0;
+	startCapture(c);
+      }
+      else if(this->_depth == 1 && this->_state == STATE_EXPECT_VALUE) { this->_state = STATE_VALUE; capture(c); }
+      else if(this->_state == STATE_VALUE || this->_state == STATE_ITEM) { capture(c); }
+      else { this->_state = STATE_ERROR; }
+      break;
+
+    case ':':
+      if(this->_depth == 1)
+      {
+	if(this->_state != STATE_EXPECT_COLON) { this->_state = STATE_ERROR; break; }
+	this->_state = STATE_EXPECT_VALUE;
+      }
+      capture(c);
+      break;
+
+    case '{':
+    case '[':
+      if(this->_state == STATE_START)
+      {
+	if(c != '{') { this->_state = STATE_ERROR; break; }
+	this->_state = STATE_EXPECT_KEY;
+      }
+      else if(this->_depth == 1 && this->_state == STATE_EXPECT_VALUE)
+      {
+	if(c == '[' && this->_psStreamedArray && strcmp(this->_key, this->_psStreamedArray) == 0)
+	{
+	  this->_state     = STATE_ARRAY;
+	  this->_itemIndex = 0;
+	}
+	else { this->_state = STATE_VALUE; capture(c); }
+      }
+      else if(this->_state == STATE_ARRAY)
+      {
+	if(c != '{') { this->_state = STATE_ERROR; break; }
+	this->_state = STATE_ITEM;
+	startCapture(c);
+      }
+      else if(this->_state == STATE_VALUE || this->_state == STATE_ITEM) { capture(c); }
+      else { this->_state = STATE_ERROR; break; }
+      this->_depth++;
+      break;
+
+    case '}':
+    case ']':
+      if(!this->_depth) { this->_state = STATE_ERROR; break; }
+      this->_depth--;
+      if(!this->_depth)
+      {
+	if(c != '}' || (this->_state != STATE_VALUE && this->_state != STATE_EXPECT_KEY))
+	{
+	  this->_state = STATE_ERROR;
+	  break;
+	}
+	if(this->_state == STATE_VALUE && this->_key[0]) { this->_res &= dispatch(); }
+	this->_state = STATE_END;
+      }
+      else if(this->_depth == 1 && this->_state == STATE_ARRAY)
+      {
+	if(c != ']') { this->_state = STATE_ERROR; break; }
+	this->_state  = STATE_VALUE;
+	this->_key[0] = '\0';  // There is nothing to hand over for the streamed array itself.
+      }
+      else if(this->_depth == 2 && this->_state == STATE_ITEM)
+      {
+	capture(c);
+	this->_res  &= dispatch();
+	this->_state = STATE_ARRAY;
+	this->_itemIndex++;
+      }
+      else { capture(c); }
+      break;
+
+    case ',':
+      if(this->_depth == 1)
+      {
+	if(this->_state != STATE_VALUE) { this->_state = STATE_ERROR; break; }
+	if(this->_key[0]) { this->_res &= dispatch(); }
+	this->_state = STATE_EXPECT_KEY;
+      }
+      else if(this->_state != STATE_ARRAY) { capture(c); }
+      break;
+
+    default:
+      if(     this->_depth == 1 && this->_state == STATE_EXPECT_VALUE) { this->_state = STATE_VALUE; }
+      else if(this->_state != STATE_VALUE && this->_state != STATE_ITEM) { this->_state = STATE_ERROR; break; }
+      capture(c);
+      break;
+  }
+}
@@ -0,0 +1,141 @@
+/**
+ * Streaming reader for the JSON configuration file.
+ *
+ * The file is read chunk by chunk and is never loaded as a whole.
+ * The top-level object is split into its members; each member is parsed on its own,
+ * as soon as it is complete, then handed over to the client.
+ * One top-level array, the streamed array, is split further: each of its items is
+ * parsed and handed over to the client on its own.
+ * So the RAM used does not depend on the file's size, only on the size of its largest
+ * member, or streamed array item.
+ *
+ * The whole file is checked before anything is handed over, so that a syntax error does not
+ * leave a partially applied configuration. Then all the members are handed over, in file order,
+ * before the streamed array's items; so the global settings apply to all the items,
+ * whatever their position in the file.
+ *
+ * The configuration's murmur3 32 bits hash is computed while checking the file, in the same pass;
+ * the configuration monitor uses it and does not read the file again.
+ *
+ * @date   2019
+ */
+#ifndef ENVIRONMENT_CONFIGREADER_HPP_
+#define ENVIRONMENT_CONFIGREADER_HPP_
+
+#include "defs.h"
+#include "json.hpp"
+
+
+#ifndef CONFIG_READER_CHUNK_SIZE
+#define CONFIG_READER_CHUNK_SIZE        256   ///< The size of the chunks the file is read with, in bytes. MUST be a multiple of 4 so that the hash does not depend on it.
+#endif
+#ifndef CONFIG_READER_JSON_BUFFER_SIZE
+#define CONFIG_READER_JSON_BUFFER_SIZE  2048  ///< The size of the JSON buffer used to parse a member or an item.
+#endif
+#define CONFIG_READER_KEY_SIZE_MAX      32    ///< The maximum size of a top-level member's key, including the ending null character.
+
+
+class ConfigReader
+{
+public:
+  /**
+   * Interface that the configuration clients must implement.
+   */
+  class Client
+  {
+  public:
+    /**
+     * Called for each top-level member, except for the streamed array.
+     *
+     * @param[in] psKey the member's key.
+     * @param[in] json  an object that only contains the member.
+     *
+     * @return true  on success.
+     * @return false otherwise.
+     */
+    virtual bool configMemberRead(const char *psKey, const JsonObject& json) = 0;
+
+    /**
+     * Called for each item of the streamed array.
+     *
+     * @param[in] psKey the streamed array's key.
+     * @param[in] index the item's index in the array.
+     * @param[in] json  the item.
+     *
+     * @return true  on success.
+     * @return false otherwise.
+     */
+    virtual bool configItemRead(const char *psKey, uint16_t index, const JsonObject& json) = 0;
+  };
+
+
+public:
+  ConfigReader(char *pcBuffer, uint32_t capacity);
+
+  bool     read(const char *psFilename, const char *psStreamedArray, Client *pvClient);
+  uint32_t size() const { return this->_size; }
+  uint32_t hash() const { return this->_hash; }
+
+
+private:
+  /**
+   * Defines what is done with the captured members and items.
+   */
+  typedef enum Phase
+  {
+    PHASE_CHECK,    ///< Only check that they can be parsed.
+    PHASE_MEMBERS,  ///< Hand over the members; ignore the items.
+    PHASE_ITEMS     ///< Hand over the items; ignore the members.
+  }
+  Phase;
+
+  /**
+   * Defines where the reader is in the top-level object.
+   */
+  typedef enum State
+  {
+    STATE_START,         ///< Before the top-level object.
+    STATE_EXPECT_KEY,    ///< Waiting for a member's key.
+    STATE_KEY,           ///< In a member's key.
+    STATE_EXPECT_COLON,  ///< After a member's key.
+    STATE_EXPECT_VALUE,  ///< After a member's colon.
+    STATE_VALUE,         ///< In a member's value.
+    STATE_ARRAY,         ///< In the streamed array, between two items.
+    STATE_ITEM,          ///< In one of the streamed array's item.
+    STATE_END,           ///< After the top-level object.
+    STATE_ERROR          ///< A syntax error has been found.
+  }
+  State;
+
+
+private:
+  bool readFile(const char *psFilename);
+  void parse(char c);
+  void capture(char c);
+  void startCapture(char c);
+  bool dispatch();
+  bool handOver(bool isItem);
+
+
+private:
+  char       *_pcBuffer;        ///< The buffer where a member, or an item, is captured.
+  uint32_t    _capacity;        ///< The buffer's capacity, in bytes.
+  Phase       _phase;           ///< What is done with the captured members and items.
+  uint32_t    _length;          ///< The number of characters captured.
+  bool        _overflow;        ///< Has the current member, or item, overflowed the buffer?
+  State       _state;           ///< Where we are in the top-level object.
+  uint8_t     _depth;           ///< The current nesting depth. 1 in the top-level object.
+  bool        _inString;        ///< Are we in a string?
+  bool        _escape;          ///< Is the previous character a string escape character?
+  char        _key[CONFIG_READER_KEY_SIZE_MAX]; ///< The current top-level member's key.
+  uint8_t     _keyLength;       ///< The current key's length.
+  const char *_psStreamedArray; ///< The streamed array's key. Can be NULL.
+  uint16_t    _itemIndex;       ///< The index of the current streamed array's item.
+  Client     *_pvClient;        ///< The client.
+  bool        _res;             ///< Have all the members and items been handled successfully?
+  uint32_t    _offset;          ///< The number of bytes parsed.
+  uint32_t    _size;            ///< The number of bytes read from the file.
+  uint32_t    _hash;            ///< The file's murmur3 32 bits hash.
+};
+
+#endif /* ENVIRONMENT_CONFIGREADER_HPP_ */
@@ -9,11 +9,16 @@
 #include "statusindication.h"
 #include "board.h"
 #include "sdcard.h"
+#include "sdcache.h"
 #include "factory.hpp"
 #include "rtc.h"
 #include "datalog-cnssrf.h"
+#include "sensorstatestore.hpp"
 #include "configmonitor.h"
+#include "configreader.hpp"
 #include "nodeinfo.h"
+#include "trace.h"
+#include "perfcounters.h"
 #include "board.h"
 #include "buzzer.h"
 #include "nodebattery.hpp"
@@ -35,8 +40,19 @@
 #define NODE_BATT_V_READING_PERIOD_MAX_SEC  3600  // Read battery if it has not been read for an hour.
 #endif
 
+#ifndef CONNECSENS_SENSORS_READY_TIMEOUT_MS
+#define CONNECSENS_SENSORS_READY_TIMEOUT_MS      3000  // Collect the sensor's readings anyway after that.
+#endif
+#ifndef CONNECSENS_SENSORS_READY_POLL_PERIOD_MS
+#define CONNECSENS_SENSORS_READY_POLL_PERIOD_MS  1
+#endif
+
 #define CONNECSENS_NODE_UNIQUE_ID_PREFIX  "CNSS-NDSTEPAT-"
 
+#ifndef CONNECSENS_CNSSRF_TIMESTAMP_MS
+#define CONNECSENS_CNSSRF_TIMESTAMP_MS  0  // Set to 1 to timestamp the CNSSRF frames with milliseconds (TimestampUTCMs).
+#endif
+
 
 #ifdef RF_FRAMES_ADD_GEOPOS_TO_EACH
 #define ADD_GEOPOS_TO_EACH_RF_FRAME_DEFAULT_VALUE  true
@@ -94,6 +110,7 @@ ConnecSenS::ConnecSenS() : myBuffer(CONNECSENS_BUFFER_SIZE)
   this->_firstGPSFix               = true;
   this->_gpsFixDoneOutsidePeriodic = false;
   this->_timeSyncMethodChanged     = false;
+  this->_timeSyncMethodIsSet       = false;
   this->_workingMode               = WMODE_NORMAL;
   this->NumberOfSensors            = 0;
   this->Network                    = NULL;
@@ -351,6 +368,8 @@ bool ConnecSenS::process(bool irq, bool periodic)
   uint8_t i;
   bool    processedSomething;
 
+  // Only trace the top-level calls, not the ones made when yielding.
+  if(irq || periodic) { TRACE_BEGIN(TRACE_ID_PROCESS); }
   do
   {
     board_watchdog_reset();
@@ -367,8 +386,19 @@ bool ConnecSenS::process(bool irq, bool periodic)
   }
   while(processedSomething);
 
-  if(irq)      { InterruptHandler(); }
-  if(periodic) { PeriodicHandler();  }
+  if(irq)
+  {
+    TRACE_BEGIN(TRACE_ID_INTERRUPTS);
+    InterruptHandler();
+    TRACE_END(  TRACE_ID_INTERRUPTS);
+  }
+  if(periodic)
+  {
+    TRACE_BEGIN(TRACE_ID_PERIODIC);
+    PeriodicHandler();
+    TRACE_END(  TRACE_ID_PERIODIC);
+  }
+  if(irq || periodic) { TRACE_END(TRACE_ID_PROCESS); }
 
   return false;
 }
@@ -389,9 +419,11 @@ void ConnecSenS::yield()
 /**
  * Start a new ConnecSenS RF dataframe.
  *
- * @param[in] timestamp the timestamp to sue for the data. If 0 then use current timestamp.
+ * @param[in] timestamp   the timestamp to sue for the data. If 0 then use current timestamp.
+ * @param[in] timestampMs the timestamp's milliseconds, [0..999]. Only used if timestamp is not 0,
+ *                        and if the frames are timestamped with milliseconds.
  */
-bool ConnecSenS::startNewCNSSRFDataFrame(ts2000_t timestamp)
+bool ConnecSenS::startNewCNSSRFDataFrame(ts2000_t timestamp, uint16_t timestampMs)
 {
   ts2000_t nowTs2000;
   uint32_t hash;
@@ -403,6 +435,21 @@ bool ConnecSenS::startNewCNSSRFDataFrame(ts2000_t timestamp)
   // First write the node informations
   cnssrf_data_frame_set_current_data_channel(&this->_cnssrfDataFrame,
 					     CNSSRF_DATA_CHANNEL_NODE);
+#if CONNECSENS_CNSSRF_TIMESTAMP_MS
+  if(timestamp)
+  {
+    if(!cnssrf_dt_timestamp_utc_ms_write_ms_to_frame(&this->_cnssrfDataFrame,
+						     ts2000ms_from_secs_and_ms(timestamp, timestampMs)))
+    { goto error_exit; }
+  }
+  else
+  {
+    if(!cnssrf_dt_timestamp_utc_ms_write_datetime_to_frame(
+	&this->_cnssrfDataFrame,
+	&this->currentTimestamp)) { goto error_exit; }
+  }
+#else
+  UNUSED(timestampMs);
   if(timestamp)
   {
     if(!cnssrf_dt_timestamp_utc_write_secs_to_frame(&this->_cnssrfDataFrame, timestamp))
@@ -414,6 +461,7 @@ bool ConnecSenS::startNewCNSSRFDataFrame(ts2000_t timestamp)
 	&this->_cnssrfDataFrame,
 	&this->currentTimestamp)) { goto error_exit; }
   }
+#endif
 
   // Add battery voltage informations
   nowTs2000 = rtc_get_date_as_secs_since_2000();
@@ -487,6 +535,7 @@ bool ConnecSenS::saveCurrentCNSSRFDataFrame()
 
 void  ConnecSenS::readBatteryVoltage()
 {
+  char         value[STR_FIXED_SIZE_MAX];
   bool         ok        = false;
   NodeBattery *pvBattery = NodeBattery::instance();
 
@@ -494,7 +543,8 @@ void  ConnecSenS::readBatteryVoltage()
   {
     if((ok = pvBattery->read()))
     {
-      log_info(logger, "Battery voltage: %1.3f V", pvBattery->voltageV());
+      log_info(logger, "Battery voltage: %s V",
+	       strn_fixed_to_string(value, pvBattery->voltageMV(), 3, sizeof(value), false));
       if(pvBattery->isCharging()) { log_info(logger, "The battery is charging"); }
       this->_batteryLastReadTs2000 = rtc_get_date_as_secs_since_2000();
     }
@@ -511,11 +561,12 @@ void  ConnecSenS::readBatteryVoltage()
  *
  * @param[in] pvSensor The sensor. MUST be NOT NULL.
  * @param[in] ts2000   The timestamp to use for the CNSSRF frame.
+ * @param[in] ms       The timestamp's milliseconds, [0..999].
  *
  * @return true  On success.
  * @return false Otherwise.
  */
-bool ConnecSenS::saveSensorData(Sensor *pvSensor, ts2000_t ts2000)
+bool ConnecSenS::saveSensorData(Sensor *pvSensor, ts2000_t ts2000, uint16_t ms)
 {
   char    *psCSVBuffer;
   uint32_t csvBufferSize, len, i;
@@ -527,7 +578,7 @@ bool ConnecSenS::saveSensorData(Sensor *pvSensor, ts2000_t ts2000)
   bool     writeCSVData = false;
 
   // Write CNSSRF data
-  if((res = startNewCNSSRFDataFrame(ts2000)))
+  if((res = startNewCNSSRFDataFrame(ts2000, ms)))
   {
     res &= appendSensorDataToCurrentCNSSRFDataFrame(pvSensor);
     res &= saveCurrentCNSSRFDataFrame();
@@ -566,9 +617,7 @@ bool ConnecSenS::saveSensorData(Sensor *pvSensor, ts2000_t ts2000)
   // Write GPS data to CSV if we have to
   if(this->_addGeoPosToEachRFFrame && rtc_geoposition(&latitude, &longitude, NULL))
   {
-    len = snprintf(psCSVBuffer, csvBufferSize, "%c%f%c%f",
-    		     OUTPUT_DATA_CSV_SEP, latitude,
-    		     OUTPUT_DATA_CSV_SEP, longitude);
+    len = csvGeoPositionToString(psCSVBuffer, csvBufferSize, latitude, longitude);
     if(len >= csvBufferSize) { writeCSVData = false; }
   }
   else
@@ -598,6 +647,7 @@ void ConnecSenS::InterruptHandler()
   char    *psCSVBuffer;
   uint32_t csvBufferSize, len, i;
   ts2000_t ts2000;
+  uint16_t ms;
   int32_t  l;
   float    latitude, longitude;
   bool     writeCSVData    = false;
@@ -660,10 +710,11 @@ void ConnecSenS::InterruptHandler()
       // Write a CNSSRF data frame with only this sensor's data and
       // use the sensor's interruption timestamp if it has one, else use readings timestamp.
       ts2000 = pvSensor->interruptionTimestamp();
+      ms     = pvSensor->interruptionTimestampMs();
       pvSensor->clearInterruptionTimestamp();
-      log_debug(logger, "Interruption timestamp: %lu.", ts2000);
-      if(!ts2000) { ts2000 = pvSensor->readingsTimestamp(); }
-      if(!startNewCNSSRFDataFrame(ts2000)) { return; }
+      log_debug(logger, "Interruption timestamp: %lu.%03u.", ts2000, (unsigned int)ms);
+      if(!ts2000) { ts2000 = pvSensor->readingsTimestamp(); ms = 0; }
+      if(!startNewCNSSRFDataFrame(ts2000, ms)) { return; }
       appendSensorDataToCurrentCNSSRFDataFrame(pvSensor);
       pvSensor->clearHasNewData();
       saveCurrentCNSSRFDataFrame();
@@ -676,9 +727,7 @@ void ConnecSenS::InterruptHandler()
   // Write GPS data to CSV if we have to
   if(this->_addGeoPosToEachRFFrame && rtc_geoposition(&latitude, &longitude, NULL))
   {
-    len = snprintf(psCSVBuffer, csvBufferSize, "%c%f%c%f",
-    		     OUTPUT_DATA_CSV_SEP, latitude,
-    		     OUTPUT_DATA_CSV_SEP, longitude);
+    len = csvGeoPositionToString(psCSVBuffer, csvBufferSize, latitude, longitude);
     if(len >= csvBufferSize) { writeCSVData = false; }
   }
   else
@@ -713,12 +762,13 @@ void ConnecSenS::PeriodicHandler()
   uint32_t csvBufferSize, len, i;
   int32_t  l;
   Sensor  *pvSensor;
+  Sensor  *dueSensors[CONNECSENS_NB_SENSOR_MAX];
+  uint8_t  nbDueSensors       = 0;
   float    latitude, longitude;
   bool     actionOnSensorDone = false;
   bool     actionOnGPSDone    = false;
   bool     writeCSVData       = this->_output_data_to_csv;
   bool     gpsDataWritten     = false;
-  bool     cnssrfFrameStarted = false;
   bool     aSensorIsInAlarm   = false;
 
   // Our time granularity is 1 second so do not do anything if this function
@@ -736,6 +786,13 @@ void ConnecSenS::PeriodicHandler()
     if(!writeCNSSRFFramesWithConfig()) { log_error(logger, "Failed to write RF frame with configuration."); }
   }
 
+  // Write the performance counters if we have to
+  if(this->_sendCountersTimer.itsTime())
+  {
+    log_info(logger, "Prepare an RF frame with the runtime performance counters.");
+    if(!writeCNSSRFFrameWithCounters()) { log_error(logger, "Failed to write RF frame with counters."); }
+  }
+
   // Open the CSV data output file if not already done
   if((writeCSVData = (openDataOutputCSVFile() && startDataOutputCSVLine())))
   {
@@ -748,25 +805,25 @@ void ConnecSenS::PeriodicHandler()
   for(i = 0; i < this->NumberOfSensors; i++)
   {
     pvSensor = this->_sensors[i];
-
-    if(pvSensor->itsTime())
+    if(pvSensor->itsTime()) { dueSensors[nbDueSensors++] = pvSensor; }
+  }
+  if(nbDueSensors)
+  {
+    // Start a new CNSSRF data frame
+    if(!startNewCNSSRFDataFrame())
     {
-      if(!cnssrfFrameStarted)
-      {
-	// Start a new CNSSRF data frame
-	if(!startNewCNSSRFDataFrame())
-	{
-	  log_error(logger, "Failed to start new CNSS RF frame.");
-	  goto data_write_failed;
-	}
-	cnssrfFrameStarted = true;
-      }
-
-      this->ActionOnSensor(pvSensor);
-      actionOnSensorDone       = true;
-      board_watchdog_reset();
+      log_error(logger, "Failed to start new CNSS RF frame.");
+      goto data_write_failed;
     }
 
+    actionOnSensorDone = this->ActionOnSensors(dueSensors, nbDueSensors);
+    board_watchdog_reset();
+  }
+
+  for(i = 0; i < this->NumberOfSensors; i++)
+  {
+    pvSensor = this->_sensors[i];
+
     aSensorIsInAlarm |= pvSensor->isInAlarm();
 
     // Write CSV data, even if the sensor has produced no data
@@ -824,16 +881,13 @@ void ConnecSenS::PeriodicHandler()
   {
     if(actionOnGPSDone)
     {
-      len = snprintf(psCSVBuffer, csvBufferSize, "%c%f%c%f",
-		     OUTPUT_DATA_CSV_SEP, this->GPS.location().latitude,
-		     OUTPUT_DATA_CSV_SEP, this->GPS.location().longitude);
+      len = csvGeoPositionToString(psCSVBuffer, csvBufferSize,
+				   this->GPS.location().latitude, this->GPS.location().longitude);
       if(len >= csvBufferSize) { writeCSVData = false; }
     }
     else if(this->_addGeoPosToEachRFFrame && rtc_geoposition(&latitude, &longitude, NULL))
     {
-      len = snprintf(psCSVBuffer, csvBufferSize, "%c%f%c%f",
-      		     OUTPUT_DATA_CSV_SEP, latitude,
-      		     OUTPUT_DATA_CSV_SEP, longitude);
+      len = csvGeoPositionToString(psCSVBuffer, csvBufferSize, latitude, longitude);
       if(len >= csvBufferSize) { writeCSVData = false; }
     }
     else
@@ -900,7 +954,8 @@ void ConnecSenS::EndOfExecution()
     if(!pvSensor->needsToBeConstantlyOpened()) { pvSensor->close(); }
   }
   if((ts = this->Network        ->nextTime()) && ts < tsNextTime) { tsNextTime = ts; }
-  if((ts = this->_sendConfigTimer.nextTime()) && ts < tsNextTime) { tsNextTime = ts; }
+  if((ts = this->_sendConfigTimer  .nextTime()) && ts < tsNextTime) { tsNextTime = ts; }
+  if((ts = this->_sendCountersTimer.nextTime()) && ts < tsNextTime) { tsNextTime = ts; }
 
   this->_timeSyncMethodChanged = false;
   rtc_set_is_not_first_run();
@@ -928,6 +983,17 @@ void ConnecSenS::Sleep(ts2000_t tsWakeup)
   {
     // Flush some files
     datalog_cnssrf_sync();
+    SensorStateStore::instance()->flush();
+
+    // Write the cached sectors now, rather than when the card goes to sleep, so that the statistics
+    // account for them; only the following log messages are left to the sleep's flush.
+    sdcard_flush();
+    log_debug(logger, "SD card: %u sectors read, %u sectors written (%u erase blocks), %u cache hits, "
+	      "%u seeks (%u fast) in %u ms.",
+	      (unsigned int)sdcache_stats()->nb_sectors_read, (unsigned int)sdcache_stats()->nb_sectors_written,
+	      (unsigned int)sdcache_stats()->nb_erase_blocks_written,
+	      (unsigned int)sdcache_stats()->nb_hits,         (unsigned int)sdcard_seek_stats()->nb_seeks,
+	      (unsigned int)sdcard_seek_stats()->nb_fast_seeks, (unsigned int)sdcard_seek_stats()->duration_ms);
 
     if(tsWakeup != this->_lastWakeupTs2000)
     {
@@ -939,6 +1005,9 @@ void ConnecSenS::Sleep(ts2000_t tsWakeup)
 
     // We are going to sleep
     status_ind_set_status(STATUS_IND_ASLEEP);
+    TRACE_STATE(TRACE_ID_SLEEP, 1);
+    trace_dump();
+    perfcounters_sleep();
 
     CNSSInt::instance()->sleep();
 
@@ -956,6 +1025,8 @@ void ConnecSenS::Sleep(ts2000_t tsWakeup)
 
     // We woke up
     cnsslog_wakeup();
+    trace_wakeup();
+    perfcounters_wakeup();
     timer_stop(&this->_wakeupTimer);
     status_ind_set_status(STATUS_IND_AWAKE);
   }
@@ -975,20 +1046,81 @@ void ConnecSenS::Sleep(ts2000_t tsWakeup)
 /**********************************************************/
 /* Gestion des Sensors ************************************/
 /**********************************************************/
-void ConnecSenS::ActionOnSensor(Sensor *pvSensor)
+/**
+ * Read a set of sensors, overlapping their measurement times.
+ *
+ * The power supplies needed by all the sensors are turned on at once, then a measurement
+ * is started on each sensor, then the results are collected as the sensors get ready.
+ * So the time spent awake approaches the one of the slowest sensor rather than
+ * the sum of all the sensors' measurement times.
+ * Sensors that cannot split their readings are read first, while the others are converting.
+ *
+ * @param[in] ppvSensors the sensors to read. MUST be NOT NULL.
+ * @param[in] nb         the number of sensors in ppvSensors.
+ *
+ * @return true  if at least one sensor has data to output.
+ * @return false if all the sensors have only added their readings to their aggregation windows.
+ */
+bool ConnecSenS::ActionOnSensors(Sensor **ppvSensors, uint8_t nb)
 {
-  if(pvSensor && pvSensor->open())
+  Sensor       *pending[CONNECSENS_NB_SENSOR_MAX];
+  Sensor       *pvSensor;
+  Sensor::Power power = Sensor::POWER_NONE;
+  uint32_t      refMs;
+  uint8_t       i, nbPending;
+  bool          hasOutput = false;
+
+  TRACE_BEGIN(TRACE_ID_ACTION_ON_SENSORS);
+
+  // Power up all the needed power supplies at once
+  for(i = 0; i < nb; i++) { power |= ppvSensors[i]->powerConfig(); }
+  board_add_power((BoardPower)power);
+
+  // Open the sensors and start the measurements
+  for(i = nbPending = 0; i < nb; i++)
   {
-    if(pvSensor->read() && !appendSensorDataToCurrentCNSSRFDataFrame(pvSensor))
+    pvSensor = ppvSensors[i];
+    if(pvSensor && pvSensor->open())
     {
-      log_error(logger, "Failed to write data for sensor: %s.", pvSensor->name());
+      pvSensor->startMeasurement();
+      pending[nbPending++] = pvSensor;
     }
-    pvSensor->close();
+  }
 
-    // Clear the alarm has just changed status.
-    // To avoid the sensor being read a second time because if alarm status change.
-    pvSensor->alarmStatusHasJustChanged(true);
+  // Collect the results, in readiness order
+  refMs = board_ms_now();
+  while(nbPending)
+  {
+    for(i = 0; i < nbPending; )
+    {
+      pvSensor = pending[i];
+      if(!pvSensor->isReady() && !board_is_timeout(refMs, CONNECSENS_SENSORS_READY_TIMEOUT_MS))
+      {
+	i++;
+	continue;
+      }
+
+      if(pvSensor->collect() && !appendSensorDataToCurrentCNSSRFDataFrame(pvSensor))
+      {
+	log_error(logger, "Failed to write data for sensor: %s.", pvSensor->name());
+      }
+      pvSensor->close();
+      hasOutput |= !pvSensor->readingsAreWithheld();
+
+      // Clear the alarm has just changed status.
+      // To avoid the sensor being read a second time because if alarm status change.
+      pvSensor->alarmStatusHasJustChanged(true);
+
+      pending[i] = pending[--nbPending];
+    }
+    board_watchdog_reset();
+
+    // Wait for the conversions in progress.
+    if(nbPending) { pwrclk_sleep_ms_max(CONNECSENS_SENSORS_READY_POLL_PERIOD_MS); }
   }
+
+  TRACE_END(TRACE_ID_ACTION_ON_SENSORS);
+  return hasOutput;
 }
 
 /**********************************************************/
@@ -1001,11 +1133,14 @@ void ConnecSenS::ActionOnNetwork()
   bool     has_more_data;
   bool     success = true;
 
+  TRACE_BEGIN(TRACE_ID_ACTION_ON_NETWORK);
+
   if(!cnssrf_data_frame_is_empty(&this->_cnssrfSendDataFrame))
   {
     if(this->Network->isBusy())
     {
       log_warn(logger, "Cannot send data we still are sending the previous data.");
+      TRACE_END(TRACE_ID_ACTION_ON_NETWORK);
       return;
     }
     else
@@ -1065,6 +1200,7 @@ void ConnecSenS::ActionOnNetwork()
 
   exit:
   if(!success) { status_ind_set_status(STATUS_IND_RF_SEND_KO); }
+  TRACE_END(TRACE_ID_ACTION_ON_NETWORK);
   return;
 }
 
@@ -1188,6 +1324,47 @@ void ConnecSenS::lookAtResetSource()
   cnssrf_data_frame_clear(&this->_cnssrfDataFrame);
 }
 
+/**
+ * Write the runtime performance counters to a CNSSRF frame and save it to the datalog.
+ * The counters are cleared once written, so that each frame holds the counts since the previous one.
+ *
+ * @return true  on success.
+ * @return false otherwise.
+ */
+bool ConnecSenS::writeCNSSRFFrameWithCounters()
+{
+  CNSSRFDTSystemCounters counters;
+  uint8_t                i;
+  bool                   res = false;
+
+  counters.nb_wakeups           = perfcounters_get(PERF_COUNTER_WAKEUPS);
+  counters.awake_ms             = perfcounters_get(PERF_COUNTER_AWAKE_MS);
+  counters.sd_bytes_written     = perfcounters_get(PERF_COUNTER_SD_BYTES_WRITTEN);
+  counters.sd_nb_syncs          = perfcounters_get(PERF_COUNTER_SD_SYNCS);
+  for(i = 0; i < CNSSRF_DT_SYS_COUNTERS_NB_DATARATES; i++)
+  {
+    counters.tx_ms[i] = i < PERF_COUNTERS_TX_NB_DATARATES ?
+	perfcounters_get((PerfCounterId)(PERF_COUNTER_TX_MS_DR0 + i)) : 0;
+  }
+  counters.tx_nb_retries        = perfcounters_get(PERF_COUNTER_TX_RETRIES);
+  counters.sdi12_ms             = perfcounters_get(PERF_COUNTER_SDI12_MS);
+  counters.datalog_backlog      = datalog_cnssrf_backlog();
+  counters.watchdog_near_misses = perfcounters_get(PERF_COUNTER_WATCHDOG_NEAR_MISSES);
+  counters.nb_interruptions     = perfcounters_get(PERF_COUNTER_INTERRUPTIONS);
+  counters.int_latency_ms       = perfcounters_get(PERF_COUNTER_INT_LATENCY_MS);
+
+  if(!startNewCNSSRFDataFrame()                                         ||
+     !cnssrf_dt_system_write_counters(&this->_cnssrfDataFrame, &counters) ||
+     !saveCurrentCNSSRFDataFrame()) { goto exit; }
+
+  perfcounters_clear();
+  res = true;
+
+  exit:
+  cnssrf_data_frame_clear(&this->_cnssrfDataFrame);
+  return res;
+}
+
 
 /**
  * Set the board power configuration for sleep mode
@@ -1216,6 +1393,7 @@ bool ConnecSenS::setRTCUsingGPS(bool blocking)
 {
   ts2000_t ts_now, ts_gps;
   uint32_t diff_abs;
+  char     latitude[STR_FIXED_SIZE_MAX], longitude[STR_FIXED_SIZE_MAX];
   bool     diff_plus;
   bool     res = false;
 
@@ -1254,7 +1432,9 @@ bool ConnecSenS::setRTCUsingGPS(bool blocking)
       log_info(logger, "GPS time: %04d-%02d-%02d %02d:%02d:%02d",
 	       this->GPS.time().year,  this->GPS.time().month,   this->GPS.time().day,
 	       this->GPS.time().hours, this->GPS.time().minutes, this->GPS.time().seconds);
-      log_info(logger, "GPS position: (lat=%f; long=%f)", this->GPS.location().latitude, this->GPS.location().longitude);
+      log_info(logger, "GPS position: (lat=%s; long=%s)",
+	       strn_float_to_string(latitude,  this->GPS.location().latitude,  6, sizeof(latitude),  false),
+	       strn_float_to_string(longitude, this->GPS.location().longitude, 6, sizeof(longitude), false));
 
       // User friendly GPS fix indication: make LED2 blink
       status_ind_set_status(STATUS_IND_GPS_FIX_OK);
@@ -1326,7 +1506,8 @@ void ConnecSenS::updatePeriodicTaskNextTime()
   for(i = 0; i < this->NumberOfSensors; i++) { this->_sensors[i]->setNextTime(); }
   if(this->Network) { this->Network->setNextTime(); }
   this->GPS             .setNextTime();
-  this->_sendConfigTimer.setNextTime();
+  this->_sendConfigTimer  .setNextTime();
+  this->_sendCountersTimer.setNextTime();
 
   this->_lastWakeupTs2000 = 0;  ///< Force setting up next wakup timer.
 }
@@ -1385,43 +1566,96 @@ uint32_t ConnecSenS::getPeriodSec(const JsonObject &obj, uint32_t defaultValue,
 /**
  * Read configuration file and set up all the objects affected by this configuration.
  *
- * @post this->myBuffer contains the configuration file's data.
+ * The file is read using a ConfigReader: each top-level member, and each sensor,
+ * is parsed and set up on its own, using this->myBuffer as working buffer.
+ * The whole file is checked, and its hash computed, before anything is set up.
+ * The top-level members, like the logs, debug and interruptions settings, are all set up
+ * before the sensors are created, whatever their position in the file.
  *
  * @return true  on success.
  * @return false otherwise.
  */
 bool ConnecSenS::loadConfig()
 {
-  File          file;
-  uint32_t      size;
-  uint8_t       i, count;
-  float         f;
-  const char   *psValue;
-  bool          res = true;
+  ConfigReader reader((char *)this->myBuffer.getBufferPtr(), CONNECSENS_BUFFER_SIZE);
+  bool         res;
+
+  // Set the default values, for the parameters that may not be in the file.
+  this->DeviceName[0]           = '\0';
+  this->_experimentName[0]      = '\0';
+  this->_addGeoPosToEachRFFrame = ADD_GEOPOS_TO_EACH_RF_FRAME_DEFAULT_VALUE;
+  this->_workingMode            = WMODE_NORMAL;
+  this->_enableGPS              = false;
+  this->_timeSyncMethodIsSet    = false;
+  this->NumberOfSensors         = 0;
+  memset(&this->manualTimestamp, 0, sizeof(this->manualTimestamp));
+  setUniqueId(NULL);
+  _sendConfigTimer  .setPeriodSec(0);
+  _sendCountersTimer.setPeriodSec(0);
 
-  /* Récupération du contenu du fichier config */
-  sdcard_fopen(     &file, CONFIG_FILE_NAME, FILE_OPEN_OR_CREATE | FILE_READ);
-  if(!sdcard_fread( &file, this->myBuffer.getBufferPtr(), (size = sdcard_fsize(&file))))
+  // Go through JSON file
+  this->myBuffer.clean();
+  res = reader.read(CONFIG_FILE_NAME, "sensors", this);
+  if(reader.size()) { config_monitor_set_hash_mm3_32(reader.size(), reader.hash()); }
+  this->myBuffer.clean();
+
+  // Check the mandatory parameters
+  if(!this->DeviceName[0])
   {
-    log_error(logger, "Failed to read configuration file '%s'.", CONFIG_FILE_NAME);
-    return false;
+    log_error(logger, "You must specify a node's name, less than %u characters long, using configuration parameter 'name'.",
+	      CONNECSENS_NAME_MAX_SIZE - 1);
+    res = false;
+  }
+  if(!this->_experimentName[0])
+  {
+    log_error(logger, "You must specify an experiment's name, less than %u characters long, using configuration parameter 'experimentName'.",
+	      CONNECSENS_EXPERIMENT_NAME_SIZE - 1);
+    res = false;
+  }
+  if(!this->Network)
+  {
+    log_error(logger, "There is no valid 'network' configuration.");
+    res = false;
+  }
+  if(!this->_timeSyncMethodIsSet)
+  {
+    log_error(logger, "You must specify the 'syncMethod' used to synchronise the node's time. ");
+    res = false;
   }
-  sdcard_fclose(&file);
-  this->myBuffer.setWriteCursor(size); // So that we can append a null character to make a string.
-  this->myBuffer.push('\0');
-  this->myBuffer.setWriteCursor(size); // Do not count the ending null character
 
-  // Go through JSON file
-  StaticJsonBuffer<CONNECSENS_BUFFER_SIZE> jsonBuffer;
-  JsonObject&   object = jsonBuffer.parseObject(this->myBuffer.getBufferPtr());
-  if(object == JsonObject::invalid())
+  if(!this->_enableGPS) { this->_addGeoPosToEachRFFrame = false; }
+
+  // Release the sensors' states that no configured sensor uses anymore.
+  // Not if the configuration is wrong; the sensors it misses may come back once it is fixed.
+  if(res)
   {
-    log_error(logger, "Configuration file syntax error.");
-    return false;
+    SensorStateStore::instance()->startClaims();
+    for(uint8_t i = 0; i < this->NumberOfSensors; i++) { this->_sensors[i]->claimState(); }
+    SensorStateStore::instance()->releaseUnclaimed();
   }
 
+  return res;
+}
+
+/**
+ * Set up the objects affected by a configuration's top-level member.
+ *
+ * Unknown members are ignored.
+ *
+ * @param[in] psKey  the member's key.
+ * @param[in] object an object that only contains the member.
+ *
+ * @return true  on success.
+ * @return false otherwise.
+ */
+bool ConnecSenS::configMemberRead(const char *psKey, const JsonObject& object)
+{
+  float       f;
+  const char *psValue;
+  bool        res = true;
+
   // Get logs configuration
-  if(object["logs"].success())
+  if(strcmp(psKey, "logs") == 0)
   {
     JsonObject& logs = object["logs"];
 
@@ -1433,7 +1667,7 @@ bool ConnecSenS::loadConfig()
   }
 
   // Get debug configuration
-  if(object["debug"].success())
+  else if(strcmp(psKey, "debug") == 0)
   {
     JsonObject& debug = object["debug"];
     leds_enable_debug(debug["useInternalLEDs"].as<bool>());
@@ -1445,55 +1679,53 @@ bool ConnecSenS::loadConfig()
   }
 
   // Get node's name
-  this->DeviceName[0] = '\0';
-  if(object["name"].success())
+  else if(strcmp(psKey, "name") == 0)
   {
     strlcpy(this->DeviceName, object["name"].as<const char*>(), CONNECSENS_NAME_MAX_SIZE);
   }
-  if(!this->DeviceName[0])
-  {
-    log_error(logger, "You must specify a node's name, less than %u characters long, using configuration parameter 'name'.",
-	      CONNECSENS_NAME_MAX_SIZE - 1);
-    res = false;
-  }
 
   // Get the experiment's name
-  this->_experimentName[0] = '\0';
-  if(object["experimentName"].success())
+  else if(strcmp(psKey, "experimentName") == 0)
   {
     strlcpy(this->_experimentName,
 	    object["experimentName"].as<const char*>(),
 	    CONNECSENS_EXPERIMENT_NAME_SIZE);
   }
-  if(!this->_experimentName[0])
-  {
-    log_error(logger, "You must specify an experiment's name, less than %u characters long, using configuration parameter 'experimentName'.",
-	      CONNECSENS_EXPERIMENT_NAME_SIZE - 1);
-    res = false;
-  }
 
   // Get node's unique identifier, if one is set.
-  setUniqueId(object["uniqueId"].as<const char*>());
+  else if(strcmp(psKey, "uniqueId") == 0) { setUniqueId(object["uniqueId"].as<const char*>()); }
 
-  if((f = object["batteryLowV"].as<float>()) != 0.0) { NodeBattery::instance()->setVoltageLowV(f); }
-  _sendConfigTimer.setPeriodSec(getPeriodSec(object, 0, NULL, "sendConfigPeriod"));
+  else if(strcmp(psKey, "batteryLowV") == 0)
+  {
+    if((f = object["batteryLowV"].as<float>()) != 0.0) { NodeBattery::instance()->setVoltageLowV(f); }
+  }
+  else if(strncmp(psKey, "sendConfigPeriod", 16) == 0)
+  {
+    _sendConfigTimer.setPeriodSec(getPeriodSec(object, 0, NULL, "sendConfigPeriod"));
+  }
+  else if(strncmp(psKey, "sendCountersPeriod", 18) == 0)
+  {
+    _sendCountersTimer.setPeriodSec(getPeriodSec(object, 0, NULL, "sendCountersPeriod"));
+  }
 
   // Add geopgraphical position to each RF frame?
-  this->_addGeoPosToEachRFFrame = ADD_GEOPOS_TO_EACH_RF_FRAME_DEFAULT_VALUE;
-  if(object["addGeoPosToAllReadings"].success())
+  else if(strcmp(psKey, "addGeoPosToAllReadings") == 0)
   {
     this->_addGeoPosToEachRFFrame = object["addGeoPosToAllReadings"].as<bool>();
   }
 
-  psValue = object["workingMode"].as<const char *>();
-  if(psValue && strcasecmp(psValue, "campaignRange") == 0) { this->_workingMode = WMODE_CAMPAIGN_RANGE; }
-  else                                                     { this->_workingMode = WMODE_NORMAL;         }
+  else if(strcmp(psKey, "workingMode") == 0)
+  {
+    psValue = object["workingMode"].as<const char *>();
+    if(psValue && strcasecmp(psValue, "campaignRange") == 0) { this->_workingMode = WMODE_CAMPAIGN_RANGE; }
+    else                                                     { this->_workingMode = WMODE_NORMAL;         }
+  }
 
   // Configure interruptions
-  CNSSInt::instance()->setConfiguration(object["interruptions"]);
+  else if(strcmp(psKey, "interruptions") == 0) { CNSSInt::instance()->setConfiguration(object["interruptions"]); }
 
   // Configure buzzer
-  if(object["buzzer"].success())
+  else if(strcmp(psKey, "buzzer") == 0)
   {
     if((psValue = object["buzzer"]["activationExtPin"].as<const char *>()) && *psValue &&
 	!buzzer_configure_on_off(psValue))
@@ -1503,135 +1735,128 @@ bool ConnecSenS::loadConfig()
     }
   }
 
-  // Initialise sensors
-  this->NumberOfSensors = 0;
-  count = object["sensors"].size();
-  for(i = 0; i < count; i++)
-  {
-    const char *psType   = object["sensors"][i]["type"].as<const char *>();
-    Sensor     *pvSensor = SensorFactory::getNewSensorInstanceUsingType(psType);
-    if(!pvSensor)
-    {
-      log_error(logger, "Unknown sensor type: %s", psType);
-      continue;
-    }
-
-    // For now the sensor's ConnecSenS RF Data Channel identifier
-    // built using it's position in the sensor's list.
-    // We should offer the possibility, or even maybe impose,
-    // that the channel number is set through a configuration parameter.
-    pvSensor->setCNSSRFDataChannel((CNSSRFDataChannel)(this->NumberOfSensors + CNSSRF_DATA_CHANNEL_1));
-
-    // Set sensor's configuration using JSON
-    if(!pvSensor->setConfiguration(object["sensors"][i]))
-    {
-      log_error(logger, "Failed to configure sensor number %d of type '%s'", i, psType);
-      delete pvSensor; pvSensor = NULL;
-      continue;
-    }
-
-    // Add the sensor to the sensor's list
-    if(this->NumberOfSensors >= CONNECSENS_NB_SENSOR_MAX)
+  // Network
+  else if(strcmp(psKey, "network") == 0)
+  {
+    if(this->Network) { delete this->Network; this->Network = NULL; }
+    psValue = object["network"]["type"].as<const char*>();
+    if(     psValue && strcasecmp(psValue, "LoRaWAN") == 0) { this->Network = new ClassLoRaWAN;  }
+    else if(psValue && strcasecmp(psValue, "SigFox")  == 0) { this->Network = new ClassSigFox;   }
+    else                                                    { this->Network = new ClassNwkSimul; }
+    if(!this->Network->setConfiguration(object["network"]))
     {
-      log_error(logger, "Too many sensors are defined in the configuration; We can handle %d sensors at most.", CONNECSENS_NB_SENSOR_MAX);
-      delete pvSensor; pvSensor = NULL;
-      break;
+      log_error(logger, "Failed to configure network");
+      delete this->Network; this->Network = NULL;
+      res = false;
     }
-    this->_sensors[this->NumberOfSensors++] = pvSensor;
-  }
-
-  // Network
-  psValue = object["network"]["type"].as<const char*>();
-  if(     strcasecmp(psValue, "LoRaWAN") == 0) { this->Network = new ClassLoRaWAN;  }
-  else if(strcasecmp(psValue, "SigFox")  == 0) { this->Network = new ClassSigFox;   }
-  else                                         { this->Network = new ClassNwkSimul; }
-  if(!this->Network->setConfiguration(object["network"]))
-  {
-    log_error(logger, "Failed to configure network");
-    delete this->Network; this->Network = NULL;
-    res = false;
   }
 
   // Get time parameters
-  this->_enableGPS = false;
-  psValue = object["time"]["syncMethod"].as<const char *>();
-  if(!psValue || !*psValue)
+  else if(strcmp(psKey, "time") == 0)
   {
-    log_error(logger, "You must specify the 'syncMethod' used to synchronise the node's time. ");
-    res = false;
-  }
-  else
-  {
-    if(strcasecmp(psValue, "GPS") == 0)
+    JsonObject& time = object["time"];
+
+    psValue = time["syncMethod"].as<const char *>();
+    if(psValue && *psValue)
     {
-      if(object["time"]["GPS"].success())
+      this->_timeSyncMethodIsSet = true;
+      if(strcasecmp(psValue, "GPS") == 0)
       {
-	if(this->GPS.setConfiguration(object["time"]["GPS"])) { this->_enableGPS = true; }
+	if(time["GPS"].success())
+	{
+	  if(this->GPS.setConfiguration(time["GPS"])) { this->_enableGPS = true; }
+	  else
+	  {
+	    log_error(logger, "Failed to configure GPS.");
+	    res = false;
+	  }
+	}
 	else
 	{
-	  log_error(logger, "Failed to configure GPS.");
+	  log_error(logger, "Configured to use GPS but cannot find 'GPS' json object in configuration.");
 	  res = false;
 	}
       }
+      else if(strcasecmp(psValue, "manual")    == 0 ||
+	  strcasecmp(    psValue, "manualUTC") == 0) { }  // Do nothing
       else
       {
-	log_error(logger, "Configured to use GPS but cannot find 'GPS' json object in configuration.");
+	log_error(logger, "Unknown time synchronisation method: '%s'.", psValue);
 	res = false;
       }
+      if((this->_timeSyncMethodChanged = config_monitor_time_sync_method_has_changed(psValue, true, true)))
+      {
+	log_warn(logger, "Time synchronisation method has been changed to %s.", psValue);
+      }
     }
-    else if(strcasecmp(psValue, "manual")    == 0 ||
-	strcasecmp(    psValue, "manualUTC") == 0) { }  // Do nothing
-    else
-    {
-      log_error(logger, "Unknown time synchronisation method: '%s'.", psValue);
-      res = false;
-    }
-    if((this->_timeSyncMethodChanged = config_monitor_time_sync_method_has_changed(psValue, true, true)))
-    {
-      log_warn(logger, "Time synchronisation method has been changed to %s.", psValue);
-    }
+    this->manualTimestamp.hours   = time["manualUTC"]["hours"]  .as<uint8_t>();
+    this->manualTimestamp.minutes = time["manualUTC"]["minutes"].as<uint8_t>();
+    this->manualTimestamp.seconds = time["manualUTC"]["seconds"].as<uint8_t>();
+    this->manualTimestamp.day     = time["manualUTC"]["day"]    .as<uint8_t>();
+    this->manualTimestamp.month   = time["manualUTC"]["month"]  .as<uint8_t>();
+    this->manualTimestamp.year    = time["manualUTC"]["year"]   .as<uint16_t>();
   }
-  this->manualTimestamp.hours   = object["time"]["manualUTC"]["hours"]  .as<uint8_t>();
-  this->manualTimestamp.minutes = object["time"]["manualUTC"]["minutes"].as<uint8_t>();
-  this->manualTimestamp.seconds = object["time"]["manualUTC"]["seconds"].as<uint8_t>();
-  this->manualTimestamp.day     = object["time"]["manualUTC"]["day"]    .as<uint8_t>();
-  this->manualTimestamp.month   = object["time"]["manualUTC"]["month"]  .as<uint8_t>();
-  this->manualTimestamp.year    = object["time"]["manualUTC"]["year"]   .as<uint16_t>();
-
-  if(!this->_enableGPS) { this->_addGeoPosToEachRFFrame = false; }
 
   return res;
 }
 
 /**
- * Check if the configuration has changed, and if so then take some actions.
+ * Create and set up a sensor using its configuration.
+ *
+ * @param[in] psKey  the sensors array's key.
+ * @param[in] index  the sensor's index in the sensors array.
+ * @param[in] object the sensor's configuration.
+ *
+ * @return true, even if the sensor is ignored; errors in a sensor's configuration are only logged.
  */
-void ConnecSenS::detectConfigurationChange()
+bool ConnecSenS::configItemRead(const char *psKey, uint16_t index, const JsonObject& object)
 {
-  File     file;
-  uint32_t size;
+  const char *psType   = object["type"].as<const char *>();
+  Sensor     *pvSensor;
+  (void)psKey;
 
-  // Read the configuration file's contents.
-  if(!sdcard_fopen(&file, CONFIG_FILE_NAME, FILE_OPEN | FILE_READ))
+  if(this->NumberOfSensors >= CONNECSENS_NB_SENSOR_MAX)
   {
-    log_error(logger, "Failed to open configuration file '%s' in read mode", CONFIG_FILE_NAME);
-    return;
+    log_error(logger, "Too many sensors are defined in the configuration; We can handle %d sensors at most.", CONNECSENS_NB_SENSOR_MAX);
+    return true;
   }
-  size = sdcard_fsize(&file);
-  this->myBuffer.clean();
-  if(!sdcard_fread(   &file, this->myBuffer.getBufferPtr(), size))
+
+  if(!(pvSensor = SensorFactory::getNewSensorInstanceUsingType(psType)))
   {
-    log_error(logger, "Failed to read configuration file '%s''s contents.", CONFIG_FILE_NAME);
-    sdcard_fclose(&file);
-    return;
+    log_error(logger, "Unknown sensor type: %s", psType);
+    return true;
   }
-  sdcard_fclose(  &file);
 
-  // Look for changes
-  if(config_monitor_config_has_changed(this->myBuffer.getBufferPtr(), size, false))
+  // For now the sensor's ConnecSenS RF Data Channel identifier
+  // built using it's position in the sensor's list.
+  // We should offer the possibility, or even maybe impose,
+  // that the channel number is set through a configuration parameter.
+  pvSensor->setCNSSRFDataChannel((CNSSRFDataChannel)(this->NumberOfSensors + CNSSRF_DATA_CHANNEL_1));
+
+  // Set sensor's configuration using JSON
+  if(!pvSensor->setConfiguration(object))
+  {
+    log_error(logger, "Failed to configure sensor number %d of type '%s'", index, psType);
+    delete pvSensor; pvSensor = NULL;
+    return true;
+  }
+
+  // Add the sensor to the sensor's list
+  this->_sensors[this->NumberOfSensors++] = pvSensor;
+
+  return true;
+}
+
+/**
+ * Check if the configuration has changed, and if so then take some actions.
+ */
+void ConnecSenS::detectConfigurationChange()
+{
+  // Look for changes. The configuration's hash has been computed while loading it.
+  if(config_monitor_config_has_changed(false))
   {
     // Set current configuration has the reference
-    config_monitor_save_config(        this->myBuffer.getBufferPtr(), size);
+    config_monitor_save_config();
 
     // The configuration file has changed
     log_warn(logger, "Configuration file has changed.");
@@ -1934,24 +2159,59 @@ void ConnecSenS::closeDataOutputCSVFile()
  */
 bool ConnecSenS::startDataOutputCSVLine(const Datetime *pvDt)
 {
+  int  len;
   bool res = false;
 
   if(!this->_output_data_to_csv || !this->_output_data_csv_file_is_opened) { goto exit; }
 
   // Write node values
   if(!pvDt) { pvDt = &this->currentTimestamp; }
-  sprintf(this->_output_data_csv_buffer,
-	  "%s%04d-%02d-%02d %02d:%02d:%02d%c%1.3f",
-	  OUTPUT_DATA_CSV_EOL_STR,
-	  pvDt->year,  pvDt->month,   pvDt->day, pvDt->hours, pvDt->minutes, pvDt->seconds,
-	  OUTPUT_DATA_CSV_SEP,
-	  NodeBattery::instance()->voltageV());
+  len = sprintf(this->_output_data_csv_buffer,
+		"%s%04d-%02d-%02d %02d:%02d:%02d%c",
+		OUTPUT_DATA_CSV_EOL_STR,
+		pvDt->year,  pvDt->month,   pvDt->day, pvDt->hours, pvDt->minutes, pvDt->seconds,
+		OUTPUT_DATA_CSV_SEP);
+  strn_fixed_to_string(&this->_output_data_csv_buffer[len], NodeBattery::instance()->voltageMV(), 3,
+		       sizeof(this->_output_data_csv_buffer) - len, false);
   res = true;
 
   exit:
   return res;
 }
 
+/**
+ * Write a geographical position to a CSV data output line: "<CSV_SEP><latitude><CSV_SEP><longitude>".
+ *
+ * @param[out] psBuffer  where to write to. MUST be NOT NULL.
+ * @param[in]  size      psBuffer's size.
+ * @param[in]  latitude  the latitude, in degrees.
+ * @param[in]  longitude the longitude, in degrees.
+ *
+ * @return the number of characters written, not counting the '\0' string terminator.
+ * @return size if psBuffer is too small.
+ */
+uint32_t ConnecSenS::csvGeoPositionToString(char *psBuffer, uint32_t size, float latitude, float longitude)
+{
+  float    values[2] = { latitude, longitude };
+  char    *pc;
+  uint32_t s;
+  uint8_t  i;
+
+  for(i = 0, s = size; i < 2; i++)
+  {
+    if(s <= 1) { return size; }
+    *psBuffer++ = OUTPUT_DATA_CSV_SEP;
+    s--;
+
+    pc = strn_float_to_string(psBuffer, values[i], 6, s, true);
+    if(pc == psBuffer) { return size; }
+    s       -= pc - psBuffer;
+    psBuffer = pc;
+  }
+
+  return size - s;
+}
+
 
 void ConnecSenS::startCampaignRange()
 {
@@ -2015,15 +2275,12 @@ void ConnecSenS::startCampaignRange()
 	       this->GPS.time().year,  this->GPS.time().month,   this->GPS.time().day,
 	       this->GPS.time().hours, this->GPS.time().minutes, this->GPS.time().seconds);
 
-      // Write position to log
-      log_info(logger, "Position: (lat=%f; long=%f)",
-	       this->GPS.location().latitude, this->GPS.location().longitude);
-
       // Convert position to strings
-      snprintf(latitudeStr,  sizeof(latitudeStr),  "%f", this->GPS.location().latitude);
-      snprintf(longitudeStr, sizeof(longitudeStr), "%f", this->GPS.location().longitude);
-      latitudeStr[ sizeof(latitudeStr)  - 1] = '\0';
-      longitudeStr[sizeof(longitudeStr) - 1] = '\0';
+      strn_float_to_string(latitudeStr,  this->GPS.location().latitude,  6, sizeof(latitudeStr),  false);
+      strn_float_to_string(longitudeStr, this->GPS.location().longitude, 6, sizeof(longitudeStr), false);
+
+      // Write position to log
+      log_info(logger, "Position: (lat=%s; long=%s)", latitudeStr, longitudeStr);
 
       status_ind_set_status(STATUS_IND_GPS_FIX_OK);
     }
@@ -29,12 +29,13 @@
 #include "cnssrf.h"
 #include "cnssrf-dt_config.h"
 #include "sensor.hpp"
+#include "configreader.hpp"
 #include "sdcard.h"
 #include "timer.h"
 
 
 
-#define CONNECSENS_NB_SENSOR_MAX         CNSSRF_DATA_CHANNEL_15
+#define CONNECSENS_NB_SENSOR_MAX         CNSSRF_DATA_CHANNEL_15  // Also sizes SENSOR_STATE_STORE_NB_SLOTS.
 #define CONNECSENS_BUFFER_SIZE		 4096
 #define CONNECSENS_NAME_MAX_SIZE         32
 #define CONNECSENS_UNIQUE_ID_SIZE        (CNSSRF_DT_CONFIG_VALUE_LEN_MAX + 1)
@@ -64,7 +65,7 @@ extern uint8_t AppKey[16];
 
 
 /* Class **************************************************/
-class ConnecSenS : ClassNetwork::EventClient
+class ConnecSenS : ClassNetwork::EventClient, ConfigReader::Client
 {
 public:
   /**
@@ -92,7 +93,7 @@ public:
   void        startCampaignRange();
   void        lookAtResetSource();
 
-  bool saveSensorData(Sensor *pvSensor, ts2000_t ts2000);
+  bool saveSensorData(Sensor *pvSensor, ts2000_t ts2000, uint16_t ms = 0);
 
   static ConnecSenS *instance();
   static void        yield();
@@ -126,7 +127,7 @@ private:
   /* Gestion des Sensors ********************************/
   Sensor *		_sensors[CONNECSENS_NB_SENSOR_MAX];		// Référencement des capteurs utilisés dans la configuration courante
   uint8_t 		NumberOfSensors;						// Nombre de capteurs int�gr�s � la configuration courante
-  void 			ActionOnSensor(Sensor *pvSensor);			// R�alise une s�rie d'actions sur un objet Sensor quelconque
+  bool                  ActionOnSensors(Sensor **ppvSensors, uint8_t nb);  ///< Read a set of sensors, overlapping their measurements.
 
   /* Gestion de l'interface r�seau **********************/
   ClassNetwork *	Network;								// Interface connectivit� sans fil
@@ -145,6 +146,7 @@ private:
   bool                  _firstGPSFix;                ///< Indicate if the current GPS fix is the first one or not.
   bool                  _gpsFixDoneOutsidePeriodic;  ///< Indicate if a GPS fix has been done outside the periodic task
   bool                  _timeSyncMethodChanged;      ///< Indicate if the time synchronisation method changed.
+  bool                  _timeSyncMethodIsSet;        ///< Indicate if the time synchronisation method is set in the configuration.
   Datetime 		currentTimestamp;						// date de l'ex�cution courante
   Datetime		manualTimestamp;						// date venant du fichier config.json lors d'un r�glage manuel
   uint32_t              _lastPeriodicProcess;        ///< Last time the periodic tasks have been processed.
@@ -156,6 +158,8 @@ private:
 
   /* Gestion des diff�rents fichiers d'environnement ****/
   bool 			loadConfig();							// Chargement de la configuration pr�sente dans le fichier config.json
+  bool                  configMemberRead(const char *psKey, const JsonObject& object);
+  bool                  configItemRead(  const char *psKey, uint16_t index, const JsonObject& object);
 
   void  readBatteryVoltage();
 
@@ -165,12 +169,13 @@ private:
   void  openCNSSRFDatalog();
   void  closeCNSSRFDatalog();
 
-  bool  startNewCNSSRFDataFrame(ts2000_t timestamp = 0);
+  bool  startNewCNSSRFDataFrame(ts2000_t timestamp = 0, uint16_t timestampMs = 0);
   bool  appendSensorDataToCurrentCNSSRFDataFrame(Sensor *pvSensor);
   bool  saveCurrentCNSSRFDataFrame();
 
   void detectConfigurationChange();
   bool writeCNSSRFFramesWithConfig();
+  bool writeCNSSRFFrameWithCounters();
   bool appendConfigValueToCurrentCNSSRFFrame(CNSSRFDataChannel   channel,
 					     CNSSRFConfigParamId paramId,
 					     const char         *psValue);
@@ -179,9 +184,11 @@ private:
   bool openDataOutputCSVFile();
   void closeDataOutputCSVFile();
   bool startDataOutputCSVLine(const Datetime *pvDt = NULL);
+  static uint32_t csvGeoPositionToString(char *psBuffer, uint32_t size, float latitude, float longitude);
 
 
-  ClassPeriodic         _sendConfigTimer;  ///< Timer used to periodically send configuration over RF
+  ClassPeriodic         _sendConfigTimer;    ///< Timer used to periodically send configuration over RF
+  ClassPeriodic         _sendCountersTimer;  ///< Timer used to periodically send the runtime performance counters over RF
 
   CNSSRFDataFrame       _cnssrfDataFrame;  ///< The data frame object used for ConnecSenS RF payloads.
   static uint8_t        _cnssrfBuffer[    CONNECSENS_CNSSRF_DATA_FRAME_BUFFER_SIZE];
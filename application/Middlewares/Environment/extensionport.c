@@ -31,7 +31,7 @@ extern "C" {
   static const ExtPortPin _extport_pins[EXTPORT_PIN_COUNT] =
   {
       {
-	  "ANA1",      ADC_ANA1_GPIO, EXTPORT_PIN_FN_ANALOG_INPUT
+	  "ANA1",      ADC_ANA1_GPIO, EXTPORT_PIN_FN_ANALOG_INPUT | EXTPORT_PIN_FN_PULSE_COUNTER
       },
       {
 	  "ANA2",      ADC_ANA2_GPIO, EXTPORT_PIN_FN_ANALOG_INPUT
@@ -44,6 +44,7 @@ extern "C" {
     EXTPORT_PIN_FN_TIMER_CAPTURE      = 1u << 13 | EXTPORT_PIN_FN_TIMER,
     EXTPORT_PIN_FN_TIMER_OUT_COMPARE  = 1u << 14 | EXTPORT_PIN_FN_TIMER,
     EXTPORT_PIN_FN_TIMER_CLK_IN       = 1u << 15 | EXTPORT_PIN_FN_TIMER,
+    EXTPORT_PIN_FN_PULSE_COUNTER      = 1u << 16,  ///< Can be used with the hardware pulse counter (see pulsecounter.h).
 
     EXTPORT_PIN_FN_ACTIVATE_VSENS_EXT = 1u << 31  ///< Active VSens_Extern power supply (interruptions power supply)
   }
@@ -337,7 +337,7 @@ extern "C" {
     {
       if(_nodeinfo_infos.main_board.batt_r26r27_divisor)
       {
-	snprintf(buffer, sizeof(buffer), "%1.3f", _nodeinfo_infos.main_board.batt_r26r27_divisor);
+	strn_float_to_string(buffer, _nodeinfo_infos.main_board.batt_r26r27_divisor, 3, sizeof(buffer), false);
 	ok = sdcard_fwrite_string(&f, buffer);
       }
       else { ok = true; }
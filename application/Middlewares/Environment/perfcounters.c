@@ -0,0 +1,177 @@
+/*
+ * Runtime performance counters.
+ *
+ * @date   2019
+ */
+#include <string.h>
+#include "perfcounters.h"
+#include "board.h"
+#include "retention.h"
+
+
+#define PERF_COUNTERS_RETENTION_MAGIC  0x50434E02  // "PCN" and format version 2.
+
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+
+  /**
+   * The counters, kept in retained memory.
+   */
+  typedef struct PerfCountersRetained
+  {
+    RetentionHeader header;                       ///< The retention header.
+    uint32_t        counters[PERF_COUNTER_COUNT]; ///< The counters.
+  }
+  PerfCountersRetained;
+
+  static PerfCountersRetained _perf_retained RETAINED;
+
+  static uint32_t _perf_start_ms[PERF_COUNTER_COUNT];  ///< Start time of the running durations.
+  static uint32_t _perf_running;                       ///< Bit field; which durations are running?
+  static uint32_t _perf_wakeup_ms;                     ///< Time of the last wakeup.
+  static uint32_t _perf_watchdog_ms;                   ///< Time of the last watchdog refresh.
+  static bool     _perf_is_awake = false;              ///< Is awake time being counted?
+
+
+  /**
+   * Initialise the counters. Restore them from the retained memory, or clear them
+   * if the retained block is not valid.
+   */
+  void perfcounters_init(void)
+  {
+    if(!retention_is_valid(&_perf_retained.header,
+			   _perf_retained.counters, sizeof(_perf_retained.counters),
+			   PERF_COUNTERS_RETENTION_MAGIC))
+    {
+      memset(_perf_retained.counters, 0, sizeof(_perf_retained.counters));
+    }
+    _perf_running = 0;
+
+    perfcounters_wakeup();
+  }
+
+  /**
+   * Clear the counters. To be called once they have been reported.
+   * The awake time is counted again from now.
+   */
+  void perfcounters_clear(void)
+  {
+    memset(_perf_retained.counters, 0, sizeof(_perf_retained.counters));
+    _perf_wakeup_ms = board_ms_now();
+  }
+
+  /**
+   * To be called just before going to sleep.
+   * Count the awake time and seal the retained block.
+   */
+  void perfcounters_sleep(void)
+  {
+    if(_perf_is_awake)
+    {
+      _perf_retained.counters[PERF_COUNTER_AWAKE_MS] += board_ms_diff(_perf_wakeup_ms, board_ms_now());
+      _perf_is_awake = false;
+    }
+
+    retention_seal(&_perf_retained.header,
+		   _perf_retained.counters, sizeof(_perf_retained.counters),
+		   PERF_COUNTERS_RETENTION_MAGIC);
+  }
+
+  /**
+   * To be called when waking up.
+   */
+  void perfcounters_wakeup(void)
+  {
+    _perf_retained.counters[PERF_COUNTER_WAKEUPS]++;
+    _perf_wakeup_ms   = board_ms_now();
+    _perf_watchdog_ms = _perf_wakeup_ms;  // The watchdog is frozen while sleeping.
+    _perf_is_awake    = true;
+  }
+
+
+  /**
+   * Add a value to a counter.
+   *
+   * @param[in] id    the counter's identifier.
+   * @param[in] value the value to add.
+   */
+  void perfcounters_add(PerfCounterId id, uint32_t value)
+  {
+    _perf_retained.counters[id] += value;
+  }
+
+  /**
+   * Start counting a duration.
+   *
+   * @param[in] id the counter's identifier.
+   */
+  void perfcounters_start(PerfCounterId id)
+  {
+    _perf_start_ms[id]  = board_ms_now();
+    _perf_running      |= 1u << id;
+  }
+
+  /**
+   * Stop counting a duration and add it to its counter. Does nothing if it has not been started.
+   *
+   * @param[in] id the counter's identifier.
+   */
+  void perfcounters_stop(PerfCounterId id)
+  {
+    if(_perf_running & (1u << id))
+    {
+      _perf_retained.counters[id] += board_ms_diff(_perf_start_ms[id], board_ms_now());
+      _perf_running               &= ~(1u << id);
+    }
+  }
+
+  /**
+   * Count a radio transmission's time.
+   *
+   * @param[in] datarate the transmission's datarate index.
+   * @param[in] ms       the transmission's time on air, in milliseconds.
+   */
+  void perfcounters_add_tx_time(uint8_t datarate, uint32_t ms)
+  {
+    if(datarate >= PERF_COUNTERS_TX_NB_DATARATES) { datarate = PERF_COUNTERS_TX_NB_DATARATES - 1; }
+
+    _perf_retained.counters[PERF_COUNTER_TX_MS_DR0 + datarate] += ms;
+  }
+
+  /**
+   * To be called each time the watchdog is refreshed.
+   * Count the refreshes that came close to the watchdog's timeout.
+   */
+  void perfcounters_watchdog_refreshed(void)
+  {
+    uint32_t now;
+
+    if(!_perf_is_awake) { return; }
+
+    now = board_ms_now();
+    if(board_ms_diff(_perf_watchdog_ms, now) >= PERF_COUNTERS_WATCHDOG_NEAR_MISS_MS)
+    {
+      _perf_retained.counters[PERF_COUNTER_WATCHDOG_NEAR_MISSES]++;
+    }
+    _perf_watchdog_ms = now;
+  }
+
+  /**
+   * Get a counter's value.
+   *
+   * @param[in] id the counter's identifier.
+   *
+   * @return the value.
+   */
+  uint32_t perfcounters_get(PerfCounterId id)
+  {
+    return _perf_retained.counters[id];
+  }
+
+
+#ifdef __cplusplus
+}
+#endif
@@ -0,0 +1,70 @@
+/*
+ * Runtime performance counters.
+ *
+ * Cheap counters, updated by the drivers and by the application, that tell how the node
+ * spends its energy: how often and for how long it is awake, how much it writes to the SD card,
+ * how much time the radio spends transmitting, etc.
+ * They are kept in retained memory, so they survive sleep and software resets,
+ * and are periodically sent as a system data type, then cleared.
+ *
+ * The retained block is only sealed when going to sleep; if a reset occurs while awake
+ * then the counters of the current reporting period are lost.
+ *
+ * @date   2019
+ */
+#ifndef ENVIRONMENT_PERFCOUNTERS_H_
+#define ENVIRONMENT_PERFCOUNTERS_H_
+
+#include "defs.h"
+
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+
+#ifndef PERF_COUNTERS_WATCHDOG_NEAR_MISS_MS
+#define PERF_COUNTERS_WATCHDOG_NEAR_MISS_MS  24000  ///< A watchdog refresh later than this after the previous one is a near miss. About 75% of the watchdog's timeout.
+#endif
+
+#define PERF_COUNTERS_TX_NB_DATARATES        6      ///< The number of datarates the transmission time is counted for. Higher datarates are counted with the last one.
+
+
+  /**
+   * The counters identifiers.
+   */
+  typedef enum PerfCounterId
+  {
+    PERF_COUNTER_WAKEUPS,               ///< Number of wakeups.
+    PERF_COUNTER_AWAKE_MS,              ///< Time spent awake, in milliseconds.
+    PERF_COUNTER_SD_BYTES_WRITTEN,      ///< Number of bytes written to SD card files.
+    PERF_COUNTER_SD_SYNCS,              ///< Number of SD card files synchronisations.
+    PERF_COUNTER_TX_MS_DR0,             ///< Radio transmission time at datarate 0, in milliseconds.
+    PERF_COUNTER_TX_MS_LAST = PERF_COUNTER_TX_MS_DR0 + PERF_COUNTERS_TX_NB_DATARATES - 1,
+    PERF_COUNTER_TX_RETRIES,            ///< Number of retransmissions of confirmed frames.
+    PERF_COUNTER_SDI12_MS,              ///< Time the SDI-12 bus has been busy, in milliseconds.
+    PERF_COUNTER_WATCHDOG_NEAR_MISSES,  ///< Number of watchdog refreshes that came close to the timeout.
+    PERF_COUNTER_INTERRUPTIONS,         ///< Number of sensor interruption IRQs dispatched to clients.
+    PERF_COUNTER_INT_LATENCY_MS,        ///< Sum of the times between a sensor interruption IRQ and its dispatch to the clients, in milliseconds.
+    PERF_COUNTER_COUNT                  ///< Not an actual counter; used to count them.
+  }
+  PerfCounterId;
+
+
+  extern void     perfcounters_init(  void);
+  extern void     perfcounters_clear( void);
+  extern void     perfcounters_sleep( void);
+  extern void     perfcounters_wakeup(void);
+
+  extern void     perfcounters_add(               PerfCounterId id,       uint32_t value);
+  extern void     perfcounters_start(             PerfCounterId id);
+  extern void     perfcounters_stop(              PerfCounterId id);
+  extern void     perfcounters_add_tx_time(       uint8_t       datarate, uint32_t ms);
+  extern void     perfcounters_watchdog_refreshed(void);
+  extern uint32_t perfcounters_get(               PerfCounterId id);
+
+
+#ifdef __cplusplus
+}
+#endif
+#endif /* ENVIRONMENT_PERFCOUNTERS_H_ */
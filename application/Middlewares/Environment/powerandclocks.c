@@ -8,6 +8,7 @@
 #include "powerandclocks.h"
 #include "logger.h"
 #include "timer.h"
+#include "trace.h"
 
 
 #ifdef __cplusplus
@@ -52,6 +53,13 @@ extern "C" {
   /// Points to the list of power mode change event listeners.
   static PwrClkPowerModeChangeListener *_pwrclk_power_mode_change_listeners = NULL;
 
+  /// Points to the list of active clock requirements.
+  static PwrClkRequirement *_pwrclk_requirements = NULL;
+
+  /// The CPU's requirement; released while waiting for I/Os.
+  static PwrClkRequirement _pwrclk_cpu_requirement = { "CPU", PWRCLK_CLOCK_SYSCLK, 0, NULL };
+  static uint8_t           _pwrclk_io_wait_depth   = 0;  ///< The number of nested I/O waits.
+
 
 
   /**
@@ -59,8 +67,9 @@ extern "C" {
    */
   typedef struct PwrClkClockConfig
   {
-    PwrClkClockConfigId id;        ///< The identifier for this configuration.
-    const char          *ps_name;  ///< The configuration's name.
+    PwrClkClockConfigId id;          ///< The identifier for this configuration.
+    const char          *ps_name;    ///< The configuration's name.
+    PwrClkPowerMode     power_mode;  ///< The power mode used by this configuration; RUN or LPRUN.
 
     /**
      * Contains the clocks frequencies.
@@ -73,7 +82,11 @@ extern "C" {
   PwrClkClockConfig;
 
 
-  static void pwrclk_set_run_config(void);
+  static void pwrclk_set_run_config(       void);
+  static void pwrclk_set_run_4mhz_config(  void);
+  static void pwrclk_set_lprun_2mhz_config(void);
+  static void pwrclk_update_clock_config(  void);
+  static void pwrclk_restore_clocks_after_stop(void);
   static void pwrclk_signal_power_mode_change(PwrClkPowerMode current_mode,
 					      PwrClkPowerMode previous_mode);
 
@@ -86,6 +99,7 @@ extern "C" {
       {
 	  PWRCLK_CLOCK_CONFIG_RUN,  // id
 	  "Run",                    // ps_name
+	  PWRCLK_POWER_MODE_RUN,    // power_mode
 	  {
 	      48000000,     // PWRCLK_CLOCK_SYSCLK
 	      48000000,     // PWRCLK_CLOCK_HCLK
@@ -94,7 +108,7 @@ extern "C" {
 	      LSE_FREQ_HZ,  // PWRCLK_CLOCK_LSE
 	      0,            // PWRCLK_CLOCK_LSI
 	      48000000,     // PWRCLK_CLOCK_MSI
-	      0,            // PWRCLK_CLOCK_HSI16
+	      16000000,     // PWRCLK_CLOCK_HSI16
 	      0,            // PWRCLK_CLOCK_HSE
 	      0,            // PWRCLK_CLOCK_SAI1
 #ifdef RCC_PLLSAI2_SUPPORT
@@ -102,6 +116,48 @@ extern "C" {
 #endif
 	  },
 	  pwrclk_set_run_config  // pf_set_clocks
+      },
+      {
+	  PWRCLK_CLOCK_CONFIG_RUN_4MHZ,  // id
+	  "Run 4 MHz",                   // ps_name
+	  PWRCLK_POWER_MODE_RUN,         // power_mode
+	  {
+	      4000000,      // PWRCLK_CLOCK_SYSCLK
+	      4000000,      // PWRCLK_CLOCK_HCLK
+	      4000000,      // PWRCLK_CLOCK_PCLK1
+	      4000000,      // PWRCLK_CLOCK_PCLK2
+	      LSE_FREQ_HZ,  // PWRCLK_CLOCK_LSE
+	      0,            // PWRCLK_CLOCK_LSI
+	      4000000,      // PWRCLK_CLOCK_MSI
+	      16000000,     // PWRCLK_CLOCK_HSI16
+	      0,            // PWRCLK_CLOCK_HSE
+	      0,            // PWRCLK_CLOCK_SAI1
+#ifdef RCC_PLLSAI2_SUPPORT
+	      0,            // PWRCLK_CLOCK_SAI2
+#endif
+	  },
+	  pwrclk_set_run_4mhz_config  // pf_set_clocks
+      },
+      {
+	  PWRCLK_CLOCK_CONFIG_LPRUN_2MHZ,  // id
+	  "LPRun 2 MHz",                   // ps_name
+	  PWRCLK_POWER_MODE_LPRUN,         // power_mode
+	  {
+	      2000000,      // PWRCLK_CLOCK_SYSCLK
+	      2000000,      // PWRCLK_CLOCK_HCLK
+	      2000000,      // PWRCLK_CLOCK_PCLK1
+	      2000000,      // PWRCLK_CLOCK_PCLK2
+	      LSE_FREQ_HZ,  // PWRCLK_CLOCK_LSE
+	      0,            // PWRCLK_CLOCK_LSI
+	      2000000,      // PWRCLK_CLOCK_MSI
+	      16000000,     // PWRCLK_CLOCK_HSI16
+	      0,            // PWRCLK_CLOCK_HSE
+	      0,            // PWRCLK_CLOCK_SAI1
+#ifdef RCC_PLLSAI2_SUPPORT
+	      0,            // PWRCLK_CLOCK_SAI2
+#endif
+	  },
+	  pwrclk_set_lprun_2mhz_config  // pf_set_clocks
       }
   };
 
@@ -145,6 +201,9 @@ extern "C" {
     HAL_PWREx_EnableVddIO2();
 
     pwrclk_switch_clock_config_to(PWRCLK_CLOCK_CONFIG_DEFAULT);
+
+    // The CPU needs its full speed, except while waiting for I/Os.
+    pwrclk_require(&_pwrclk_cpu_requirement, PWRCLK_CLOCK_SYSCLK, PWRCLK_CPU_CLOCK_HZ);
   }
 
 
@@ -156,6 +215,7 @@ extern "C" {
   void pwrclk_switch_clock_config_to(PwrClkClockConfigId cfg_id)
   {
     const PwrClkClockConfig *pv_config;
+    const PwrClkClockConfig *pv_previous = _pv_pwrclk_current_clock_config;
 
     // Check identifier
     if(cfg_id < 0 || cfg_id >= PWRCLK_CLOCK_CONFIG_COUNT)
@@ -176,10 +236,111 @@ extern "C" {
     // For HAL library
     SystemCoreClock = pv_config->clock_frequencies_hz[PWRCLK_CLOCK_HCLK];
 
+    // Let the peripherals adapt to the new clocks
+    if(pv_previous)
+    {
+      TRACE_STATE(TRACE_ID_CLOCK, SystemCoreClock / 100000);
+      pwrclk_signal_power_mode_change(pv_config->power_mode, pv_previous->power_mode);
+    }
+
     exit:
     return;
   }
 
+  /**
+   * Switch to the slowest clock configuration that satisfies all the active requirements.
+   */
+  static void pwrclk_update_clock_config(void)
+  {
+    const PwrClkClockConfig *pv_config;
+    PwrClkRequirement       *pv_req;
+    int8_t                   id;
+
+    // Keep the default configuration until pwrclk_init() has been called.
+    if(!_pv_pwrclk_current_clock_config) { return; }
+
+    // The configurations are ordered from the fastest to the slowest; the fastest is the fallback.
+    for(id = PWRCLK_CLOCK_CONFIG_COUNT - 1; id > 0; id--)
+    {
+      pv_config = &_pwrclk_clock_configs[id];
+      for(pv_req = _pwrclk_requirements; pv_req; pv_req = pv_req->pv_next)
+      {
+	if(pv_config->clock_frequencies_hz[pv_req->clock] < pv_req->min_hz) { break; }
+      }
+      if(!pv_req) { break; }
+    }
+
+    pwrclk_switch_clock_config_to((PwrClkClockConfigId)id);
+  }
+
+  /**
+   * Set or update a clock requirement, and switch to a faster clock configuration if needed.
+   *
+   * @param[in] pv_req the requirement. MUST be NOT NULL. Its name MUST have been set.
+   * @param[in] clock  the required clock.
+   * @param[in] min_hz the clock's minimum frequency, in Hz.
+   */
+  void pwrclk_require(PwrClkRequirement *pv_req, PwrClkClockId clock, uint32_t min_hz)
+  {
+    PwrClkRequirement *pv;
+
+    // Add it to the active requirements if it is not already there.
+    for(pv = _pwrclk_requirements; pv && pv != pv_req; pv = pv->pv_next) ;
+    if(!pv)
+    {
+      pv_req->pv_next      = _pwrclk_requirements;
+      _pwrclk_requirements = pv_req;
+    }
+    pv_req->clock  = clock;
+    pv_req->min_hz = min_hz;
+
+    pwrclk_update_clock_config();
+  }
+
+  /**
+   * Release a clock requirement, and switch to a slower clock configuration if possible.
+   * Does nothing if the requirement is not active.
+   *
+   * @param[in] pv_req the requirement. MUST be NOT NULL.
+   */
+  void pwrclk_release(PwrClkRequirement *pv_req)
+  {
+    PwrClkRequirement **ppv;
+
+    for(ppv = &_pwrclk_requirements; *ppv; ppv = &(*ppv)->pv_next)
+    {
+      if(*ppv == pv_req)
+      {
+	*ppv            = pv_req->pv_next;
+	pv_req->pv_next = NULL;
+	pwrclk_update_clock_config();
+	break;
+      }
+    }
+  }
+
+  /**
+   * To be called when the CPU starts waiting for I/Os, polling or sleeping.
+   * The clocks are slowed down as much as the other requirements allow.
+   * Calls can be nested; each call MUST be matched by a call to pwrclk_io_wait_end().
+   */
+  void pwrclk_io_wait_begin(void)
+  {
+    if(!_pwrclk_io_wait_depth++) { pwrclk_release(&_pwrclk_cpu_requirement); }
+  }
+
+  /**
+   * To be called when the CPU has finished waiting for I/Os.
+   * The CPU gets its full speed back.
+   */
+  void pwrclk_io_wait_end(void)
+  {
+    if(_pwrclk_io_wait_depth && !--_pwrclk_io_wait_depth)
+    {
+      pwrclk_require(&_pwrclk_cpu_requirement, PWRCLK_CLOCK_SYSCLK, PWRCLK_CPU_CLOCK_HZ);
+    }
+  }
+
   /**
    * Return the clock frequency, in Hz, of a given clock.
    *
@@ -196,6 +357,16 @@ extern "C" {
    */
   static void pwrclk_set_run_config(void)
   {
+    // Get the main regulator and its range 1 back first; they are needed for the higher frequencies.
+    if(READ_BIT(PWR->CR1, PWR_CR1_LPR) && HAL_PWREx_DisableLowPowerRunMode() != HAL_OK)
+    {
+      log_fatal(logger, "Failed to leave low-power run mode.");
+    }
+    if(HAL_PWREx_ControlVoltageScaling(PWR_REGULATOR_VOLTAGE_SCALE1) != HAL_OK)
+    {
+      log_fatal(logger, "Failed to set Run voltage regulator configuration.");
+    }
+
     if(!_pwrclk_run_cfg.has_been_initialised)
     {
       _pwrclk_run_cfg.osc_init.OscillatorType      = RCC_OSCILLATORTYPE_MSI | RCC_OSCILLATORTYPE_HSI;
@@ -235,13 +406,69 @@ extern "C" {
     {
       log_fatal(logger, "Failed to set Run clock configuration.");
     }
+  }
 
-    if(HAL_PWREx_ControlVoltageScaling(PWR_REGULATOR_VOLTAGE_SCALE1) != HAL_OK)
+  /**
+   * Set up a configuration where every clock comes, undivided, from the MSI,
+   * with the voltage regulator in range 2.
+   *
+   * The HSI16 is kept on, for the USARTs. The other oscillators and the peripherals' clock sources
+   * are left as they are; the peripherals clocked by the MSI or by the APB clocks must adapt
+   * to the new frequencies.
+   *
+   * @param[in] msi_range the MSI range; one of RCC_MSIRANGE_x, for a frequency of 6 MHz at most.
+   * @param[in] lprun     use the low-power run mode? If so then the frequency MUST be 2 MHz at most.
+   */
+  static void pwrclk_set_msi_config(uint32_t msi_range, bool lprun)
+  {
+    RCC_OscInitTypeDef osc_init;
+    RCC_ClkInitTypeDef clk_init;
+
+    // The clocks can only be changed with the main regulator
+    if(READ_BIT(PWR->CR1, PWR_CR1_LPR) && HAL_PWREx_DisableLowPowerRunMode() != HAL_OK)
     {
-      log_fatal(logger, "Failed to set Run voltage regulator configuration.");
+      log_fatal(logger, "Failed to leave low-power run mode.");
     }
+
+    osc_init.OscillatorType      = RCC_OSCILLATORTYPE_MSI | RCC_OSCILLATORTYPE_HSI;
+    osc_init.MSIState            = RCC_MSI_ON;
+    osc_init.MSICalibrationValue = 0;
+    osc_init.MSIClockRange       = msi_range;
+    osc_init.PLL.PLLState        = RCC_PLL_NONE;
+    osc_init.HSIState            = RCC_HSI_ON;
+    osc_init.HSICalibrationValue = 0;
+
+    clk_init.ClockType      = RCC_CLOCKTYPE_HCLK  | RCC_CLOCKTYPE_SYSCLK |
+	RCC_CLOCKTYPE_PCLK1 | RCC_CLOCKTYPE_PCLK2;
+    clk_init.SYSCLKSource   = RCC_SYSCLKSOURCE_MSI;
+    clk_init.AHBCLKDivider  = RCC_SYSCLK_DIV1;
+    clk_init.APB1CLKDivider = RCC_HCLK_DIV1;
+    clk_init.APB2CLKDivider = RCC_HCLK_DIV1;
+
+    // Lower the frequency first, then the regulator's range.
+    if( HAL_RCC_OscConfig(  &osc_init)                  != HAL_OK ||
+	HAL_RCC_ClockConfig(&clk_init, FLASH_LATENCY_0) != HAL_OK)
+    {
+      log_fatal(logger, "Failed to set MSI clock configuration.");
+    }
+    if(HAL_PWREx_ControlVoltageScaling(PWR_REGULATOR_VOLTAGE_SCALE2) != HAL_OK)
+    {
+      log_fatal(logger, "Failed to set MSI voltage regulator configuration.");
+    }
+
+    if(lprun) { HAL_PWREx_EnableLowPowerRunMode(); }
   }
 
+  /**
+   * Set up the Run 4 MHz configuration.
+   */
+  static void pwrclk_set_run_4mhz_config(void) { pwrclk_set_msi_config(RCC_MSIRANGE_6, false); }
+
+  /**
+   * Set up the LPRun 2 MHz configuration.
+   */
+  static void pwrclk_set_lprun_2mhz_config(void) { pwrclk_set_msi_config(RCC_MSIRANGE_5, true); }
+
 
   /**
    * Go to Sleep low power mode.
@@ -253,11 +480,19 @@ extern "C" {
    */
   void pwrclk_sleep(void)
   {
-    pwrclk_signal_power_mode_change(PWRCLK_POWER_MODE_SLEEP, PWRCLK_POWER_MODE_RUN);
+    PwrClkPowerMode run_mode, sleep_mode;
+
+    pwrclk_io_wait_begin();
+    run_mode   = _pv_pwrclk_current_clock_config->power_mode;
+    sleep_mode = run_mode == PWRCLK_POWER_MODE_LPRUN ? PWRCLK_POWER_MODE_LPSLEEP : PWRCLK_POWER_MODE_SLEEP;
 
-    HAL_PWR_EnterSLEEPMode(PWR_MAINREGULATOR_ON, PWR_SLEEPENTRY_WFI);
+    pwrclk_signal_power_mode_change(sleep_mode, run_mode);
 
-    pwrclk_signal_power_mode_change(PWRCLK_POWER_MODE_RUN, PWRCLK_POWER_MODE_SLEEP);
+    HAL_PWR_EnterSLEEPMode(run_mode == PWRCLK_POWER_MODE_LPRUN ? PWR_LOWPOWERREGULATOR_ON : PWR_MAINREGULATOR_ON,
+			   PWR_SLEEPENTRY_WFI);
+
+    pwrclk_signal_power_mode_change(run_mode, sleep_mode);
+    pwrclk_io_wait_end();
   }
 
 
@@ -273,22 +508,86 @@ extern "C" {
    */
   void pwrclk_sleep_ms_max(uint32_t ms)
   {
-    Timer timer;
+    pwrclk_idle_ms(ms);
+  }
+
+  /**
+   * Idle until a deadline, or until an interruption wakes us up.
+   *
+   * The Stop 2 mode is used, with the RTC alarm of a millisecond timer to wake up, unless the wait is
+   * shorter than PWRCLK_IDLE_STOP_MIN_MS or a peripheral has an active clock requirement;
+   * its clock would be stopped. The Sleep mode, with the clocks as slow as possible, is used then.
+   *
+   * Only an interruption can wake us up. Events do not.
+   *
+   * @post When we get out of this function then we are in Run mode,
+   *       with the power and clock configuration used when entering the function.
+   *
+   * @param[in] ms the maximum number of milliseconds to idle.
+   *
+   * @return PWRCLK_WAKE_REASON_TIMEOUT      if the deadline has been reached.
+   * @return PWRCLK_WAKE_REASON_INTERRUPTION if another interruption has woken us up before the deadline.
+   */
+  PwrClkWakeReason pwrclk_idle_ms(uint32_t ms)
+  {
+    Timer            timer;
+    PwrClkPowerMode  run_mode, idle_mode;
+    PwrClkWakeReason reason;
 
     timer_init( &timer, ms, TIMER_TU_MSECS | TIMER_SINGLE_SHOT | TIMER_RELATIVE);
     timer_start(&timer);
 
-    // Go to Sleep low power mode.
-    pwrclk_signal_power_mode_change(PWRCLK_POWER_MODE_SLEEP, PWRCLK_POWER_MODE_RUN);
+    // Once the CPU's requirement has been released, the remaining ones are the peripherals'.
+    pwrclk_io_wait_begin();
+    run_mode = _pv_pwrclk_current_clock_config->power_mode;
+    if(ms >= PWRCLK_IDLE_STOP_MIN_MS && !_pwrclk_requirements) { idle_mode = PWRCLK_POWER_MODE_STOP2;   }
+    else if(run_mode == PWRCLK_POWER_MODE_LPRUN)               { idle_mode = PWRCLK_POWER_MODE_LPSLEEP; }
+    else                                                       { idle_mode = PWRCLK_POWER_MODE_SLEEP;   }
+
+    pwrclk_signal_power_mode_change(idle_mode, run_mode);
     if(!timer_has_timed_out(&timer))
     {
-      HAL_PWR_EnterSLEEPMode(PWR_MAINREGULATOR_ON, PWR_SLEEPENTRY_WFI);
+      if(idle_mode == PWRCLK_POWER_MODE_STOP2)
+      {
+	HAL_PWREx_EnterSTOP2Mode(PWR_STOPENTRY_WFI);
+	pwrclk_restore_clocks_after_stop();
+      }
+      else
+      {
+	HAL_PWR_EnterSLEEPMode(run_mode == PWRCLK_POWER_MODE_LPRUN ? PWR_LOWPOWERREGULATOR_ON : PWR_MAINREGULATOR_ON,
+			       PWR_SLEEPENTRY_WFI);
+      }
     }
-    pwrclk_signal_power_mode_change(PWRCLK_POWER_MODE_RUN, PWRCLK_POWER_MODE_SLEEP);
+    pwrclk_signal_power_mode_change(run_mode, idle_mode);
+    pwrclk_io_wait_end();
 
-    // We have been woken up by our timer or by any other interruption or event.
-    // Stop our timer.
+    // We have been woken up by our timer or by any other interruption.
+    reason = timer_has_timed_out(&timer) ? PWRCLK_WAKE_REASON_TIMEOUT : PWRCLK_WAKE_REASON_INTERRUPTION;
     timer_stop(&timer);
+
+    return reason;
+  }
+
+  /**
+   * Overrides the weak HAL HAL_Delay() function.
+   * Idle until the delay has elapsed, rather than busy waiting.
+   *
+   * Busy waits if called from an interruption handler, as the RTC alarm may not be able
+   * to preempt it, or before pwrclk_init() has been called.
+   *
+   * @param[in] ms the delay, in milliseconds.
+   */
+  void HAL_Delay(uint32_t ms)
+  {
+    uint32_t ref_ms = board_ms_now();
+    uint32_t elapsed_ms;
+
+    while((elapsed_ms = board_ms_diff(ref_ms, board_ms_now())) < ms)
+    {
+      if(__get_IPSR() || !_pv_pwrclk_current_clock_config) { continue; }
+
+      pwrclk_idle_ms(ms - elapsed_ms);
+    }
   }
 
 
@@ -301,14 +600,26 @@ extern "C" {
    */
   void pwrclk_stop(void)
   {
-    pwrclk_signal_power_mode_change(PWRCLK_POWER_MODE_STOP1, PWRCLK_POWER_MODE_RUN);
+    pwrclk_signal_power_mode_change(PWRCLK_POWER_MODE_STOP1, _pv_pwrclk_current_clock_config->power_mode);
 
     HAL_PWREx_EnterSTOP1Mode(PWR_SLEEPENTRY_WFI);
 
-    // Set up default configuration
-    pwrclk_switch_clock_config_to(PWRCLK_CLOCK_CONFIG_DEFAULT);
+    // Set up the configuration required by the active requirements
+    pwrclk_restore_clocks_after_stop();
+    pwrclk_update_clock_config();
+
+    pwrclk_signal_power_mode_change(_pv_pwrclk_current_clock_config->power_mode, PWRCLK_POWER_MODE_STOP1);
+  }
 
-    pwrclk_signal_power_mode_change(PWRCLK_CLOCK_CONFIG_DEFAULT, PWRCLK_POWER_MODE_STOP1);
+
+  /**
+   * Set the current clock configuration up again after a wakeup from a Stop mode.
+   * The system clock is back on the MSI, but the HSI16 has been turned off and the regulator
+   * may have left the low-power run mode.
+   */
+  static void pwrclk_restore_clocks_after_stop(void)
+  {
+    _pv_pwrclk_current_clock_config->pf_set_clocks();
   }
 
 
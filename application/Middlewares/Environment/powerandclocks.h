@@ -16,12 +16,23 @@ extern "C" {
 #endif
 
 
+#ifndef PWRCLK_CPU_CLOCK_HZ
+#define PWRCLK_CPU_CLOCK_HZ      48000000  ///< The system clock frequency the CPU needs when it is not waiting for I/Os.
+#endif
+#ifndef PWRCLK_IDLE_STOP_MIN_MS
+#define PWRCLK_IDLE_STOP_MIN_MS  5         ///< Idle waits shorter than this, in milliseconds, use the Sleep mode rather than the Stop 2 mode.
+#endif
+
+
   /**
    * The clock configuration identifiers.
+   * Ordered from the fastest configuration to the slowest one.
    */
   typedef enum PwrClkClockConfigId
   {
-    PWRCLK_CLOCK_CONFIG_RUN,  ///< Normal run mode, with USB.
+    PWRCLK_CLOCK_CONFIG_RUN,           ///< Normal run mode, with USB.
+    PWRCLK_CLOCK_CONFIG_RUN_4MHZ,      ///< Run mode, MSI at 4 MHz.
+    PWRCLK_CLOCK_CONFIG_LPRUN_2MHZ,    ///< Low-power run mode, MSI at 2 MHz.
     PWRCLK_CLOCK_CONFIG_COUNT,         ///< Not an actual identifier. Is after last valid id to count the number of identifiers.
     PWRCLK_CLOCK_CONFIG_NONE    = PWRCLK_CLOCK_CONFIG_COUNT,  ///< Id to indicate no id set.
     PWRCLK_CLOCK_CONFIG_DEFAULT = PWRCLK_CLOCK_CONFIG_RUN     ///< Default clock configuration
@@ -100,6 +111,16 @@ extern "C" {
   }
   PwrClkPowerMode;
 
+  /**
+   * Why an idle wait has ended.
+   */
+  typedef enum PwrClkWakeReason
+  {
+    PWRCLK_WAKE_REASON_TIMEOUT,      ///< The wait's deadline has been reached.
+    PWRCLK_WAKE_REASON_INTERRUPTION  ///< An interruption, other than the wait's timer, has woken the µC up.
+  }
+  PwrClkWakeReason;
+
   /**
    * Used to store information about a listener for 'power mode change event'.
    */
@@ -111,6 +132,9 @@ extern "C" {
 
     /**
      * Function called when the power mode has changed.
+     * Also called when the clock configuration has changed; then both modes are run modes,
+     * possibly the same (see pwrclk_is_clock_config_change()), and the new clock frequencies
+     * are given by pwrclk_clock_frequency_hz().
      *
      * The function pointer MUST be NOT NULL.
      *
@@ -122,15 +146,35 @@ extern "C" {
     PwrClkPowerModeChangeListener *pv_next;  ///< Next listener in the list. NULL if last in the list.
   };
 
+  /**
+   * A clock requirement: the minimum frequency a subsystem needs for a given clock,
+   * for as long as the requirement is active.
+   */
+  struct PwrClkRequirement;
+  typedef struct PwrClkRequirement PwrClkRequirement;
+  struct PwrClkRequirement
+  {
+    const char        *ps_name;  ///< The requirement's name. MUST be NOT NULL and NOT EMPTY.
+    PwrClkClockId      clock;    ///< The required clock. Set by pwrclk_require().
+    uint32_t           min_hz;   ///< The minimum frequency, in Hz. Set by pwrclk_require().
+    PwrClkRequirement *pv_next;  ///< Next active requirement. Used internally.
+  };
+
 
   extern void     pwrclk_init(void);
   extern void     pwrclk_switch_clock_config_to(PwrClkClockConfigId cfg_id);
   extern uint32_t pwrclk_clock_frequency_hz(    PwrClkClockId id);
 
+  extern void pwrclk_require(      PwrClkRequirement *pv_req, PwrClkClockId clock, uint32_t min_hz);
+  extern void pwrclk_release(      PwrClkRequirement *pv_req);
+  extern void pwrclk_io_wait_begin(void);
+  extern void pwrclk_io_wait_end(  void);
+
   extern void pwrclk_sleep(void);
   extern void pwrclk_stop( void);
 
-  extern void pwrclk_sleep_ms_max(uint32_t ms);
+  extern void             pwrclk_sleep_ms_max(uint32_t ms);
+  extern PwrClkWakeReason pwrclk_idle_ms(     uint32_t ms);
 
   extern void pwrclk_register_power_mode_change_listener(PwrClkPowerModeChangeListener *pv_listener);
   /**
@@ -144,6 +188,18 @@ extern "C" {
    */
 #define pwrclk_is_power_mode_at_most(pwmode, ref)  ((pwmode) >= (ref))
 
+  /**
+   * Indicate if a power mode change event is in fact a clock configuration change.
+   *
+   * @param[in] current_mode  the event's current power mode.
+   * @param[in] previous_mode the event's previous power mode.
+   *
+   * @return true  if it is a clock configuration change.
+   * @return false otherwise.
+   */
+#define pwrclk_is_clock_config_change(current_mode, previous_mode)  \
+  ((current_mode) <= PWRCLK_POWER_MODE_LPRUN && (previous_mode) <= PWRCLK_POWER_MODE_LPRUN)
+
 
 #ifdef __cplusplus
 }
@@ -0,0 +1,132 @@
+/*
+ * Lightweight execution tracing.
+ *
+ * @date   2019
+ */
+#include "trace.h"
+#include "config.h"
+#include "sdcard.h"
+#include "rtc.h"
+
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+
+#if TRACE_CATEGORIES
+
+#define TRACE_FILE  LOG_DIRECTORY_NAME "/trace.bin"
+
+  /**
+   * The tracing state.
+   */
+  typedef struct Trace
+  {
+    TraceDumpHeader header;                    ///< The current wakeup's header.
+    TraceRecord     records[TRACE_RING_SIZE];  ///< The records.
+    bool            enabled;                   ///< Are records recorded?
+  }
+  Trace;
+
+  static Trace _trace;
+
+
+  /**
+   * Initialise tracing and start the DWT cycle counter.
+   */
+  void trace_init(void)
+  {
+    CoreDebug->DEMCR |= CoreDebug_DEMCR_TRCENA_Msk;
+    DWT->CYCCNT       = 0;
+    DWT->CTRL        |= DWT_CTRL_CYCCNTENA_Msk;
+
+    trace_wakeup();
+  }
+
+  /**
+   * Start recording a new wakeup. The records from the previous wakeup are discarded.
+   */
+  void trace_wakeup(void)
+  {
+    _trace.header.magic         = TRACE_DUMP_MAGIC;
+    _trace.header.wakeup_ts     = rtc_get_date_as_secs_since_2000();
+    _trace.header.core_clock_hz = SystemCoreClock;
+    _trace.header.nb_records    = 0;
+    _trace.header.nb_dropped    = 0;
+    _trace.enabled              = true;
+  }
+
+  /**
+   * Add a record to the ring. Can be called from interrupt handlers.
+   *
+   * @param[in] id   the trace point's identifier.
+   * @param[in] kind the record's kind.
+   * @param[in] arg  the record's argument.
+   */
+  void trace_record(TraceId id, TraceKind kind, uint16_t arg)
+  {
+    TraceRecord *pv_record;
+    uint32_t     primask;
+
+    if(!_trace.enabled) { return; }
+
+    primask = __get_PRIMASK();
+    __disable_irq();
+    if(_trace.header.nb_records < TRACE_RING_SIZE)
+    {
+      pv_record         = &_trace.records[_trace.header.nb_records++];
+      pv_record->cycles = DWT->CYCCNT;
+      pv_record->ms     = board_ms_now();
+      pv_record->arg    = arg;
+      pv_record->id     = (uint8_t)id;
+      pv_record->kind   = (uint8_t)kind;
+    }
+    else { _trace.header.nb_dropped++; }
+    __set_PRIMASK(primask);
+  }
+
+  /**
+   * Append the current wakeup's records to the trace file.
+   * The file is restarted when it has become too big.
+   *
+   * Recording is suspended while the file is written, so that the SD card's
+   * trace points do not show up in the dump.
+   */
+  void trace_dump(void)
+  {
+    File file;
+
+    _trace.enabled = false;
+
+    if(!sdcard_fopen(&file, TRACE_FILE, FILE_APPEND | FILE_WRITE)) { goto exit; }
+    if(sdcard_fsize(&file) >= TRACE_FILE_SIZE_MAX)
+    {
+      if(!sdcard_ftruncateTo(&file, 0, false)) { goto close_exit; }
+    }
+    if(sdcard_fwrite(&file, (const uint8_t *)&_trace.header,  sizeof(_trace.header)))
+    {
+      sdcard_fwrite( &file, (const uint8_t *)_trace.records,
+		     _trace.header.nb_records * sizeof(TraceRecord));
+    }
+
+    close_exit:
+    sdcard_fclose(&file);
+
+    exit:
+    return;
+  }
+
+#else  // TRACE_CATEGORIES
+
+  void trace_init(  void) { }
+  void trace_wakeup(void) { }
+  void trace_dump(  void) { }
+  void trace_record(TraceId id, TraceKind kind, uint16_t arg) { (void)id; (void)kind; (void)arg; }
+
+#endif  // TRACE_CATEGORIES
+
+
+#ifdef __cplusplus
+}
+#endif
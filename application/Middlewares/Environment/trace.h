@@ -0,0 +1,163 @@
+/*
+ * Lightweight execution tracing.
+ *
+ * Trace points record the DWT cycle counter and the millisecond tick into a RAM ring.
+ * The ring is written to the SD card before going to sleep, one block per wakeup,
+ * so that where the awake time goes can be analysed on a host.
+ *
+ * The trace points are grouped into categories, selected at compile time with
+ * TRACE_CATEGORIES. The trace points of the categories not selected are not compiled in;
+ * with TRACE_CATEGORIES set to 0, the default, tracing does not cost anything.
+ *
+ * @date   2019
+ */
+#ifndef ENVIRONMENT_TRACE_H_
+#define ENVIRONMENT_TRACE_H_
+
+#include "board.h"
+
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+
+  /**
+   * The trace categories. Trace identifiers are grouped by category, 16 per category.
+   */
+#define TRACE_CATEGORY_APP      (1u << 0)  ///< Application's main tasks.
+#define TRACE_CATEGORY_DATALOG  (1u << 1)  ///< Datalog files.
+#define TRACE_CATEGORY_SDCARD   (1u << 2)  ///< SD card files operations.
+#define TRACE_CATEGORY_SDI12    (1u << 3)  ///< SDI-12 bus.
+#define TRACE_CATEGORY_LORAMAC  (1u << 4)  ///< LoRaWAN MAC and radio.
+#define TRACE_CATEGORY_POWER    (1u << 5)  ///< Power supplies and clocks.
+#define TRACE_CATEGORY_ALL      0x3Fu
+
+#ifndef TRACE_CATEGORIES
+#define TRACE_CATEGORIES        0     ///< The categories of the trace points to compile in.
+#endif
+#ifndef TRACE_RING_SIZE
+#define TRACE_RING_SIZE         256   ///< The number of records the ring can hold. Records past that are dropped.
+#endif
+#ifndef TRACE_FILE_SIZE_MAX
+#define TRACE_FILE_SIZE_MAX     1000000  ///< The trace file is restarted once it has reached this size, in bytes.
+#endif
+
+#define TRACE_DUMP_MAGIC        0x31435254  ///< "TRC1"
+
+
+  /**
+   * The trace points identifiers.
+   * DO NOT change their values; they are used by the host analysis tool.
+   */
+  typedef enum TraceId
+  {
+    TRACE_ID_PROCESS           = 0x00,  ///< ConnecSenS::process().
+    TRACE_ID_PERIODIC          = 0x01,  ///< ConnecSenS::PeriodicHandler().
+    TRACE_ID_INTERRUPTS        = 0x02,  ///< ConnecSenS::InterruptHandler().
+    TRACE_ID_ACTION_ON_SENSORS = 0x03,  ///< ConnecSenS::ActionOnSensors().
+    TRACE_ID_ACTION_ON_NETWORK = 0x04,  ///< ConnecSenS::ActionOnNetwork().
+    TRACE_ID_SLEEP             = 0x05,  ///< Going to sleep.
+
+    TRACE_ID_DATALOG_OPEN      = 0x10,  ///< datalogfile_open().
+    TRACE_ID_DATALOG_SYNC      = 0x11,  ///< datalogfile_sync().
+    TRACE_ID_DATALOG_WRITE     = 0x12,  ///< datalogfile_write_record().
+    TRACE_ID_DATALOG_READ      = 0x13,  ///< datalogfile_record_data().
+
+    TRACE_ID_SDCARD_OPEN       = 0x20,  ///< sdcard_fopen().
+    TRACE_ID_SDCARD_READ       = 0x21,  ///< sdcard_fread().
+    TRACE_ID_SDCARD_WRITE      = 0x22,  ///< sdcard_fwrite().
+    TRACE_ID_SDCARD_SYNC       = 0x23,  ///< sdcard_fsync().
+
+    TRACE_ID_SDI12             = 0x30,  ///< SDI-12 bus state. Argument is a TraceSDI12State.
+
+    TRACE_ID_LORAMAC_SEND      = 0x40,  ///< LoRaWAN frame preparation and scheduling.
+    TRACE_ID_RADIO             = 0x41,  ///< Radio state. Argument is a TraceRadioState.
+
+    TRACE_ID_POWER             = 0x50,  ///< Power supply change. Argument is (BoardPowerFlag << 8) | is on.
+    TRACE_ID_CLOCK             = 0x51   ///< Clock configuration change. Argument is the core clock, in units of 100 kHz.
+  }
+  TraceId;
+
+  /**
+   * The trace records kinds.
+   */
+  typedef enum TraceKind
+  {
+    TRACE_KIND_BEGIN,  ///< Start of a synchronous section. Sections are nested.
+    TRACE_KIND_END,    ///< End of a synchronous section.
+    TRACE_KIND_STATE   ///< A state change of something running on its own, like a bus or the radio.
+  }
+  TraceKind;
+
+  /**
+   * The SDI-12 bus states.
+   */
+  typedef enum TraceSDI12State
+  {
+    TRACE_SDI12_IDLE,
+    TRACE_SDI12_COMMAND,
+    TRACE_SDI12_SERVICE_REQUEST
+  }
+  TraceSDI12State;
+
+  /**
+   * The radio states.
+   */
+  typedef enum TraceRadioState
+  {
+    TRACE_RADIO_IDLE,
+    TRACE_RADIO_TX,
+    TRACE_RADIO_RX
+  }
+  TraceRadioState;
+
+  /**
+   * Defines a trace record.
+   */
+  typedef struct TraceRecord
+  {
+    uint32_t cycles;  ///< The DWT cycle counter.
+    uint32_t ms;      ///< The millisecond tick. Used to unwrap the cycle counter.
+    uint16_t arg;     ///< The argument; depends on the trace point.
+    uint8_t  id;      ///< The trace point identifier. One of TraceId.
+    uint8_t  kind;    ///< The record's kind. One of TraceKind.
+  }
+  TraceRecord;
+
+  /**
+   * Defines the header of each wakeup's block in the trace file.
+   * It is followed by the records.
+   */
+  typedef struct TraceDumpHeader
+  {
+    uint32_t magic;          ///< TRACE_DUMP_MAGIC.
+    uint32_t wakeup_ts;      ///< The wakeup's timestamp, in seconds since 2000-01-01 00:00:00.
+    uint32_t core_clock_hz;  ///< The core clock frequency, in Hz, when the wakeup started.
+    uint16_t nb_records;     ///< The number of records that follow.
+    uint16_t nb_dropped;     ///< The number of records dropped because the ring was full.
+  }
+  TraceDumpHeader;
+
+
+#define trace_category_of(id)  (1u << ((id) >> 4))
+#define trace_is_enabled(id)   ((TRACE_CATEGORIES & trace_category_of(id)) != 0)
+
+#define TRACE_BEGIN(id) \
+  do { if(trace_is_enabled(id)) { trace_record((id), TRACE_KIND_BEGIN, 0);   } } while(0)
+#define TRACE_END(id) \
+  do { if(trace_is_enabled(id)) { trace_record((id), TRACE_KIND_END,   0);   } } while(0)
+#define TRACE_STATE(id, state) \
+  do { if(trace_is_enabled(id)) { trace_record((id), TRACE_KIND_STATE, (state)); } } while(0)
+
+
+  extern void trace_init(  void);
+  extern void trace_wakeup(void);
+  extern void trace_dump(  void);
+  extern void trace_record(TraceId id, TraceKind kind, uint16_t arg);
+
+
+#ifdef __cplusplus
+}
+#endif
+#endif /* ENVIRONMENT_TRACE_H_ */
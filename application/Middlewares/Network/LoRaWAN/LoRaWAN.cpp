@@ -36,6 +36,16 @@
 #define LORA_RADIO_POWER_ON_SETTLE_TIME_MS  200
 #define LORA_RADIO_DIO_IRQ_PRIORITY         0
 #define LORA_RADIO_SPI_TIMEOUT_MS           1000
+#ifndef LORA_RADIO_SPI_DMA_SIZE_MIN
+#define LORA_RADIO_SPI_DMA_SIZE_MIN         16  ///< Smaller transfers are done without DMA; setting up the DMA would cost more.
+#endif
+
+/**
+ * Indicate if a SPI transfer can use the DMA.
+ * Not from an interruption handler, like the DIO ones that read the FIFO: the DMA interruptions
+ * could not preempt it, and the end of the transfer would never be seen.
+ */
+#define lorawan_sx1272_spi_can_use_dma(size)  ((size) >= LORA_RADIO_SPI_DMA_SIZE_MIN && !__get_IPSR())
 
 #define LORAWAN_APP_PORT       2
 #define LORAWAN_DEFAULT_CLASS  CLASS_A
@@ -70,6 +80,35 @@
 
 static SPI_HandleTypeDef _lorawan_spi; ///< The SPI object to use.
 
+#ifdef LORA_RADIO_SPI_USE_DMA
+#define LORA_SPI_DMA_ENABLE_CLOCK()   PASTER3(__HAL_RCC_DMA, LORA_SPI_DMA_NUM, _CLK_ENABLE)()
+#define LORA_SPI_DMA_RX_CHANNEL       PASTER4(DMA, LORA_SPI_DMA_NUM, _Channel, LORA_SPI_DMA_RX_CHANNEL_NUM)
+#define LORA_SPI_DMA_RX_CHANNEL_IRQN  PASTER5(DMA, LORA_SPI_DMA_NUM, _Channel, LORA_SPI_DMA_RX_CHANNEL_NUM, _IRQn)
+#define LORA_SPI_DMA_RX_IRQ_HANDLER   PASTER5(DMA, LORA_SPI_DMA_NUM, _Channel, LORA_SPI_DMA_RX_CHANNEL_NUM, _IRQHandler)
+#define LORA_SPI_DMA_TX_CHANNEL       PASTER4(DMA, LORA_SPI_DMA_NUM, _Channel, LORA_SPI_DMA_TX_CHANNEL_NUM)
+#define LORA_SPI_DMA_TX_CHANNEL_IRQN  PASTER5(DMA, LORA_SPI_DMA_NUM, _Channel, LORA_SPI_DMA_TX_CHANNEL_NUM, _IRQn)
+#define LORA_SPI_DMA_TX_IRQ_HANDLER   PASTER5(DMA, LORA_SPI_DMA_NUM, _Channel, LORA_SPI_DMA_TX_CHANNEL_NUM, _IRQHandler)
+
+/**
+ * Defines the SPI DMA transfer statuses.
+ */
+typedef enum LoRaWANSPIDMAStatus
+{
+  LORAWAN_SPI_DMA_STATUS_DONE,
+  LORAWAN_SPI_DMA_STATUS_IN_PROGRESS,
+  LORAWAN_SPI_DMA_STATUS_ERROR
+}
+LoRaWANSPIDMAStatus;
+
+static DMA_HandleTypeDef            _lorawan_spi_dma_rx;  ///< The SPI's reception DMA channel.
+static DMA_HandleTypeDef            _lorawan_spi_dma_tx;  ///< The SPI's transmission DMA channel.
+static volatile LoRaWANSPIDMAStatus _lorawan_spi_dma_status = LORAWAN_SPI_DMA_STATUS_DONE;
+
+static void lorawan_sx1272_spi_dma_init();
+static void lorawan_sx1272_spi_dma_deinit();
+static bool lorawan_sx1272_spi_dma_wait();
+#endif // LORA_RADIO_SPI_USE_DMA
+
 static void     lorawan_SX1272IoInit();
 static void     lorawan_SX1272IoDeInit();
 static void     lorawan_SX1272IoIrqInit(       DioIrqHandler **irqHandlers);
@@ -722,6 +761,9 @@ static void lorawan_SX1272IoInit()
   _lorawan_spi.Init.NSS               = SPI_NSS_SOFT;
   _lorawan_spi.Init.TIMode            = SPI_TIMODE_DISABLE;
   HAL_SPI_Init(&_lorawan_spi);
+#ifdef LORA_RADIO_SPI_USE_DMA
+  lorawan_sx1272_spi_dma_init();
+#endif
 
   // Then the GPIOs
   init.Mode      = GPIO_MODE_AF_PP;
@@ -772,6 +814,7 @@ static void lorawan_SX1272IoDeInit()
   HAL_GPIO_WritePin(gpio_hal_port_and_pin_from_id(LORA_PWR_GPIO,   &init.Pin),
 		    init.Pin,
 		    (GPIO_PinState)!LORA_PWR_LEVEL_FOR_ON);
+  SX1272InvalidateRegisterShadow();
 
   // Free GPIOs
   gpio_free_gpios_with_ids(LORA_RESET_GPIO, LORA_PWR_GPIO,
@@ -781,6 +824,9 @@ static void lorawan_SX1272IoDeInit()
 			   LORA_DIO2_GPIO,  LORA_DIO3_GPIO);
 
   // Disable SPI module
+#ifdef LORA_RADIO_SPI_USE_DMA
+  lorawan_sx1272_spi_dma_deinit();
+#endif
   HAL_SPI_DeInit(&_lorawan_spi);
   PASTER3(__HAL_RCC_SPI, LORA_SPI_ID, _FORCE_RESET)();
   PASTER3(__HAL_RCC_SPI, LORA_SPI_ID, _RELEASE_RESET)();
@@ -847,6 +893,9 @@ static void lorawan_sx1272_com_stop()
 /**
  * Read bytes from radio over SPI.
  *
+ * The bytes are read in a single burst; using DMA for the large transfers, outside interruption handlers.
+ * The radio ignores the data sent during a burst read, so the buffer's contents are sent.
+ *
  * @pre the communication MUST have been started (NSS).
  *
  * @param[in] pu8_buffer the buffer where to write the data read from the radio. MUST be NOT NULL.
@@ -857,26 +906,39 @@ static void lorawan_sx1272_com_stop()
  */
 static uint8_t *lorawan_sx1272_com_read(uint8_t *pu8_buffer, uint16_t size)
 {
-  uint8_t *pu8;
-  uint8_t  dummy = 0;
+  if(!size) { goto exit; }
 
-  // Read
-  for(pu8 = pu8_buffer; size; size--, pu8++)
+#ifdef LORA_RADIO_SPI_USE_DMA
+  if(lorawan_sx1272_spi_can_use_dma(size))
   {
-    if(HAL_SPI_TransmitReceive(&_lorawan_spi, &dummy, pu8, 1, LORA_RADIO_SPI_TIMEOUT_MS) != HAL_OK)
+    _lorawan_spi_dma_status = LORAWAN_SPI_DMA_STATUS_IN_PROGRESS;
+    if(HAL_SPI_Receive_DMA(&_lorawan_spi, pu8_buffer, size) != HAL_OK)
     {
-      pu8_buffer = NULL;
-      goto exit;
+      _lorawan_spi_dma_status = LORAWAN_SPI_DMA_STATUS_DONE;
+      goto error_exit;
     }
+    if(!lorawan_sx1272_spi_dma_wait()) { goto error_exit; }
+    goto exit;
+  }
+#endif
+
+  if(HAL_SPI_Receive(&_lorawan_spi, pu8_buffer, size, LORA_RADIO_SPI_TIMEOUT_MS) != HAL_OK)
+  {
+    goto error_exit;
   }
 
   exit:
   return pu8_buffer;
+
+  error_exit:
+  return NULL;
 }
 
 /**
  * Write bytes to the radio over SPI.
  *
+ * The bytes are written in a single burst; using DMA for the large transfers, outside interruption handlers.
+ *
  * @pre the communication MUST have been started (NSS).
  *
  * @param[in] pu8_data the data to write. MUST be NOT NULL.
@@ -887,26 +949,169 @@ static uint8_t *lorawan_sx1272_com_read(uint8_t *pu8_buffer, uint16_t size)
  */
 static bool lorawan_sx1272_com_write(const uint8_t *pu8_data, uint16_t size)
 {
-  uint8_t dummy = 0;
-  bool    res   = true;
+  if(!size) { return true; }
 
-  // Write
-  for( ; size; size--, pu8_data++)
+#ifdef LORA_RADIO_SPI_USE_DMA
+  if(lorawan_sx1272_spi_can_use_dma(size))
   {
-    if(HAL_SPI_TransmitReceive(&_lorawan_spi,
-			       (uint8_t *)pu8_data,
-			       &dummy,
-			       1,
-			       LORA_RADIO_SPI_TIMEOUT_MS) != HAL_OK)
+    _lorawan_spi_dma_status = LORAWAN_SPI_DMA_STATUS_IN_PROGRESS;
+    if(HAL_SPI_Transmit_DMA(&_lorawan_spi, (uint8_t *)pu8_data, size) != HAL_OK)
     {
-      res = false;
-      goto exit;
+      _lorawan_spi_dma_status = LORAWAN_SPI_DMA_STATUS_DONE;
+      return false;
     }
+    return lorawan_sx1272_spi_dma_wait();
   }
+#endif
 
-  exit:
-  return res;
+  return HAL_SPI_Transmit(&_lorawan_spi, (uint8_t *)pu8_data, size, LORA_RADIO_SPI_TIMEOUT_MS) == HAL_OK;
+}
+
+
+#ifdef LORA_RADIO_SPI_USE_DMA
+/**
+ * Configure a DMA channel for the radio's SPI.
+ *
+ * @param[out] pv_dma    the DMA object. MUST be NOT NULL.
+ * @param[in]  pv_chan   the DMA channel.
+ * @param[in]  direction the transfer direction.
+ * @param[in]  irqn      the channel's interruption.
+ */
+static void lorawan_sx1272_spi_dma_config(DMA_HandleTypeDef   *pv_dma,
+					  DMA_Channel_TypeDef *pv_chan,
+					  uint32_t             direction,
+					  IRQn_Type            irqn)
+{
+  pv_dma->Instance                 = pv_chan;
+  pv_dma->Init.Request             = LORA_SPI_DMA_REQUEST;
+  pv_dma->Init.Direction           = direction;
+  pv_dma->Init.PeriphInc           = DMA_PINC_DISABLE;
+  pv_dma->Init.MemInc              = DMA_MINC_ENABLE;
+  pv_dma->Init.PeriphDataAlignment = DMA_PDATAALIGN_BYTE;
+  pv_dma->Init.MemDataAlignment    = DMA_MDATAALIGN_BYTE;
+  pv_dma->Init.Mode                = DMA_NORMAL;
+  pv_dma->Init.Priority            = DMA_PRIORITY_HIGH;
+  HAL_DMA_DeInit(pv_dma);
+  HAL_DMA_Init(  pv_dma);
+
+  HAL_NVIC_SetPriority(irqn, LORA_RADIO_DIO_IRQ_PRIORITY, 0);
+  HAL_NVIC_EnableIRQ(  irqn);
+}
+
+/**
+ * Set up the DMA channels used by the radio's SPI.
+ */
+static void lorawan_sx1272_spi_dma_init()
+{
+  LORA_SPI_DMA_ENABLE_CLOCK();
+
+  lorawan_sx1272_spi_dma_config(&_lorawan_spi_dma_rx, LORA_SPI_DMA_RX_CHANNEL,
+				DMA_PERIPH_TO_MEMORY, LORA_SPI_DMA_RX_CHANNEL_IRQN);
+  lorawan_sx1272_spi_dma_config(&_lorawan_spi_dma_tx, LORA_SPI_DMA_TX_CHANNEL,
+				DMA_MEMORY_TO_PERIPH, LORA_SPI_DMA_TX_CHANNEL_IRQN);
+  __HAL_LINKDMA(&_lorawan_spi, hdmarx, _lorawan_spi_dma_rx);
+  __HAL_LINKDMA(&_lorawan_spi, hdmatx, _lorawan_spi_dma_tx);
+
+  _lorawan_spi_dma_status = LORAWAN_SPI_DMA_STATUS_DONE;
+}
+
+/**
+ * Release the DMA channels used by the radio's SPI.
+ */
+static void lorawan_sx1272_spi_dma_deinit()
+{
+  HAL_NVIC_DisableIRQ(LORA_SPI_DMA_RX_CHANNEL_IRQN);
+  HAL_NVIC_DisableIRQ(LORA_SPI_DMA_TX_CHANNEL_IRQN);
+  HAL_DMA_DeInit(&_lorawan_spi_dma_rx);
+  HAL_DMA_DeInit(&_lorawan_spi_dma_tx);
+}
+
+/**
+ * Wait for the end of the current SPI DMA transfer.
+ *
+ * The core sleeps until an interruption occurs; interruptions are masked between
+ * the status check and the WFI instruction so that the end of transfer cannot be missed.
+ *
+ * @return true  if the transfer has completed successfully.
+ * @return false otherwise.
+ */
+static bool lorawan_sx1272_spi_dma_wait()
+{
+  uint32_t ts_ref = board_ms_now();
+
+  while(1)
+  {
+    __disable_irq();
+    if(_lorawan_spi_dma_status != LORAWAN_SPI_DMA_STATUS_IN_PROGRESS) { __enable_irq(); break; }
+    __WFI();
+    __enable_irq();
+
+    if(board_is_timeout(ts_ref, LORA_RADIO_SPI_TIMEOUT_MS))
+    {
+      HAL_SPI_Abort(&_lorawan_spi);
+      _lorawan_spi_dma_status = LORAWAN_SPI_DMA_STATUS_ERROR;
+      break;
+    }
+  }
+
+  return _lorawan_spi_dma_status == LORAWAN_SPI_DMA_STATUS_DONE;
+}
+
+extern "C"
+{
+  /**
+   * Irq handler for the radio's SPI DMA reception channel.
+   */
+  void LORA_SPI_DMA_RX_IRQ_HANDLER(void)
+  {
+    HAL_DMA_IRQHandler(&_lorawan_spi_dma_rx);
+  }
+
+  /**
+   * Irq handler for the radio's SPI DMA transmission channel.
+   */
+  void LORA_SPI_DMA_TX_IRQ_HANDLER(void)
+  {
+    HAL_DMA_IRQHandler(&_lorawan_spi_dma_tx);
+  }
+
+  /**
+   * Called when a SPI DMA transmission has completed.
+   *
+   * Overwrite a weak function definition from HAL.
+   *
+   * @param[in] hspi the SPI object.
+   */
+  void HAL_SPI_TxCpltCallback(SPI_HandleTypeDef *hspi)
+  {
+    if(hspi == &_lorawan_spi) { _lorawan_spi_dma_status = LORAWAN_SPI_DMA_STATUS_DONE; }
+  }
+
+  /**
+   * Called when a SPI DMA reception has completed.
+   *
+   * Overwrite a weak function definition from HAL.
+   *
+   * @param[in] hspi the SPI object.
+   */
+  void HAL_SPI_TxRxCpltCallback(SPI_HandleTypeDef *hspi)
+  {
+    if(hspi == &_lorawan_spi) { _lorawan_spi_dma_status = LORAWAN_SPI_DMA_STATUS_DONE; }
+  }
+
+  /**
+   * Called when a SPI DMA transfer has failed.
+   *
+   * Overwrite a weak function definition from HAL.
+   *
+   * @param[in] hspi the SPI object.
+   */
+  void HAL_SPI_ErrorCallback(SPI_HandleTypeDef *hspi)
+  {
+    if(hspi == &_lorawan_spi) { _lorawan_spi_dma_status = LORAWAN_SPI_DMA_STATUS_ERROR; }
+  }
 }
+#endif // LORA_RADIO_SPI_USE_DMA
 
 
 static uint32_t lorawan_SX1272GetWakeTime()
@@ -64,6 +64,16 @@
 
 #include "aes.h"
 
+/* the byte oriented rounds are not used by the 32-bit word encryption */
+#if ( defined( AES_ENC_PREKEYED ) && !defined( AES_ENC_T_TABLES ) ) \
+    || defined( AES_ENC_128_OTFK ) || defined( AES_ENC_256_OTFK )
+#  define AES_ENC_BYTE_ROUNDS
+#endif
+#if defined( AES_ENC_BYTE_ROUNDS ) || defined( AES_DEC_PREKEYED ) \
+    || defined( AES_DEC_128_OTFK ) || defined( AES_DEC_256_OTFK )
+#  define AES_BYTE_ROUNDS
+#endif
+
 //#if defined( HAVE_UINT_32T )
 //  typedef unsigned long uint32_t;
 //#endif
@@ -197,8 +207,18 @@ static const uint8_t sbox[256]  =  sb_data(f1);
 static const uint8_t isbox[256] = isb_data(f1);
 #endif
 
+#if defined( AES_ENC_BYTE_ROUNDS )
 static const uint8_t gfm2_sbox[256] = sb_data(f2);
 static const uint8_t gfm3_sbox[256] = sb_data(f3);
+#endif
+
+#if defined( AES_ENC_T_TABLES )
+/* combined S box and mix columns for a byte in row 0 of a column, as a */
+/* little endian column word; rows 1 to 3 are obtained by rotation      */
+#define te_w(x)   ((uint32_t)f2(x) | ((uint32_t)(x) << 8) \
+                  | ((uint32_t)(x) << 16) | ((uint32_t)f3(x) << 24))
+static const uint32_t te_tab[256] = sb_data(te_w);
+#endif
 
 #if defined( AES_DEC_PREKEYED )
 static const uint8_t gfmul_9[256] = mm_data(f9);
@@ -211,8 +231,10 @@ static const uint8_t gfmul_e[256] = mm_data(fe);
 #if defined( AES_DEC_PREKEYED )
 #define is_box(x)    isbox[(x)]
 #endif
+#if defined( AES_ENC_BYTE_ROUNDS )
 #define gfm2_sb(x)   gfm2_sbox[(x)]
 #define gfm3_sb(x)   gfm3_sbox[(x)]
+#endif
 #if defined( AES_DEC_PREKEYED )
 #define gfm_9(x)     gfmul_9[(x)]
 #define gfm_b(x)     gfmul_b[(x)]
@@ -373,6 +395,8 @@ static void xor_block( void *d, const void *s )
 #endif
 }
 
+#if defined( AES_BYTE_ROUNDS )
+
 static void copy_and_key( void *d, const void *s, const void *k )
 {
 #if defined( HAVE_UINT_32T )
@@ -408,6 +432,10 @@ static void add_round_key( uint8_t d[N_BLOCK], const uint8_t k[N_BLOCK] )
     xor_block(d, k);
 }
 
+#endif
+
+#if defined( AES_ENC_BYTE_ROUNDS )
+
 static void shift_sub_rows( uint8_t st[N_BLOCK] )
 {   uint8_t tt;
 
@@ -424,6 +452,8 @@ static void shift_sub_rows( uint8_t st[N_BLOCK] )
     st[ 7] = s_box(st[ 3]); st[ 3] = s_box( tt );
 }
 
+#endif
+
 #if defined( AES_DEC_PREKEYED )
 
 static void inv_shift_sub_rows( uint8_t st[N_BLOCK] )
@@ -444,6 +474,8 @@ static void inv_shift_sub_rows( uint8_t st[N_BLOCK] )
 
 #endif
 
+#if defined( AES_ENC_BYTE_ROUNDS )
+
 #if defined( VERSION_1 )
   static void mix_sub_columns( uint8_t dt[N_BLOCK] )
   { uint8_t st[N_BLOCK];
@@ -473,6 +505,8 @@ static void inv_shift_sub_rows( uint8_t st[N_BLOCK] )
     dt[15] = gfm3_sb(st[12]) ^ s_box(st[1]) ^ s_box(st[6]) ^ gfm2_sb(st[11]);
   }
 
+#endif
+
 #if defined( AES_DEC_PREKEYED )
 
 #if defined( VERSION_1 )
@@ -561,7 +595,68 @@ return_type aes_set_key( const uint8_t key[], length_type keylen, aes_context ct
 
 #endif
 
-#if defined( AES_ENC_PREKEYED )
+#if defined( AES_ENC_PREKEYED ) && defined( AES_ENC_T_TABLES )
+
+#if !defined( USE_TABLES )
+#  error "AES_ENC_T_TABLES requires USE_TABLES"
+#endif
+
+#define rotl32(x, n)    (((x) << (n)) | ((x) >> (32 - (n))))
+#define word_in(p)      ((uint32_t)(p)[0] | ((uint32_t)(p)[1] << 8) \
+                        | ((uint32_t)(p)[2] << 16) | ((uint32_t)(p)[3] << 24))
+#define word_out(p, w)  do { (p)[0] = (uint8_t)(w);         (p)[1] = (uint8_t)((w) >> 8);  \
+                             (p)[2] = (uint8_t)((w) >> 16); (p)[3] = (uint8_t)((w) >> 24); } while(0)
+
+/* one round for one column: sub bytes, shift rows, mix columns and add round key */
+#define t_round(x0, x1, x2, x3, k) \
+    (te_tab[(x0) & 0xff] ^ rotl32(te_tab[((x1) >> 8) & 0xff], 8) \
+    ^ rotl32(te_tab[((x2) >> 16) & 0xff], 16) ^ rotl32(te_tab[(x3) >> 24], 24) ^ (k))
+
+/* the last round for one column: sub bytes, shift rows and add round key */
+#define t_last_round(x0, x1, x2, x3, k) \
+    (((uint32_t)s_box((x0) & 0xff) | ((uint32_t)s_box(((x1) >> 8) & 0xff) << 8) \
+    | ((uint32_t)s_box(((x2) >> 16) & 0xff) << 16) | ((uint32_t)s_box((x3) >> 24) << 24)) ^ (k))
+
+/*  Encrypt a single block of 16 bytes, using 32-bit column words */
+
+return_type aes_encrypt( const uint8_t in[N_BLOCK], uint8_t  out[N_BLOCK], const aes_context ctx[1] )
+{
+    const uint32_t *rk = ctx->ksch32;
+    uint32_t x0, x1, x2, x3, y0, y1, y2, y3;
+    uint8_t r;
+
+    if( !ctx->rnd )
+        return ( uint8_t )-1;
+
+    x0 = word_in(in     ) ^ rk[0];
+    x1 = word_in(in +  4) ^ rk[1];
+    x2 = word_in(in +  8) ^ rk[2];
+    x3 = word_in(in + 12) ^ rk[3];
+
+    for( r = 1 ; r < ctx->rnd ; ++r )
+    {
+        rk += N_COL;
+        y0 = t_round(x0, x1, x2, x3, rk[0]);
+        y1 = t_round(x1, x2, x3, x0, rk[1]);
+        y2 = t_round(x2, x3, x0, x1, rk[2]);
+        y3 = t_round(x3, x0, x1, x2, rk[3]);
+        x0 = y0; x1 = y1; x2 = y2; x3 = y3;
+    }
+
+    rk += N_COL;
+    y0 = t_last_round(x0, x1, x2, x3, rk[0]);
+    y1 = t_last_round(x1, x2, x3, x0, rk[1]);
+    y2 = t_last_round(x2, x3, x0, x1, rk[2]);
+    y3 = t_last_round(x3, x0, x1, x2, rk[3]);
+
+    word_out(out     , y0);
+    word_out(out +  4, y1);
+    word_out(out +  8, y2);
+    word_out(out + 12, y3);
+    return 0;
+}
+
+#elif defined( AES_ENC_PREKEYED )
 
 /*  Encrypt a single block of 16 bytes */
 
@@ -592,6 +687,10 @@ return_type aes_encrypt( const uint8_t in[N_BLOCK], uint8_t  out[N_BLOCK], const
     return 0;
 }
 
+#endif
+
+#if defined( AES_ENC_PREKEYED )
+
 /* CBC encrypt a number of blocks (input and return an IV) */
 
 return_type aes_cbc_encrypt( const uint8_t *in, uint8_t *out,
@@ -38,6 +38,9 @@
 #if 0
 #  define AES_DEC_PREKEYED  /* AES decryption with a precomputed key schedule  */
 #endif
+#if 1
+#  define AES_ENC_T_TABLES  /* AES encryption using 32-bit words and a 1 KB table */
+#endif
 #if 0
 #  define AES_ENC_128_OTFK  /* AES encryption with 'on the fly' 128 bit keying */
 #endif
@@ -65,7 +68,10 @@ typedef uint8_t return_type;
 typedef uint8_t length_type;
 
 typedef struct
-{   uint8_t ksch[(N_MAX_ROUNDS + 1) * N_BLOCK];
+{   union
+    {   uint8_t  ksch[(N_MAX_ROUNDS + 1) * N_BLOCK];
+        uint32_t ksch32[(N_MAX_ROUNDS + 1) * N_COL];  /* the key schedule as little endian column words */
+    };
     uint8_t rnd;
 } aes_context;
 
@@ -61,13 +61,41 @@ void AES_CMAC_Init(AES_CMAC_CTX *ctx)
 {
             memset1(ctx->X, 0, sizeof ctx->X);
             ctx->M_n = 0;
-        memset1(ctx->rijndael.ksch, '\0', 240);
+            ctx->key = &ctx->key_storage;
 }
-    
+
+/* derive K2 from K1, or K1 from L = AES-K(0), as specified in RFC 4493 */
+static void AES_CMAC_Subkey(uint8_t K[16], const uint8_t L[16])
+{
+            LSHIFT(L, K);
+            if (L[0] & 0x80)
+                    K[15] ^= 0x87;
+}
+
+/* expand a key once: its AES key schedule and its two subkeys */
+void AES_CMAC_ExpandKey(AES_CMAC_KEY *expanded, const uint8_t key[AES_CMAC_KEY_LENGTH])
+{
+            uint8_t L[16];
+
+            aes_set_key( key, AES_CMAC_KEY_LENGTH, &expanded->rijndael);
+
+            memset1(L, '\0', 16);
+            aes_encrypt( L, L, &expanded->rijndael);
+            AES_CMAC_Subkey(expanded->K1, L);
+            AES_CMAC_Subkey(expanded->K2, expanded->K1);
+            memset1(L, 0, sizeof L);
+}
+
 void AES_CMAC_SetKey(AES_CMAC_CTX *ctx, const uint8_t key[AES_CMAC_KEY_LENGTH])
 {
-           //rijndael_set_key_enc_only(&ctx->rijndael, key, 128);
-       aes_set_key( key, AES_CMAC_KEY_LENGTH, &ctx->rijndael);
+            AES_CMAC_ExpandKey(&ctx->key_storage, key);
+            ctx->key = &ctx->key_storage;
+}
+
+/* use a key already expanded by AES_CMAC_ExpandKey(); it must outlive the context's use */
+void AES_CMAC_UseKey(AES_CMAC_CTX *ctx, const AES_CMAC_KEY *expanded)
+{
+            ctx->key = expanded;
 }
     
 void AES_CMAC_Update(AES_CMAC_CTX *ctx, const uint8_t *data, uint32_t len)
@@ -82,18 +110,18 @@ void AES_CMAC_Update(AES_CMAC_CTX *ctx, const uint8_t *data, uint32_t len)
                     if (ctx->M_n < 16 || len == mlen)
                             return;
                    XOR(ctx->M_last, ctx->X);
-                    //rijndael_encrypt(&ctx->rijndael, ctx->X, ctx->X);
-            aes_encrypt( ctx->X, ctx->X, &ctx->rijndael);
+                    //rijndael_encrypt(&ctx->key->rijndael, ctx->X, ctx->X);
+            aes_encrypt( ctx->X, ctx->X, &ctx->key->rijndael);
                     data += mlen;
                     len -= mlen;
             }
             while (len > 16) {      /* not last block */
 
                     XOR(data, ctx->X);
-                    //rijndael_encrypt(&ctx->rijndael, ctx->X, ctx->X);
+                    //rijndael_encrypt(&ctx->key->rijndael, ctx->X, ctx->X);
 
                     memcpy1(in, &ctx->X[0], 16); //Bestela ez du ondo iten
-            aes_encrypt( in, in, &ctx->rijndael);
+            aes_encrypt( in, in, &ctx->key->rijndael);
                     memcpy1(&ctx->X[0], in, 16);
 
                     data += 16;
@@ -106,51 +134,23 @@ void AES_CMAC_Update(AES_CMAC_CTX *ctx, const uint8_t *data, uint32_t len)
    
 void AES_CMAC_Final(uint8_t digest[AES_CMAC_DIGEST_LENGTH], AES_CMAC_CTX *ctx)
 {
-            uint8_t K[16];
-        uint8_t in[16];
-            /* generate subkey K1 */
-            memset1(K, '\0', 16);
-
-            //rijndael_encrypt(&ctx->rijndael, K, K);
-
-            aes_encrypt( K, K, &ctx->rijndael);
-
-            if (K[0] & 0x80) {
-                    LSHIFT(K, K);
-                   K[15] ^= 0x87;
-            } else
-                    LSHIFT(K, K);
-
+            uint8_t in[16];
 
             if (ctx->M_n == 16) {
                     /* last block was a complete block */
-                    XOR(K, ctx->M_last);
-
-           } else {
-                   /* generate subkey K2 */
-                  if (K[0] & 0x80) {
-                          LSHIFT(K, K);
-                          K[15] ^= 0x87;
-                  } else
-                           LSHIFT(K, K);
-
-                   /* padding(M_last) */
-                   ctx->M_last[ctx->M_n] = 0x80;
-                   while (++ctx->M_n < 16)
-                         ctx->M_last[ctx->M_n] = 0;
-   
-                  XOR(K, ctx->M_last);
-
-
-           }
-           XOR(ctx->M_last, ctx->X);
-
-           //rijndael_encrypt(&ctx->rijndael, ctx->X, digest);
-
-       memcpy1(in, &ctx->X[0], 16); //Bestela ez du ondo iten
-       aes_encrypt(in, digest, &ctx->rijndael);
-           memset1(K, 0, sizeof K);
+                    XOR(ctx->key->K1, ctx->M_last);
+            } else {
+                    /* padding(M_last) */
+                    ctx->M_last[ctx->M_n] = 0x80;
+                    while (++ctx->M_n < 16)
+                          ctx->M_last[ctx->M_n] = 0;
+
+                    XOR(ctx->key->K2, ctx->M_last);
+            }
+            XOR(ctx->M_last, ctx->X);
 
+            memcpy1(in, &ctx->X[0], 16); //Bestela ez du ondo iten
+            aes_encrypt(in, digest, &ctx->key->rijndael);
 }
 
 #ifdef __cplusplus
@@ -45,8 +45,16 @@ extern "C" {
 #define AES_CMAC_KEY_LENGTH     16
 #define AES_CMAC_DIGEST_LENGTH  16
  
-typedef struct _AES_CMAC_CTX {
+/* expanded key: the AES key schedule and the two CMAC subkeys */
+typedef struct _AES_CMAC_KEY {
             aes_context    rijndael;
+            uint8_t        K1[16];
+            uint8_t        K2[16];
+    } AES_CMAC_KEY;
+
+typedef struct _AES_CMAC_CTX {
+            const AES_CMAC_KEY *key;      /* points to key_storage, or to a key set with AES_CMAC_UseKey() */
+            AES_CMAC_KEY   key_storage;
             uint8_t        X[16];
             uint8_t        M_last[16];
             uint32_t       M_n;
@@ -56,7 +64,9 @@ typedef struct _AES_CMAC_CTX {
     
 //__BEGIN_DECLS
 void     AES_CMAC_Init(AES_CMAC_CTX * ctx);
+void     AES_CMAC_ExpandKey(AES_CMAC_KEY * expanded, const uint8_t key[AES_CMAC_KEY_LENGTH]);
 void     AES_CMAC_SetKey(AES_CMAC_CTX * ctx, const uint8_t key[AES_CMAC_KEY_LENGTH]);
+void     AES_CMAC_UseKey(AES_CMAC_CTX * ctx, const AES_CMAC_KEY * expanded);
 void     AES_CMAC_Update(AES_CMAC_CTX * ctx, const uint8_t * data, uint32_t len);
           //          __attribute__((__bounded__(__string__,2,3)));
 void     AES_CMAC_Final(uint8_t digest[AES_CMAC_DIGEST_LENGTH], AES_CMAC_CTX  * ctx);
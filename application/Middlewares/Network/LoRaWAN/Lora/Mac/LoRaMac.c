@@ -25,6 +25,8 @@ Maintainer: Miguel Luis ( Semtech ), Gregory Cristian ( Semtech ) and Daniel Jae
 #include "loraradio.h"
 #include "region/Region.h"
 #include "LoRaMacCrypto.h"
+#include "trace.h"
+#include "perfcounters.h"
 
 #include "LoRaMacTest.h"
 
@@ -616,6 +618,8 @@ static void OnRadioTxDone( void )
     SetBandTxDoneParams_t txDone;
     TimerTime_t curTime = TimerGetCurrentTime( );
 
+    TRACE_STATE( TRACE_ID_RADIO, TRACE_RADIO_IDLE );
+    perfcounters_add_tx_time( McpsConfirm.Datarate, TxTimeOnAir );
     if( LoRaMacDeviceClass != CLASS_C )
     {
         lora_radio.Sleep( );
@@ -710,6 +714,8 @@ static void OnRadioRxDone( uint8_t *payload, uint16_t size, int16_t rssi, int8_t
 
     uint8_t pktHeaderLen = 0;
     uint32_t address = 0;
+
+    TRACE_STATE( TRACE_ID_RADIO, TRACE_RADIO_IDLE );
     uint8_t appPayloadStartIndex = 0;
     uint8_t port = 0xFF;
     uint8_t frameLen = 0;
@@ -1120,6 +1126,7 @@ static void OnRadioRxDone( uint8_t *payload, uint16_t size, int16_t rssi, int8_t
 
 static void OnRadioTxTimeout( void )
 {
+    TRACE_STATE( TRACE_ID_RADIO, TRACE_RADIO_IDLE );
     if( LoRaMacDeviceClass != CLASS_C )
     {
         lora_radio.Sleep( );
@@ -1136,6 +1143,7 @@ static void OnRadioTxTimeout( void )
 
 static void OnRadioRxError( void )
 {
+    TRACE_STATE( TRACE_ID_RADIO, TRACE_RADIO_IDLE );
     if( LoRaMacDeviceClass != CLASS_C )
     {
         lora_radio.Sleep( );
@@ -1171,6 +1179,7 @@ static void OnRadioRxError( void )
 
 static void OnRadioRxTimeout( void )
 {
+    TRACE_STATE( TRACE_ID_RADIO, TRACE_RADIO_IDLE );
     if( LoRaMacDeviceClass != CLASS_C )
     {
         lora_radio.Sleep( );
@@ -1319,6 +1328,7 @@ static void OnMacStateCheckTimerEvent( void )
             if( ( AckTimeoutRetriesCounter < AckTimeoutRetries ) && ( AckTimeoutRetriesCounter <= MAX_ACK_RETRIES ) )
             {
                 AckTimeoutRetriesCounter++;
+                perfcounters_add( PERF_COUNTER_TX_RETRIES, 1 );
 
                 if( ( AckTimeoutRetriesCounter % 2 ) == 1 )
                 {
@@ -1506,6 +1516,7 @@ static void OnAckTimeoutTimerEvent( void )
 
 static void RxWindowSetup( bool rxContinuous, uint32_t maxRxWindow )
 {
+    TRACE_STATE( TRACE_ID_RADIO, TRACE_RADIO_RX );
     if( rxContinuous == false )
     {
         lora_radio.Rx( maxRxWindow );
@@ -1881,6 +1892,8 @@ LoRaMacStatus_t Send( LoRaMacHeader_t *macHdr, uint8_t fPort, void *fBuffer, uin
     LoRaMacFrameCtrl_t fCtrl;
     LoRaMacStatus_t status = LORAMAC_STATUS_PARAMETER_INVALID;
 
+    TRACE_BEGIN( TRACE_ID_LORAMAC_SEND );
+
     fCtrl.Value = 0;
     fCtrl.Bits.FOptsLen      = 0;
     fCtrl.Bits.FPending      = 0;
@@ -1894,6 +1907,7 @@ LoRaMacStatus_t Send( LoRaMacHeader_t *macHdr, uint8_t fPort, void *fBuffer, uin
     // Validate status
     if( status != LORAMAC_STATUS_OK )
     {
+        TRACE_END( TRACE_ID_LORAMAC_SEND );
         return status;
     }
 
@@ -1904,6 +1918,7 @@ LoRaMacStatus_t Send( LoRaMacHeader_t *macHdr, uint8_t fPort, void *fBuffer, uin
 
     status = ScheduleTx( );
 
+    TRACE_END( TRACE_ID_LORAMAC_SEND );
     return status;
 }
 
@@ -2253,6 +2268,7 @@ LoRaMacStatus_t SendFrameOnChannel( uint8_t channel )
     }
 
     // Send now
+    TRACE_STATE( TRACE_ID_RADIO, TRACE_RADIO_TX );
     lora_radio.Send( LoRaMacBuffer, LoRaMacBufferPktLen );
 
     LoRaMacState |= LORAMAC_TX_RUNNING;
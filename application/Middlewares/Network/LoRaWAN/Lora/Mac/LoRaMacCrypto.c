@@ -57,15 +57,68 @@ static uint8_t sBlock[] = { 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00,
                           };
 
 /*!
- * AES computation context variable
+ * Number of expanded keys kept in the key cache.
+ * The network session key, the application session key and the application key
+ * are used in turn, so they all fit.
  */
-static aes_context AesContext;
+#ifndef LORAMAC_CRYPTO_KEY_CACHE_SIZE
+#define LORAMAC_CRYPTO_KEY_CACHE_SIZE               3
+#endif
+
+/*!
+ * Key cache entry: a key, its AES key schedule and its CMAC subkeys
+ */
+typedef struct sLoRaMacCryptoKey
+{
+    bool IsValid;
+    uint8_t Key[16];
+    AES_CMAC_KEY Expanded;
+}LoRaMacCryptoKey_t;
+
+/*!
+ * Key cache, so that a key is only expanded once, and not before each frame
+ */
+static LoRaMacCryptoKey_t KeyCache[LORAMAC_CRYPTO_KEY_CACHE_SIZE];
+
+/*!
+ * Index of the key cache entry to be replaced next
+ */
+static uint8_t KeyCacheNext = 0;
 
 /*!
  * CMAC computation context variable
  */
 static AES_CMAC_CTX AesCmacCtx[1];
 
+/*!
+ * \brief Gets a key's expanded form from the key cache, expanding it if it is not there
+ *
+ * \param [IN]  key             AES key
+ * \retval                      The expanded key
+ */
+static const AES_CMAC_KEY *LoRaMacCryptoGetKey( const uint8_t *key )
+{
+    LoRaMacCryptoKey_t *entry;
+    uint8_t i;
+
+    for( i = 0; i < LORAMAC_CRYPTO_KEY_CACHE_SIZE; i++ )
+    {
+        if( KeyCache[i].IsValid && memcmp( KeyCache[i].Key, key, 16 ) == 0 )
+        {
+            return &KeyCache[i].Expanded;
+        }
+    }
+
+    entry = &KeyCache[KeyCacheNext];
+    KeyCacheNext = ( KeyCacheNext + 1 ) % LORAMAC_CRYPTO_KEY_CACHE_SIZE;
+
+    memcpy1( entry->Key, key, 16 );
+    AES_CMAC_ExpandKey( &entry->Expanded, key );
+    entry->IsValid = true;
+
+    return &entry->Expanded;
+}
+
 /*!
  * \brief Computes the LoRaMAC frame MIC field  
  *
@@ -95,7 +148,7 @@ void LoRaMacComputeMic( const uint8_t *buffer, uint16_t size, const uint8_t *key
 
     AES_CMAC_Init( AesCmacCtx );
 
-    AES_CMAC_SetKey( AesCmacCtx, key );
+    AES_CMAC_UseKey( AesCmacCtx, LoRaMacCryptoGetKey( key ) );
 
     AES_CMAC_Update( AesCmacCtx, MicBlockB0, LORAMAC_MIC_BLOCK_B0_SIZE );
     
@@ -112,8 +165,7 @@ void LoRaMacPayloadEncrypt( const uint8_t *buffer, uint16_t size, const uint8_t
     uint8_t bufferIndex = 0;
     uint16_t ctr = 1;
 
-    memset1( AesContext.ksch, '\0', 240 );
-    aes_set_key( key, 16, &AesContext );
+    const aes_context *aesContext = &LoRaMacCryptoGetKey( key )->rijndael;
 
     aBlock[5] = dir;
 
@@ -131,7 +183,7 @@ void LoRaMacPayloadEncrypt( const uint8_t *buffer, uint16_t size, const uint8_t
     {
         aBlock[15] = ( ( ctr ) & 0xFF );
         ctr++;
-        aes_encrypt( aBlock, sBlock, &AesContext );
+        aes_encrypt( aBlock, sBlock, aesContext );
         for( i = 0; i < 16; i++ )
         {
             encBuffer[bufferIndex + i] = buffer[bufferIndex + i] ^ sBlock[i];
@@ -143,7 +195,7 @@ void LoRaMacPayloadEncrypt( const uint8_t *buffer, uint16_t size, const uint8_t
     if( size > 0 )
     {
         aBlock[15] = ( ( ctr ) & 0xFF );
-        aes_encrypt( aBlock, sBlock, &AesContext );
+        aes_encrypt( aBlock, sBlock, aesContext );
         for( i = 0; i < size; i++ )
         {
             encBuffer[bufferIndex + i] = buffer[bufferIndex + i] ^ sBlock[i];
@@ -160,7 +212,7 @@ void LoRaMacJoinComputeMic( const uint8_t *buffer, uint16_t size, const uint8_t
 {
     AES_CMAC_Init( AesCmacCtx );
 
-    AES_CMAC_SetKey( AesCmacCtx, key );
+    AES_CMAC_UseKey( AesCmacCtx, LoRaMacCryptoGetKey( key ) );
 
     AES_CMAC_Update( AesCmacCtx, buffer, size & 0xFF );
 
@@ -171,13 +223,12 @@ void LoRaMacJoinComputeMic( const uint8_t *buffer, uint16_t size, const uint8_t
 
 void LoRaMacJoinDecrypt( const uint8_t *buffer, uint16_t size, const uint8_t *key, uint8_t *decBuffer )
 {
-    memset1( AesContext.ksch, '\0', 240 );
-    aes_set_key( key, 16, &AesContext );
-    aes_encrypt( buffer, decBuffer, &AesContext );
+    const aes_context *aesContext = &LoRaMacCryptoGetKey( key )->rijndael;
+    aes_encrypt( buffer, decBuffer, aesContext );
     // Check if optional CFList is included
     if( size >= 16 )
     {
-        aes_encrypt( buffer + 16, decBuffer + 16, &AesContext );
+        aes_encrypt( buffer + 16, decBuffer + 16, aesContext );
     }
 }
 
@@ -186,20 +237,19 @@ void LoRaMacJoinComputeSKeys( const uint8_t *key, const uint8_t *appNonce, uint1
     uint8_t nonce[16];
     uint8_t *pDevNonce = ( uint8_t * )&devNonce;
     
-    memset1( AesContext.ksch, '\0', 240 );
-    aes_set_key( key, 16, &AesContext );
+    const aes_context *aesContext = &LoRaMacCryptoGetKey( key )->rijndael;
 
     memset1( nonce, 0, sizeof( nonce ) );
     nonce[0] = 0x01;
     memcpy1( nonce + 1, appNonce, 6 );
     memcpy1( nonce + 7, pDevNonce, 2 );
-    aes_encrypt( nonce, nwkSKey, &AesContext );
+    aes_encrypt( nonce, nwkSKey, aesContext );
 
     memset1( nonce, 0, sizeof( nonce ) );
     nonce[0] = 0x02;
     memcpy1( nonce + 1, appNonce, 6 );
     memcpy1( nonce + 7, pDevNonce, 2 );
-    aes_encrypt( nonce, appSKey, &AesContext );
+    aes_encrypt( nonce, appSKey, aesContext );
 }
 
 
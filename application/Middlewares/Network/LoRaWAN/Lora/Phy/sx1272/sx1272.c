@@ -224,6 +224,22 @@ static uint8_t RxTxBuffer[RX_BUFFER_SIZE];
 
 static LoRaBoardCallback_t *LoRaBoardCallbacks;
 
+/*!
+ * Shadow copy of the radio's configuration registers.
+ *
+ * The radio keeps its registers in sleep mode, so a register written or read is kept here
+ * until the radio is reset; writing a register with the value it already holds is skipped
+ * and reading it is served from the copy.
+ * Only the registers that the radio never changes on its own are shadowed, and only in LoRa
+ * mode: the FSK and LoRa modems map different registers at the same addresses.
+ * It is compiled out when SX1272_REG_SHADOW is 0.
+ */
+#define REG_SHADOW_SIZE  0x60
+
+static uint8_t  RegShadow[REG_SHADOW_SIZE];
+static uint32_t RegShadowValid[REG_SHADOW_SIZE / 32];  ///< One bit per register; is its copy valid?
+static bool     RegShadowLoRaMode = false;              ///< Is the radio in LoRa mode, from the last REG_OPMODE write?
+
 /*
  * Public global variables
  */
@@ -1073,6 +1089,10 @@ void SX1272Reset( void )
   DelayMs(1);
   _pv_sx1272_com->apply_reset_signal(false);
   DelayMs(6);
+
+  // The registers are back to their default values, in FSK mode.
+  SX1272InvalidateRegisterShadow( );
+  RegShadowLoRaMode = false;
 }
 
 void SX1272SetOpMode( uint8_t opMode )
@@ -1126,34 +1146,134 @@ void SX1272SetModem( LoRaRadioModem modem )
     }
 }
 
+void SX1272InvalidateRegisterShadow( void )
+{
+    memset( RegShadowValid, 0, sizeof( RegShadowValid ) );
+}
+
+/*!
+ * \brief Indicate if a register can be shadowed
+ *
+ * \param [IN] addr Register address
+ * \retval true if the radio never changes the register on its own, in LoRa mode
+ */
+static bool SX1272RegIsShadowable( uint8_t addr )
+{
+    if( !SX1272_REG_SHADOW )
+    {
+        return false;
+    }
+    switch( addr )
+    {
+    case REG_LR_FRFMSB:
+    case REG_LR_FRFMID:
+    case REG_LR_FRFLSB:
+    case REG_LR_PACONFIG:
+    case REG_LR_PARAMP:
+    case REG_LR_OCP:
+    case REG_LR_FIFOTXBASEADDR:
+    case REG_LR_FIFORXBASEADDR:
+    case REG_LR_IRQFLAGSMASK:
+    case REG_LR_MODEMCONFIG1:
+    case REG_LR_MODEMCONFIG2:
+    case REG_LR_SYMBTIMEOUTLSB:
+    case REG_LR_PREAMBLEMSB:
+    case REG_LR_PREAMBLELSB:
+    case REG_LR_PAYLOADLENGTH:
+    case REG_LR_PAYLOADMAXLENGTH:
+    case REG_LR_HOPPERIOD:
+    case REG_LR_DETECTOPTIMIZE:
+    case REG_LR_INVERTIQ:
+    case REG_LR_DETECTIONTHRESHOLD:
+    case REG_LR_SYNCWORD:
+    case REG_LR_INVERTIQ2:
+    case REG_LR_DIOMAPPING1:
+    case REG_LR_DIOMAPPING2:
+    case REG_LR_PLLHOP:
+    case REG_LR_PADAC:
+        return RegShadowLoRaMode;
+    default:
+        return false;
+    }
+}
+
+/*!
+ * \brief Update the shadow copy after registers have been written or read
+ *
+ * \param [IN] addr   First register address
+ * \param [IN] buffer The registers' values
+ * \param [IN] size   Number of registers
+ */
+static void SX1272UpdateRegisterShadow( uint8_t addr, const uint8_t *buffer, uint8_t size )
+{
+    // A burst to the FIFO's address does not advance the address; the data are not registers.
+    if( addr == REG_LR_FIFO )
+    {
+        return;
+    }
+    for( ; size && addr < REG_SHADOW_SIZE; size--, addr++, buffer++ )
+    {
+        if( SX1272RegIsShadowable( addr ) )
+        {
+            RegShadow[addr]            = *buffer;
+            RegShadowValid[addr / 32] |= 1UL << ( addr % 32 );
+        }
+    }
+}
+
+#define RegShadowIsValid( addr ) \
+    ( SX1272RegIsShadowable( addr ) && ( RegShadowValid[( addr ) / 32] & ( 1UL << ( ( addr ) % 32 ) ) ) != 0 )
+
 void SX1272Write( uint8_t addr, uint8_t data )
 {
+    if( RegShadowIsValid( addr ) && RegShadow[addr] == data )
+    {
+        return;
+    }
     SX1272WriteBuffer( addr, &data, 1 );
 }
 
 uint8_t SX1272Read( uint8_t addr )
 {
     uint8_t data;
+
+    if( RegShadowIsValid( addr ) )
+    {
+        return RegShadow[addr];
+    }
     SX1272ReadBuffer( addr, &data, 1 );
     return data;
 }
 
 void SX1272WriteBuffer( uint8_t addr, uint8_t *buffer, uint8_t size )
 {
-  addr |= 0x80;
+  uint8_t cmd = addr | 0x80;
+
   _pv_sx1272_com->start();
-  _pv_sx1272_com->write(&addr,  1);
+  _pv_sx1272_com->write(&cmd,   1);
   _pv_sx1272_com->write(buffer, size);
   _pv_sx1272_com->stop();
+
+  if( addr == REG_OPMODE && size &&
+      ( ( buffer[0] & RFLR_OPMODE_LONGRANGEMODE_ON ) != 0 ) != RegShadowLoRaMode )
+  {
+    // The registers' mapping has changed.
+    SX1272InvalidateRegisterShadow( );
+    RegShadowLoRaMode = !RegShadowLoRaMode;
+  }
+  SX1272UpdateRegisterShadow( addr, buffer, size );
 }
 
 void SX1272ReadBuffer( uint8_t addr, uint8_t *buffer, uint8_t size )
 {
-  addr &= 0x7F;
+  uint8_t cmd = addr & 0x7F;
+
   _pv_sx1272_com->start();
-  _pv_sx1272_com->write(&addr,  1);
+  _pv_sx1272_com->write(&cmd,   1);
   _pv_sx1272_com->read( buffer, size);
   _pv_sx1272_com->stop();
+
+  SX1272UpdateRegisterShadow( addr, buffer, size );
 }
 
 void SX1272WriteFifo( uint8_t *buffer, uint8_t size )
@@ -60,6 +60,13 @@ Maintainer: Miguel Luis and Gregory Cristian
 extern "C" {
 #endif
 
+/*!
+ * Keep a shadow copy of the LoRa configuration registers (1), or always access the radio (0)
+ */
+#ifndef SX1272_REG_SHADOW
+#define SX1272_REG_SHADOW                           1
+#endif
+
 /*!
  * Radio wake-up time from sleep
  */
@@ -509,6 +516,14 @@ void SX1272WriteBuffer( uint8_t addr, uint8_t *buffer, uint8_t size );
  */
 void SX1272ReadBuffer( uint8_t addr, uint8_t *buffer, uint8_t size );
 
+/*!
+ * \brief Forget the shadow copy of the radio's registers
+ *
+ * To be called when the radio may have lost its registers' values without having been reset
+ * by the driver; for example after its power supply has been cut.
+ */
+void SX1272InvalidateRegisterShadow( void );
+
 /*!
  * \brief Sets the maximum payload length.
  *
@@ -0,0 +1,189 @@
+/**
+ * Hardware pulse counter, using a low power timer (LPTIM).
+ *
+ * @date   2019
+ */
+#include "pulsecounter.h"
+#include "board.h"
+
+
+#ifndef PULSE_COUNTER_IRQ_PRIORITY
+#define PULSE_COUNTER_IRQ_PRIORITY  14
+#endif
+#define PULSE_COUNTER_FILTER_CLOCKS  8       ///< The glitch filter's length, in kernel clock periods. 2, 4 or 8. This is no debouncing.
+#define PULSE_COUNTER_HALF_RANGE     0x7FFF  ///< The compare value; the count is updated at half and at full range.
+
+// LPTIM1 is the only low power timer that keeps running in STOP 2 mode.
+#define PULSE_COUNTER_LPTIM          LPTIM1
+#define PULSE_COUNTER_LPTIM_IRQN     LPTIM1_IRQn
+
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+
+  static bool              _pulsecounter_is_running = false;  ///< Is the counter in use?
+  static volatile uint32_t _pulsecounter_total;               ///< The 32 bits count.
+  static volatile uint16_t _pulsecounter_last_cnt;            ///< The hardware counter's value when the count was last updated.
+
+
+  /**
+   * Add the pulses counted by the hardware since the last update to the 32 bits count.
+   * Must be called, with the interruptions disabled, at least once every 65536 pulses.
+   * The compare and auto-reload match interruptions take care of that: they occur at most 32768 pulses
+   * after any update, so they can be serviced up to 32767 pulses late.
+   */
+  static void pulsecounter_update(void)
+  {
+    uint16_t cnt;
+
+    // The counter is clocked asynchronously; it is only reliable when two consecutive reads match
+    do { cnt = (uint16_t)PULSE_COUNTER_LPTIM->CNT; } while(cnt != (uint16_t)PULSE_COUNTER_LPTIM->CNT);
+
+    _pulsecounter_total    += (uint16_t)(cnt - _pulsecounter_last_cnt);
+    _pulsecounter_last_cnt  = cnt;
+  }
+
+
+  /**
+   * Indicate if a pin can be used with the hardware pulse counter.
+   *
+   * @param[in] gpio the pin's GPIO.
+   *
+   * @return true  if it can, and the counter is not already used.
+   * @return false otherwise.
+   */
+  bool pulsecounter_is_available(GPIOId gpio)
+  {
+    return gpio == PULSE_COUNTER_GPIO && !_pulsecounter_is_running;
+  }
+
+  /**
+   * Start counting the pulses on a pin. The count starts from 0.
+   *
+   * @param[in] gpio the pin's GPIO.
+   * @param[in] edge the edges to count.
+   * @param[in] pull the pin's pull configuration; one of GPIO_NOPULL, GPIO_PULLUP, GPIO_PULLDOWN.
+   *
+   * @return true  on success.
+   * @return false if the pin cannot be used with the counter, or if the counter is already used.
+   */
+  bool pulsecounter_start(GPIOId gpio, PulseCounterEdge edge, uint32_t pull)
+  {
+    GPIO_InitTypeDef init;
+    uint32_t         cfgr;
+
+    if(!pulsecounter_is_available(gpio)) { return false; }
+
+    // Set up the pin
+    gpio_use_gpio_with_id(gpio);
+    init.Mode      = GPIO_MODE_AF_PP;
+    init.Pull      = pull;
+    init.Speed     = GPIO_SPEED_FREQ_LOW;
+    init.Alternate = PULSE_COUNTER_GPIO_AF;
+    HAL_GPIO_Init(gpio_hal_port_and_pin_from_id(gpio, &init.Pin), &init);
+
+    // Clock the LPTIM with the LSE, also while in STOP mode
+    __HAL_RCC_LPTIM1_CONFIG(RCC_LPTIM1CLKSOURCE_LSE);
+    __HAL_RCC_LPTIM1_CLK_ENABLE();
+    __HAL_RCC_LPTIM1_CLK_SLEEP_ENABLE();
+
+    // Count the external input's edges, filtered using the kernel clock.
+    // The configuration and interrupt registers can only be written when the LPTIM is disabled.
+    switch(edge)
+    {
+      case PULSE_COUNTER_EDGE_FALLING: cfgr = LPTIM_CFGR_CKPOL_0; break;
+      case PULSE_COUNTER_EDGE_BOTH:    cfgr = LPTIM_CFGR_CKPOL_1; break;
+      default:                         cfgr = 0;                  break;
+    }
+#if   PULSE_COUNTER_FILTER_CLOCKS == 8
+    cfgr |= LPTIM_CFGR_CKFLT;
+#elif PULSE_COUNTER_FILTER_CLOCKS == 4
+    cfgr |= LPTIM_CFGR_CKFLT_1;
+#else
+    cfgr |= LPTIM_CFGR_CKFLT_0;
+#endif
+    PULSE_COUNTER_LPTIM->CR   = 0;
+    PULSE_COUNTER_LPTIM->CFGR = cfgr | LPTIM_CFGR_COUNTMODE;
+    PULSE_COUNTER_LPTIM->IER  = LPTIM_IER_ARRMIE | LPTIM_IER_CMPMIE;
+
+    // Enable, then count continuously over the whole 16 bits range, with a match at half range
+    PULSE_COUNTER_LPTIM->CR   = LPTIM_CR_ENABLE;
+    PULSE_COUNTER_LPTIM->ARR  = 0xFFFF;
+    while(!(PULSE_COUNTER_LPTIM->ISR & LPTIM_ISR_ARROK)) { }
+    PULSE_COUNTER_LPTIM->ICR  = LPTIM_ICR_ARROKCF;
+    PULSE_COUNTER_LPTIM->CMP  = PULSE_COUNTER_HALF_RANGE;
+    while(!(PULSE_COUNTER_LPTIM->ISR & LPTIM_ISR_CMPOK)) { }
+    PULSE_COUNTER_LPTIM->ICR  = LPTIM_ICR_CMPOKCF;
+    _pulsecounter_total       = 0;
+    _pulsecounter_last_cnt    = 0;
+    PULSE_COUNTER_LPTIM->CR  |= LPTIM_CR_CNTSTRT;
+
+    // The match interruptions must be able to wake the µC up
+    EXTI->IMR2 |= EXTI_IMR2_IM32;
+    HAL_NVIC_SetPriority(PULSE_COUNTER_LPTIM_IRQN, PULSE_COUNTER_IRQ_PRIORITY, 0);
+    HAL_NVIC_EnableIRQ(  PULSE_COUNTER_LPTIM_IRQN);
+
+    _pulsecounter_is_running = true;
+    return true;
+  }
+
+  /**
+   * Stop counting the pulses on a pin.
+   *
+   * @param[in] gpio the pin's GPIO.
+   */
+  void pulsecounter_stop(GPIOId gpio)
+  {
+    if(gpio != PULSE_COUNTER_GPIO || !_pulsecounter_is_running) { return; }
+
+    HAL_NVIC_DisableIRQ(PULSE_COUNTER_LPTIM_IRQN);
+    PULSE_COUNTER_LPTIM->CR = 0;
+    __HAL_RCC_LPTIM1_CLK_DISABLE();
+    gpio_free_gpio_with_id(gpio);
+
+    _pulsecounter_is_running = false;
+  }
+
+  /**
+   * Get the number of pulses counted on a pin since the counter has been started.
+   * The count wraps around at 2^32; use the difference between two counts.
+   *
+   * @param[in] gpio the pin's GPIO.
+   *
+   * @return the number of pulses.
+   * @return 0 if the counter is not running for this pin.
+   */
+  uint32_t pulsecounter_count(GPIOId gpio)
+  {
+    uint32_t cnt, primask;
+
+    if(gpio != PULSE_COUNTER_GPIO || !_pulsecounter_is_running) { return 0; }
+
+    primask = __get_PRIMASK();
+    __disable_irq();
+    pulsecounter_update();
+    cnt = _pulsecounter_total;
+    __set_PRIMASK(primask);
+
+    return cnt;
+  }
+
+
+  /**
+   * The LPTIM's interruption handler; the counter has reached half or full range.
+   */
+  void LPTIM1_IRQHandler(void)
+  {
+    if(PULSE_COUNTER_LPTIM->ISR & (LPTIM_ISR_ARRM | LPTIM_ISR_CMPM))
+    {
+      PULSE_COUNTER_LPTIM->ICR = LPTIM_ICR_ARRMCF | LPTIM_ICR_CMPMCF;
+      pulsecounter_update();
+    }
+  }
+
+
+#ifdef __cplusplus
+}
+#endif
@@ -0,0 +1,50 @@
+/**
+ * Hardware pulse counter, using a low power timer (LPTIM).
+ *
+ * The LPTIM counts the edges on its input pin, through its digital glitch filter,
+ * while the node stays in STOP mode; it only wakes the µC twice per turn of its 16 bits counter,
+ * at half and at full range, to extend the count to 32 bits.
+ * The LPTIM's kernel clock is the LSE, that clocks the glitch filter; pulses shorter than
+ * PULSE_COUNTER_FILTER_CLOCKS LSE periods (about 250 µs) are ignored.
+ * It does not debounce: it is only meant for sources with clean edges, like electronic outputs.
+ * A mechanical contact bounces for milliseconds and would be counted several times per closure;
+ * its pulses must be counted using interruptions, with software debouncing.
+ *
+ * Only one pin, PULSE_COUNTER_GPIO, is wired to an LPTIM input that keeps running in STOP mode.
+ *
+ * @date   2019
+ */
+#ifndef PERIPHERALS_PULSECOUNTER_H_
+#define PERIPHERALS_PULSECOUNTER_H_
+
+#include "defs.h"
+#include "gpio.h"
+
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+
+  /**
+   * Defines the edges that can be counted.
+   */
+  typedef enum PulseCounterEdge
+  {
+    PULSE_COUNTER_EDGE_RISING,
+    PULSE_COUNTER_EDGE_FALLING,
+    PULSE_COUNTER_EDGE_BOTH
+  }
+  PulseCounterEdge;
+
+
+  extern bool     pulsecounter_is_available(GPIOId gpio);
+  extern bool     pulsecounter_start(       GPIOId gpio, PulseCounterEdge edge, uint32_t pull);
+  extern void     pulsecounter_stop(        GPIOId gpio);
+  extern uint32_t pulsecounter_count(       GPIOId gpio);
+
+
+#ifdef __cplusplus
+}
+#endif
+#endif /* PERIPHERALS_PULSECOUNTER_H_ */
@@ -39,6 +39,9 @@ extern "C" {
 #else
 #error "Please define ALARMSUBSECONDMASK"
 #endif
+#if RTC_TICKS_IN_1SECOND != (1 << N_PREDIV_S)
+#error "RTC_TICKS_IN_1SECOND does not match N_PREDIV_S"
+#endif
 
 
 #define RTC_CAL_OFFSET_PPM_MAX     488
@@ -64,17 +67,34 @@ extern "C" {
   }
   RTCIrqCtx;
 
+  /**
+   * The last date and time read from the calendar registers.
+   * Used to avoid decoding and converting them again while they have not changed.
+   */
+  typedef struct RTCCalendarShadow
+  {
+    uint32_t tr;      ///< The RTC_TR register's value the shadow is for. RTC_CALENDAR_SHADOW_INVALID if the shadow is not valid.
+    uint32_t dr;      ///< The RTC_DR register's value the shadow is for.
+    ts2000_t ts2000;  ///< The date and time, as a number of seconds since 2000.
+    Datetime dt;      ///< The date and time; the sub-seconds are not used.
+  }
+  RTCCalendarShadow;
+
+#define RTC_CALENDAR_SHADOW_INVALID  0xFFFFFFFF  ///< Not a valid RTC_TR value; reserved bits are set.
+
 
   static RTC_HandleTypeDef _rtc;
   static bool              _rtc_first_run_since_power_up;
   static RTCIrqCtx         _rtc_irq_handlers[RTC_IRQ_ID_COUNT];
   static bool              _rtc_has_been_initialised = false;
   static RTCDateWatcher   *_pv_rtc_date_whatchers    = NULL;
+  static RTCCalendarShadow _rtc_calendar             = { .tr = RTC_CALENDAR_SHADOW_INVALID };
 
   static const uint8_t _rtc_days_in_month[]           = { 31, 28, 31, 30, 31, 30, 31, 31, 30, 31, 30, 31 };
   static const uint8_t _rtc_days_in_month_leap_year[] = { 31, 29, 31, 30, 31, 30, 31, 31, 30, 31, 30, 31 };
 
   static void     rtc_read_date_and_time(RTC_DateTypeDef *pv_date, RTC_TimeTypeDef *pv_time);
+  static ts2000_t rtc_read_calendar(     Datetime        *pv_dt,   uint32_t        *pu32_ssr);
 
   static uint32_t rtc_read_backup_register( RTCBackupRegister reg);
   static void     rtc_write_backup_register(RTCBackupRegister reg, uint32_t v);
@@ -365,20 +385,75 @@ static void rtc_read_date_and_time(RTC_DateTypeDef *pv_date, RTC_TimeTypeDef *pv
 #endif
 }
 
-void rtc_get_date(Datetime *pv_time)
+/**
+ * Read the date and time from the calendar registers.
+ *
+ * The registers are read directly, and consistently; the date and time are only decoded
+ * and converted to a timestamp when they differ from the previous read, that is about once per second.
+ * Can be called from interruption handlers.
+ *
+ * @param[out] pv_dt    where the date and time are written to; the sub-seconds are not set.
+ *                      Can be NULL if we are not interested in this information.
+ * @param[out] pu32_ssr where the sub-seconds register's value is written to. MUST be NOT NULL.
+ *
+ * @return the date and time, as a number of seconds since 2000.
+ */
+static ts2000_t rtc_read_calendar(Datetime *pv_dt, uint32_t *pu32_ssr)
 {
-  RTC_TimeTypeDef rtc_time;
-  RTC_DateTypeDef rtc_date;
+  uint32_t tr, dr, ssr, primask;
+  ts2000_t ts2000;
+  Datetime dt;
 
-  rtc_read_date_and_time(&rtc_date, &rtc_time);
+  // The shadow registers are bypassed; the read is consistent if the sub-seconds did not change.
+  do
+  {
+    ssr = _rtc.Instance->SSR;
+    tr  = _rtc.Instance->TR & RTC_TR_RESERVED_MASK;
+    dr  = _rtc.Instance->DR & RTC_DR_RESERVED_MASK;
+  }
+  while(ssr != _rtc.Instance->SSR);
+  *pu32_ssr = ssr;
+
+  primask = __get_PRIMASK();
+  __disable_irq();
+  if(tr == _rtc_calendar.tr && dr == _rtc_calendar.dr)
+  {
+    // Same second as the previous read
+    ts2000 = _rtc_calendar.ts2000;
+    if(pv_dt) { *pv_dt = _rtc_calendar.dt; }
+    __set_PRIMASK(primask);
+    return ts2000;
+  }
+  __set_PRIMASK(primask);
+
+  // Decode the registers
+  dt.year        = RTC_Bcd2ToByte((dr & (RTC_DR_YT  | RTC_DR_YU))  >> RTC_DR_YU_Pos)  + RTC_YEARS_OFFSET;
+  dt.month       = RTC_Bcd2ToByte((dr & (RTC_DR_MT  | RTC_DR_MU))  >> RTC_DR_MU_Pos);
+  dt.day         = RTC_Bcd2ToByte((dr & (RTC_DR_DT  | RTC_DR_DU))  >> RTC_DR_DU_Pos);
+  dt.hours       = RTC_Bcd2ToByte((tr & (RTC_TR_HT  | RTC_TR_HU))  >> RTC_TR_HU_Pos);
+  dt.minutes     = RTC_Bcd2ToByte((tr & (RTC_TR_MNT | RTC_TR_MNU)) >> RTC_TR_MNU_Pos);
+  dt.seconds     = RTC_Bcd2ToByte((tr & (RTC_TR_ST  | RTC_TR_SU))  >> RTC_TR_SU_Pos);
+  dt.sub_seconds = 0;
+  ts2000         = datetime_to_timestamp_sec_2000(&dt);
+  if(pv_dt) { *pv_dt = dt; }
+
+  // Update the shadow
+  __disable_irq();
+  _rtc_calendar.tr     = tr;
+  _rtc_calendar.dr     = dr;
+  _rtc_calendar.ts2000 = ts2000;
+  _rtc_calendar.dt     = dt;
+  __set_PRIMASK(primask);
+
+  return ts2000;
+}
 
-  pv_time->day         = rtc_date.Date;
-  pv_time->month       = rtc_date.Month;
-  pv_time->year        = rtc_date.Year + RTC_YEARS_OFFSET;
-  pv_time->hours       = rtc_time.Hours;
-  pv_time->minutes     = rtc_time.Minutes;
-  pv_time->seconds     = rtc_time.Seconds;
-  pv_time->sub_seconds = rtc_ticks_to_ms(PREDIV_S - rtc_time.SubSeconds);
+void rtc_get_date(Datetime *pv_time)
+{
+  uint32_t ssr;
+
+  rtc_read_calendar(pv_time, &ssr);
+  pv_time->sub_seconds = rtc_ticks_to_ms(PREDIV_S - ssr);
 }
 
 /**
@@ -451,6 +526,7 @@ bool rtc_set_date_get_offset(const Datetime *pv_time,
   HAL_RTC_SetTime(&_rtc, &rtc_time, RTC_FORMAT_BIN);
   HAL_RTC_SetDate(&_rtc, &rtc_date, RTC_FORMAT_BIN);
   disable_write_in_backup_domain();
+  _rtc_calendar.tr = RTC_CALENDAR_SHADOW_INVALID;
 
   // Signal the date watchers, if there are any
   for(pv_watcher = _pv_rtc_date_whatchers; pv_watcher; pv_watcher = pv_watcher->pv_next)
@@ -478,36 +554,73 @@ bool rtc_set_date_get_offset(const Datetime *pv_time,
 
 ts2000_t rtc_get_date_as_secs_since_2000(void)
 {
-  Datetime dt;
+  uint32_t ssr;
 
-  rtc_get_date(&dt);
-  return datetime_to_timestamp_sec_2000(&dt);
+  return rtc_read_calendar(NULL, &ssr);
 }
 
 RTCTicks rtc_get_date_as_ticks_since_2000(void)
 {
-  RTC_TimeTypeDef rtc_time;
-  RTC_DateTypeDef rtc_date;
-  Datetime        dt;
-  RTCTicks        res;
-
-  rtc_read_date_and_time(&rtc_date, &rtc_time);
+  uint32_t ssr;
+  RTCTicks res;
 
-  // Set up Datetime object to get the number of seconds since 2000
-  dt.year    = rtc_date.Year + RTC_YEARS_OFFSET;
-  dt.month   = rtc_date.Month;
-  dt.day     = rtc_date.Date;
-  dt.hours   = rtc_time.Hours;
-  dt.minutes = rtc_time.Minutes;
-  dt.seconds = rtc_time.Seconds;
-  res        = datetime_to_timestamp_sec_2000(&dt);
+  res = rtc_read_calendar(NULL, &ssr);
 
   // Add the sub-seconds
-  res = (res << N_PREDIV_S) + (PREDIV_S - rtc_time.SubSeconds);
+  res = (res << N_PREDIV_S) + (PREDIV_S - ssr);
 
   return res;
 }
 
+/**
+ * Get the current date and time as a number of seconds since 2000, and the milliseconds.
+ * The seconds and the milliseconds are read consistently.
+ *
+ * @param[out] pu16_ms where the milliseconds, [0..999], are written to. MUST be NOT NULL.
+ *
+ * @return the number of seconds since 2000.
+ */
+ts2000_t rtc_get_date_as_secs_and_ms_since_2000(uint16_t *pu16_ms)
+{
+  uint32_t ssr;
+  ts2000_t ts2000;
+
+  ts2000   = rtc_read_calendar(NULL, &ssr);
+  *pu16_ms = (uint16_t)rtc_ticks_to_ms(PREDIV_S - ssr);
+
+  return ts2000;
+}
+
+/**
+ * Get the current date and time as a number of milliseconds since 2000.
+ *
+ * Unlike the RTC ticks, this timebase does not wrap around.
+ *
+ * @return the number of milliseconds since 2000.
+ */
+ts2000ms_t rtc_get_date_as_ms_since_2000(void)
+{
+  uint16_t ms;
+  ts2000_t secs = rtc_get_date_as_secs_and_ms_since_2000(&ms);
+
+  return ts2000ms_from_secs_and_ms(secs, ms);
+}
+
+/**
+ * Get the number of RTC ticks elapsed in the current second, from the sub-seconds register.
+ *
+ * @return the number of ticks, [0..RTC_TICKS_IN_1SECOND - 1].
+ */
+RTCTicks rtc_get_sub_seconds_ticks(void)
+{
+  uint32_t ssr;
+
+  // The shadow registers are bypassed; the register can be read directly.
+  do { ssr = _rtc.Instance->SSR; } while(ssr != _rtc.Instance->SSR);
+
+  return PREDIV_S - ssr;
+}
+
 /**
  * Convert a milliseconds value to a number of RTC ticks.
  *
@@ -994,7 +1107,7 @@ HAL_StatusTypeDef HAL_InitTick(uint32_t TickPriority)
  */
 uint32_t HAL_GetTick(void)
 {
-  return _rtc_has_been_initialised ? rtc_ticks_to_ms(rtc_get_date_as_ticks_since_2000()) : 0;
+  return _rtc_has_been_initialised ? (uint32_t)rtc_get_date_as_ms_since_2000() : 0;
 }
 
 
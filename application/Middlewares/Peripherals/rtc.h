@@ -87,6 +87,7 @@ extern "C" {
    * The type used to store RTC ticks count.
    */
   typedef uint32_t RTCTicks;
+#define RTC_TICKS_IN_1SECOND  1024u  ///< The RTC's sub-seconds resolution.
 
 
   /**
@@ -134,6 +135,9 @@ extern "C" {
 #define rtc_set_date(pv_time)  rtc_set_date_get_offset(pv_time, NULL, NULL, NULL)
   extern ts2000_t rtc_get_date_as_secs_since_2000( void);
   extern RTCTicks rtc_get_date_as_ticks_since_2000(void);
+  extern RTCTicks rtc_get_sub_seconds_ticks(       void);
+  extern ts2000_t   rtc_get_date_as_secs_and_ms_since_2000(uint16_t *pu16_ms);
+  extern ts2000ms_t rtc_get_date_as_ms_since_2000(         void);
   extern RTCTicks rtc_ms_to_ticks(  uint32_t ms);
   extern RTCTicks rtc_secs_to_ticks(uint32_t secs);
   extern uint32_t rtc_ticks_to_ms(  RTCTicks ticks);
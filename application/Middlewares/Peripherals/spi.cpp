@@ -56,6 +56,9 @@ SPI::SPI(uint32_t       sckFreqHz,
   this->_ptSSConfigs    = NULL;
   this->_ssConfigsCount = 0;
 
+  this->_pwrclkReq.ps_name = "SPI";
+  this->_pwrclkReq.pv_next = NULL;
+
   // Set up slave select signal(s).
   if(ptSSInfos)
   {
@@ -226,6 +229,7 @@ void SPI::close()
   // Deinit SPI module and stop its clock.
   HAL_SPI_DeInit(&this->_spi);
   PASTER3(__HAL_RCC_SPI, EXT_SPI_ID, _CLK_DISABLE)();
+  pwrclk_release(&this->_pwrclkReq);
 
   // Free GPIOs
   if(this->_options & OPTION_MASTER)
@@ -277,11 +281,13 @@ bool SPI::initUsingOptions(uint32_t sckFreq, Options options)
   PASTER3(__HAL_RCC_SPI, EXT_SPI_ID, _RELEASE_RESET)();
 
   // Compute the prescaler value to use to achieve a SCK frequency equal or lower
-  // to sckFreqHz.
+  // to sckFreqHz. The APB clock must then keep its frequency until the SPI is closed.
 #if EXT_SPI_ID == 1
   div = pwrclk_clock_frequency_hz(PWRCLK_CLOCK_PCLK2);
+  pwrclk_require(&this->_pwrclkReq, PWRCLK_CLOCK_PCLK2, div);
 #else
   div = pwrclk_clock_frequency_hz(PWRCLK_CLOCK_PCLK1);
+  pwrclk_require(&this->_pwrclkReq, PWRCLK_CLOCK_PCLK1, div);
 #endif
   div /= sckFreq;
   for(presc = 0, d = 2;
@@ -10,6 +10,7 @@
 #include "board.h"
 #include "json.hpp"
 #include "extensionport.h"
+#include "powerandclocks.h"
 
 class SPI
 {
@@ -163,6 +164,7 @@ private:
   Options           _options;         ///< The configuration options.
   SSConfig         *_ptSSConfigs;     ///< The slave select configuration(s).
   uint8_t           _ssConfigsCount;  ///< The number of slave select configurations. Can be 0 if no slave select is used.
+  PwrClkRequirement _pwrclkReq;       ///< Keeps the SPI's APB clock at the frequency the prescaler has been computed for.
 };
 
 #endif // _SPI_H_
@@ -23,6 +23,10 @@ extern "C" {
 #endif
 #endif
 
+#ifndef USART_SYSCLK_HZ_PER_BAUD
+#define USART_SYSCLK_HZ_PER_BAUD  100  ///< The system clock an opened USART requires, in Hz per baud; about 1000 cycles per byte for the interruption handlers.
+#endif
+
 
   CREATE_LOGGER(usart);
 #undef  logger
@@ -150,6 +154,8 @@ extern "C" {
     uint32_t            _rx_pin_af;  ///< RX GPIO pin alternate function.
 
     USARTIt     it;         ///< Interruptions data.
+
+    PwrClkRequirement _pwrclk_req;  ///< The system clock requirement, active while the USART is opened and awake.
   };
 
 
@@ -534,11 +540,14 @@ extern "C" {
     pv_usart->_baudrate = baudrate;
     pv_usart->_params   = params;
 
-    // Set UART clock source
-    usart_set_clock_source(pv_usart,
-			   (params & USART_PARAM_RX_WHEN_ASLEEP) ?
-			       PWRCLK_CLOCK_HSI16:
-			       PWRCLK_CLOCK_PCLK1);
+    // Set UART clock source.
+    // Use the HSI16 so that the baudrate does not depend on the system clock configuration,
+    // that can change while bytes are being transferred.
+    usart_set_clock_source(pv_usart, PWRCLK_CLOCK_HSI16);
+
+    // Make sure that the interruption handlers can keep up with the baudrate
+    pv_usart->_pwrclk_req.ps_name = pv_usart->ps_name;
+    pwrclk_require(&pv_usart->_pwrclk_req, PWRCLK_CLOCK_SYSCLK, baudrate * USART_SYSCLK_HZ_PER_BAUD);
 
     // Enable USART clock
     usart_enable_clock(pv_usart, true);
@@ -639,6 +648,9 @@ extern "C" {
       // Free GPIOs
       usart_deinit_ios(pv_usart);
 
+      // The system clock can be slowed down
+      pwrclk_release(&pv_usart->_pwrclk_req);
+
       // Indicate that the USART is free
       pv_usart->_is_opened                    = false;
       _usarts_in_use_by[pv_usart->id].ps_name = NULL;
@@ -659,6 +671,7 @@ extern "C" {
     {
       usart_enable_clock(pv_usart, false);
       usart_deinit_ios(  pv_usart);
+      pwrclk_release(   &pv_usart->_pwrclk_req);
     }
   }
 
@@ -678,6 +691,8 @@ extern "C" {
       usart_set_clock_source(pv_usart, pv_usart->_clock_source);
       usart_init_ios(        pv_usart);
       usart_enable_clock(    pv_usart, true);
+      pwrclk_require(       &pv_usart->_pwrclk_req, PWRCLK_CLOCK_SYSCLK,
+			     pv_usart->_baudrate * USART_SYSCLK_HZ_PER_BAUD);
     }
   }
 
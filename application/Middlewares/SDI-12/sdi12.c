@@ -6,6 +6,8 @@
  * @date   2018
  */
 #include "sdi12.h"
+#include "trace.h"
+#include "perfcounters.h"
 
 #ifdef __cplusplus
 extern "C" {
@@ -95,6 +97,8 @@ extern "C" {
 
     // We are ready to process another command
     p_interface->state = SDI12_STATE_IDLE;
+    TRACE_STATE(TRACE_ID_SDI12, TRACE_SDI12_IDLE);
+    perfcounters_stop(PERF_COUNTER_SDI12_MS);
 
 #if defined SDI12_PERIOD_MIN_BETWEEN_COMMANDS_MS && SDI12_PERIOD_MIN_BETWEEN_COMMANDS_MS > 0
     p_interface->last_command_timestamp = HAL_GetTick();
@@ -344,6 +348,8 @@ extern "C" {
 
     // Resets the context
     sdi12_reset_cmd_context(p_interface);
+    TRACE_STATE(TRACE_ID_SDI12, TRACE_SDI12_COMMAND);
+    perfcounters_start(PERF_COUNTER_SDI12_MS);
 
     if(sdi12_command_cfg_send_break(p_command))
     {
@@ -498,6 +504,8 @@ extern "C" {
 
     // Set the state
     p_interface->state = SDI12_STATE_WAITING_FOR_SERVICE_REQUEST;
+    TRACE_STATE(TRACE_ID_SDI12, TRACE_SDI12_SERVICE_REQUEST);
+    perfcounters_start(PERF_COUNTER_SDI12_MS);
 
     // Initialise the service request object
     sdi12_set_no_service_request(&p_interface->service_request);
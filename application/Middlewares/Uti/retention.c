@@ -0,0 +1,67 @@
+/**
+ * Data retained in SRAM2.
+ *
+ * @date:   2019
+ */
+
+#include "retention.h"
+#include "murmur3.h"
+
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+  /**
+   * Indicate if a retained block is valid.
+   *
+   * @param[in] pv_header the block's header. MUST be NOT NULL.
+   * @param[in] pv_data   the block's contents. MUST be NOT NULL.
+   * @param[in] size      the block's expected size, in bytes.
+   * @param[in] magic     the block's expected magic number.
+   *
+   * @return true  if the block is valid.
+   * @return false otherwise.
+   */
+  bool retention_is_valid(const RetentionHeader *pv_header,
+			  const void            *pv_data,
+			  uint32_t               size,
+			  uint32_t               magic)
+  {
+    return pv_header->magic == magic &&
+	pv_header->size     == size  &&
+	pv_header->check    == mm3_32_cnss((const uint8_t *)pv_data, size);
+  }
+
+  /**
+   * Seal a retained block; to be called each time its contents are modified.
+   *
+   * @param[out] pv_header the block's header. MUST be NOT NULL.
+   * @param[in]  pv_data   the block's contents. MUST be NOT NULL.
+   * @param[in]  size      the block's size, in bytes.
+   * @param[in]  magic     the block's magic number.
+   */
+  void retention_seal(RetentionHeader *pv_header,
+		      const void      *pv_data,
+		      uint32_t         size,
+		      uint32_t         magic)
+  {
+    pv_header->magic = magic;
+    pv_header->size  = size;
+    pv_header->check = mm3_32_cnss((const uint8_t *)pv_data, size);
+  }
+
+  /**
+   * Invalidate a retained block.
+   *
+   * @param[out] pv_header the block's header. MUST be NOT NULL.
+   */
+  void retention_invalidate(RetentionHeader *pv_header)
+  {
+    pv_header->magic = 0;
+    pv_header->check = 0;
+  }
+
+#ifdef __cplusplus
+}
+#endif
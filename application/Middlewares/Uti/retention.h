@@ -0,0 +1,50 @@
+/**
+ * Data retained in SRAM2.
+ *
+ * SRAM2 is not erased on reset (see the option bytes set in board.c) and is not initialised
+ * by the startup code. Data placed there using RETAINED survive resets, but not power losses;
+ * so each retained block is sealed with a header holding a magic number, its size and
+ * a checksum, and has to be validated before being used.
+ *
+ * @date:   2019
+ */
+
+#ifndef UTI_RETENTION_H_
+#define UTI_RETENTION_H_
+
+#include "defs.h"
+
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#define RETAINED  __attribute__((section(".retained")))  ///< Place a variable in the retained SRAM2 section.
+
+
+  /**
+   * Defines the header placed before each retained block.
+   */
+  typedef struct RetentionHeader
+  {
+    uint32_t magic;  ///< Identifies the block's contents and its format.
+    uint32_t size;   ///< The block's size, in bytes.
+    uint32_t check;  ///< The checksum of the block's contents.
+  }
+  RetentionHeader;
+
+
+  extern bool retention_is_valid(  const RetentionHeader *pv_header,
+				   const void            *pv_data,
+				   uint32_t               size,
+				   uint32_t               magic);
+  extern void retention_seal(      RetentionHeader       *pv_header,
+				   const void            *pv_data,
+				   uint32_t               size,
+				   uint32_t               magic);
+  extern void retention_invalidate(RetentionHeader       *pv_header);
+
+#ifdef __cplusplus
+}
+#endif
+#endif /* UTI_RETENTION_H_ */
@@ -0,0 +1,317 @@
+/**
+ * Streaming statistics computed in constant memory.
+ *
+ * @date   2019
+ */
+#include <math.h>
+#include "runningstats.hpp"
+
+
+#define DEG_TO_RAD  0.017453292519943f
+#define RAD_TO_DEG  57.295779513082321f
+
+
+/**
+ * Add a value to a sum using Kahan's compensated summation.
+ *
+ * @param[in,out] sum   the sum.
+ * @param[in,out] err   the sum's rounding error, to compensate at the next addition.
+ * @param[in]     value the value to add.
+ */
+static inline void compensatedAdd(float &sum, float &err, float value)
+{
+  float y = value - err;
+  float t = sum + y;
+
+  err = (t - sum) - y;
+  sum = t;
+}
+
+
+/**************************** RunningStats ****************************/
+
+/**
+ * Forget all the values.
+ */
+void RunningStats::reset()
+{
+  this->_count  = 0;
+  this->_sum    = 0.0;
+  this->_sumErr = 0.0;
+  this->_min    = 0.0;
+  this->_max    = 0.0;
+  this->_shift  = 0.0;
+  this->_mean   = 0.0;
+  this->_m2     = 0.0;
+}
+
+/**
+ * Add a value.
+ *
+ * @param[in] value the value. NaN values are ignored.
+ */
+void RunningStats::add(float value)
+{
+  float delta;
+
+  if(isnan(value)) { return; }
+
+  if(!this->_count++) { this->_min = this->_max = this->_shift = value; }
+  else
+  {
+    if(value < this->_min) { this->_min = value; }
+    if(value > this->_max) { this->_max = value; }
+  }
+  compensatedAdd(this->_sum, this->_sumErr, value);
+
+  value       -= this->_shift;
+  delta        = value - this->_mean;
+  this->_mean += delta / this->_count;
+  this->_m2   += delta * (value - this->_mean);
+}
+
+/**
+ * @return the minimum value.
+ * @return NaN if there is no value.
+ */
+float RunningStats::min() const
+{
+  return this->_count ? this->_min : NAN;
+}
+
+/**
+ * @return the maximum value.
+ * @return NaN if there is no value.
+ */
+float RunningStats::max() const
+{
+  return this->_count ? this->_max : NAN;
+}
+
+/**
+ * @return the mean.
+ * @return NaN if there is no value.
+ */
+float RunningStats::mean() const
+{
+  return this->_count ? this->_sum / this->_count : NAN;
+}
+
+/**
+ * @return the population variance.
+ * @return NaN if there is no value.
+ */
+float RunningStats::variance() const
+{
+  return this->_count ? this->_m2 / this->_count : NAN;
+}
+
+/**
+ * @return the population standard deviation.
+ * @return NaN if there is no value.
+ */
+float RunningStats::stddev() const
+{
+  return this->_count ? sqrtf(this->_m2 / this->_count) : NAN;
+}
+
+
+/**************************** DirectionStats ****************************/
+
+/**
+ * Forget all the directions.
+ */
+void DirectionStats::reset()
+{
+  this->_count  = 0;
+  this->_sumSin = 0.0;
+  this->_sumCos = 0.0;
+  this->_sinErr = 0.0;
+  this->_cosErr = 0.0;
+}
+
+/**
+ * Add a direction.
+ *
+ * @param[in] deg the direction, in degrees. NaN values are ignored.
+ */
+void DirectionStats::add(float deg)
+{
+  if(isnan(deg)) { return; }
+
+  this->_count++;
+  compensatedAdd(this->_sumSin, this->_sinErr, sinf(deg * DEG_TO_RAD));
+  compensatedAdd(this->_sumCos, this->_cosErr, cosf(deg * DEG_TO_RAD));
+}
+
+/**
+ * @return the vector mean direction, in degrees, in range [0..360[.
+ * @return NaN if there is no direction.
+ */
+float DirectionStats::mean() const
+{
+  float deg;
+
+  if(!this->_count) { return NAN; }
+
+  deg = atan2f(this->_sumSin, this->_sumCos) * RAD_TO_DEG;
+  return fmodf(deg + 360.0f, 360.0f);
+}
+
+/**
+ * @return the directions' standard deviation, in degrees, using the Yamartino method.
+ * @return NaN if there is no direction.
+ */
+float DirectionStats::stddev() const
+{
+  float s, c, r2, eps;
+
+  if(!this->_count) { return NAN; }
+
+  s   = this->_sumSin / this->_count;
+  c   = this->_sumCos / this->_count;
+  r2  = s * s + c * c;
+  eps = r2 >= 1.0f ? 0.0f : sqrtf(1.0f - r2);
+
+  return asinf(eps) * (1.0f + 0.1547005f * eps * eps * eps) * RAD_TO_DEG;  // 0.1547 = 2 / sqrt(3) - 1
+}
+
+
+/**************************** P2Quantile ****************************/
+
+/**
+ * Set the quantile to estimate. Forget all the values.
+ *
+ * @param[in] p the quantile, in range [0..1]. 0.5 for the median.
+ */
+void P2Quantile::setQuantile(float p)
+{
+  if(     p < 0.0f) { p = 0.0f; }
+  else if(p > 1.0f) { p = 1.0f; }
+  this->_p = p;
+
+  reset();
+}
+
+/**
+ * Forget all the values.
+ */
+void P2Quantile::reset()
+{
+  float p = this->_p;
+
+  this->_count = 0;
+  for(uint8_t i = 0; i < 5; i++)
+  {
+    this->_heights[  i] = 0.0;
+    this->_positions[i] = i;
+  }
+  this->_desired[0]    = 0.0;
+  this->_desired[1]    = 2.0f * p;
+  this->_desired[2]    = 4.0f * p;
+  this->_desired[3]    = 2.0f + 2.0f * p;
+  this->_desired[4]    = 4.0;
+  this->_increments[0] = 0.0;
+  this->_increments[1] = p / 2.0f;
+  this->_increments[2] = p;
+  this->_increments[3] = (1.0f + p) / 2.0f;
+  this->_increments[4] = 1.0;
+}
+
+/**
+ * Add a value.
+ *
+ * @param[in] value the value. NaN values are ignored.
+ */
+void P2Quantile::add(float value)
+{
+  uint8_t i, k;
+  float   d, q;
+
+  if(isnan(value)) { return; }
+
+  if(this->_count < 5)
+  {
+    // Keep the first values sorted; they are the initial markers' heights.
+    for(i = this->_count; i && this->_heights[i - 1] > value; i--)
+    {
+      this->_heights[i] = this->_heights[i - 1];
+    }
+    this->_heights[i] = value;
+    this->_count++;
+    return;
+  }
+  this->_count++;
+
+  // Find the cell the value falls in, and update the extreme markers.
+  if(value < this->_heights[0])      { this->_heights[0] = value; k = 0; }
+  else if(value >= this->_heights[4]) { this->_heights[4] = value; k = 3; }
+  else { for(k = 0; value >= this->_heights[k + 1]; k++) { /* Do nothing */ } }
+
+  // Update the markers' positions
+  for(i = k + 1; i < 5; i++) { this->_positions[i]++;                       }
+  for(i = 0;     i < 5; i++) { this->_desired[  i] += this->_increments[i]; }
+
+  // Adjust the middle markers' heights if they are off their desired positions.
+  for(i = 1; i < 4; i++)
+  {
+    d = this->_desired[i] - this->_positions[i];
+    if((d >=  1.0f && this->_positions[i + 1] - this->_positions[i] >  1.0f) ||
+       (d <= -1.0f && this->_positions[i - 1] - this->_positions[i] < -1.0f))
+    {
+      d = d >= 0 ? 1.0f : -1.0f;
+      q = parabolic(i, d);
+      if(q <= this->_heights[i - 1] || q >= this->_heights[i + 1]) { q = linear(i, (int8_t)d); }
+      this->_heights[  i]  = q;
+      this->_positions[i] += d;
+    }
+  }
+}
+
+/**
+ * Compute a marker's new height using the piecewise-parabolic formula.
+ *
+ * @param[in] i the marker's index, in range [1..3].
+ * @param[in] d the direction of the marker's move: -1 or +1.
+ *
+ * @return the new height.
+ */
+float P2Quantile::parabolic(uint8_t i, float d) const
+{
+  const float *n = this->_positions;
+  const float *q = this->_heights;
+
+  return q[i] + d / (n[i + 1] - n[i - 1]) *
+      ((n[i]     - n[i - 1] + d) * (q[i + 1] - q[i])     / (n[i + 1] - n[i]) +
+       (n[i + 1] - n[i]     - d) * (q[i]     - q[i - 1]) / (n[i]     - n[i - 1]));
+}
+
+/**
+ * Compute a marker's new height using the linear formula.
+ *
+ * @param[in] i the marker's index, in range [1..3].
+ * @param[in] d the direction of the marker's move: -1 or +1.
+ *
+ * @return the new height.
+ */
+float P2Quantile::linear(uint8_t i, int8_t d) const
+{
+  return this->_heights[i] + d * (this->_heights[i + d] - this->_heights[i]) /
+      (this->_positions[i + d] - this->_positions[i]);
+}
+
+/**
+ * @return the quantile estimate. Exact if at most 5 values have been added.
+ * @return NaN if there is no value.
+ */
+float P2Quantile::value() const
+{
+  if(!this->_count)     { return NAN; }
+  if(this->_count <= 5)
+  {
+    // Nearest rank on the sorted values.
+    return this->_heights[(uint8_t)(this->_p * (this->_count - 1) + 0.5f)];
+  }
+
+  return this->_heights[2];
+}
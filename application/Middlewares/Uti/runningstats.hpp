@@ -0,0 +1,111 @@
+/**
+ * Streaming statistics computed in constant memory.
+ *
+ * Values are added one at a time and are not stored.
+ *
+ * @date   2019
+ */
+#pragma once
+
+#include "defs.h"
+
+
+/**
+ * Count, sum, minimum, maximum, mean and standard deviation of a series of values.
+ *
+ * The sum uses Kahan's compensated summation, so that its error does not grow with the number of values;
+ * the mean is computed from it.
+ * The variance is updated using Welford's algorithm,
+ * which does not suffer from the cancellation problems of the sum of squares method;
+ * it is applied to the values minus the first one, so that a large offset does not eat the float's precision.
+ */
+class RunningStats
+{
+public:
+  RunningStats() { reset(); }
+
+  void     reset();
+  void     add(float value);
+
+  uint32_t count()    const { return this->_count; }
+  float    sum()      const { return this->_sum;   }
+  float    min()      const;
+  float    max()      const;
+  float    mean()     const;
+  float    variance() const;
+  float    stddev()   const;
+
+
+private:
+  uint32_t _count;  ///< The number of values.
+  float    _sum;    ///< The sum of the values.
+  float    _sumErr; ///< The rounding error of the sum, to compensate at the next addition.
+  float    _min;    ///< The minimum value.
+  float    _max;    ///< The maximum value.
+  float    _shift;  ///< The first value, subtracted from all the values for Welford's algorithm.
+  float    _mean;   ///< The current mean of the shifted values, as updated by Welford's algorithm.
+  float    _m2;     ///< The sum of the squared differences to the current mean.
+};
+
+
+/**
+ * Mean and standard deviation of a series of directions.
+ *
+ * The mean is the direction of the unit vectors' mean.
+ * The vectors' components are summed using Kahan's compensated summation.
+ * The standard deviation is estimated using the Yamartino method.
+ */
+class DirectionStats
+{
+public:
+  DirectionStats() { reset(); }
+
+  void     reset();
+  void     add(float deg);
+
+  uint32_t count()  const { return this->_count; }
+  float    mean()   const;
+  float    stddev() const;
+
+
+private:
+  uint32_t _count;  ///< The number of directions.
+  float    _sumSin; ///< The sum of the directions' sines.
+  float    _sumCos; ///< The sum of the directions' cosines.
+  float    _sinErr; ///< The rounding error of the sines' sum.
+  float    _cosErr; ///< The rounding error of the cosines' sum.
+};
+
+
+/**
+ * Estimate a quantile of a series of values using the P-square algorithm
+ * (R. Jain and I. Chlamtac, 1985).
+ *
+ * Only five markers are stored, whatever the number of values.
+ */
+class P2Quantile
+{
+public:
+  P2Quantile(float p = 0.5) { setQuantile(p); }
+
+  void     setQuantile(float p);
+  void     reset();
+  void     add(float value);
+
+  uint32_t count() const { return this->_count; }
+  float    value() const;
+
+
+private:
+  float    parabolic(uint8_t i, float d) const;
+  float    linear(   uint8_t i, int8_t d) const;
+
+
+private:
+  float    _p;                 ///< The quantile to estimate, in range [0..1].
+  uint32_t _count;             ///< The number of values.
+  float    _heights[5];        ///< The markers' heights.
+  float    _positions[5];      ///< The markers' actual positions.
+  float    _desired[5];        ///< The markers' desired positions.
+  float    _increments[5];     ///< The desired positions' increments.
+};
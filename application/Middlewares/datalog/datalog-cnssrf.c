@@ -658,6 +658,31 @@ extern "C" {
   }
 
 
+  /**
+   * Estimate the number of records that may still hold data that have not been sent.
+   *
+   * Without reading any record: the records are counted from the last search position for
+   * unsent data, if the indexes are used and it is set; otherwise all the records are counted.
+   * So this is an upper bound.
+   *
+   * @return the number of records.
+   */
+  uint32_t datalog_cnssrf_backlog(void)
+  {
+    if(!_datalog_cnssrf_has_been_initialised) { return 0; }
+
+#ifdef USE_DATALOG_CNSSRF_INDEXES
+    if(_datalog_cnssrf_file_indexes.rid_of_last_not_sent_search)
+    {
+      return datalogfile_nb_records_from(&_datalog_cnssrf_file,
+					 _datalog_cnssrf_file_indexes.rid_of_last_not_sent_search);
+    }
+#endif // USE_DATALOG_CNSSRF_INDEXES
+
+    return _datalog_cnssrf_file.header.dynamic.nb_records_with_data;
+  }
+
+
   /**
    * Function to call after a CNSSRF frame previously built have successfully been sent.
    *
@@ -32,6 +32,7 @@ extern "C" {
 				 ts2000_t         since,
 				 bool            *pb_has_more);
   void  datalog_cnssrf_frame_has_been_sent(void);
+  uint32_t datalog_cnssrf_backlog(          void);
 
 
 #ifdef __cplusplus
@@ -9,6 +9,7 @@
 #include "datalogfile.h"
 #include "logger.h"
 #include "rtc.h"
+#include "trace.h"
 
 
 #ifdef __cplusplus
@@ -92,6 +93,7 @@ extern "C" {
     pv_dlf->created_by_last_open = false;
 
     if(pv_dlf->is_opened) { return true; } // Already opened
+    TRACE_BEGIN(TRACE_ID_DATALOG_OPEN);
 
     // Check if the file exist
     if(!sdcard_exists(pv_dlf->ps_filename))
@@ -126,10 +128,18 @@ extern "C" {
       }
     }
 
+    // Records are accessed randomly; avoid following the cluster chain in the FAT for each seek.
+    if(!sdcard_fenable_fast_seek(&pv_dlf->file, pv_dlf->linkmap, DATALOG_LINKMAP_SIZE))
+    {
+      log_info(_logger, "Datalog file '%s' is too fragmented to use fast seeks.", pv_dlf->ps_filename);
+    }
+
     pv_dlf->is_opened = true;
+    TRACE_END(TRACE_ID_DATALOG_OPEN);
     return true;
 
     error_exit:
+    TRACE_END(TRACE_ID_DATALOG_OPEN);
     return false;
   }
 
@@ -156,7 +166,9 @@ extern "C" {
   {
     if(pv_dlf->is_opened)
     {
+      TRACE_BEGIN(TRACE_ID_DATALOG_SYNC);
       sdcard_fsync(&pv_dlf->file);
+      TRACE_END(  TRACE_ID_DATALOG_SYNC);
     }
   }
 
@@ -185,9 +197,14 @@ extern "C" {
       return false;
     }
 
-    // Allocate space on disk for the file
+    // Allocate space on disk for the file. Try to use contiguous clusters first,
+    // so that the file can be accessed using a small cluster link map.
     size = FIRST_RECORD_POS + pv_dlf->header.nb_records * pv_dlf->header.records_size;
-    if(!sdcard_fseek_abs(&pv_dlf->file, size))
+    if(!sdcard_fexpand(&pv_dlf->file, size))
+    {
+      log_info(_logger, "Cannot allocate contiguous space for datalog file '%s'.", pv_dlf->ps_filename);
+    }
+    if(sdcard_fsize(&pv_dlf->file) != size && !sdcard_fseek_abs(&pv_dlf->file, size))
     {
       log_error(_logger, "Failed to expand datalog file '%s' size to %d bytes.", pv_dlf->ps_filename, size);
       goto error_exit;
@@ -351,11 +368,13 @@ extern "C" {
     DataLogFileRecordId     rid;
     DataLogFileRecordHeader record_header;
 
+    TRACE_BEGIN(TRACE_ID_DATALOG_WRITE);
+
     // Check data size
     if(size > pv_dlf->header.records_size - sizeof(DataLogFileRecordHeader))
     {
       log_error(_logger, "Cannot write data of length %d bytes to datalog file '%s'; data is too big.", size, pv_dlf->ps_filename);
-      return 0;
+      goto error_exit;
     }
 
     // Write record header
@@ -367,7 +386,7 @@ extern "C" {
     {
       // Failed to write the header.
       log_error(_logger, "Failed to write datalog record header.");
-      return 0;
+      goto error_exit;
     }
 
     // Write data
@@ -382,7 +401,7 @@ extern "C" {
 			     (const uint8_t *)&_NULL_RECORD_HEADER,
 			     sizeof(           _NULL_RECORD_HEADER)));
 	log_error(_logger, "Failed to write NULL record header.");
-	return 0;
+	goto error_exit;
       }
     }
     rid = pv_dlf->header.dynamic.log_head_seek_pos;
@@ -412,10 +431,15 @@ extern "C" {
     {
       // Failed to write dynamic part of the header.
       log_error(_logger, "Failed to write datalog header's dynamic part.");
-      return 0;
+      goto error_exit;
     }
 
+    TRACE_END(TRACE_ID_DATALOG_WRITE);
     return rid;
+
+    error_exit:
+    TRACE_END(TRACE_ID_DATALOG_WRITE);
+    return 0;
   }
 
   /**
@@ -492,6 +516,29 @@ extern "C" {
     return rid;
   }
 
+  /**
+   * Count the records from a given record up to the latest one.
+   *
+   * @param[in] pv_dlf the datalog file object. MUST have been opened.
+   * @param[in] rid    the identifier of the first record to count.
+   *
+   * @return the number of records, including the given record and the latest one.
+   * @return 0 if the record identifier is not valid or if the datalog file is empty.
+   */
+  uint32_t datalogfile_nb_records_from(DataLogFile *pv_dlf, DataLogFileRecordId rid)
+  {
+    uint32_t head = pv_dlf->header.dynamic.log_head_seek_pos;
+    uint32_t n;
+
+    if(!rid_is_valid(pv_dlf, rid) || datalogfile_is_empty(pv_dlf)) { return 0; }
+
+    n = (rid < head ? head - rid : pv_dlf->file_size - rid + head - FIRST_RECORD_POS) /
+	pv_dlf->header.records_size;
+
+    return n > pv_dlf->header.dynamic.nb_records_with_data ?
+	pv_dlf->header.dynamic.nb_records_with_data : n;
+  }
+
 
   /**
    * Read a record header.
@@ -536,16 +583,19 @@ extern "C" {
 				   DataLogFileRecordHeader *pv_header)
   {
     DataLogFileRecordHeader record_header;
+    bool                    ok;
 
     if(!pv_header)  { pv_header = &record_header; }
     pv_header->timestamp = pv_header->user_status = pv_header->nb_data = 0;
 
-    return (
-	rid_is_valid(             pv_dlf, rid)            &&
-	datalogfile_record_header(pv_dlf, rid, pv_header) &&
-	record_header.nb_data <= buffer_size              &&
-	sdcard_fread(            &pv_dlf->file, pu8_data, pv_header->nb_data)) ?
-	    pu8_data : NULL;
+    TRACE_BEGIN(TRACE_ID_DATALOG_READ);
+    ok = rid_is_valid(             pv_dlf, rid)            &&
+	 datalogfile_record_header(pv_dlf, rid, pv_header) &&
+	 record_header.nb_data <= buffer_size              &&
+	 sdcard_fread(            &pv_dlf->file, pu8_data, pv_header->nb_data);
+    TRACE_END(  TRACE_ID_DATALOG_READ);
+
+    return ok ? pu8_data : NULL;
   }
 
   /**
@@ -20,6 +20,9 @@ extern "C" {
 
 #ifndef DATALOG_FILENAME_SIZE_MAX
 #define DATALOG_FILENAME_SIZE_MAX  100
+#endif
+#ifndef DATALOG_LINKMAP_SIZE
+#define DATALOG_LINKMAP_SIZE       16  // The size of the cluster link map used for fast seeks. Enough for 7 fragments.
 #endif
 
 
@@ -87,6 +90,7 @@ extern "C" {
       File              file;                                   ///< The file object.
       uint32_t          file_size;                              ///< The file's size.
       DataLogFileHeader header;                                 ///< The datalog's header.
+      DWORD             linkmap[DATALOG_LINKMAP_SIZE];          ///< The file's cluster link map, for fast seeks.
     }
     DataLogFile;
 
@@ -126,6 +130,8 @@ extern "C" {
 								  DataLogFileRecordId         rid);
     extern DataLogFileRecordId datalogfile_previous_record(       DataLogFile                *pv_dlf,
 								  DataLogFileRecordId         rid);
+    extern uint32_t            datalogfile_nb_records_from(       DataLogFile                *pv_dlf,
+								  DataLogFileRecordId         rid);
     extern uint8_t *           datalogfile_record_data(           DataLogFile                *pv_dlf,
 								  DataLogFileRecordId         rid,
 								  uint8_t                    *pu8_data,
@@ -5,6 +5,8 @@
 #include "rtc.h"
 #include "connecsens.hpp"
 #include "logger.h"
+#include "trace.h"
+#include "perfcounters.h"
 
 
 #define VECT_TAB_OFFSET  0x20000  // Take into account bootloader
@@ -20,12 +22,13 @@ static ConnecSenS _env;
 
 int main(void)
 {
-  bool     res, res_previous;
-  uint32_t refMs;
+  bool res, res_previous;
 
   HAL_Init();
   pwrclk_init();
   rtc_init();
+  trace_init();
+  perfcounters_init();
 
   // De-activate systick
   SysTick->CTRL &= ~(SysTick_CTRL_TICKINT_Msk | SysTick_CTRL_ENABLE_Msk);
@@ -57,11 +60,9 @@ int main(void)
 	// Some interruptions can wake us up quite often, for example when receiving
 	// data from UART where we may get an interruption per data byte.
 	// So do not be eager to go to sleep, let's have a dry run.
-	// We'll sleep not so deep for a little while and if we have not been woken up during
+	// We'll idle for a little while and if we have not been woken up during
 	// that time, then we'll go to deeper sleep
-	refMs = board_ms_now();
-	pwrclk_sleep_ms_max(200);
-	if(!board_is_timeout(refMs, 200)) { continue; }  // Do not go to sleep.
+	if(pwrclk_idle_ms(200) != PWRCLK_WAKE_REASON_TIMEOUT) { continue; }  // Do not go to sleep.
 
 	while(_env.process());  // To be sure that there is nothing left to do.
 
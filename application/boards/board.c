@@ -11,6 +11,8 @@
 #include "cnssint_c_connector.h"
 #include "rtc.h"
 #include "sdcard.h"
+#include "trace.h"
+#include "perfcounters.h"
 
 #ifdef __cplusplus
 extern "C" {
@@ -198,6 +200,7 @@ extern "C" {
   void board_watchdog_reset(void)
   {
     HAL_IWDG_Refresh(&hiwdg);
+    perfcounters_watchdog_refreshed();
   }
 
 
@@ -270,6 +273,7 @@ extern "C" {
     HAL_GPIO_Init(pv_enable_port, &init);
 
     state = (HAL_GPIO_ReadPin(pv_state_port, state_pin) == GPIO_PIN_SET);
+    TRACE_STATE(TRACE_ID_POWER, ((uint16_t)pv_info->id_flag << 8) | enable);
     if(state != enable)
     {
       log_debug(logger, "Turning %s's power supply %s...", pv_info->ps_name, ps_state);
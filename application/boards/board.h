@@ -232,6 +232,14 @@ extern "C" {
 #define ADC_BATV_ADC_CHANNEL_ID    3
 #define ADC_REFINT_ADC_ID          1
 #define ADC_REFINT_ADC_CHANNEL_ID  0
+#define ADC_DMA_NUM                1  // Used by ADC1's scan sequences
+#define ADC_DMA_CHANNEL_NUM        1
+#define ADC_DMA_REQUEST            DMA_REQUEST_0
+
+
+  //==================== Pulse counter ===========================
+#define PULSE_COUNTER_GPIO     ADC_ANA1_GPIO    // LPTIM1_IN1
+#define PULSE_COUNTER_GPIO_AF  GPIO_AF1_LPTIM1
 
 
   //==================== GPIO pins on extension port =============
@@ -322,6 +330,10 @@ extern void board_sdi12_init(void);
 #define LORA_DIO3_GPIO         GPIO_PC4
 #define LORA_PWR_GPIO          GPIO_PF11
 #define LORA_PWR_LEVEL_FOR_ON  HIGH
+#define LORA_SPI_DMA_NUM             1
+#define LORA_SPI_DMA_RX_CHANNEL_NUM  2
+#define LORA_SPI_DMA_TX_CHANNEL_NUM  3
+#define LORA_SPI_DMA_REQUEST         DMA_REQUEST_1
 
 
 //=================== GPS configuration ======================
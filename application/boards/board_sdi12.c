@@ -126,25 +126,27 @@ extern "C" {
     sdi12_timer_init(&p_uart->timer);
 #endif
 
-    // Set the UART clock
+    // Set the UART clock.
+    // Use the HSI16, that the clock configurations keep on, so that the baudrate does not depend
+    // on the system clock; it can be slowed down while waiting for the sensors.
 #if   SDI12_UART == 1
-    RCC->CCIPR      &= ~RCC_CCIPR_USART3SEL_Msk;   // Set PCLK as the UART's clock.
+    RCC->CCIPR       = (RCC->CCIPR & ~RCC_CCIPR_USART1SEL_Msk) | RCC_CCIPR_USART1SEL_1;  // Set HSI16 as the UART's clock.
     RCC->APB2ENR    |=  RCC_APB2ENR_USART1EN;      // Enable the UART clock.
     RCC->APB2SMENR  &= ~RCC_APB2SMENR_USART1SMEN;  // Clock gating during sleep and stop modes.
 #elif SDI12_UART == 2
-    RCC->CCIPR      &= ~RCC_CCIPR_USART2SEL_Msk;   // Set PCLK as the UART's clock.
+    RCC->CCIPR       = (RCC->CCIPR & ~RCC_CCIPR_USART2SEL_Msk) | RCC_CCIPR_USART2SEL_1;  // Set HSI16 as the UART's clock.
     RCC->APB1ENR1   |=  RCC_APB1ENR1_USART2EN;     // Enable the UART clock.
     RCC->APB1SMENR1 &= ~RCC_APB1SMENR1_USART2SMEN; // Clock gating during sleep and stop modes.
 #elif SDI12_UART == 3
-    RCC->CCIPR      &= ~RCC_CCIPR_USART3SEL_Msk;   // Set PCLK as the UART's clock.
+    RCC->CCIPR       = (RCC->CCIPR & ~RCC_CCIPR_USART3SEL_Msk) | RCC_CCIPR_USART3SEL_1;  // Set HSI16 as the UART's clock.
     RCC->APB1ENR1   |=  RCC_APB1ENR1_USART3EN;     // Enable the UART clock.
     RCC->APB1SMENR1 &= ~RCC_APB1SMENR1_USART3SMEN; // Clock gating during sleep and stop modes.
 #elif SDI12_UART == 4
-    RCC->CCIPR      &= ~RCC_CCIPR_UART4SEL_Msk;    // Set PCLK as the UART's clock.
+    RCC->CCIPR       = (RCC->CCIPR & ~RCC_CCIPR_UART4SEL_Msk) | RCC_CCIPR_UART4SEL_1;    // Set HSI16 as the UART's clock.
     RCC->APB1ENR1   |=  RCC_APB1ENR1_UART4EN;      // Enable the UART clock.
     RCC->APB1SMENR1 &= ~RCC_APB1SMENR1_UART4SMEN;  // Clock gating during sleep and stop modes.
 #elif SDI12_UART == 5
-    RCC->CCIPR      &= ~RCC_CCIPR_UART5SEL_Msk;    // Set PCLK as the UART's clock.
+    RCC->CCIPR       = (RCC->CCIPR & ~RCC_CCIPR_UART5SEL_Msk) | RCC_CCIPR_UART5SEL_1;    // Set HSI16 as the UART's clock.
     RCC->APB1ENR1   |=  RCC_APB1ENR1_UART5EN;      // Enable the UART clock.
     RCC->APB1SMENR1 &= ~RCC_APB1SMENR1_UART5SMEN;  // Clock gating during sleep and stop modes.
 #endif
@@ -159,11 +161,7 @@ extern "C" {
     p_uart->p_regs->CR1  =  USART_CR1_PCE;    // 7 bits + even parity (so 8 bits for STM32's UART), 16x oversampling.
     p_uart->p_regs->CR2  =  USART_CR2_TXINV;  // LSB first, 1 stop bit, use inverse logic (1=L, 0=H) for TX.
     p_uart->p_regs->CR3  =  0x00000000;
-#if SDI12_UART == 1
-    p_uart->p_regs->BRR  = (uint16_t)(pwrclk_clock_frequency_hz(PWRCLK_CLOCK_PCLK2) / SDI12_UART_BAUDRATE);  // This formula because 16x oversampling;
-#else
-    p_uart->p_regs->BRR  = (uint16_t)(pwrclk_clock_frequency_hz(PWRCLK_CLOCK_PCLK1) / SDI12_UART_BAUDRATE);  // This formula because 16x oversampling
-#endif
+    p_uart->p_regs->BRR  = (uint16_t)(pwrclk_clock_frequency_hz(PWRCLK_CLOCK_HSI16) / SDI12_UART_BAUDRATE);  // This formula because 16x oversampling
   }
 
   /**
@@ -305,6 +303,8 @@ extern "C" {
 #ifdef SDI12_USE_DMA
     // TODO: implement me. use DMA to send data.
 #else
+    // The CPU only waits for the UART; let the clocks slow down.
+    pwrclk_io_wait_begin();
     for(; len; len--, pu8_data++)
     {
       // Wait for the transmission buffer to be empty
@@ -316,6 +316,7 @@ extern "C" {
 
     // Wait for end of transmission
     while(!(p_uart->p_regs->ISR & USART_ISR_TC)) /* Do nothing */;
+    pwrclk_io_wait_end();
 
     // Transmission is done; it's time to call the callback function
     if(cb) { cb(pv_cbargs); }
@@ -362,6 +363,8 @@ extern "C" {
     p_uart->p_regs->CR1 |= USART_CR1_RE; // Enable reception.
 
     // Wait for a data byte to arrive and process it.
+    // The CPU mostly waits for the sensor; let the clocks slow down.
+    pwrclk_io_wait_begin();
     while(board_sdi12_uart_is_enabled(p_uart))
     {
       // Wait for a data byte
@@ -378,6 +381,7 @@ extern "C" {
       }
       else { break; } // The UART has been disabled, or timeout; stop receiving.
     }
+    pwrclk_io_wait_end();
 
     return ok;
   }
@@ -13,7 +13,8 @@ extern "C" {
 #endif
 
 
-#define DATA_TYPE_ACCELERATION_3DG_ID  0x0D
+#define DATA_TYPE_ACCELERATION_3DG_ID        0x0D
+#define DATA_TYPE_ACCELERATION_3DG_STATS_ID  0x25
 
 #define ACCEL_G_STEP  0.001f
 
@@ -47,6 +48,53 @@ extern "C" {
   }
 
 
+  /**
+   * Writes a Acceleration3DGStats Data Type to a frame.
+   *
+   * The values are written in the following order: X, Y and Z minimums, X, Y and Z maximums,
+   * X, Y and Z RMS values, the number of samples and the number of peaks.
+   *
+   * @param[in,out] pv_frame   the data frame to write to. MUST be NOT NULL. MUST have been initialised.
+   * @param[in]     pf_min_g   the minimum accelerations, in G, along the X, Y and Z axis. MUST be NOT NULL.
+   * @param[in]     pf_max_g   the maximum accelerations, in G, along the X, Y and Z axis. MUST be NOT NULL.
+   * @param[in]     pf_rms_g   the RMS accelerations, in G, along the X, Y and Z axis. MUST be NOT NULL.
+   * @param[in]     nb_samples the number of samples the statistics have been computed from.
+   * @param[in]     nb_peaks   the number of samples that have been detected as peaks.
+   *
+   * @return true  on success.
+   * @return false otherwise.
+   */
+  bool cnssrf_dt_acceleration_write_3dg_stats_to_frame(CNSSRFDataFrame *pv_frame,
+						       const float     *pf_min_g,
+						       const float     *pf_max_g,
+						       const float     *pf_rms_g,
+						       uint16_t         nb_samples,
+						       uint16_t         nb_peaks)
+  {
+    CNSSRFValue values[11];
+    uint8_t     i;
+
+    for(i = 0; i < 3; i++)
+    {
+      values[i    ].type        = CNSSRF_VALUE_TYPE_INT16;
+      values[i    ].value.int16 = (int16_t)(pf_min_g[i] / ACCEL_G_STEP);
+      values[i + 3].type        = CNSSRF_VALUE_TYPE_INT16;
+      values[i + 3].value.int16 = (int16_t)(pf_max_g[i] / ACCEL_G_STEP);
+      values[i + 6].type        = CNSSRF_VALUE_TYPE_INT16;
+      values[i + 6].value.int16 = (int16_t)(pf_rms_g[i] / ACCEL_G_STEP);
+    }
+    values[ 9].type         = CNSSRF_VALUE_TYPE_UINT16;
+    values[ 9].value.uint16 = nb_samples;
+    values[10].type         = CNSSRF_VALUE_TYPE_UINT16;
+    values[10].value.uint16 = nb_peaks;
+
+    return cnssrf_data_type_write_values_to_frame(pv_frame,
+						  DATA_TYPE_ACCELERATION_3DG_STATS_ID,
+						  values, 11,
+						  CNSSRF_META_DATA_FLAG_NONE);
+  }
+
+
 #ifdef __cplusplus
 }
 #endif
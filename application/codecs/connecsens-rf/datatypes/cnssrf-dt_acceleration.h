@@ -15,6 +15,12 @@ extern "C" {
 
 
   bool cnssrf_dt_acceleration_write_3dg_to_frame(CNSSRFDataFrame *pv_frame, float xg, float yg, float zg);
+  bool cnssrf_dt_acceleration_write_3dg_stats_to_frame(CNSSRFDataFrame *pv_frame,
+						       const float     *pf_min_g,
+						       const float     *pf_max_g,
+						       const float     *pf_rms_g,
+						       uint16_t         nb_samples,
+						       uint16_t         nb_peaks);
 
 
 #ifdef __cplusplus
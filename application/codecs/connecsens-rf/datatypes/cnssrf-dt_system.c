@@ -18,6 +18,10 @@
 #define RESET_SOURCE_ID_MIN        0x1
 #define RESET_SOURCE_ID_MAX        0x9
 
+#define COUNTERS_DATA_TYPE_ID      0x2D
+#define COUNTERS_NB_VALUES         (10 + CNSSRF_DT_SYS_COUNTERS_NB_DATARATES)
+#define COUNTERS_TX_UNIT_MS        10    ///< The unit of the transmission times, in milliseconds.
+
 
 
 #ifdef __cplusplus
@@ -98,6 +102,80 @@ extern "C" {
 	CNSSRF_META_DATA_FLAG_NONE);
   }
 
+
+  /**
+   * Set a value with an unsigned type, saturating it to the type's maximum.
+   *
+   * @param[out] pv_value the value to set. MUST be NOT NULL.
+   * @param[in]  type     the value's type. One of the CNSSRF_VALUE_TYPE_UINTx types.
+   * @param[in]  v        the value.
+   */
+  static void cnssrf_dt_system_set_saturated(CNSSRFValue *pv_value, CNSSRFValueType type, uint32_t v)
+  {
+    pv_value->type = type;
+    switch(type)
+    {
+      case CNSSRF_VALUE_TYPE_UINT8:
+	pv_value->value.uint8  = v > UINT8_MAX  ? UINT8_MAX  : (uint8_t)v;
+	break;
+      case CNSSRF_VALUE_TYPE_UINT16:
+	pv_value->value.uint16 = v > UINT16_MAX ? UINT16_MAX : (uint16_t)v;
+	break;
+      case CNSSRF_VALUE_TYPE_UINT24:
+	pv_value->value.uint24 = v > 0xFFFFFF   ? 0xFFFFFF   : v;
+	break;
+      default:
+	pv_value->value.uint32 = v;
+	break;
+    }
+  }
+
+  /**
+   * Write a RuntimeCounters Data Type to a frame.
+   *
+   * The values are, in order:
+   * wakeups (uint16), awake time (uint24, ms), SD card bytes written (uint16, KiB),
+   * SD card synchronisations (uint16), radio transmission time for each datarate from DR0
+   * (uint16 each, 10 ms), retransmissions (uint8), SDI-12 bus time (uint24, ms),
+   * datalog backlog (uint16, records), watchdog near misses (uint8), sensor interruptions dispatched (uint16)
+   * and the sum of their dispatch latencies (uint24, ms).
+   * Values too big for their type are saturated.
+   *
+   * @param[in,out] pv_frame    The data frame to write to. MUST be NOT NULL. MUST have been initialised.
+   * @param[in]     pv_counters The counters. MUST be NOT NULL.
+   *
+   * @return true  on success.
+   * @return false otherwise.
+   */
+  bool cnssrf_dt_system_write_counters(CNSSRFDataFrame              *pv_frame,
+				       const CNSSRFDTSystemCounters *pv_counters)
+  {
+    CNSSRFValue values[COUNTERS_NB_VALUES];
+    uint8_t     i, n = 0;
+
+    cnssrf_dt_system_set_saturated(&values[n++], CNSSRF_VALUE_TYPE_UINT16, pv_counters->nb_wakeups);
+    cnssrf_dt_system_set_saturated(&values[n++], CNSSRF_VALUE_TYPE_UINT24, pv_counters->awake_ms);
+    cnssrf_dt_system_set_saturated(&values[n++], CNSSRF_VALUE_TYPE_UINT16, pv_counters->sd_bytes_written / 1024);
+    cnssrf_dt_system_set_saturated(&values[n++], CNSSRF_VALUE_TYPE_UINT16, pv_counters->sd_nb_syncs);
+    for(i = 0; i < CNSSRF_DT_SYS_COUNTERS_NB_DATARATES; i++)
+    {
+      cnssrf_dt_system_set_saturated(&values[n++], CNSSRF_VALUE_TYPE_UINT16,
+				     pv_counters->tx_ms[i] / COUNTERS_TX_UNIT_MS);
+    }
+    cnssrf_dt_system_set_saturated(&values[n++], CNSSRF_VALUE_TYPE_UINT8,  pv_counters->tx_nb_retries);
+    cnssrf_dt_system_set_saturated(&values[n++], CNSSRF_VALUE_TYPE_UINT24, pv_counters->sdi12_ms);
+    cnssrf_dt_system_set_saturated(&values[n++], CNSSRF_VALUE_TYPE_UINT16, pv_counters->datalog_backlog);
+    cnssrf_dt_system_set_saturated(&values[n++], CNSSRF_VALUE_TYPE_UINT8,  pv_counters->watchdog_near_misses);
+    cnssrf_dt_system_set_saturated(&values[n++], CNSSRF_VALUE_TYPE_UINT16, pv_counters->nb_interruptions);
+    cnssrf_dt_system_set_saturated(&values[n++], CNSSRF_VALUE_TYPE_UINT24, pv_counters->int_latency_ms);
+
+    return cnssrf_data_type_write_values_to_frame(
+	pv_frame,
+	COUNTERS_DATA_TYPE_ID,
+	values, n,
+	CNSSRF_META_DATA_FLAG_NONE);
+  }
+
 #ifdef __cplusplus
 }
 #endif
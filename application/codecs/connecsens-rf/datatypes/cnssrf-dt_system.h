@@ -40,6 +40,31 @@ extern "C" {
   extern bool cnssrf_dt_system_write_reset_source(CNSSRFDataFrame            *pv_frame,
 						  CNSSRFDTSystemResetSourceId source_id);
 
+#define CNSSRF_DT_SYS_COUNTERS_NB_DATARATES  6  ///< The number of datarates the transmission time is given for.
+
+  /**
+   * Defines the runtime counters written by cnssrf_dt_system_write_counters().
+   * The values are given in their base units; they are scaled and saturated when written.
+   */
+  typedef struct CNSSRFDTSystemCounters
+  {
+    uint32_t nb_wakeups;                                 ///< Number of wakeups.
+    uint32_t awake_ms;                                   ///< Time spent awake, in milliseconds.
+    uint32_t sd_bytes_written;                           ///< Bytes written to the SD card.
+    uint32_t sd_nb_syncs;                                ///< Number of SD card files synchronisations.
+    uint32_t tx_ms[CNSSRF_DT_SYS_COUNTERS_NB_DATARATES]; ///< Radio transmission time per datarate, in milliseconds.
+    uint32_t tx_nb_retries;                              ///< Number of retransmissions.
+    uint32_t sdi12_ms;                                   ///< SDI-12 bus busy time, in milliseconds.
+    uint32_t datalog_backlog;                            ///< Number of datalog records that may hold unsent data.
+    uint32_t watchdog_near_misses;                       ///< Number of watchdog refreshes close to the timeout.
+    uint32_t nb_interruptions;                           ///< Number of sensor interruptions dispatched.
+    uint32_t int_latency_ms;                             ///< Sum of the sensor interruptions' dispatch latencies, in milliseconds.
+  }
+  CNSSRFDTSystemCounters;
+
+  extern bool cnssrf_dt_system_write_counters(CNSSRFDataFrame              *pv_frame,
+					      const CNSSRFDTSystemCounters *pv_counters);
+
 #ifdef __cplusplus
 }
 #endif
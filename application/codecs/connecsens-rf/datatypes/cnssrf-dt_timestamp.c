@@ -13,7 +13,8 @@ extern "C" {
 #endif
 
 
-#define DATA_TYPE_ID  0x00
+#define DATA_TYPE_ID     0x00
+#define DATA_TYPE_MS_ID  0x2E  ///< TimestampUTCMs
 
 
   /**
@@ -56,6 +57,52 @@ extern "C" {
   }
 
 
+  /**
+   * Write a TimestampUTCMs Data Type to a frame using a timestamp described as the number of milliseconds
+   * elapsed since 2000/01/01 00:00:00.
+   *
+   * The Data Type holds the number of seconds, as an unsigned 32 bits integer,
+   * followed by the milliseconds, [0..999], as an unsigned 16 bits integer.
+   *
+   * @param[in,out] pv_frame the data frame to write to. MUST be NOT NULL. MUST have been initialised.
+   * @param[in]     ts       the timestamp.
+   *
+   * @return true  on success.
+   * @return false otherwise.
+   */
+  bool cnssrf_dt_timestamp_utc_ms_write_ms_to_frame(CNSSRFDataFrame *pv_frame, ts2000ms_t ts)
+  {
+    CNSSRFValue values[2];
+
+    values[0].type         = CNSSRF_VALUE_TYPE_UINT32;
+    values[0].value.uint32 = (uint32_t)(ts / DT_MS_IN_1SECOND);
+    values[1].type         = CNSSRF_VALUE_TYPE_UINT16;
+    values[1].value.uint16 = (uint16_t)(ts - ((ts2000ms_t)values[0].value.uint32) * DT_MS_IN_1SECOND);
+
+    return cnssrf_data_type_write_values_to_frame(pv_frame,
+						  DATA_TYPE_MS_ID,
+						  values, 2,
+						  pv_frame->current_data_channel == CNSSRF_DATA_CHANNEL_0 ?
+						      CNSSRF_META_DATA_FLAG_GLOBAL :
+						      CNSSRF_META_DATA_FLAG_NONE);
+  }
+
+  /**
+   * Write a TimestampUTCMs Data Type to a frame using a timestamp represented using a Datetime object.
+   *
+   * @param[in,out] pv_frame the data frame to write to. MUST be NOT NULL. MUST have been initialised.
+   * @param[in]     pv_dt    the Datetime object, with the milliseconds in its sub-seconds.
+   *                         MUST be NOT NULL. MUST have been initialised.
+   *
+   * @return true  on success.
+   * @return false otherwise.
+   */
+  bool cnssrf_dt_timestamp_utc_ms_write_datetime_to_frame(CNSSRFDataFrame *pv_frame, const Datetime *pv_dt)
+  {
+    return cnssrf_dt_timestamp_utc_ms_write_ms_to_frame(pv_frame, datetime_to_timestamp_ms_2000(pv_dt));
+  }
+
+
 #ifdef __cplusplus
 }
 #endif
@@ -19,6 +19,9 @@ extern "C" {
   bool cnssrf_dt_timestamp_utc_write_secs_to_frame(    CNSSRFDataFrame *pv_frame, ts2000_t        ts);
   bool cnssrf_dt_timestamp_utc_write_datetime_to_frame(CNSSRFDataFrame *pv_frame, const Datetime *pv_dt);
 
+  bool cnssrf_dt_timestamp_utc_ms_write_ms_to_frame(      CNSSRFDataFrame *pv_frame, ts2000ms_t      ts);
+  bool cnssrf_dt_timestamp_utc_ms_write_datetime_to_frame(CNSSRFDataFrame *pv_frame, const Datetime *pv_dt);
+
 
 #ifdef __cplusplus
 }
@@ -12,16 +12,72 @@ extern "C" {
 #endif
 
 
-#define  DAYS_IN_MONTH_CORRECTION_NORM  ((uint32_t) 0x99AAA0)
-#define  DAYS_IN_MONTH_CORRECTION_LEAP  ((uint32_t) 0x445550)
+/*
+ * The conversions use the closed form days from civil and civil from days algorithms
+ * (see http://howardhinnant.github.io/date_algorithms.html), with years starting on March 1st
+ * so that the leap day is the last day of the year; 1600-03-01 is used as the origin so that
+ * all computations are done with unsigned integers.
+ */
+#define DAYS_IN_400_YEARS        146097u  ///< Number of days in a 400 years era.
+#define DAYS_1600_03_01_TO_2000  146037u  ///< Number of days from 1600-03-01 to 2000-01-01.
+
+/*
+ * The last converted day is cached, packed in a single word so that it is read and written
+ * atomically: the number of days since 2000 in the 16 upper bits, and the date in the 16 lower bits
+ * (years since 2000 on 7 bits, month on 4 bits, day on 5 bits). A date value of 0 is not valid.
+ * Only the years from 2000 to 2127 are cached.
+ */
+#define DAY_CACHE_YEARS_MAX      127u
+#define day_cache_date(year, month, day)  \
+  ((((uint32_t)(year) - 2000u) << 9) | ((uint32_t)(month) << 5) | (uint32_t)(day))
+
 
+  static volatile uint32_t _datetime_day_cache = 0;  ///< The last converted day. See above.
 
-/* Calculates ceiling(X/N) */
-#define DIVC(X, N) (((X) + (N) - 1) / (N))
 
+  /**
+   * Get the number of days since 2000-01-01 for a date.
+   *
+   * @param[in] year  the year. MUST be >= 2000.
+   * @param[in] month the month, [1..12].
+   * @param[in] day   the day of the month, [1..31].
+   *
+   * @return the number of days.
+   */
+  static uint32_t datetime_days_from_civil(uint32_t year, uint32_t month, uint32_t day)
+  {
+    uint32_t era, yoe, doy, doe;
 
-  static uint8_t _datetime_days_in_month_norm_year[12] = { 31, 28, 31, 30, 31, 30, 31, 31, 30, 31, 30, 31 };
-  static uint8_t _datetime_days_in_month_leap_year[12] = { 31, 29, 31, 30, 31, 30, 31, 31, 30, 31, 30, 31 };
+    year -= 1600 + (month <= 2);
+    era   = year / 400;
+    yoe   = year - era * 400;                                   // [0..399]
+    doy   = (153 * (month > 2 ? month - 3 : month + 9) + 2) / 5 + day - 1;  // [0..365]
+    doe   = yoe * 365 + yoe / 4 - yoe / 100 + doy;              // [0..146096]
+
+    return era * DAYS_IN_400_YEARS + doe - DAYS_1600_03_01_TO_2000;
+  }
+
+  /**
+   * Get the date for a number of days since 2000-01-01.
+   *
+   * @param[out] pv_dt where the year, the month and the day are written to. MUST be NOT NULL.
+   * @param[in]  days  the number of days since 2000-01-01.
+   */
+  static void datetime_civil_from_days(Datetime *pv_dt, uint32_t days)
+  {
+    uint32_t era, doe, yoe, doy, mp;
+
+    days += DAYS_1600_03_01_TO_2000;
+    era   = days / DAYS_IN_400_YEARS;
+    doe   = days - era * DAYS_IN_400_YEARS;                           // [0..146096]
+    yoe   = (doe - doe / 1460 + doe / 36524 - doe / 146096) / 365;  // [0..399]
+    doy   = doe - (365 * yoe + yoe / 4 - yoe / 100);                // [0..365]
+    mp    = (5 * doy + 2) / 153;                                    // [0..11], from March
+
+    pv_dt->day   = doy - (153 * mp + 2) / 5 + 1;
+    pv_dt->month = mp < 10 ? mp + 3 : mp - 9;
+    pv_dt->year  = 1600 + era * 400 + yoe + (pv_dt->month <= 2);
+  }
 
 
   /**
@@ -86,24 +142,35 @@ extern "C" {
    */
   ts2000_t datetime_to_timestamp_sec_2000(const Datetime *pv_dt)
   {
-    ts2000_t res;
-    uint32_t correction;
-    uint32_t year = pv_dt->year - 2000;
+    uint32_t days;
+    uint32_t date  = day_cache_date(pv_dt->year, pv_dt->month, pv_dt->day);
+    uint32_t cache = _datetime_day_cache;
 
-    // Calculate amount of elapsed days since 2000/01/01
-    correction = (year % 4) ? DAYS_IN_MONTH_CORRECTION_NORM : DAYS_IN_MONTH_CORRECTION_LEAP;
-    res        = DIVC((DT_DAYS_IN_YEAR  * 3 + DT_DAYS_IN_LEAP_YEAR) * year , 4);
-    res       += DIVC( (((uint32_t)pv_dt->month) - 1) * (30 + 31), 2) -
-	         ((correction >> ((pv_dt->month  - 1) * 2)) & 0x3);
-    res       += pv_dt->day - 1;
+    // Calculate amount of elapsed days since 2000/01/01; usually the same day as the previous conversion.
+    if((cache & 0xFFFF) == date) { days = cache >> 16; }
+    else
+    {
+      days = datetime_days_from_civil(pv_dt->year, pv_dt->month, pv_dt->day);
+      if(pv_dt->year - 2000u <= DAY_CACHE_YEARS_MAX) { _datetime_day_cache = (days << 16) | date; }
+    }
 
     // Convert from days to seconds
-    res       *= DT_SECONDS_IN_1DAY;
-    res       += ((uint32_t)pv_dt->seconds)                         +
-	         ((uint32_t)pv_dt->minutes) * DT_SECONDS_IN_1MINUTE +
-		 ((uint32_t)pv_dt->hours)   * DT_SECONDS_IN_1HOUR;
+    return days                      * DT_SECONDS_IN_1DAY    +
+	   ((uint32_t)pv_dt->hours)   * DT_SECONDS_IN_1HOUR   +
+	   ((uint32_t)pv_dt->minutes) * DT_SECONDS_IN_1MINUTE +
+	   ((uint32_t)pv_dt->seconds);
+  }
 
-    return res;
+  /**
+   * Convert a date and time, including the sub-seconds, to a timestamp in milliseconds since 2000.
+   *
+   * @param[in] pv_dt the date and time. MUST be NOT NULL.
+   *
+   * @return the timestamp.
+   */
+  ts2000ms_t datetime_to_timestamp_ms_2000(const Datetime *pv_dt)
+  {
+    return ts2000ms_from_secs_and_ms(datetime_to_timestamp_sec_2000(pv_dt), pv_dt->sub_seconds);
   }
 
   /**
@@ -116,36 +183,31 @@ extern "C" {
    */
   Datetime *datetime_from_sec_2000(Datetime *pv_dt, ts2000_t ts2000)
   {
-    uint8_t        i, leap_days;
-    uint16_t       days;
-    const uint8_t *days_in_month;
+    uint32_t days  = ts2000 / DT_SECONDS_IN_1DAY;
+    uint32_t secs  = ts2000 - days * DT_SECONDS_IN_1DAY;
+    uint32_t cache = _datetime_day_cache;
 
     pv_dt->sub_seconds = 0;
-    pv_dt->seconds     = ts2000 % 60; ts2000 /= 60;
-    pv_dt->minutes     = ts2000 % 60; ts2000 /= 60;
-    pv_dt->hours       = ts2000 % 24; ts2000 /= 24;
-
-    // ts2000 is now the number of days since 2000. Remember 2000 is a leap year.
-    leap_days   = (ts2000 + DT_DAYS_IN_YEAR * 3 + 1) / (DT_DAYS_IN_YEAR * 3 + DT_DAYS_IN_LEAP_YEAR);
-    pv_dt->year = (ts2000 - leap_days)               /  DT_DAYS_IN_YEAR;
-    ts2000     -= pv_dt->year * DT_DAYS_IN_YEAR + (pv_dt->year + 3) / 4;
-
-    // ts is now the number of days since the start of the year
-    days_in_month = (pv_dt->year % 4) ? _datetime_days_in_month_norm_year : _datetime_days_in_month_leap_year;
-    ts2000       += 1; // Because first day is 1 and not 0.
-    for(i = 0, days = 0; i < 12; days += days_in_month[i], i++)
+    pv_dt->hours       = secs / DT_SECONDS_IN_1HOUR;   secs -= pv_dt->hours   * DT_SECONDS_IN_1HOUR;
+    pv_dt->minutes     = secs / DT_SECONDS_IN_1MINUTE; secs -= pv_dt->minutes * DT_SECONDS_IN_1MINUTE;
+    pv_dt->seconds     = secs;
+
+    // Get the date; usually the same day as the previous conversion.
+    if((cache & 0xFFFF) && (cache >> 16) == days)
     {
-      if(ts2000 <= days + days_in_month[i])
+      pv_dt->year  = 2000 + ((cache >> 9) & 0x7F);
+      pv_dt->month =         (cache >> 5) & 0x0F;
+      pv_dt->day   =          cache       & 0x1F;
+    }
+    else
+    {
+      datetime_civil_from_days(pv_dt, days);
+      if(pv_dt->year - 2000u <= DAY_CACHE_YEARS_MAX)
       {
-	pv_dt->month = i      + 1;
-	pv_dt->day   = ts2000 - days;
-	break;
+	_datetime_day_cache = (days << 16) | day_cache_date(pv_dt->year, pv_dt->month, pv_dt->day);
       }
     }
 
-    // Add year 2000 offset
-    pv_dt->year += 2000;
-
     return pv_dt;
   }
 
@@ -22,6 +22,7 @@ extern "C" {
 #define  DT_SECONDS_IN_1MINUTE ((uint32_t) 60)
 #define  DT_MINUTES_IN_1HOUR   ((uint32_t) 60)
 #define  DT_HOURS_IN_1DAY      ((uint32_t) 24)
+#define  DT_MS_IN_1SECOND      ((uint32_t) 1000)
 
 
 
@@ -46,6 +47,11 @@ extern "C" {
   /// Defines the type for the timestamp expressed in seconds since 2000/01/01 00:00:00
   typedef uint32_t ts2000_t;
 
+  /// Defines the type for the timestamp expressed in milliseconds since 2000/01/01 00:00:00
+  typedef uint64_t ts2000ms_t;
+
+#define ts2000ms_from_secs_and_ms(secs, ms)  (((ts2000ms_t)(secs)) * DT_MS_IN_1SECOND + (ms))
+
 #define datetime_init(pv_dt, _year, _month, _day, _hours, _minutes, _seconds, _sub_seconds)  \
   (pv_dt)->year        = (_year);     \
   (pv_dt)->month       = (_month);    \
@@ -55,15 +61,16 @@ extern "C" {
   (pv_dt)->seconds     = (_seconds);  \
   (pv_dt)->sub_seconds = (_sub_seconds)
 
-  extern void      datetime_clear(       Datetime *pv_dt);
-  extern void      datetime_copy(        Datetime *pv_dest, const Datetime *pv_src);
-  extern bool      datetime_equals(const Datetime *pv_dt1,
-				   const Datetime *pv_dt2,
-				   bool            compare_sub_secs);
-  extern ts2000_t  datetime_to_timestamp_sec_2000(const Datetime *pv_dt);
-  extern Datetime *datetime_from_sec_2000(Datetime *pv_dt, ts2000_t ts2000);
-  extern ts2000_t  datetime_values_to_timestamp_sec_2000(uint16_t year,  uint8_t month,   uint8_t day,
-							 uint8_t  hours, uint8_t minutes, uint8_t seconds);
+  extern void       datetime_clear(       Datetime *pv_dt);
+  extern void       datetime_copy(        Datetime *pv_dest, const Datetime *pv_src);
+  extern bool       datetime_equals(const Datetime *pv_dt1,
+				    const Datetime *pv_dt2,
+				    bool            compare_sub_secs);
+  extern ts2000_t   datetime_to_timestamp_sec_2000(const Datetime *pv_dt);
+  extern ts2000ms_t datetime_to_timestamp_ms_2000( const Datetime *pv_dt);
+  extern Datetime  *datetime_from_sec_2000(Datetime *pv_dt, ts2000_t ts2000);
+  extern ts2000_t   datetime_values_to_timestamp_sec_2000(uint16_t year,  uint8_t month,   uint8_t day,
+							  uint8_t  hours, uint8_t minutes, uint8_t seconds);
 
 
 
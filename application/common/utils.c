@@ -4,6 +4,7 @@
  * @date   2018
  */
 #include <ctype.h>
+#include <stdio.h>
 #include <string.h>
 #include "utils.h"
 
@@ -202,6 +203,325 @@ extern "C" {
     return point_to_end ? pe : ps_dest;
   }
 
+
+  static const uint32_t _utils_pow10[STR_FIXED_DECIMALS_MAX + 1] =
+  {
+      1, 10, 100, 1000, 10000, 100000, 1000000, 10000000, 100000000, 1000000000
+  };
+
+  /**
+   * Write a decimal number, given as its integer and fractional parts, to a string.
+   *
+   * @param[in,out] ps_dest      pointer of the first character to write. MUST be NOT NULL.
+   * @param[in]     negative     write a minus sign?
+   * @param[in]     int_part     the integer part.
+   * @param[in]     frac_part    the fractional part, as an integer; MUST be lower than 10^nb_decimals.
+   * @param[in]     nb_decimals  the number of decimals to write. MUST be <= STR_FIXED_DECIMALS_MAX.
+   * @param[in]     n            the maximum number of characters to write, including the '\0' character.
+   * @param[in]     point_to_end does the returned pointer points to the end of the resulting string or
+   *                             to its beginning?
+   *
+   * @return a pointer to the beginning or the end of the resulting string,
+   *         depending on the value of the <code>point_to_end</code> parameter.
+   * @return an empty string if <code>n</code> is too small for the given value.
+   */
+  static char *strn_decimal_to_string(char    *ps_dest,
+				      bool     negative,
+				      uint32_t int_part,
+				      uint32_t frac_part,
+				      uint8_t  nb_decimals,
+				      uint32_t n,
+				      bool     point_to_end)
+  {
+    uint32_t len, v;
+    char    *pc;
+
+    // Compute the string's length, to check it against n and to write it from its end
+    for(len = 1, v = int_part; v >= 10; v /= 10) { len++; }
+    if(negative)    { len++; }
+    if(nb_decimals) { len += 1 + nb_decimals; }
+    if(len >= n)
+    {
+      *ps_dest = '\0';
+      return ps_dest;
+    }
+
+    pc  = ps_dest + len;
+    *pc = '\0';
+    if(nb_decimals)
+    {
+      for( ; nb_decimals; nb_decimals--)
+      {
+	*--pc      = (frac_part % 10) + '0';
+	frac_part /= 10;
+      }
+      *--pc = '.';
+    }
+    do
+    {
+      *--pc     = (int_part % 10) + '0';
+      int_part /= 10;
+    }
+    while(int_part);
+    if(negative) { *--pc = '-'; }
+
+    return point_to_end ? ps_dest + len : ps_dest;
+  }
+
+  /**
+   * Write "nan", "inf" or "-inf" to a string.
+   *
+   * @param[in,out] ps_dest      pointer of the first character to write. MUST be NOT NULL.
+   * @param[in]     nan          is the value not a number?
+   * @param[in]     negative     is the infinite value negative?
+   * @param[in]     n            the maximum number of characters to write, including the '\0' character.
+   * @param[in]     point_to_end does the returned pointer points to the end of the resulting string or
+   *                             to its beginning?
+   *
+   * @return a pointer to the beginning or the end of the resulting string,
+   *         depending on the value of the <code>point_to_end</code> parameter.
+   * @return an empty string if <code>n</code> is too small.
+   */
+  static char *strn_special_to_string(char *ps_dest, bool nan, bool negative, uint32_t n, bool point_to_end)
+  {
+    const char *ps = nan ? "nan" : negative ? "-inf" : "inf";
+
+    if(strlen(ps) >= n)
+    {
+      *ps_dest = '\0';
+      return ps_dest;
+    }
+    strcpy(ps_dest, ps);
+
+    return point_to_end ? ps_dest + strlen(ps) : ps_dest;
+  }
+
+  /**
+   * Write a value too big for the integer only conversions, using snprintf("%.<nb_decimals>f").
+   *
+   * @param[in,out] ps_dest      pointer of the first character to write. MUST be NOT NULL.
+   * @param[in]     value        the value.
+   * @param[in]     nb_decimals  the number of decimals.
+   * @param[in]     n            the maximum number of characters to write, including the '\0' character.
+   * @param[in]     point_to_end does the returned pointer points to the end of the resulting string or
+   *                             to its beginning?
+   *
+   * @return a pointer to the beginning or the end of the resulting string,
+   *         depending on the value of the <code>point_to_end</code> parameter.
+   * @return an empty string if <code>n</code> is too small for the given value.
+   */
+  static char *strn_big_to_string(char *ps_dest, double value, uint8_t nb_decimals, uint32_t n, bool point_to_end)
+  {
+    int len = snprintf(ps_dest, n, "%.*f", nb_decimals, value);
+
+    if(len < 0 || (uint32_t)len >= n)
+    {
+      if(n) { *ps_dest = '\0'; }
+      return ps_dest;
+    }
+
+    return point_to_end ? ps_dest + len : ps_dest;
+  }
+
+  /**
+   * Converts a fixed point value to a string, using a fixed number of decimals.
+   * Gives the same result as printf("%.<nb_decimals>f", value / 10^nb_decimals),
+   * using only integer operations.
+   *
+   * @param[in,out] ps_dest      pointer of the first character to write. MUST be NOT NULL.
+   * @param[in]     value        the value, multiplied by 10^nb_decimals. For example 1234 with 3 decimals is 1.234.
+   * @param[in]     nb_decimals  the number of decimals. MUST be <= STR_FIXED_DECIMALS_MAX.
+   * @param[in]     n            the maximum number of characters to write, including the '\0' character.
+   * @param[in]     point_to_end does the returned pointer points to the end of the resulting string or
+   *                             to its beginning?
+   *
+   * @return a pointer to the beginning or the end of the resulting string,
+   *         depending on the value of the <code>point_to_end</code> parameter.
+   * @return an empty string if <code>n</code> is too small for the given value.
+   */
+  char *strn_fixed_to_string(char *ps_dest, int32_t value, uint8_t nb_decimals, uint32_t n, bool point_to_end)
+  {
+    uint32_t u = value < 0 ? 0u - (uint32_t)value : (uint32_t)value;
+
+    return strn_decimal_to_string(ps_dest, value < 0,
+				  u / _utils_pow10[nb_decimals], u % _utils_pow10[nb_decimals],
+				  nb_decimals, n, point_to_end);
+  }
+
+  /**
+   * Converts a float value to a string, using a fixed number of decimals.
+   *
+   * Gives the same result as printf("%.<nb_decimals>f", value), including the rounding
+   * of the exact binary value to the nearest, ties to even, and the sign of negative values
+   * rounded to zero. But only integer operations are used: the float is split in its mantissa
+   * and its exponent, so that its exact value is mantissa * 2^-shift.
+   *
+   * @param[in,out] ps_dest      pointer of the first character to write. MUST be NOT NULL.
+   * @param[in]     value        the value.
+   * @param[in]     nb_decimals  the number of decimals. MUST be <= STR_FIXED_DECIMALS_MAX.
+   * @param[in]     n            the maximum number of characters to write, including the '\0' character.
+   * @param[in]     point_to_end does the returned pointer points to the end of the resulting string or
+   *                             to its beginning?
+   *
+   * @return a pointer to the beginning or the end of the resulting string,
+   *         depending on the value of the <code>point_to_end</code> parameter.
+   * @return "nan", "inf" or "-inf" if the value is not a number or is infinite.
+   * @return an empty string if <code>n</code> is too small for the given value.
+   *
+   * @note values of magnitude 2^32 or greater are written by snprintf().
+   */
+  char *strn_float_to_string(char *ps_dest, float value, uint8_t nb_decimals, uint32_t n, bool point_to_end)
+  {
+    union { float f; uint32_t u; } bits;
+    uint32_t mantissa, exponent, int_part, frac_bits, frac_part, shift;
+    uint64_t scaled, rem, half;
+    bool     negative;
+
+    bits.f   = value;
+    negative = (bits.u >> 31) != 0;
+    exponent = (bits.u >> 23) & 0xFF;
+    mantissa =  bits.u & 0x7FFFFF;
+
+    if(exponent == 0xFF)
+    {
+      return strn_special_to_string(ps_dest, mantissa != 0, negative, n, point_to_end);
+    }
+
+    // value = mantissa * 2^(exponent - 150) for normal values, and mantissa * 2^-149 for subnormal ones.
+    if(exponent) { mantissa |= 0x800000; }
+    else         { exponent  = 1;        }
+    if(exponent >= 150)
+    {
+      // No fractional part
+      if(exponent - 150 > 8)
+      {
+	// Too big for the integer part's 32 bits
+	return strn_big_to_string(ps_dest, value, nb_decimals, n, point_to_end);
+      }
+      int_part  = mantissa << (exponent - 150);
+      frac_part = 0;
+    }
+    else
+    {
+      shift     = 150 - exponent;
+      int_part  = shift < 32 ? mantissa >> shift               : 0;
+      frac_bits = shift < 32 ? mantissa & ((1u << shift) - 1) : mantissa;
+
+      // The fractional part is frac_bits / 2^shift; scale it to the number of decimals, then round
+      // to nearest, ties to even. frac_bits < 2^24 and 10^nb_decimals < 2^30 so there is no overflow.
+      frac_part = 0;
+      if(shift < 64)
+      {
+	scaled    = (uint64_t)frac_bits * _utils_pow10[nb_decimals];
+	frac_part = (uint32_t)(scaled >> shift);
+	rem       = scaled & (((uint64_t)1 << shift) - 1);
+	half      = (uint64_t)1 << (shift - 1);
+	if(rem > half || (rem == half && ((nb_decimals ? frac_part : int_part) & 1)))
+	{
+	  if(++frac_part == _utils_pow10[nb_decimals])
+	  {
+	    frac_part = 0;
+	    int_part++;
+	  }
+	}
+      }
+      // else the value is lower than 2^-40, too small to round up even with the maximum number of decimals.
+    }
+
+    return strn_decimal_to_string(ps_dest, negative, int_part, frac_part, nb_decimals, n, point_to_end);
+  }
+
+  /**
+   * Converts a double value to a string, using a fixed number of decimals.
+   *
+   * Gives the same result as printf("%.<nb_decimals>f", value), like strn_float_to_string().
+   * The double's 53 bits mantissa does not leave room for the float's 64 bits scaling, so the
+   * fractional part is kept as a 96 bits fixed point number and the decimals are extracted one by one.
+   *
+   * @param[in,out] ps_dest      pointer of the first character to write. MUST be NOT NULL.
+   * @param[in]     value        the value.
+   * @param[in]     nb_decimals  the number of decimals. MUST be <= STR_FIXED_DECIMALS_MAX.
+   * @param[in]     n            the maximum number of characters to write, including the '\0' character.
+   * @param[in]     point_to_end does the returned pointer points to the end of the resulting string or
+   *                             to its beginning?
+   *
+   * @return a pointer to the beginning or the end of the resulting string,
+   *         depending on the value of the <code>point_to_end</code> parameter.
+   * @return "nan", "inf" or "-inf" if the value is not a number or is infinite.
+   * @return an empty string if <code>n</code> is too small for the given value.
+   *
+   * @note values that round to 2^32 or greater are written by snprintf().
+   */
+  char *strn_double_to_string(char *ps_dest, double value, uint8_t nb_decimals, uint32_t n, bool point_to_end)
+  {
+    union { double d; uint64_t u; } bits;
+    uint64_t mantissa, frac_bits, lo, l0, l1, hi;
+    uint32_t exponent, int_part, frac_part, shift, d;
+    bool     negative;
+
+    bits.d   = value;
+    negative = (bits.u >> 63) != 0;
+    exponent = (bits.u >> 52) & 0x7FF;
+    mantissa =  bits.u & 0xFFFFFFFFFFFFFull;
+
+    if(exponent == 0x7FF)
+    {
+      return strn_special_to_string(ps_dest, mantissa != 0, negative, n, point_to_end);
+    }
+    if(exponent >= 1023 + 32)
+    {
+      // Too big for the integer part's 32 bits
+      return strn_big_to_string(ps_dest, value, nb_decimals, n, point_to_end);
+    }
+
+    // value = mantissa * 2^-shift, with shift >= 21.
+    if(exponent) { mantissa |= 1ull << 52; }
+    else         { exponent  = 1;          }
+    shift     = 1075 - exponent;
+    int_part  = shift < 64 ? (uint32_t)(mantissa >> shift)       : 0;
+    frac_bits = shift < 64 ? mantissa & ((1ull << shift) - 1) : mantissa;
+
+    // The fractional part, frac_bits / 2^shift, as hi:lo / 2^96, hi < 2^32. Below 2^-43 it is too small
+    // to round up even with the maximum number of decimals, and is taken as 0.
+    hi = lo = 0;
+    if(shift <= 96)
+    {
+      d = 96 - shift;
+      if(d >= 64) { hi = frac_bits << (d - 64); }
+      else
+      {
+	lo = frac_bits << d;
+	hi = d ? frac_bits >> (64 - d) : 0;
+      }
+    }
+
+    // Extract the decimals: multiply by 10 and take the integer part, above bit 96.
+    for(frac_part = 0, d = nb_decimals; d; d--)
+    {
+      l0        = (lo & 0xFFFFFFFF) * 10;
+      l1        = (lo >> 32)        * 10 + (l0 >> 32);
+      lo        = (l1 << 32) | (l0 & 0xFFFFFFFF);
+      hi        = hi * 10 + (l1 >> 32);
+      frac_part = frac_part * 10 + (uint32_t)(hi >> 32);
+      hi       &= 0xFFFFFFFF;
+    }
+
+    // Round to nearest, ties to even; the remainder is compared with one half, 2^95.
+    if(hi > 0x80000000u || (hi == 0x80000000u && (lo || ((nb_decimals ? frac_part : int_part) & 1))))
+    {
+      if(++frac_part == _utils_pow10[nb_decimals])
+      {
+	frac_part = 0;
+	if(++int_part == 0)
+	{
+	  return strn_big_to_string(ps_dest, value, nb_decimals, n, point_to_end);
+	}
+      }
+    }
+
+    return strn_decimal_to_string(ps_dest, negative, int_part, frac_part, nb_decimals, n, point_to_end);
+  }
+
   /**
    * Convert a string to an unsigned integer value.
    *
@@ -23,6 +23,9 @@ extern "C" {
 #define str_is_empty(ps)         ((ps)[0] == '\0')
 #define str_is_null_or_empty(ps) (!(ps) || (ps)[0] == '\0')
 
+#define STR_FIXED_DECIMALS_MAX  9   ///< The maximum number of decimals strn_fixed_to_string(), strn_float_to_string() and strn_double_to_string() can write.
+#define STR_FIXED_SIZE_MAX      22  ///< A buffer this size can hold any string written by strn_fixed_to_string(), and by strn_float_to_string() and strn_double_to_string() for magnitudes lower than 2^32.
+
   extern bool     strn_contains_only_digits(const char *ps_str, uint32_t size);
   extern int32_t  strn_nosign_to_uint(      const char *ps_str, uint32_t size);
 
@@ -31,6 +34,12 @@ extern "C" {
   extern char *   strn_uint_to_string(char *ps_dest, uint32_t value, uint32_t n, bool point_to_end);
   extern char *   strn_int_to_string( char *ps_dest, int32_t  value, uint32_t n,
 				      bool add_sign, bool     point_to_end);
+  extern char *   strn_fixed_to_string(char *ps_dest, int32_t value, uint8_t nb_decimals,
+				       uint32_t n, bool point_to_end);
+  extern char *   strn_float_to_string(char *ps_dest, float   value, uint8_t nb_decimals,
+				       uint32_t n, bool point_to_end);
+  extern char *   strn_double_to_string(char *ps_dest, double value, uint8_t nb_decimals,
+					uint32_t n, bool point_to_end);
 
   extern uint32_t strn_string_to_uint(const char *ps_src, uint32_t size, bool *pb_ok);
   extern int32_t  strn_string_to_int( const char *ps_src, uint32_t size, bool *pb_ok);
@@ -0,0 +1,219 @@
+#!/usr/bin/env python3
+"""
+Analyse the execution traces written by the firmware to log/trace.bin.
+
+The firmware must have been built with TRACE_CATEGORIES defined (see Middlewares/Environment/trace.h).
+
+For each wakeup, prints where the awake time went and an estimate of the energy used.
+With --folded, also writes the sections' durations as folded stacks, in microseconds,
+to be turned into a flame graph with flamegraph.pl (https://github.com/brendangregg/FlameGraph):
+
+    tracetool.py trace.bin --folded trace.folded && flamegraph.pl trace.folded > trace.svg
+
+The energy estimate uses the currents given on the command line; the defaults are only
+orders of magnitude and should be replaced with figures measured on the actual hardware.
+"""
+import argparse
+import collections
+import datetime
+import struct
+import sys
+
+# Must match trace.h.
+DUMP_MAGIC   = 0x31435254
+HEADER       = struct.Struct('<IIIHH')   # TraceDumpHeader
+RECORD       = struct.Struct('<IIHBB')   # TraceRecord
+KIND_BEGIN, KIND_END, KIND_STATE = range(3)
+
+NAMES = {
+    0x00: 'process',
+    0x01: 'PeriodicHandler',
+    0x02: 'InterruptHandler',
+    0x03: 'ActionOnSensors',
+    0x04: 'ActionOnNetwork',
+    0x05: 'sleep',
+    0x10: 'datalogfile_open',
+    0x11: 'datalogfile_sync',
+    0x12: 'datalogfile_write_record',
+    0x13: 'datalogfile_record_data',
+    0x20: 'sdcard_fopen',
+    0x21: 'sdcard_fread',
+    0x22: 'sdcard_fwrite',
+    0x23: 'sdcard_fsync',
+    0x30: 'sdi12',
+    0x40: 'LoRaMac Send',
+    0x41: 'radio',
+    0x50: 'power',
+    0x51: 'clock',
+}
+ID_SLEEP, ID_SDI12, ID_RADIO, ID_POWER, ID_CLOCK = 0x05, 0x30, 0x41, 0x50, 0x51
+SDCARD_IDS = (0x20, 0x21, 0x22, 0x23)
+SDI12_STATES = ('idle', 'command', 'service request')
+RADIO_STATES = ('idle', 'tx', 'rx')
+RAILS = {  # BoardPowerFlag: name
+    1 << 1: 'internal',
+    1 << 2: 'external',
+    1 << 3: 'extint',
+}
+
+# Two clocks whose intervals differ by more than this mean that the core was stopped.
+CLOCKS_TOLERANCE_S = 0.002
+
+EPOCH_2000 = datetime.datetime(2000, 1, 1)
+
+
+def read_wakeups(path):
+    """Yield (header, records) for each wakeup block of the trace file."""
+    with open(path, 'rb') as f:
+        data = f.read()
+    pos = 0
+    while pos + HEADER.size <= len(data):
+        magic, ts, clock_hz, nb, dropped = HEADER.unpack_from(data, pos)
+        if magic != DUMP_MAGIC:
+            sys.exit('Invalid block at offset %d.' % pos)
+        pos += HEADER.size
+        records = [RECORD.unpack_from(data, pos + i * RECORD.size) for i in range(nb)]
+        pos += nb * RECORD.size
+        yield (ts, clock_hz, dropped), records
+
+
+def intervals(records, clock_hz):
+    """
+    Yield (record, run_s, wall_s, clock_hz) for each interval between two consecutive records.
+
+    The cycle counter is precise but wraps, and does not count while the core is stopped;
+    the millisecond tick does. The cycle count is used when both agree.
+    The core clock starts at clock_hz and follows the clock configuration changes.
+    """
+    for prev, cur in zip(records, records[1:]):
+        if prev[4] == KIND_STATE and prev[3] == ID_CLOCK:
+            clock_hz = prev[2] * 100000
+        run_s  = ((cur[0] - prev[0]) & 0xFFFFFFFF) / clock_hz
+        wall_s = ((cur[1] - prev[1]) & 0xFFFFFFFF) / 1000.0
+        if abs(run_s - wall_s) <= CLOCKS_TOLERANCE_S:
+            wall_s = run_s
+        elif run_s > wall_s:          # The cycle counter has wrapped.
+            run_s = wall_s
+        yield prev, run_s, wall_s, clock_hz
+
+
+def analyse(header, records, args, folded):
+    ts, clock_hz, dropped = header
+    stack       = []
+    inclusive   = collections.Counter()
+    exclusive   = collections.Counter()
+    counts      = collections.Counter()
+    states      = collections.Counter()
+    rails_on    = set()
+    radio       = 0
+    sdi12       = 0
+    sd_active   = False
+    energy_mj   = collections.Counter()
+    awake_s     = run_total_s = cycles_total = 0.0
+
+    for rec, run_s, wall_s, cur_hz in intervals(records, clock_hz):
+        cycles, ms, arg, rid, kind = rec
+        if kind == KIND_BEGIN:
+            stack.append(rid)
+            counts[rid] += 1
+        elif kind == KIND_END and rid in stack:
+            while stack.pop() != rid:
+                pass
+        elif kind == KIND_STATE:
+            if rid == ID_RADIO:
+                radio = arg
+            elif rid == ID_POWER:
+                rail = RAILS.get(arg >> 8, hex(arg >> 8))
+                (rails_on.add if arg & 0xFF else rails_on.discard)(rail)
+            elif rid == ID_SDI12:
+                sdi12 = arg
+            elif rid == ID_SLEEP:
+                break
+        sd_active = any(i in SDCARD_IDS for i in stack)
+
+        # Time
+        awake_s     += wall_s
+        run_total_s += run_s
+        cycles_total += run_s * cur_hz
+        for i in set(stack):
+            inclusive[i] += wall_s
+        if stack:
+            exclusive[stack[-1]] += wall_s
+        states['radio ' + RADIO_STATES[min(radio, 2)]] += wall_s
+        states['sdi12 ' + SDI12_STATES[min(sdi12, 2)]] += wall_s
+        if folded is not None and wall_s > 0:
+            path = ';'.join(['wake'] + [NAMES.get(i, hex(i)) for i in stack])
+            folded[path] += wall_s * 1e6
+
+        # Energy: current in mA times duration in s gives mC; times V gives mJ.
+        v = args.vbat
+        energy_mj['mcu run']   += v * args.mcu_ua_per_mhz * cur_hz / 1e6 / 1000.0 * run_s
+        energy_mj['mcu sleep'] += v * args.mcu_sleep_ma * (wall_s - run_s)
+        for rail in rails_on:
+            energy_mj['rail ' + rail] += v * args.rail.get(rail, 0.0) * wall_s
+        if radio:
+            energy_mj['radio ' + RADIO_STATES[min(radio, 2)]] += \
+                v * (args.radio_tx_ma if radio == 1 else args.radio_rx_ma) * wall_s
+        if sd_active:
+            energy_mj['sd card'] += v * args.sd_ma * wall_s
+
+    when = EPOCH_2000 + datetime.timedelta(seconds=ts)
+    print('Wakeup %s: %.1f ms awake, %.1f ms running at %.1f MHz on average, %d records%s.' %
+          (when.isoformat(' '), awake_s * 1e3, run_total_s * 1e3,
+           (cycles_total / run_total_s if run_total_s else clock_hz) / 1e6, len(records),
+           ', %d dropped' % dropped if dropped else ''))
+    for rid, t in inclusive.most_common():
+        print('  %-26s %5dx %10.3f ms  (self %10.3f ms)' %
+              (NAMES.get(rid, hex(rid)), counts[rid], t * 1e3, exclusive[rid] * 1e3))
+    for name, t in sorted(states.items()):
+        if t and not name.endswith('idle'):
+            print('  %-26s       %10.3f ms' % (name, t * 1e3))
+    total = sum(energy_mj.values())
+    print('  Energy: %.3f mJ (%s)' %
+          (total, ', '.join('%s %.3f' % (k, e) for k, e in energy_mj.most_common() if e)))
+    return total
+
+
+def rail_arg(s):
+    name, _, ma = s.partition('=')
+    if name not in RAILS.values():
+        raise argparse.ArgumentTypeError('unknown rail: %s; use one of %s' % (name, ', '.join(RAILS.values())))
+    return name, float(ma)
+
+
+def main():
+    parser = argparse.ArgumentParser(description=__doc__.split('\n\n')[1],
+                                     formatter_class=argparse.RawDescriptionHelpFormatter)
+    parser.add_argument('trace', help='the trace file, log/trace.bin on the SD card')
+    parser.add_argument('--folded', help='write the folded stacks to this file')
+    parser.add_argument('--vbat', type=float, default=3.6, help='battery voltage, in V (%(default)s)')
+    parser.add_argument('--mcu-ua-per-mhz', type=float, default=120.0,
+                        help='MCU run current, in uA/MHz (%(default)s)')
+    parser.add_argument('--mcu-sleep-ma', type=float, default=0.1,
+                        help='MCU current while waiting in low-power mode, in mA (%(default)s)')
+    parser.add_argument('--radio-tx-ma', type=float, default=28.0, help='radio TX current, in mA (%(default)s)')
+    parser.add_argument('--radio-rx-ma', type=float, default=11.0, help='radio RX current, in mA (%(default)s)')
+    parser.add_argument('--sd-ma', type=float, default=20.0,
+                        help='SD card current during file operations, in mA (%(default)s)')
+    parser.add_argument('--rail', type=rail_arg, action='append', default=[], metavar='NAME=MA',
+                        help='current drawn from a power rail when it is on, in mA; rails: %s' %
+                        ', '.join(RAILS.values()))
+    args = parser.parse_args()
+    args.rail = dict([('internal', 1.0), ('external', 5.0), ('extint', 1.0)] + args.rail)
+
+    folded = collections.Counter() if args.folded else None
+    nb, total = 0, 0.0
+    for header, records in read_wakeups(args.trace):
+        total += analyse(header, records, args, folded)
+        nb    += 1
+    if nb:
+        print('%d wakeups, %.3f mJ on average.' % (nb, total / nb))
+
+    if folded is not None:
+        with open(args.folded, 'w') as f:
+            for path, us in sorted(folded.items()):
+                f.write('%s %d\n' % (path, round(us)))
+
+
+if __name__ == '__main__':
+    main()
@@ -0,0 +1,181 @@
+/**
+ * Checks the ADC scan statistics and calibration cache used by SensorADC,
+ * Drivers/Sensors/sensor_adc_stats.cpp:
+ *  - each line's values are taken from its rank in the interleaved scan sequences;
+ *  - the average is rounded to the nearest millivolt, and the peak to peak noise truncated,
+ *    against double precision computations on random sequences;
+ *  - full scale values do not overflow with the largest number of sequences;
+ *  - a calibration factor is returned until it reaches its maximum age, including across
+ *    the 2^32 seconds wrap around, and not if the RTC has been set back before it;
+ *  - a renewed factor reuses its ADC's entry, and a factor is not stored when the cache is full.
+ *
+ * @date   2019
+ */
+#include <stdio.h>
+#include <math.h>
+#include "sensor_adc_stats.hpp"
+
+
+#define ADCSTATSTEST_VREF_MV      3300  ///< VDDA_VOLTAGE_MV
+#define ADCSTATSTEST_NB_SEQUENCES 4     ///< SENSOR_ADC_NB_SEQUENCES
+#define ADCSTATSTEST_MAX_AGE_SEC  86400 ///< SENSOR_ADC_CALIBRATION_MAX_AGE_SEC
+#define ADCSTATSTEST_NB_RANKS     3
+#define ADCSTATSTEST_NB_RANDOM    100000
+
+
+static uint32_t _nb_failed;
+static uint64_t _rand_state = 0x41444331;
+
+
+static void check(const char *ps_what, bool ok)
+{
+  printf("%s  %s\n", ok ? "ok  " : "FAIL", ps_what);
+  if(!ok) { _nb_failed++; }
+}
+
+static uint32_t next_rand(void)
+{
+  _rand_state = _rand_state * 6364136223846793005ull + 1442695040888963407ull;
+  return (uint32_t)(_rand_state >> 33);
+}
+
+/**
+ * Check the statistics of random scan sequences, for each rank and several numbers of sequences,
+ * against double precision computations.
+ */
+static void check_random(uint32_t vref_mv)
+{
+  static const uint8_t nb_sequences[] = { 1, 2, ADCSTATSTEST_NB_SEQUENCES, 16, 255 };
+  uint16_t             samples[255 * ADCSTATSTEST_NB_RANKS];
+  ADCLineStats         stats;
+  uint32_t             nb_value_errors = 0, nb_noise_errors = 0;
+  char                 what[96];
+
+  for(uint32_t n = 0; n < ADCSTATSTEST_NB_RANDOM; n++)
+  {
+    uint8_t  nb_seq = nb_sequences[n % sizeof(nb_sequences)];
+    uint8_t  rank   = (uint8_t)(n % ADCSTATSTEST_NB_RANKS);
+    uint16_t center = (uint16_t)(next_rand() % (ADC_FULL_SCALE + 1));
+    uint16_t spread = (uint16_t)(next_rand() % 64);
+    uint16_t min    = 0xFFFF, max = 0;
+    double   sum    = 0;
+
+    for(uint16_t i = 0; i < nb_seq * ADCSTATSTEST_NB_RANKS; i++)
+    {
+      int32_t v = center + (int32_t)(next_rand() % (2 * spread + 1)) - spread;
+      samples[i] = (uint16_t)(v < 0 ? 0 : v > ADC_FULL_SCALE ? ADC_FULL_SCALE : v);
+    }
+    for(uint8_t seq = 0; seq < nb_seq; seq++)
+    {
+      uint16_t v = samples[seq * ADCSTATSTEST_NB_RANKS + rank];
+      sum += v;
+      if(v < min) { min = v; }
+      if(v > max) { max = v; }
+    }
+
+    stats.reset();
+    stats.addFromSequences(samples, nb_seq, ADCSTATSTEST_NB_RANKS, rank);
+    if(stats.valueMV(vref_mv) != (uint32_t)floor(sum * vref_mv / (nb_seq * (double)ADC_FULL_SCALE) + 0.5))
+    {
+      nb_value_errors++;
+    }
+    if(stats.noiseMV(vref_mv) != (uint32_t)floor((max - min) * (double)vref_mv / ADC_FULL_SCALE))
+    {
+      nb_noise_errors++;
+    }
+  }
+  snprintf(what, sizeof(what), "random sequences, %u mV reference: averages rounded", (unsigned int)vref_mv);
+  check(what, !nb_value_errors);
+  snprintf(what, sizeof(what), "random sequences, %u mV reference: noises truncated", (unsigned int)vref_mv);
+  check(what, !nb_noise_errors);
+}
+
+static void check_line_stats(void)
+{
+  // Three lines, four sequences; each line has its own pattern.
+  static const uint16_t samples[ADCSTATSTEST_NB_SEQUENCES * ADCSTATSTEST_NB_RANKS] =
+  {
+      1000,    0, 4095,
+      1002,    0, 4095,
+       998,    0, 4095,
+      1004,    1, 4094
+  };
+  ADCLineStats stats;
+
+  check("no sample: 0 mV", !stats.nbSamples() && !stats.valueMV(ADCSTATSTEST_VREF_MV) &&
+	!stats.noiseMV(ADCSTATSTEST_VREF_MV));
+
+  stats.addFromSequences(samples, ADCSTATSTEST_NB_SEQUENCES, ADCSTATSTEST_NB_RANKS, 0);
+  // 4004 * 3300 / (4 * 4095) = 806.67; 6 * 3300 / 4095 = 4.83
+  check("rank 0: its four values only", stats.nbSamples() == ADCSTATSTEST_NB_SEQUENCES);
+  check("rank 0: average rounded up",   stats.valueMV(ADCSTATSTEST_VREF_MV) == 807);
+  check("rank 0: noise truncated",      stats.noiseMV(ADCSTATSTEST_VREF_MV) == 4);
+
+  stats.reset();
+  stats.addFromSequences(samples, ADCSTATSTEST_NB_SEQUENCES, ADCSTATSTEST_NB_RANKS, 1);
+  // 1 * 3300 / (4 * 4095) = 0.20
+  check("rank 1: average rounded down", stats.valueMV(ADCSTATSTEST_VREF_MV) == 0);
+  check("rank 1: noise under 1 mV",     stats.noiseMV(ADCSTATSTEST_VREF_MV) == 0);
+
+  stats.reset();
+  stats.addFromSequences(samples, ADCSTATSTEST_NB_SEQUENCES, ADCSTATSTEST_NB_RANKS, 2);
+  check("rank 2: near full scale", stats.valueMV(ADCSTATSTEST_VREF_MV) == 3300 &&
+	stats.noiseMV(ADCSTATSTEST_VREF_MV) == 0);
+
+  // The largest number of sequences, at full scale, with a 3.5 V reference.
+  stats.reset();
+  for(uint16_t i = 0; i < 255; i++) { stats.add(ADC_FULL_SCALE); }
+  check("255 full scale values: no overflow", stats.valueMV(3500) == 3500);
+  stats.add(0);
+  check("full scale noise", stats.noiseMV(ADCSTATSTEST_VREF_MV) == ADCSTATSTEST_VREF_MV);
+
+  check_random(ADCSTATSTEST_VREF_MV);
+  check_random(1800);
+}
+
+static void check_calibration_cache(void)
+{
+  static const int    adcs[4] = { 0 };  // Only their addresses are used, as the ADCs' identifiers.
+  ADCCalibrationCache cache(ADCSTATSTEST_MAX_AGE_SEC);
+  uint32_t            factor = 0;
+  const uint32_t      t      = 1000000;
+
+  check("empty cache: no factor", !cache.get(&adcs[0], t, &factor));
+
+  check("factor stored", cache.set(&adcs[0], t, 0x41));
+  check("factor returned", cache.get(&adcs[0], t, &factor) && factor == 0x41);
+  check("factor returned just before its maximum age",
+	cache.get(&adcs[0], t + ADCSTATSTEST_MAX_AGE_SEC - 1, &factor) && factor == 0x41);
+  check("factor not returned at its maximum age", !cache.get(&adcs[0], t + ADCSTATSTEST_MAX_AGE_SEC, &factor));
+  check("factor not returned when the RTC has been set back", !cache.get(&adcs[0], t - 1, &factor));
+  check("no factor for another ADC", !cache.get(&adcs[1], t, &factor));
+
+  // Renew the factor; the other ADCs still get their entries.
+  check("factor renewed", cache.set(&adcs[0], t + ADCSTATSTEST_MAX_AGE_SEC, 0x42));
+  check("renewed factor returned",
+	cache.get(&adcs[0], t + 2 * ADCSTATSTEST_MAX_AGE_SEC - 1, &factor) && factor == 0x42);
+  check("second and third ADCs stored", cache.set(&adcs[1], t, 0x51) && cache.set(&adcs[2], t, 0x61));
+  check("fourth ADC not stored, the cache is full", !cache.set(&adcs[3], t, 0x71) &&
+	!cache.get(&adcs[3], t, &factor));
+  check("factors kept per ADC",
+	cache.get(&adcs[0], t + ADCSTATSTEST_MAX_AGE_SEC, &factor) && factor == 0x42 &&
+	cache.get(&adcs[1], t,                            &factor) && factor == 0x51 &&
+	cache.get(&adcs[2], t,                            &factor) && factor == 0x61);
+
+  // Ages wrap around with the 32 bits dates.
+  cache.clear();
+  check("cleared", !cache.get(&adcs[0], t, &factor));
+  cache.set(&adcs[0], UINT32_MAX - 10, 0x43);
+  check("factor returned across the wrap around", cache.get(&adcs[0], 5, &factor) && factor == 0x43);
+  check("factor too old across the wrap around",
+	!cache.get(&adcs[0], ADCSTATSTEST_MAX_AGE_SEC - 11, &factor));
+}
+
+int main(void)
+{
+  check_line_stats();
+  check_calibration_cache();
+
+  printf("%u failure(s).\n", (unsigned int)_nb_failed);
+  return _nb_failed ? 1 : 0;
+}
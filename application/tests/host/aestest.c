@@ -0,0 +1,478 @@
+/**
+ * Checks the LoRaWAN stack's AES and AES-CMAC implementations, in the configuration
+ * built for the firmware, against the FIPS-197 and RFC 4493 test vectors;
+ * and the LoRaWAN 1.0 cryptographic functions of LoRaMacCrypto.c, with their key cache,
+ * against vectors built following the LoRaWAN 1.0.2 specification's definitions
+ * (sections 4.3.3, 4.4 and 6.2.5), computed with OpenSSL's AES-128 and CMAC:
+ *  - join request MIC;
+ *  - join accept decryption and MIC, with and without CFList;
+ *  - session keys derivation;
+ *  - uplink FRMPayload encryption and MIC.
+ *
+ * With --bench, also measures the time taken to secure an uplink, FRMPayload encryption
+ * and MIC, with the key cache and with the keys expanded for each frame as before the cache.
+ *
+ * @date   2019
+ */
+#include <stdint.h>
+#include <stdbool.h>
+#include <stdio.h>
+#include <string.h>
+#include <time.h>
+#include "aes.h"
+#include "cmac.h"
+#include "LoRaMacCrypto.h"
+#if defined(__x86_64__) || defined(__i386__)
+#include <x86intrin.h>
+#define AESTEST_HAS_TSC  1
+#else
+#define AESTEST_HAS_TSC  0
+#endif
+
+
+#define AESTEST_NB_BENCH     200000
+#define AESTEST_UPLINK_SIZE  51      ///< The FRMPayload's size: the largest at SF12 with the EU868 region.
+#define AESTEST_FHDR_SIZE    9       ///< MHDR, DevAddr, FCtrl, FCnt and FPort.
+
+
+/**
+ * Defines a FIPS-197 AES cipher test vector.
+ */
+typedef struct AESTestVector
+{
+  const char   *ps_name;      ///< The vector's reference.
+  uint8_t       key_size;     ///< The key's size, in bytes.
+  const uint8_t key[32];
+  const uint8_t plain[N_BLOCK];
+  const uint8_t cipher[N_BLOCK];
+}
+AESTestVector;
+
+/**
+ * Defines a RFC 4493 AES-CMAC test vector; they all use the same key.
+ */
+typedef struct CMACTestVector
+{
+  const char *ps_name;    ///< The vector's reference.
+  uint32_t    len;        ///< The message's length, in bytes.
+  uint8_t     mac[AES_CMAC_DIGEST_LENGTH];
+}
+CMACTestVector;
+
+
+static const AESTestVector _aes_vectors[] =
+{
+    {
+	"FIPS-197 appendix B", 16,
+	{ 0x2b, 0x7e, 0x15, 0x16, 0x28, 0xae, 0xd2, 0xa6, 0xab, 0xf7, 0x15, 0x88, 0x09, 0xcf, 0x4f, 0x3c },
+	{ 0x32, 0x43, 0xf6, 0xa8, 0x88, 0x5a, 0x30, 0x8d, 0x31, 0x31, 0x98, 0xa2, 0xe0, 0x37, 0x07, 0x34 },
+	{ 0x39, 0x25, 0x84, 0x1d, 0x02, 0xdc, 0x09, 0xfb, 0xdc, 0x11, 0x85, 0x97, 0x19, 0x6a, 0x0b, 0x32 }
+    },
+    {
+	"FIPS-197 appendix C.1 (AES-128)", 16,
+	{ 0x00, 0x01, 0x02, 0x03, 0x04, 0x05, 0x06, 0x07, 0x08, 0x09, 0x0a, 0x0b, 0x0c, 0x0d, 0x0e, 0x0f },
+	{ 0x00, 0x11, 0x22, 0x33, 0x44, 0x55, 0x66, 0x77, 0x88, 0x99, 0xaa, 0xbb, 0xcc, 0xdd, 0xee, 0xff },
+	{ 0x69, 0xc4, 0xe0, 0xd8, 0x6a, 0x7b, 0x04, 0x30, 0xd8, 0xcd, 0xb7, 0x80, 0x70, 0xb4, 0xc5, 0x5a }
+    },
+    {
+	"FIPS-197 appendix C.2 (AES-192)", 24,
+	{ 0x00, 0x01, 0x02, 0x03, 0x04, 0x05, 0x06, 0x07, 0x08, 0x09, 0x0a, 0x0b, 0x0c, 0x0d, 0x0e, 0x0f,
+	  0x10, 0x11, 0x12, 0x13, 0x14, 0x15, 0x16, 0x17 },
+	{ 0x00, 0x11, 0x22, 0x33, 0x44, 0x55, 0x66, 0x77, 0x88, 0x99, 0xaa, 0xbb, 0xcc, 0xdd, 0xee, 0xff },
+	{ 0xdd, 0xa9, 0x7c, 0xa4, 0x86, 0x4c, 0xdf, 0xe0, 0x6e, 0xaf, 0x70, 0xa0, 0xec, 0x0d, 0x71, 0x91 }
+    },
+    {
+	"FIPS-197 appendix C.3 (AES-256)", 32,
+	{ 0x00, 0x01, 0x02, 0x03, 0x04, 0x05, 0x06, 0x07, 0x08, 0x09, 0x0a, 0x0b, 0x0c, 0x0d, 0x0e, 0x0f,
+	  0x10, 0x11, 0x12, 0x13, 0x14, 0x15, 0x16, 0x17, 0x18, 0x19, 0x1a, 0x1b, 0x1c, 0x1d, 0x1e, 0x1f },
+	{ 0x00, 0x11, 0x22, 0x33, 0x44, 0x55, 0x66, 0x77, 0x88, 0x99, 0xaa, 0xbb, 0xcc, 0xdd, 0xee, 0xff },
+	{ 0x8e, 0xa2, 0xb7, 0xca, 0x51, 0x67, 0x45, 0xbf, 0xea, 0xfc, 0x49, 0x90, 0x4b, 0x49, 0x60, 0x89 }
+    }
+};
+
+static const uint8_t _cmac_key[AES_CMAC_KEY_LENGTH] =
+{
+    0x2b, 0x7e, 0x15, 0x16, 0x28, 0xae, 0xd2, 0xa6, 0xab, 0xf7, 0x15, 0x88, 0x09, 0xcf, 0x4f, 0x3c
+};
+static const uint8_t _cmac_message[64] =
+{
+    0x6b, 0xc1, 0xbe, 0xe2, 0x2e, 0x40, 0x9f, 0x96, 0xe9, 0x3d, 0x7e, 0x11, 0x73, 0x93, 0x17, 0x2a,
+    0xae, 0x2d, 0x8a, 0x57, 0x1e, 0x03, 0xac, 0x9c, 0x9e, 0xb7, 0x6f, 0xac, 0x45, 0xaf, 0x8e, 0x51,
+    0x30, 0xc8, 0x1c, 0x46, 0xa3, 0x5c, 0xe4, 0x11, 0xe5, 0xfb, 0xc1, 0x19, 0x1a, 0x0a, 0x52, 0xef,
+    0xf6, 0x9f, 0x24, 0x45, 0xdf, 0x4f, 0x9b, 0x17, 0xad, 0x2b, 0x41, 0x7b, 0xe6, 0x6c, 0x37, 0x10
+};
+static const CMACTestVector _cmac_vectors[] =
+{
+    { "RFC 4493 example 1 (empty)",   0,
+      { 0xbb, 0x1d, 0x69, 0x29, 0xe9, 0x59, 0x37, 0x28, 0x7f, 0xa3, 0x7d, 0x12, 0x9b, 0x75, 0x67, 0x46 } },
+    { "RFC 4493 example 2 (16 bytes)", 16,
+      { 0x07, 0x0a, 0x16, 0xb4, 0x6b, 0x4d, 0x41, 0x44, 0xf7, 0x9b, 0xdd, 0x9d, 0xd0, 0x4a, 0x28, 0x7c } },
+    { "RFC 4493 example 3 (40 bytes)", 40,
+      { 0xdf, 0xa6, 0x67, 0x47, 0xde, 0x9a, 0xe6, 0x30, 0x30, 0xca, 0x32, 0x61, 0x14, 0x97, 0xc8, 0x27 } },
+    { "RFC 4493 example 4 (64 bytes)", 64,
+      { 0x51, 0xf0, 0xbe, 0xbf, 0x7e, 0x3b, 0x9d, 0x92, 0xfc, 0x49, 0x74, 0x17, 0x79, 0x36, 0x3c, 0xfe } }
+};
+
+
+/*
+ * LoRaWAN vectors. The keys and the fields are arbitrary; the multi-byte fields are little endian,
+ * as sent over the air.
+ */
+static const uint8_t  _lw_app_key[16] =
+{
+    0x2b, 0x7e, 0x15, 0x16, 0x28, 0xae, 0xd2, 0xa6, 0xab, 0xf7, 0x15, 0x88, 0x09, 0xcf, 0x4f, 0x3c
+};
+static const uint32_t _lw_dev_addr  = 0x26011BDA;
+static const uint16_t _lw_dev_nonce = 0x5A3C;
+
+/// Join request: MHDR, AppEUI 70B3D57ED0000001, DevEUI 0004A30B001C0530, DevNonce; and its MIC.
+static const uint8_t  _lw_join_request[19] =
+{
+    0x00, 0x01, 0x00, 0x00, 0xd0, 0x7e, 0xd5, 0xb3, 0x70, 0x30, 0x05, 0x1c, 0x00, 0x0b, 0xa3, 0x04,
+    0x00, 0x3c, 0x5a
+};
+static const uint32_t _lw_join_request_mic = 0xc0212d9c;
+
+/// Join accept without CFList: AppNonce A1B2C3, NetID 000013, DevAddr, DLSettings 0, RxDelay 1 then the MIC.
+static const uint8_t  _lw_join_accept_plain[16] =
+{
+    0xa1, 0xb2, 0xc3, 0x13, 0x00, 0x00, 0xda, 0x1b, 0x01, 0x26, 0x00, 0x01, 0xe3, 0x57, 0x8b, 0x83
+};
+static const uint8_t  _lw_join_accept_cipher[16] =
+{
+    0x81, 0x1e, 0xd4, 0x08, 0x1f, 0x3f, 0x9f, 0x88, 0x31, 0xac, 0x35, 0xf2, 0x3c, 0xf6, 0x05, 0x9e
+};
+
+/// Same join accept with a CFList of five frequencies.
+static const uint8_t  _lw_join_accept_cflist_plain[32] =
+{
+    0xa1, 0xb2, 0xc3, 0x13, 0x00, 0x00, 0xda, 0x1b, 0x01, 0x26, 0x00, 0x01, 0x18, 0x4f, 0x84, 0xe8,
+    0x56, 0x84, 0xb8, 0x5e, 0x84, 0x88, 0x66, 0x84, 0x58, 0x6e, 0x84, 0x00, 0x83, 0xfd, 0x33, 0xd8
+};
+static const uint8_t  _lw_join_accept_cflist_cipher[32] =
+{
+    0xd5, 0xd5, 0xaf, 0x2b, 0xb4, 0xdc, 0xe4, 0x4b, 0xd4, 0xa9, 0x00, 0xaa, 0xc9, 0x85, 0x5a, 0x78,
+    0xbb, 0x01, 0xa0, 0x4e, 0x63, 0x30, 0x4c, 0x12, 0x36, 0xb1, 0x40, 0xec, 0xe0, 0xd7, 0x4c, 0xb5
+};
+
+/// The session keys derived from the join accept and the DevNonce.
+static const uint8_t  _lw_nwk_skey[16] =
+{
+    0x23, 0x51, 0x84, 0xeb, 0x0a, 0x11, 0xa4, 0x7d, 0x07, 0x36, 0xab, 0xfc, 0x10, 0x0a, 0x20, 0xda
+};
+static const uint8_t  _lw_app_skey[16] =
+{
+    0x86, 0x93, 0x21, 0xd0, 0xaf, 0xc4, 0xa5, 0x67, 0x83, 0x1f, 0xbb, 0xeb, 0x4b, 0xdd, 0xfd, 0xbd
+};
+
+/**
+ * Defines an uplink vector: FRMPayload i is 0x30 + i; FPort 2, FCtrl 0.
+ */
+typedef struct LoRaWANUplinkVector
+{
+  const char *ps_name;       ///< The vector's reference.
+  uint32_t    fcnt;          ///< The 32 bits frame counter.
+  uint8_t     size;          ///< The FRMPayload's size.
+  uint8_t     cipher[AESTEST_UPLINK_SIZE];  ///< The encrypted FRMPayload.
+  uint32_t    mic;           ///< The MIC.
+}
+LoRaWANUplinkVector;
+
+static const LoRaWANUplinkVector _lw_uplinks[] =
+{
+    { "LoRaWAN uplink, 11 bytes, FCnt 1",        1, 11,
+      { 0x0f, 0xb7, 0xd4, 0xd7, 0x48, 0x8f, 0x98, 0x2e, 0x1c, 0x28, 0x2a },
+      0x376f5b4f },
+    { "LoRaWAN uplink, 51 bytes, FCnt 0x12345", 0x12345, 51,
+      { 0x5d, 0x71, 0x91, 0xf8, 0x21, 0x0b, 0x2a, 0x67, 0x5e, 0x5d, 0xb9, 0x5b, 0xa7, 0x50, 0xbf, 0x9e,
+	0xff, 0x4b, 0x8a, 0x19, 0x37, 0xb7, 0xd7, 0x68, 0x42, 0x40, 0x87, 0xa6, 0xc4, 0xcb, 0x2b, 0x12,
+	0xd5, 0x71, 0x84, 0xd2, 0xc5, 0x4d, 0x32, 0x21, 0x6e, 0xd6, 0xbe, 0xe5, 0x44, 0x83, 0x95, 0x37,
+	0xf7, 0xa5, 0xc5 },
+      0x52a7330e }
+};
+
+
+/**
+ * Report a test's result.
+ *
+ * @param[in] ps_name      the test's name. MUST be NOT NULL.
+ * @param[in] pu8_result   the computed value. MUST be NOT NULL.
+ * @param[in] pu8_expected the expected value. MUST be NOT NULL.
+ * @param[in] size         the values' size, in bytes.
+ *
+ * @return true  if the values are equal.
+ * @return false otherwise.
+ */
+static bool aestest_report_n(const char    *ps_name,
+			     const uint8_t *pu8_result,
+			     const uint8_t *pu8_expected,
+			     uint32_t       size)
+{
+  bool ok = memcmp(pu8_result, pu8_expected, size) == 0;
+
+  printf("%s  %s\n", ok ? "ok  " : "FAIL", ps_name);
+  return ok;
+}
+
+static bool aestest_report(const char *ps_name, const uint8_t *pu8_result, const uint8_t *pu8_expected)
+{
+  return aestest_report_n(ps_name, pu8_result, pu8_expected, N_BLOCK);
+}
+
+static bool aestest_report_mic(const char *ps_name, uint32_t mic, uint32_t expected)
+{
+  printf("%s  %s\n", mic == expected ? "ok  " : "FAIL", ps_name);
+  return mic == expected;
+}
+
+/**
+ * Build an uplink's PHYPayload, without its MIC, as LoRaMac.c does.
+ *
+ * @param[out] pu8_frame where the frame is written to. MUST be NOT NULL.
+ * @param[in]  fcnt      the frame counter.
+ * @param[in]  size      the FRMPayload's size.
+ *
+ * @return the frame's size, in bytes.
+ */
+static uint32_t aestest_build_uplink(uint8_t *pu8_frame, uint32_t fcnt, uint8_t size)
+{
+  uint8_t payload[AESTEST_UPLINK_SIZE];
+  uint8_t i;
+
+  for(i = 0; i < size; i++) { payload[i] = 0x30 + i; }
+  pu8_frame[0] = 0x40;  // Unconfirmed data up.
+  pu8_frame[1] = (uint8_t)(_lw_dev_addr);       pu8_frame[2] = (uint8_t)(_lw_dev_addr >> 8);
+  pu8_frame[3] = (uint8_t)(_lw_dev_addr >> 16); pu8_frame[4] = (uint8_t)(_lw_dev_addr >> 24);
+  pu8_frame[5] = 0;
+  pu8_frame[6] = (uint8_t)fcnt; pu8_frame[7] = (uint8_t)(fcnt >> 8);
+  pu8_frame[8] = 2;
+  LoRaMacPayloadEncrypt(payload, size, _lw_app_skey, _lw_dev_addr, 0, fcnt, pu8_frame + AESTEST_FHDR_SIZE);
+
+  return AESTEST_FHDR_SIZE + size;
+}
+
+/**
+ * Check LoRaMacCrypto.c against the LoRaWAN vectors.
+ *
+ * Every vector is computed twice, so that the second computation uses the keys from the cache.
+ *
+ * @return the number of failures.
+ */
+static unsigned int aestest_lorawan(void)
+{
+  uint8_t      buffer[33], nwk_skey[16], app_skey[16];
+  uint8_t      frame[AESTEST_FHDR_SIZE + AESTEST_UPLINK_SIZE];
+  uint32_t     mic, size, pass;
+  char         name[80];
+  unsigned int i, nb_failed = 0;
+
+  for(pass = 0; pass < 2; pass++)
+  {
+    const char *ps_pass = pass ? ", cached keys" : "";
+
+    LoRaMacJoinComputeMic(_lw_join_request, sizeof(_lw_join_request), _lw_app_key, &mic);
+    snprintf(name, sizeof(name), "LoRaWAN join request MIC%s", ps_pass);
+    nb_failed += !aestest_report_mic(name, mic, _lw_join_request_mic);
+
+    // The join accept is decrypted after its MHDR, then its MIC is computed from the MHDR on.
+    memset(buffer, 0, sizeof(buffer));
+    buffer[0] = 0x20;
+    LoRaMacJoinDecrypt(_lw_join_accept_cipher, sizeof(_lw_join_accept_cipher), _lw_app_key, buffer + 1);
+    snprintf(name, sizeof(name), "LoRaWAN join accept decryption%s", ps_pass);
+    nb_failed += !aestest_report_n(name, buffer + 1, _lw_join_accept_plain, sizeof(_lw_join_accept_plain));
+    LoRaMacJoinComputeMic(buffer, 1 + sizeof(_lw_join_accept_plain) - 4, _lw_app_key, &mic);
+    snprintf(name, sizeof(name), "LoRaWAN join accept MIC%s", ps_pass);
+    nb_failed += !aestest_report_n(name, (const uint8_t *)&mic, _lw_join_accept_plain + 12, 4);
+
+    LoRaMacJoinDecrypt(_lw_join_accept_cflist_cipher, sizeof(_lw_join_accept_cflist_cipher), _lw_app_key, buffer + 1);
+    snprintf(name, sizeof(name), "LoRaWAN join accept with CFList decryption%s", ps_pass);
+    nb_failed += !aestest_report_n(name, buffer + 1, _lw_join_accept_cflist_plain, sizeof(_lw_join_accept_cflist_plain));
+    LoRaMacJoinComputeMic(buffer, 1 + sizeof(_lw_join_accept_cflist_plain) - 4, _lw_app_key, &mic);
+    snprintf(name, sizeof(name), "LoRaWAN join accept with CFList MIC%s", ps_pass);
+    nb_failed += !aestest_report_n(name, (const uint8_t *)&mic, _lw_join_accept_cflist_plain + 28, 4);
+
+    LoRaMacJoinComputeSKeys(_lw_app_key, _lw_join_accept_plain, _lw_dev_nonce, nwk_skey, app_skey);
+    snprintf(name, sizeof(name), "LoRaWAN NwkSKey derivation%s", ps_pass);
+    nb_failed += !aestest_report(name, nwk_skey, _lw_nwk_skey);
+    snprintf(name, sizeof(name), "LoRaWAN AppSKey derivation%s", ps_pass);
+    nb_failed += !aestest_report(name, app_skey, _lw_app_skey);
+
+    for(i = 0; i < sizeof(_lw_uplinks) / sizeof(*_lw_uplinks); i++)
+    {
+      const LoRaWANUplinkVector *pv = &_lw_uplinks[i];
+
+      size = aestest_build_uplink(frame, pv->fcnt, pv->size);
+      snprintf(name, sizeof(name), "%s, FRMPayload encryption%s", pv->ps_name, ps_pass);
+      nb_failed += !aestest_report_n(name, frame + AESTEST_FHDR_SIZE, pv->cipher, pv->size);
+      LoRaMacComputeMic(frame, size, _lw_nwk_skey, _lw_dev_addr, 0, pv->fcnt, &mic);
+      snprintf(name, sizeof(name), "%s, MIC%s", pv->ps_name, ps_pass);
+      nb_failed += !aestest_report_mic(name, mic, pv->mic);
+    }
+  }
+
+  return nb_failed;
+}
+
+/**
+ * Secure an uplink the way LoRaMacCrypto.c did before its key cache:
+ * the keys are expanded for each frame.
+ *
+ * @param[out] pu8_frame where the frame is written to. MUST be NOT NULL.
+ * @param[in]  fcnt      the frame counter.
+ *
+ * @return the MIC.
+ */
+static uint32_t aestest_uplink_without_cache(uint8_t *pu8_frame, uint32_t fcnt)
+{
+  static const uint8_t payload[AESTEST_UPLINK_SIZE];
+  aes_context  aes;
+  AES_CMAC_CTX cmac;
+  uint8_t      a[N_BLOCK], s[N_BLOCK], b0[N_BLOCK], mic[AES_CMAC_DIGEST_LENGTH];
+  uint32_t     i, j;
+
+  memset(a, 0, sizeof(a));
+  a[0] = 0x01;
+  memcpy(a + 6,  &_lw_dev_addr, 4);
+  memcpy(a + 10, &fcnt,         4);
+  memset(&aes, 0, sizeof(aes));
+  aes_set_key(_lw_app_skey, 16, &aes);
+  for(i = 0; i < AESTEST_UPLINK_SIZE; i += N_BLOCK)
+  {
+    a[15] = i / N_BLOCK + 1;
+    aes_encrypt(a, s, &aes);
+    for(j = 0; j < N_BLOCK && i + j < AESTEST_UPLINK_SIZE; j++)
+    {
+      pu8_frame[AESTEST_FHDR_SIZE + i + j] = payload[i + j] ^ s[j];
+    }
+  }
+
+  memcpy(b0, a, sizeof(b0));
+  b0[0]  = 0x49;
+  b0[15] = AESTEST_FHDR_SIZE + AESTEST_UPLINK_SIZE;
+  AES_CMAC_Init(&cmac);
+  AES_CMAC_SetKey(&cmac, _lw_nwk_skey);
+  AES_CMAC_Update(&cmac, b0, sizeof(b0));
+  AES_CMAC_Update(&cmac, pu8_frame, AESTEST_FHDR_SIZE + AESTEST_UPLINK_SIZE);
+  AES_CMAC_Final(mic, &cmac);
+
+  return mic[0] | mic[1] << 8 | mic[2] << 16 | (uint32_t)mic[3] << 24;
+}
+
+static double now_ns(void)
+{
+  struct timespec ts;
+
+  clock_gettime(CLOCK_MONOTONIC, &ts);
+  return ts.tv_sec * 1e9 + ts.tv_nsec;
+}
+
+static uint64_t now_cycles(void)
+{
+#if AESTEST_HAS_TSC
+  return __rdtsc();
+#else
+  return 0;
+#endif
+}
+
+/**
+ * Print a benchmark's result.
+ *
+ * @param[in] ps_name the benchmark's name. MUST be NOT NULL.
+ * @param[in] ns      the time taken by AESTEST_NB_BENCH uplinks, in nanoseconds.
+ * @param[in] cycles  the host's cycles taken by AESTEST_NB_BENCH uplinks.
+ */
+static void aestest_print_bench(const char *ps_name, double ns, uint64_t cycles)
+{
+  printf("  %-32s %7.0f ns", ps_name, ns / AESTEST_NB_BENCH);
+  if(AESTEST_HAS_TSC) { printf(", %7.0f host cycles", (double)cycles / AESTEST_NB_BENCH); }
+  printf(" per uplink\n");
+}
+
+/**
+ * Measure the time taken to secure a 51 bytes uplink: FRMPayload encryption and MIC.
+ */
+static void aestest_bench(void)
+{
+  uint8_t  frame[AESTEST_FHDR_SIZE + AESTEST_UPLINK_SIZE];
+  uint32_t i, mic, sum = 0;
+  uint64_t cycles;
+  double   start;
+
+  memset(frame, 0, sizeof(frame));
+  start  = now_ns();
+  cycles = now_cycles();
+  for(i = 0; i < AESTEST_NB_BENCH; i++)
+  {
+    aestest_build_uplink(frame, i, AESTEST_UPLINK_SIZE);
+    LoRaMacComputeMic(frame, sizeof(frame), _lw_nwk_skey, _lw_dev_addr, 0, i, &mic);
+    sum += mic;
+  }
+  cycles = now_cycles() - cycles;
+  printf("Securing a %u bytes uplink, FRMPayload encryption and MIC:\n", AESTEST_UPLINK_SIZE);
+  aestest_print_bench("LoRaMacCrypto, key cache", now_ns() - start, cycles);
+
+  start  = now_ns();
+  cycles = now_cycles();
+  for(i = 0; i < AESTEST_NB_BENCH; i++) { sum += aestest_uplink_without_cache(frame, i); }
+  cycles = now_cycles() - cycles;
+  aestest_print_bench("keys expanded for each frame", now_ns() - start, cycles);
+  printf("  (%u)\n", (unsigned int)(sum & 1));
+}
+
+int main(int argc, char *argv[])
+{
+  aes_context  aes;
+  AES_CMAC_CTX cmac;
+  AES_CMAC_KEY expanded;
+  uint8_t      out[N_BLOCK], iv[N_BLOCK];
+  char         name[80];
+  unsigned int i, split, nb_failed = 0;
+
+  for(i = 0; i < sizeof(_aes_vectors) / sizeof(*_aes_vectors); i++)
+  {
+    const AESTestVector *pv = &_aes_vectors[i];
+
+    memset(out, 0, sizeof(out));
+    if(aes_set_key(pv->key, pv->key_size, &aes) != 0) { memset(out, 0xFF, sizeof(out)); }
+    else { aes_encrypt(pv->plain, out, &aes); }
+    nb_failed += !aestest_report(pv->ps_name, out, pv->cipher);
+
+    // A single block CBC encryption with a null IV is the block's encryption.
+    memset(iv, 0, sizeof(iv));
+    aes_cbc_encrypt(pv->plain, out, 1, iv, &aes);
+    snprintf(name, sizeof(name), "%s, CBC", pv->ps_name);
+    nb_failed += !aestest_report(name, out, pv->cipher);
+  }
+
+  AES_CMAC_ExpandKey(&expanded, _cmac_key);
+  for(i = 0; i < sizeof(_cmac_vectors) / sizeof(*_cmac_vectors); i++)
+  {
+    const CMACTestVector *pv = &_cmac_vectors[i];
+
+    AES_CMAC_Init(&cmac);
+    AES_CMAC_SetKey(&cmac, _cmac_key);
+    AES_CMAC_Update(&cmac, _cmac_message, pv->len);
+    AES_CMAC_Final(out, &cmac);
+    nb_failed += !aestest_report(pv->ps_name, out, pv->mac);
+
+    // Same with the cached expanded key, and the message given in two parts.
+    for(split = 1; split < pv->len; split += 7)
+    {
+      AES_CMAC_Init(&cmac);
+      AES_CMAC_UseKey(&cmac, &expanded);
+      AES_CMAC_Update(&cmac, _cmac_message,         split);
+      AES_CMAC_Update(&cmac, _cmac_message + split, pv->len - split);
+      AES_CMAC_Final(out, &cmac);
+      snprintf(name, sizeof(name), "%s, expanded key, split at %u", pv->ps_name, split);
+      nb_failed += !aestest_report(name, out, pv->mac);
+    }
+  }
+
+  nb_failed += aestest_lorawan();
+
+  if(argc > 1 && !strcmp(argv[1], "--bench")) { aestest_bench(); }
+
+  printf("%u failure(s).\n", nb_failed);
+  return nb_failed ? 1 : 0;
+}
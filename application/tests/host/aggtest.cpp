@@ -0,0 +1,161 @@
+/**
+ * Checks the numeric accuracy of the streaming statistics used by the sensors' aggregation,
+ * Middlewares/Uti/runningstats.cpp, against double precision computations on the stored values.
+ *
+ * The series mimic the sensors that are aggregated: values with a large offset and a small
+ * spread (pressure, temperature), wind speeds, wind directions around north, and so on; with the
+ * number of values of a 15 minutes window sampled every 10 seconds, of an hour sampled every second
+ * and of a day sampled every second.
+ *
+ * @date   2019
+ */
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <math.h>
+#include <algorithm>
+#include <vector>
+#include "runningstats.hpp"
+
+
+/**
+ * Defines a series of values.
+ */
+typedef struct Series
+{
+  const char *ps_name;  ///< The series' name.
+  double      offset;   ///< The values' offset.
+  double      spread;   ///< The values' standard deviation, around the offset.
+  bool        gaussian; ///< Normally distributed values? Uniformly distributed otherwise.
+}
+Series;
+
+
+static const Series   _series[] =
+{
+    { "pressure, hPa",        1013.25, 0.2,   true  },
+    { "temperature, degC",      21.5,  3.0,   true  },
+    { "wind speed, m/s",         4.0,  2.5,   false },
+    { "acceleration, g",         1.0,  0.002, true  },
+    { "large offset",        25000.0,  0.5,   true  }
+};
+static const uint32_t _sizes[] = { 90, 3600, 86400 };
+
+static uint64_t _rand_state = 0x41474754;
+static bool     _ok         = true;
+
+
+static double next_uniform(void)
+{
+  _rand_state = _rand_state * 6364136223846793005ull + 1442695040888963407ull;
+  return ((_rand_state >> 11) + 0.5) / 9007199254740992.0;  // ]0..1[
+}
+
+static double next_gaussian(void)
+{
+  return sqrt(-2.0 * log(next_uniform())) * cos(2.0 * M_PI * next_uniform());
+}
+
+/**
+ * Report a value's error, and check it against its bound.
+ *
+ * @param[in] ps_what  what is checked.
+ * @param[in] error    the error.
+ * @param[in] bound    the bound.
+ */
+static void report(const char *ps_what, double error, double bound)
+{
+  bool ok = error <= bound;
+
+  printf("  %s  %-48s %10.3g  (bound %.3g)\n", ok ? "ok  " : "FAIL", ps_what, error, bound);
+  _ok = _ok && ok;
+}
+
+/**
+ * Check RunningStats and P2Quantile on a series.
+ */
+static void check_series(const Series *pv_series, uint32_t n)
+{
+  std::vector<float> values(n);
+  RunningStats       stats;
+  P2Quantile         median(0.5f), p90(0.9f);
+  double             sum = 0.0, mean, m2 = 0.0, exact;
+  float              min, max;
+  uint32_t           i;
+
+  for(i = 0; i < n; i++)
+  {
+    values[i] = (float)(pv_series->offset + pv_series->spread *
+			(pv_series->gaussian ? next_gaussian() : (next_uniform() - 0.5) * sqrt(12.0)));
+    stats.add(values[i]);
+    median.add(values[i]);
+    p90.add(values[i]);
+    sum += values[i];
+  }
+  mean = sum / n;
+  for(i = 0; i < n; i++) { m2 += (values[i] - mean) * (values[i] - mean); }
+  min = *std::min_element(values.begin(), values.end());
+  max = *std::max_element(values.begin(), values.end());
+
+  printf("%s, %u values:\n", pv_series->ps_name, (unsigned int)n);
+  report("count",                          fabs((double)stats.count() - n),             0.0);
+  report("min and max",                    fabs(stats.min() - min) + fabs(stats.max() - max), 0.0);
+  // A float has a 6e-8 relative resolution; the compensated sum stays within a few of them.
+  report("mean, relative error",           fabs(stats.mean() - mean) / fabs(mean),      3e-7);
+  report("sum, relative error",            fabs(stats.sum()  - sum)  / fabs(sum),       2e-7);
+  report("stddev, relative error",         fabs(stats.stddev() - sqrt(m2 / n)) / sqrt(m2 / n), 1e-4);
+
+  // The P-square estimates are compared to the exact quantiles, relatively to the spread.
+  std::sort(values.begin(), values.end());
+  exact = values[(size_t)floor(0.5 * (n - 1) + 0.5)];
+  report("median, error / stddev",         fabs(median.value() - exact) / pv_series->spread, n < 100 ? 0.2 : 0.05);
+  exact = values[(size_t)floor(0.9 * (n - 1) + 0.5)];
+  report("90th percentile, error / stddev", fabs(p90.value() - exact) / pv_series->spread, n < 100 ? 0.3 : 0.05);
+}
+
+/**
+ * Check DirectionStats on directions spread around a mean direction.
+ */
+static void check_directions(double mean_deg, double spread_deg, uint32_t n)
+{
+  DirectionStats stats;
+  double         s = 0.0, c = 0.0, d, ref_mean, ref_eps, ref_stddev, diff;
+  uint32_t       i;
+
+  for(i = 0; i < n; i++)
+  {
+    d = fmod(mean_deg + spread_deg * next_gaussian() + 720.0, 360.0);
+    stats.add((float)d);
+    s += sin(d * M_PI / 180.0);
+    c += cos(d * M_PI / 180.0);
+  }
+  ref_mean   = fmod(atan2(s, c) * 180.0 / M_PI + 360.0, 360.0);
+  ref_eps    = sqrt(fmax(0.0, 1.0 - (s / n) * (s / n) - (c / n) * (c / n)));
+  ref_stddev = asin(ref_eps) * (1.0 + (2.0 / sqrt(3.0) - 1.0) * ref_eps * ref_eps * ref_eps) * 180.0 / M_PI;
+  diff       = fabs(stats.mean() - ref_mean);
+  if(diff > 180.0) { diff = 360.0 - diff; }
+
+  printf("wind direction %.0f +/- %.0f deg, %u values:\n", mean_deg, spread_deg, (unsigned int)n);
+  report("vector mean, error in deg",      diff,                              1e-3);
+  report("Yamartino stddev, error in deg", fabs(stats.stddev() - ref_stddev), 5e-3);
+}
+
+int main()
+{
+  uint32_t s, i;
+
+  for(s = 0; s < sizeof(_series) / sizeof(*_series); s++)
+  {
+    for(i = 0; i < sizeof(_sizes) / sizeof(*_sizes); i++) { check_series(&_series[s], _sizes[i]); }
+  }
+  for(i = 0; i < sizeof(_sizes) / sizeof(*_sizes); i++)
+  {
+    check_directions(0.0,   20.0, _sizes[i]);
+    check_directions(355.0, 60.0, _sizes[i]);
+    check_directions(180.0, 5.0,  _sizes[i]);
+    check_directions(90.0,  0.5,  _sizes[i]);
+  }
+
+  printf("%s\n", _ok ? "ok" : "FAIL");
+  return _ok ? 0 : 1;
+}
@@ -0,0 +1,463 @@
+/**
+ * Checks the sensor interruptions' dispatch, Middlewares/Environment/cnssint.cpp,
+ * against the linear scan of the clients it replaces, on simulated interruption lines:
+ *  - the bit scan, __CLZ(__RBIT()), gives the set bits from the lowest one;
+ *  - after any sequence of registrations, sensitivity changes and unregistrations, each client
+ *    listening to at least one of the interruptions is called once, in registration order,
+ *    like the linear scan does; and the dispatch table matches the client list;
+ *  - the first and the last places of a full client list are dispatched to;
+ *  - only the lines of the group, internal or external, whose wake up line is set are read;
+ *  - a dispatch after a wake up IRQ counts an interruption and its latency.
+ *
+ * @date   2019
+ */
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <vector>
+#include "board.h"
+#include "gpio.h"
+#include "rtc.h"
+#include "perfcounters.h"
+// Access the client list and the dispatch table, to compare them with the reference.
+#define private public
+#include "cnssint.hpp"
+#undef  private
+#include "cnssintclient.hpp"
+
+
+#define CNSSINTTEST_NB_CLIENTS  (CNSSIT_CLIENT_COUNT_MAX + 4)  ///< More clients than can be registered.
+#define CNSSINTTEST_NB_STEPS    20000
+#define CNSSINTTEST_NB_GPIOS    256
+
+
+/**
+ * A client that logs its calls.
+ */
+class LoggingClient : public CNSSIntClient
+{
+public:
+  void processInterruption(CNSSInt::Interruptions ints);
+};
+
+/**
+ * A call to a client.
+ */
+typedef struct Call
+{
+  const CNSSIntClient   *pvClient;
+  CNSSInt::Interruptions ints;
+}
+Call;
+
+/**
+ * A client registration, in the reference client list.
+ */
+typedef struct Registration
+{
+  CNSSIntClient         *pvClient;
+  CNSSInt::Interruptions mask;
+}
+Registration;
+
+
+static uint32_t                  _nb_failed;
+static std::vector<Call>         _calls;                          ///< The calls to the clients, in order.
+static std::vector<Registration> _reference;                      ///< The client list, as the linear scan sees it.
+static LoggingClient             _clients[CNSSINTTEST_NB_CLIENTS];
+static GPIO_TypeDef              _ports[   CNSSINTTEST_NB_GPIOS]; ///< One port for each line.
+static bool                      _levels[  CNSSINTTEST_NB_GPIOS]; ///< The level of each line.
+static uint32_t                  _nb_reads[CNSSINTTEST_NB_GPIOS]; ///< The number of reads of each line.
+static GPIOIrqHandler            _pf_wakeup_irq_handler;
+
+
+void LoggingClient::processInterruption(CNSSInt::Interruptions ints)
+{
+  Call call = { this, ints };
+  _calls.push_back(call);
+}
+
+
+/*
+ * The interruption lines.
+ * A line is identified by its port, not by its pin: the reads pass the pin set by
+ * gpio_hal_port_and_pin_from_id() in the same call, and the order the arguments are evaluated in is unspecified.
+ */
+extern "C"
+{
+  GPIO_TypeDef *gpio_hal_port_and_pin_from_id(GPIOId gpio_id, uint32_t *pu32_pin)
+  {
+    if(pu32_pin) { *pu32_pin = GPIO_PIN_0; }
+    return &_ports[gpio_id];
+  }
+
+  GPIO_PinState HAL_GPIO_ReadPin(GPIO_TypeDef *pv_port, uint16_t pin)
+  {
+    (void)pin;
+    _nb_reads[pv_port - _ports]++;
+    return _levels[pv_port - _ports] ? GPIO_PIN_SET : GPIO_PIN_RESET;
+  }
+
+  void HAL_GPIO_WritePin(GPIO_TypeDef *pv_port, uint16_t pin, GPIO_PinState state)
+  {
+    GPIOId gpio = (GPIOId)(pv_port - _ports);
+
+    (void)pin;
+    // Clearing a group's memories resets its lines and its wake up line.
+    bool internal = gpio == SENSOR_INT_CLEAR_INTERRUPT_GPIO && state == (GPIO_PinState)SENSOR_INT_CLEAR_INTERRUPT_CLEAR_LEVEL;
+    bool external = gpio == SENSOR_EXT_CLEAR_INTERRUPT_GPIO && state == (GPIO_PinState)SENSOR_EXT_CLEAR_INTERRUPT_CLEAR_LEVEL;
+    if(!internal && !external) { return; }
+
+    for(const CNSSInt::IntConfig *pvCfg = CNSSInt::_intConfigs; pvCfg->psName; pvCfg++)
+    {
+      if(pvCfg->internal == internal) { _levels[pvCfg->gpio] = false; }
+    }
+    _levels[internal ? WAKEUP_INT_SENSOR_GPIO : WAKEUP_EXT_SENSOR_GPIO] = false;
+  }
+
+  void gpio_set_irq_handler(GPIOId gpio_id, uint32_t prio, GPIOIrqHandler pf_handler)
+  {
+    (void)prio;
+    if(gpio_id == WAKEUP_EXT_SENSOR_GPIO || gpio_id == WAKEUP_INT_SENSOR_GPIO)
+    {
+      _pf_wakeup_irq_handler = pf_handler ? pf_handler : _pf_wakeup_irq_handler;
+    }
+  }
+
+  bool rtc_is_first_run_since_power_up(void) { return false; }
+
+  void board_reset(BoardSoftwareResetType type)
+  {
+    (void)type;
+    fprintf(stderr, "Unexpected reset.\n");
+    exit(2);
+  }
+}
+
+
+static void check(const char *ps_what, bool ok)
+{
+  printf("%s  %s\n", ok ? "ok  " : "FAIL", ps_what);
+  if(!ok) { _nb_failed++; }
+}
+
+/**
+ * Raise interruption lines, and the wake up lines of their groups.
+ */
+static void raise(CNSSInt::Interruptions ints)
+{
+  for(const CNSSInt::IntConfig *pvCfg = CNSSInt::_intConfigs; pvCfg->psName; pvCfg++)
+  {
+    if(!(ints & pvCfg->flag)) { continue; }
+    _levels[pvCfg->gpio] = true;
+    _levels[pvCfg->internal ? WAKEUP_INT_SENSOR_GPIO : WAKEUP_EXT_SENSOR_GPIO] = true;
+  }
+}
+
+/**
+ * Get the calls the linear scan of the clients makes.
+ */
+static std::vector<Call> linear_scan(CNSSInt::Interruptions ints)
+{
+  std::vector<Call> calls;
+
+  for(size_t i = 0; i < _reference.size(); i++)
+  {
+    if(_reference[i].mask & ints)
+    {
+      Call call = { _reference[i].pvClient, ints };
+      calls.push_back(call);
+    }
+  }
+
+  return calls;
+}
+
+static bool same_calls(const std::vector<Call>& calls, const std::vector<Call>& expected)
+{
+  if(calls.size() != expected.size()) { return false; }
+  for(size_t i = 0; i < calls.size(); i++)
+  {
+    if(calls[i].pvClient != expected[i].pvClient || calls[i].ints != expected[i].ints) { return false; }
+  }
+  return true;
+}
+
+/**
+ * Check that the client list is the reference one, and that the dispatch table is built from it.
+ */
+static bool same_clients(const CNSSInt *pvInt)
+{
+  if(pvInt->_nbClients != _reference.size()) { return false; }
+  for(uint32_t i = 0; i < pvInt->_nbClients; i++)
+  {
+    if(pvInt->_clients[i].pvClient        != _reference[i].pvClient ||
+       pvInt->_clients[i].sensitivityMask != _reference[i].mask) { return false; }
+  }
+  for(uint8_t id = 0; id < CNSSInt::INTERRUPTION_COUNT; id++)
+  {
+    uint32_t clients = 0;
+    for(uint32_t i = 0; i < pvInt->_nbClients; i++)
+    {
+      if(pvInt->_clients[i].sensitivityMask & (1u << id)) { clients |= 1u << i; }
+    }
+    if(pvInt->_dispatchTable[id] != clients) { return false; }
+  }
+  return true;
+}
+
+/**
+ * The reference client list's registerClient() and unregisterClient().
+ */
+static bool reference_register(CNSSIntClient *pvClient, CNSSInt::Interruptions mask, bool append);
+
+static void reference_unregister(CNSSIntClient *pvClient)
+{
+  for(size_t i = 0; i < _reference.size(); i++)
+  {
+    if(_reference[i].pvClient == pvClient) { _reference.erase(_reference.begin() + i); return; }
+  }
+}
+
+static bool reference_register(CNSSIntClient *pvClient, CNSSInt::Interruptions mask, bool append)
+{
+  if(_reference.size() >= CNSSIT_CLIENT_COUNT_MAX) { return false; }
+
+  for(size_t i = 0; i < _reference.size(); i++)
+  {
+    if(_reference[i].pvClient != pvClient) { continue; }
+
+    if(append)                              { _reference[i].mask |= mask; }
+    else if(mask == CNSSInt::INT_FLAG_NONE) { reference_unregister(pvClient); }
+    else                                    { _reference[i].mask  = mask; }
+    return true;
+  }
+  Registration registration = { pvClient, mask };
+  _reference.push_back(registration);
+  return true;
+}
+
+static CNSSInt::Interruptions random_ints(void)
+{
+  // Mostly one or two interruptions, sometimes many.
+  CNSSInt::Interruptions ints = 0;
+  int                    n    = rand() % 8 == 0 ? CNSSInt::INTERRUPTION_COUNT : 1 + rand() % 2;
+
+  for(int i = 0; i < n; i++) { ints |= 1u << (rand() % CNSSInt::INTERRUPTION_COUNT); }
+  return ints;
+}
+
+static void check_bit_scan(void)
+{
+  bool ok = true;
+
+  for(uint32_t i = 0; i < 32; i++)
+  {
+    ok = ok && __CLZ(__RBIT(1u << i)) == i && __CLZ(__RBIT(0xFFFFFFFFu << i)) == i;
+  }
+  for(uint32_t n = 0; n < 10000 && ok; n++)
+  {
+    uint32_t v = (uint32_t)rand() ^ ((uint32_t)rand() << 16), seen = 0;
+    int32_t  last = -1;
+
+    for(uint32_t bits = v; bits && ok; bits &= bits - 1)
+    {
+      uint32_t i = __CLZ(__RBIT(bits));
+      ok    = (int32_t)i > last && (v & (1u << i));
+      seen |= 1u << i;
+      last  = i;
+    }
+    ok = ok && seen == v;
+  }
+  check("bit scan: the set bits, from the lowest one", ok);
+}
+
+static void check_against_linear_scan(CNSSInt *pvInt)
+{
+  uint32_t nb_steps_ok = 0, nb_dispatches = 0, nb_full = 0;
+
+  for(uint32_t step = 0; step < CNSSINTTEST_NB_STEPS; step++)
+  {
+    CNSSIntClient         *pvClient = &_clients[rand() % CNSSINTTEST_NB_CLIENTS];
+    CNSSInt::Interruptions mask     = rand() % 6 == 0 ? (CNSSInt::Interruptions)CNSSInt::INT_FLAG_NONE : random_ints();
+    bool                   append   = rand() % 2;
+    bool                   ok;
+
+    switch(rand() % 4)
+    {
+      case 0:
+	pvInt->unregisterClient(*pvClient);
+	reference_unregister(pvClient);
+	ok = true;
+	break;
+      case 1:
+      {
+	// By name.
+	CNSSInt::IntId id   = (CNSSInt::IntId)(rand() % CNSSInt::INTERRUPTION_COUNT);
+	CNSSInt::IntFlag flag = pvInt->registerClient(*pvClient, CNSSInt::getNameUsingId(id), append);
+	ok = (flag != CNSSInt::INT_FLAG_NONE) == reference_register(pvClient, 1u << id, append) &&
+	    (flag == CNSSInt::INT_FLAG_NONE || flag == (CNSSInt::IntFlag)(1u << id));
+	break;
+      }
+      default:
+	ok = pvInt->registerClient(*pvClient, mask, append) == reference_register(pvClient, mask, append);
+	break;
+    }
+    nb_full += _reference.size() == CNSSIT_CLIENT_COUNT_MAX;
+    ok       = ok && same_clients(pvInt);
+
+    CNSSInt::Interruptions ints = random_ints();
+    _calls.clear();
+    raise(ints);
+    ok             = ok && pvInt->processInterruptions() && same_calls(_calls, linear_scan(ints));
+    nb_dispatches += _calls.size();
+    nb_steps_ok   += ok;
+    if(!ok)
+    {
+      printf("FAIL  step %u: interruptions 0x%03X, %u client(s), %u call(s), %u expected\n",
+	     (unsigned int)step, (unsigned int)ints, (unsigned int)_reference.size(),
+	     (unsigned int)_calls.size(), (unsigned int)linear_scan(ints).size());
+      _nb_failed++;
+      break;
+    }
+  }
+  printf("      %u steps, %u calls, %u with a full client list\n", (unsigned int)nb_steps_ok,
+	 (unsigned int)nb_dispatches, (unsigned int)nb_full);
+  check("registrations, sensitivity changes and unregistrations: same calls as the linear scan",
+	nb_steps_ok == CNSSINTTEST_NB_STEPS);
+
+  while(!_reference.empty())
+  {
+    pvInt->unregisterClient(*_reference.front().pvClient);
+    reference_unregister(_reference.front().pvClient);
+  }
+  check("all the clients unregistered: empty dispatch table", same_clients(pvInt));
+}
+
+static void check_full_list(CNSSInt *pvInt)
+{
+  bool ok = true;
+
+  // The first client listens to OPTO1, the last one to INT2 and LIS3DH, the others to nothing else.
+  for(uint32_t i = 0; i < CNSSIT_CLIENT_COUNT_MAX; i++)
+  {
+    CNSSInt::Interruptions mask = i == 0 ? CNSSInt::OPTO1_FLAG :
+	i == CNSSIT_CLIENT_COUNT_MAX - 1 ? CNSSInt::INT2_FLAG | CNSSInt::LIS3DH_FLAG : CNSSInt::SDI12_FLAG;
+    ok = pvInt->registerClient(_clients[i], mask) && reference_register(&_clients[i], mask, true) && ok;
+  }
+  check("full client list: one more client is refused",
+	ok && !pvInt->registerClient(_clients[CNSSIT_CLIENT_COUNT_MAX], CNSSInt::INT1_FLAG));
+
+  _calls.clear();
+  raise(CNSSInt::OPTO1_FLAG | CNSSInt::LIS3DH_FLAG);
+  pvInt->processInterruptions();
+  check("full client list: the first and the last clients are called, in this order",
+	_calls.size() == 2 && _calls[0].pvClient == &_clients[0] &&
+	_calls[1].pvClient == &_clients[CNSSIT_CLIENT_COUNT_MAX - 1] &&
+	same_calls(_calls, linear_scan(CNSSInt::OPTO1_FLAG | CNSSInt::LIS3DH_FLAG)));
+
+  for(uint32_t i = 0; i < CNSSIT_CLIENT_COUNT_MAX; i++)
+  {
+    pvInt->unregisterClient(_clients[i]);
+    reference_unregister(&_clients[i]);
+  }
+}
+
+static void check_group_skip(CNSSInt *pvInt)
+{
+  uint32_t nb_reads_ext = 0, nb_reads_int = 0;
+
+  pvInt->registerClient(_clients[0], CNSSInt::LIS3DH_FLAG);
+  pvInt->registerClient(_clients[1], CNSSInt::OPTO1_FLAG);
+
+  // Only the internal group's wake up line is set; the external line is set, but already cleared for the group.
+  memset(_nb_reads, 0, sizeof(_nb_reads));
+  _calls.clear();
+  raise(CNSSInt::LIS3DH_FLAG);
+  _levels[OPTO1_INTERRUPT_GPIO] = true;
+  pvInt->processInterruptions();
+  for(const CNSSInt::IntConfig *pvCfg = CNSSInt::_intConfigs; pvCfg->psName; pvCfg++)
+  {
+    (pvCfg->internal ? nb_reads_int : nb_reads_ext) += _nb_reads[pvCfg->gpio];
+  }
+  check("internal wake up: the external lines are not read, and their clients are not called",
+	nb_reads_ext == 0 && nb_reads_int > 0 && _calls.size() == 1 && _calls[0].pvClient == &_clients[0] &&
+	_calls[0].ints == CNSSInt::LIS3DH_FLAG);
+  _levels[OPTO1_INTERRUPT_GPIO] = false;
+
+  // And the other way round.
+  memset(_nb_reads, 0, sizeof(_nb_reads));
+  nb_reads_ext = nb_reads_int = 0;
+  _calls.clear();
+  raise(CNSSInt::OPTO1_FLAG);
+  _levels[LIS3DH_INTERRUPT_GPIO] = true;
+  pvInt->processInterruptions();
+  for(const CNSSInt::IntConfig *pvCfg = CNSSInt::_intConfigs; pvCfg->psName; pvCfg++)
+  {
+    (pvCfg->internal ? nb_reads_int : nb_reads_ext) += _nb_reads[pvCfg->gpio];
+  }
+  check("external wake up: the internal lines are not read, and their clients are not called",
+	nb_reads_int == 0 && nb_reads_ext > 0 && _calls.size() == 1 && _calls[0].pvClient == &_clients[1] &&
+	_calls[0].ints == CNSSInt::OPTO1_FLAG);
+  _levels[LIS3DH_INTERRUPT_GPIO] = false;
+
+  // No wake up line set: no line is read, even the ones that are set.
+  memset(_nb_reads, 0, sizeof(_nb_reads));
+  nb_reads_ext = 0;
+  _calls.clear();
+  _levels[LIS3DH_INTERRUPT_GPIO] = _levels[OPTO1_INTERRUPT_GPIO] = true;
+  bool processed = pvInt->processInterruptions();
+  for(const CNSSInt::IntConfig *pvCfg = CNSSInt::_intConfigs; pvCfg->psName; pvCfg++)
+  {
+    nb_reads_ext += _nb_reads[pvCfg->gpio];
+  }
+  check("no wake up: no line is read, no client is called", !processed && nb_reads_ext == 0 && _calls.empty());
+  _levels[LIS3DH_INTERRUPT_GPIO] = _levels[OPTO1_INTERRUPT_GPIO] = false;
+
+  pvInt->unregisterClient(_clients[0]);
+  pvInt->unregisterClient(_clients[1]);
+}
+
+static void check_latency(CNSSInt *pvInt)
+{
+  uint32_t nb = perfcounters_get(PERF_COUNTER_INTERRUPTIONS);
+  uint32_t ms = perfcounters_get(PERF_COUNTER_INT_LATENCY_MS);
+  uint32_t irq_ms;
+
+  pvInt->registerClient(_clients[0], CNSSInt::OPTO2_FLAG);
+  raise(CNSSInt::OPTO2_FLAG);
+  irq_ms = host_tick_ms;
+  if(_pf_wakeup_irq_handler) { _pf_wakeup_irq_handler(); }
+  host_tick_ms += 7;
+  if(_pf_wakeup_irq_handler) { _pf_wakeup_irq_handler(); }  // A later IRQ does not restart the measure.
+  host_tick_ms += 5;
+  pvInt->processInterruptions();
+  // The latency also includes the time taken to clear the interruption memories.
+  check("wake up IRQ: an interruption is counted, with its latency",
+	_pf_wakeup_irq_handler &&
+	perfcounters_get(PERF_COUNTER_INTERRUPTIONS)  == nb + 1 &&
+	perfcounters_get(PERF_COUNTER_INT_LATENCY_MS) == ms + host_tick_ms - irq_ms &&
+	host_tick_ms - irq_ms >= 12);
+
+  // Lines polled without an IRQ: nothing is counted.
+  raise(CNSSInt::OPTO2_FLAG);
+  pvInt->processInterruptions();
+  check("no wake up IRQ: nothing is counted", perfcounters_get(PERF_COUNTER_INTERRUPTIONS) == nb + 1);
+
+  pvInt->unregisterClient(_clients[0]);
+}
+
+int main(void)
+{
+  CNSSInt *pvInt = CNSSInt::instance();
+
+  srand(2019);
+  check_bit_scan();
+  check_against_linear_scan(pvInt);
+  check_full_list(pvInt);
+  check_group_skip(pvInt);
+  check_latency(pvInt);
+
+  printf("%u failure(s).\n", (unsigned int)_nb_failed);
+  return _nb_failed ? 1 : 0;
+}
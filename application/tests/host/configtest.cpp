@@ -0,0 +1,238 @@
+/**
+ * Checks the streaming configuration reader, Middlewares/Environment/configreader.cpp,
+ * on the configuration templates, through the firmware's own SD card driver and FatFs on a RAM disk;
+ * and reports what reading each configuration costs at boot.
+ *
+ * For each file:
+ *  - the members and the sensors handed over by the reader must be the ones of a whole-file parse,
+ *    in file order, the members before the sensors;
+ *  - the size and the murmur3 hash given by the reader must be the ones of the file;
+ *  - the card's accesses, and their time, are counted for a read done just after the card is mounted,
+ *    like at boot.
+ *
+ * With --bench, each file is also read repeatedly to measure the host's time per read.
+ *
+ * @date   2019
+ */
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <string>
+#include <vector>
+#include "config.h"
+#include "configreader.hpp"
+#include "sdcard.h"
+#include "sdcache.h"
+#include "murmur3.h"
+#include "sdimage.h"
+
+
+#define CONFIGTEST_IMAGE_NB_SECTORS    (512u * 1024 * 2) ///< 512 MiB
+#define CONFIGTEST_CLUSTER_NB_SECTORS  8
+#define CONFIGTEST_BUFFER_SIZE         4096              ///< CONNECSENS_BUFFER_SIZE
+#define CONFIGTEST_FILE_SIZE_MAX       65536
+#define CONFIGTEST_NB_BENCH            2000
+
+
+/**
+ * Client that records what it is handed over, as JSON text.
+ */
+class RecordingClient : public ConfigReader::Client
+{
+public:
+  bool configMemberRead(const char *psKey, const JsonObject& json)
+  {
+    record("member " + std::string(psKey), json);
+    return true;
+  }
+
+  bool configItemRead(const char *psKey, uint16_t index, const JsonObject& json)
+  {
+    record("item " + std::string(psKey) + "[" + std::to_string(index) + "]", json);
+    return true;
+  }
+
+  void record(const std::string& what, const JsonObject& json)
+  {
+    char text[CONFIGTEST_BUFFER_SIZE];
+
+    json.printTo(text, sizeof(text));
+    this->records.push_back(what + " " + text);
+  }
+
+  std::vector<std::string> records;
+};
+
+
+static uint32_t _nb_failed;
+static char     _text[CONFIGTEST_FILE_SIZE_MAX];
+static char     _buffer[CONFIGTEST_BUFFER_SIZE];
+
+
+static double now_ns(void)
+{
+  struct timespec ts;
+
+  clock_gettime(CLOCK_MONOTONIC, &ts);
+  return ts.tv_sec * 1e9 + ts.tv_nsec;
+}
+
+/**
+ * Get the records expected for a configuration, from a parse of the whole file.
+ *
+ * @param[in]  ps_text   the file's content. Modified by the parse. MUST be NOT NULL.
+ * @param[out] pv_client where the records are written to. MUST be NOT NULL.
+ *
+ * @return true  on success.
+ * @return false if the file cannot be parsed.
+ */
+static bool expected_records(char *ps_text, RecordingClient *pv_client)
+{
+  DynamicJsonBuffer jsonBuffer;
+  uint16_t          index = 0;
+
+  JsonObject& root = jsonBuffer.parseObject(ps_text);
+  if(!root.success()) { return false; }
+
+  for(JsonObject::iterator it = root.begin(); it != root.end(); ++it)
+  {
+    if(strcmp(it->key, "sensors") == 0) { continue; }
+
+    JsonObject& member = jsonBuffer.createObject();
+    member[it->key] = it->value;
+    pv_client->configMemberRead(it->key, member);
+  }
+  JsonArray& sensors = root["sensors"];
+  for(JsonArray::iterator it = sensors.begin(); it != sensors.end(); ++it, index++)
+  {
+    pv_client->configItemRead("sensors", index, it->as<JsonObject>());
+  }
+
+  return true;
+}
+
+/**
+ * Copy a file to the card, as the configuration file.
+ *
+ * @param[in] ps_text the file's content. MUST be NOT NULL.
+ * @param[in] size    the file's size, in bytes.
+ *
+ * @return true  on success.
+ * @return false otherwise.
+ */
+static bool install(const char *ps_text, uint32_t size)
+{
+  File file;
+  bool res;
+
+  if(!sdcard_fopen(&file, CONFIG_FILE_NAME, FILE_TRUNCATE | FILE_WRITE)) { return false; }
+  res = sdcard_fwrite(&file, (const uint8_t *)ps_text, size);
+  sdcard_fclose(&file);
+
+  return res && sdcard_flush();
+}
+
+/**
+ * Mount the card again, with an empty sector cache, like at boot.
+ *
+ * @return true  on success.
+ * @return false otherwise.
+ */
+static bool reboot(void)
+{
+  sdcard_deinit();
+  return sdcard_init();
+}
+
+/**
+ * Check the reader on a configuration file, and report its costs.
+ *
+ * @param[in] ps_path the file's path on the host. MUST be NOT NULL.
+ * @param[in] bench   also measure the host's time per read?
+ */
+static void check_file(const char *ps_path, bool bench)
+{
+  RecordingClient client, expected;
+  SDImageStats    before;
+  const char     *ps_name;
+  FILE           *pf;
+  uint32_t        size, hash, i;
+  double          start, t_read = 0;
+  bool            ok;
+
+  if(!(pf = fopen(ps_path, "rb")))
+  {
+    printf("FAIL  %s: cannot be opened\n", ps_path);
+    _nb_failed++;
+    return;
+  }
+  size = fread(_text, 1, sizeof(_text) - 1, pf);
+  fclose(pf);
+  _text[size] = '\0';
+  hash        = mm3_32_cnss((const uint8_t *)_text, size);
+  ps_name     = strrchr(ps_path, '/') ? strrchr(ps_path, '/') + 1 : ps_path;
+
+  memset(&before, 0, sizeof(before));
+  ok = install(_text, size) && reboot();
+  if(ok)
+  {
+    ConfigReader reader(_buffer, sizeof(_buffer));
+
+    before = *sdimage_stats();
+    ok     = reader.read(CONFIG_FILE_NAME, "sensors", &client) &&
+	reader.size() == size && reader.hash() == hash;
+  }
+  before.nb_read_commands = sdimage_stats()->nb_read_commands - before.nb_read_commands;
+  before.nb_sectors_read  = sdimage_stats()->nb_sectors_read  - before.nb_sectors_read;
+  before.busy_us          = sdimage_stats()->busy_us          - before.busy_us;
+  ok = ok && expected_records(_text, &expected) && client.records == expected.records;
+
+  if(ok && bench)
+  {
+    start = now_ns();
+    for(i = 0; i < CONFIGTEST_NB_BENCH; i++)
+    {
+      ConfigReader reader(_buffer, sizeof(_buffer));
+      RecordingClient discarded;
+      reader.read(CONFIG_FILE_NAME, "sensors", &discarded);
+    }
+    t_read = (now_ns() - start) / CONFIGTEST_NB_BENCH;
+  }
+
+  printf("%s  %-42s %5u bytes %3u members/items, %2u reads, %2u sectors, %5.2f ms on card",
+	 ok ? "ok  " : "FAIL", ps_name, (unsigned int)size, (unsigned int)client.records.size(),
+	 (unsigned int)before.nb_read_commands, (unsigned int)before.nb_sectors_read,
+	 before.busy_us / 1000.0);
+  if(bench) { printf(", %6.1f us on host", t_read / 1000.0); }
+  printf("\n");
+  if(!ok) { _nb_failed++; }
+}
+
+int main(int argc, char *argv[])
+{
+  bool bench = false;
+  int  i;
+
+  if(!sdimage_open(CONFIGTEST_IMAGE_NB_SECTORS, SDCACHE_ERASE_BLOCK_NB_SECTORS) ||
+     !sdimage_format(CONFIGTEST_CLUSTER_NB_SECTORS) ||
+     !sdcard_init() ||
+     !sdcard_check_and_mkdir(ENV_DIRECTORY_NAME) ||
+     !sdcard_check_and_mkdir(PRIVATE_DATA_DIRECTORY_NAME))
+  {
+    fprintf(stderr, "Failed to set up the card.\n");
+    return 2;
+  }
+
+  for(i = 1; i < argc; i++) { bench = bench || !strcmp(argv[i], "--bench"); }
+  for(i = 1; i < argc; i++)
+  {
+    if(strcmp(argv[i], "--bench")) { check_file(argv[i], bench); }
+  }
+
+  sdcard_deinit();
+  sdimage_close();
+
+  printf("%u failure(s).\n", (unsigned int)_nb_failed);
+  return _nb_failed ? 1 : 0;
+}
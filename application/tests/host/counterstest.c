@@ -0,0 +1,183 @@
+/**
+ * Checks the encoding of the RuntimeCounters Data Type, 0x2D,
+ * codecs/connecsens-rf/datatypes/cnssrf-dt_system.c:
+ *  - the values are written in order, little endian, each one with its type's size;
+ *  - the SD card bytes are written in KiB and the radio transmission times in 10 ms units;
+ *  - the sensor interruptions dispatched and the sum of their latencies are written last;
+ *  - a value that is its type's maximum is written as it is, a bigger one is saturated;
+ *  - the Data Type is not written to a frame that is too small.
+ *
+ * @date   2019
+ */
+#include <stdio.h>
+#include <string.h>
+#include "cnssrf-dataframe.h"
+#include "cnssrf-dt_system.h"
+
+
+#define COUNTERSTEST_TYPE_ID      0x2D
+#define COUNTERSTEST_VALUES_SIZE  33   ///< The size of the values, in bytes.
+#define COUNTERSTEST_BUFFER_SIZE  64
+
+
+static uint32_t _nb_failed;
+
+
+static void check(const char *ps_what, bool ok)
+{
+  printf("%s  %s\n", ok ? "ok  " : "FAIL", ps_what);
+  if(!ok) { _nb_failed++; }
+}
+
+/**
+ * Write counters to a new frame, on the node's channel.
+ *
+ * @param[in]  pv_counters the counters. MUST be NOT NULL.
+ * @param[out] pu8_bytes   where the Data Type's bytes, from its type id, are copied to. MUST be NOT NULL.
+ * @param[out] pu16_size   where the number of bytes copied is written to. MUST be NOT NULL.
+ * @param[in]  buffer_size the frame's buffer size.
+ *
+ * @return the value returned by cnssrf_dt_system_write_counters().
+ */
+static bool write(const CNSSRFDTSystemCounters *pv_counters, uint8_t *pu8_bytes, uint16_t *pu16_size,
+		  uint16_t buffer_size)
+{
+  CNSSRFDataFrame frame;
+  uint8_t         buffer[COUNTERSTEST_BUFFER_SIZE];
+  uint16_t        start;
+  bool            res;
+
+  memset(buffer, 0, sizeof(buffer));
+  cnssrf_data_frame_init(&frame, buffer, buffer_size, NULL, 0);
+  cnssrf_data_frame_set_current_data_channel(&frame, CNSSRF_DATA_CHANNEL_NODE);
+  start      = frame.data_count;
+  res        = cnssrf_dt_system_write_counters(&frame, pv_counters);
+  *pu16_size = frame.data_count - start;
+  memcpy(pu8_bytes, buffer + start, *pu16_size);
+
+  return res;
+}
+
+/**
+ * Set every counter to the same value.
+ */
+static void set_all(CNSSRFDTSystemCounters *pv_counters, uint32_t v)
+{
+  pv_counters->nb_wakeups           = v;
+  pv_counters->awake_ms             = v;
+  pv_counters->sd_bytes_written     = v;
+  pv_counters->sd_nb_syncs          = v;
+  for(uint8_t i = 0; i < CNSSRF_DT_SYS_COUNTERS_NB_DATARATES; i++) { pv_counters->tx_ms[i] = v; }
+  pv_counters->tx_nb_retries        = v;
+  pv_counters->sdi12_ms             = v;
+  pv_counters->datalog_backlog      = v;
+  pv_counters->watchdog_near_misses = v;
+  pv_counters->nb_interruptions     = v;
+  pv_counters->int_latency_ms       = v;
+}
+
+static void check_bytes(const char *ps_what, const CNSSRFDTSystemCounters *pv_counters,
+			const uint8_t *pu8_expected)
+{
+  uint8_t  bytes[COUNTERSTEST_BUFFER_SIZE];
+  uint16_t size;
+  bool     ok;
+
+  ok = write(pv_counters, bytes, &size, COUNTERSTEST_BUFFER_SIZE) &&
+      size == COUNTERSTEST_VALUES_SIZE + 1 && !memcmp(bytes, pu8_expected, size);
+  check(ps_what, ok);
+  if(!ok)
+  {
+    printf("      written: ");
+    for(uint16_t i = 0; i < size; i++) { printf(" %02X", bytes[i]); }
+    printf("\n");
+  }
+}
+
+int main(void)
+{
+  CNSSRFDTSystemCounters counters;
+  uint8_t                bytes[COUNTERSTEST_BUFFER_SIZE];
+  uint16_t               size;
+
+  // Known values.
+  counters.nb_wakeups           = 0x1234;
+  counters.awake_ms             = 0x345678;
+  counters.sd_bytes_written     = 0x0ABC * 1024 + 1023;
+  counters.sd_nb_syncs          = 0x0102;
+  for(uint8_t i = 0; i < CNSSRF_DT_SYS_COUNTERS_NB_DATARATES; i++)
+  {
+    counters.tx_ms[i] = (0x0100 + i) * 10 + 9;
+  }
+  counters.tx_nb_retries        = 0x07;
+  counters.sdi12_ms             = 0x0A0B0C;
+  counters.datalog_backlog      = 0x0D0E;
+  counters.watchdog_near_misses = 0x03;
+  counters.nb_interruptions     = 0x4321;
+  counters.int_latency_ms       = 0x876543;
+  const uint8_t known[] =
+  {
+    COUNTERSTEST_TYPE_ID,
+    0x34, 0x12,                                                  // wakeups
+    0x78, 0x56, 0x34,                                            // awake time
+    0xBC, 0x0A,                                                  // SD card KiB written
+    0x02, 0x01,                                                  // SD card synchronisations
+    0x00, 0x01, 0x01, 0x01, 0x02, 0x01, 0x03, 0x01, 0x04, 0x01, 0x05, 0x01,  // DR0 to DR5
+    0x07,                                                        // retransmissions
+    0x0C, 0x0B, 0x0A,                                            // SDI-12 bus time
+    0x0E, 0x0D,                                                  // datalog backlog
+    0x03,                                                        // watchdog near misses
+    0x21, 0x43,                                                  // sensor interruptions
+    0x43, 0x65, 0x87                                             // sum of their latencies
+  };
+  check_bytes("known values", &counters, known);
+
+  // Each value at its type's maximum is written as it is.
+  set_all(&counters, 0);
+  counters.nb_wakeups           = 0xFFFF;
+  counters.awake_ms             = 0xFFFFFF;
+  counters.sd_bytes_written     = 0xFFFF * 1024;
+  counters.sd_nb_syncs          = 0xFFFF;
+  for(uint8_t i = 0; i < CNSSRF_DT_SYS_COUNTERS_NB_DATARATES; i++) { counters.tx_ms[i] = 0xFFFF * 10; }
+  counters.tx_nb_retries        = 0xFF;
+  counters.sdi12_ms             = 0xFFFFFF;
+  counters.datalog_backlog      = 0xFFFF;
+  counters.watchdog_near_misses = 0xFF;
+  counters.nb_interruptions     = 0xFFFF;
+  counters.int_latency_ms       = 0xFFFFFF;
+  uint8_t max[COUNTERSTEST_VALUES_SIZE + 1];
+  max[0] = COUNTERSTEST_TYPE_ID;
+  memset(max + 1, 0xFF, COUNTERSTEST_VALUES_SIZE);
+  check_bytes("values at their type's maximum", &counters, max);
+
+  // One more saturates every value.
+  counters.nb_wakeups++;
+  counters.awake_ms++;
+  counters.sd_bytes_written += 1024;
+  counters.sd_nb_syncs++;
+  for(uint8_t i = 0; i < CNSSRF_DT_SYS_COUNTERS_NB_DATARATES; i++) { counters.tx_ms[i] += 10; }
+  counters.tx_nb_retries++;
+  counters.sdi12_ms++;
+  counters.datalog_backlog++;
+  counters.watchdog_near_misses++;
+  counters.nb_interruptions++;
+  counters.int_latency_ms++;
+  check_bytes("values just above their type's maximum are saturated", &counters, max);
+
+  set_all(&counters, UINT32_MAX);
+  check_bytes("32-bit maximums are saturated", &counters, max);
+
+  // Zeroes.
+  uint8_t zero[COUNTERSTEST_VALUES_SIZE + 1];
+  set_all(&counters, 0);
+  zero[0] = COUNTERSTEST_TYPE_ID;
+  memset(zero + 1, 0, COUNTERSTEST_VALUES_SIZE);
+  check_bytes("zeroes", &counters, zero);
+
+  // The format byte, the channel byte, the type id and the values; one byte short, then just enough.
+  check("frame too small", !write(&counters, bytes, &size, 1 + 1 + COUNTERSTEST_VALUES_SIZE));
+  check("frame just big enough", write(&counters, bytes, &size, 1 + 1 + 1 + COUNTERSTEST_VALUES_SIZE));
+
+  printf("%u failure(s).\n", (unsigned int)_nb_failed);
+  return _nb_failed ? 1 : 0;
+}
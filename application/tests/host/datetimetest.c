@@ -0,0 +1,200 @@
+/**
+ * Checks the date and time conversions of common/datetime.c against a straightforward
+ * reference implementation, for every day from 2000 to 2099, and measures their speed.
+ *
+ * @date   2019
+ */
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include "datetime.h"
+
+
+#define DATETIMETEST_FIRST_YEAR  2000
+#define DATETIMETEST_LAST_YEAR   2099
+#define DATETIMETEST_NB_BENCH    10000000u
+
+
+static const uint8_t _days_in_month[12] = { 31, 28, 31, 30, 31, 30, 31, 31, 30, 31, 30, 31 };
+static uint32_t      _nb_failed;
+static uint32_t      _rand_state = 0x2000;
+
+
+static bool is_leap(uint32_t year)
+{
+  return (year % 4 == 0 && year % 100 != 0) || year % 400 == 0;
+}
+
+static uint32_t days_in_month(uint32_t year, uint32_t month)
+{
+  return _days_in_month[month - 1] + (month == 2 && is_leap(year));
+}
+
+static uint32_t next_rand(void)
+{
+  _rand_state = _rand_state * 1103515245u + 12345u;
+  return _rand_state >> 1;
+}
+
+/**
+ * Reference conversion from a timestamp to a date, counting years and months one by one.
+ */
+static void ref_from_sec_2000(Datetime *pv_dt, ts2000_t ts)
+{
+  uint32_t days = ts / DT_SECONDS_IN_1DAY;
+  uint32_t secs = ts % DT_SECONDS_IN_1DAY;
+
+  pv_dt->year = 2000;
+  while(days >= (is_leap(pv_dt->year) ? DT_DAYS_IN_LEAP_YEAR : DT_DAYS_IN_YEAR))
+  {
+    days -= is_leap(pv_dt->year) ? DT_DAYS_IN_LEAP_YEAR : DT_DAYS_IN_YEAR;
+    pv_dt->year++;
+  }
+  for(pv_dt->month = 1; days >= days_in_month(pv_dt->year, pv_dt->month); pv_dt->month++)
+  {
+    days -= days_in_month(pv_dt->year, pv_dt->month);
+  }
+  pv_dt->day         = days + 1;
+  pv_dt->hours       = secs / DT_SECONDS_IN_1HOUR;
+  pv_dt->minutes     = secs / DT_SECONDS_IN_1MINUTE % DT_MINUTES_IN_1HOUR;
+  pv_dt->seconds     = secs % DT_SECONDS_IN_1MINUTE;
+  pv_dt->sub_seconds = 0;
+}
+
+/**
+ * Check the conversions, both ways, of one timestamp whose date and time are known.
+ */
+static void check(ts2000_t ts, const Datetime *pv_expected)
+{
+  Datetime dt;
+  ts2000_t res;
+
+  datetime_from_sec_2000(&dt, ts);
+  if(!datetime_equals(&dt, pv_expected, true))
+  {
+    if(_nb_failed++ < 10)
+    {
+      printf("FAIL  %u -> %04u-%02u-%02u %02u:%02u:%02u, expected %04u-%02u-%02u %02u:%02u:%02u\n",
+	     (unsigned int)ts, dt.year, dt.month, dt.day, dt.hours, dt.minutes, dt.seconds,
+	     pv_expected->year, pv_expected->month, pv_expected->day,
+	     pv_expected->hours, pv_expected->minutes, pv_expected->seconds);
+    }
+  }
+  if((res = datetime_to_timestamp_sec_2000(pv_expected)) != ts)
+  {
+    if(_nb_failed++ < 10)
+    {
+      printf("FAIL  %04u-%02u-%02u %02u:%02u:%02u -> %u, expected %u\n",
+	     pv_expected->year, pv_expected->month, pv_expected->day,
+	     pv_expected->hours, pv_expected->minutes, pv_expected->seconds,
+	     (unsigned int)res, (unsigned int)ts);
+    }
+  }
+}
+
+static double now_ns(void)
+{
+  struct timespec ts;
+
+  clock_gettime(CLOCK_MONOTONIC, &ts);
+  return ts.tv_sec * 1e9 + ts.tv_nsec;
+}
+
+/**
+ * Measure the average duration of a conversion from timestamps.
+ *
+ * @param[in] ps_name the measure's name.
+ * @param[in] pf_conv the conversion function.
+ * @param[in] step    the step between two consecutive timestamps, in seconds.
+ */
+static void bench(const char *ps_name, Datetime *(*pf_conv)(Datetime *, ts2000_t), uint32_t step)
+{
+  Datetime dt;
+  uint32_t i, sum = 0;
+  ts2000_t ts = 600000000;
+  double   start;
+
+  start = now_ns();
+  for(i = 0; i < DATETIMETEST_NB_BENCH; i++, ts += step)
+  {
+    pf_conv(&dt, ts);
+    sum += dt.day + dt.seconds;
+  }
+  printf("  %-40s %6.1f ns per conversion (%u)\n",
+	 ps_name, (now_ns() - start) / DATETIMETEST_NB_BENCH, (unsigned int)(sum & 1));
+}
+
+static Datetime *ref_from_sec_2000_bench(Datetime *pv_dt, ts2000_t ts)
+{
+  ref_from_sec_2000(pv_dt, ts);
+  return pv_dt;
+}
+
+int main(int argc, char *argv[])
+{
+  Datetime dt, prev;
+  uint32_t days, secs, year, month, day, i;
+  ts2000_t ts;
+
+  // Every day, at midnight, at the last second and at a random time; walk forward, so that
+  // the cached day is the previous day, or the same day with another time.
+  days = 0;
+  for(year = DATETIMETEST_FIRST_YEAR; year <= DATETIMETEST_LAST_YEAR; year++)
+  {
+    for(month = 1; month <= 12; month++)
+    {
+      for(day = 1; day <= days_in_month(year, month); day++, days++)
+      {
+	datetime_init(&dt, year, month, day, 0,  0,  0,  0); check(days * DT_SECONDS_IN_1DAY,         &dt);
+	datetime_init(&dt, year, month, day, 23, 59, 59, 0); check(days * DT_SECONDS_IN_1DAY + 86399, &dt);
+	secs = next_rand() % DT_SECONDS_IN_1DAY;
+	datetime_init(&dt, year, month, day, secs / 3600, secs / 60 % 60, secs % 60, 0);
+	check(days * DT_SECONDS_IN_1DAY + secs, &dt);
+
+	if(datetime_values_to_timestamp_sec_2000(year, month, day, 12, 34, 56) !=
+	    days * DT_SECONDS_IN_1DAY + 12 * 3600 + 34 * 60 + 56)
+	{
+	  if(_nb_failed++ < 10) { printf("FAIL  values %04u-%02u-%02u\n", year, month, day); }
+	}
+      }
+    }
+  }
+  printf("%s  %u days from %u to %u\n",
+	 _nb_failed ? "FAIL" : "ok  ", days, DATETIMETEST_FIRST_YEAR, DATETIMETEST_LAST_YEAR);
+
+  // Every second of a few days, including leap days and year boundaries.
+  {
+    static const ts2000_t starts[] = { 0, 5097600, 946598400, 3155587200u, 1546214400 };
+    for(i = 0; i < sizeof(starts) / sizeof(*starts); i++)
+    {
+      for(ts = starts[i]; ts < starts[i] + 2 * DT_SECONDS_IN_1DAY; ts++)
+      {
+	ref_from_sec_2000(&dt, ts);
+	check(ts, &dt);
+      }
+    }
+  }
+  printf("%s  every second of 10 days\n", _nb_failed ? "FAIL" : "ok  ");
+
+  // Random timestamps, so that the cached day is almost never the right one.
+  for(i = 0; i < 1000000; i++)
+  {
+    ts = next_rand() % (days * DT_SECONDS_IN_1DAY);
+    ref_from_sec_2000(&dt, ts);
+    check(ts, &dt);
+    datetime_from_sec_2000(&prev, ts ^ 0x10000);  // Change the cached day
+  }
+  printf("%s  1000000 random timestamps\n", _nb_failed ? "FAIL" : "ok  ");
+
+  if(argc > 1 && !strcmp(argv[1], "--bench"))
+  {
+    printf("Conversions from timestamps:\n");
+    bench("closed form, 1 second steps",        datetime_from_sec_2000,  1);
+    bench("closed form, 1 day and 1 s steps",   datetime_from_sec_2000,  86401);
+    bench("reference, 1 second steps",          ref_from_sec_2000_bench, 1);
+  }
+
+  printf("%u failure(s).\n", (unsigned int)_nb_failed);
+  return _nb_failed ? 1 : 0;
+}
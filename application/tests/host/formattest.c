@@ -0,0 +1,236 @@
+/**
+ * Checks the integer only number formatters of common/utils.c, used for the CSV output and the logs,
+ * against the C library's printf("%.<n>f"), and measures their speed.
+ * Magnitudes of 2^32 or more are written by snprintf() itself; they are checked too.
+ *
+ * @date   2019
+ */
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <math.h>
+#include <time.h>
+#include "utils.h"
+
+
+#define FORMATTEST_NB_RANDOM  1000000u
+#define FORMATTEST_NB_BENCH   5000000u
+
+
+static uint32_t _nb_failed;
+static uint32_t _nb_checked;
+static uint64_t _rand_state = 0x4353565F;
+
+
+static uint32_t next_rand(void)
+{
+  _rand_state = _rand_state * 6364136223846793005ull + 1442695040888963407ull;
+  return (uint32_t)(_rand_state >> 32);
+}
+
+static float float_from_bits(uint32_t u)
+{
+  union { float f; uint32_t u; } bits;
+
+  bits.u = u;
+  return bits.f;
+}
+
+static double double_from_bits(uint64_t u)
+{
+  union { double d; uint64_t u; } bits;
+
+  bits.u = u;
+  return bits.d;
+}
+
+/**
+ * Compare a formatter's output with the expected string, and check that it gives an empty string
+ * when the buffer is one character too small.
+ */
+static void compare(const char *ps_what, const char *ps_res, const char *ps_expected,
+		    const char *ps_small_res, uint8_t nb_decimals)
+{
+  _nb_checked++;
+  if(strcmp(ps_res, ps_expected) || *ps_small_res)
+  {
+    if(_nb_failed++ < 10)
+    {
+      printf("FAIL  %s with %u decimals: \"%s\", expected \"%s\"; with a too small buffer: \"%s\"\n",
+	     ps_what, nb_decimals, ps_res, ps_expected, ps_small_res);
+    }
+  }
+}
+
+/**
+ * Check strn_float_to_string() for one value.
+ */
+static void check_float(float value, uint8_t nb_decimals)
+{
+  char expected[64], res[64], small[64], what[32];
+  int  len;
+
+  len = snprintf(expected, sizeof(expected), "%.*f", nb_decimals, value);
+  if(isnan(value)) { strcpy(expected, "nan"); len = 3; }  // newlib does not print "-nan"
+
+  strn_float_to_string(res,   value, nb_decimals, sizeof(res), false);
+  strn_float_to_string(small, value, nb_decimals, len, false);
+  snprintf(what, sizeof(what), "%a", value);
+  compare(what, res, expected, small, nb_decimals);
+}
+
+/**
+ * Check strn_double_to_string() for one value.
+ */
+static void check_double(double value, uint8_t nb_decimals)
+{
+  char expected[512], res[512], small[512], what[32];
+  int  len;
+
+  len = snprintf(expected, sizeof(expected), "%.*f", nb_decimals, value);
+  if(isnan(value)) { strcpy(expected, "nan"); len = 3; }
+
+  strn_double_to_string(res,   value, nb_decimals, sizeof(res), false);
+  strn_double_to_string(small, value, nb_decimals, len, false);
+  snprintf(what, sizeof(what), "%a", value);
+  compare(what, res, expected, small, nb_decimals);
+}
+
+/**
+ * Check strn_fixed_to_string() for one value.
+ */
+static void check_fixed(int32_t value, uint8_t nb_decimals)
+{
+  char expected[64], res[64], small[64], what[32];
+  int  len;
+
+  // The value divided by 10^nb_decimals has at most 10 significant digits; a double is exact enough.
+  len = snprintf(expected, sizeof(expected), "%.*f", nb_decimals, value / pow(10, nb_decimals));
+  if(value < 0 && expected[0] != '-')
+  {
+    memmove(expected + 1, expected, ++len);
+    expected[0] = '-';
+  }
+
+  strn_fixed_to_string(res,   value, nb_decimals, sizeof(res), false);
+  strn_fixed_to_string(small, value, nb_decimals, len, false);
+  snprintf(what, sizeof(what), "%d", (int)value);
+  compare(what, res, expected, small, nb_decimals);
+}
+
+static double now_ns(void)
+{
+  struct timespec ts;
+
+  clock_gettime(CLOCK_MONOTONIC, &ts);
+  return ts.tv_sec * 1e9 + ts.tv_nsec;
+}
+
+static void bench(void)
+{
+  static float values[1024];
+  char     buffer[STR_FIXED_SIZE_MAX];
+  uint32_t i, sum = 0;
+  double   start, t_utils, t_printf;
+
+  for(i = 0; i < 1024; i++) { values[i] = (int32_t)(next_rand() % 200000 - 100000) / 1000.0f; }
+
+  start = now_ns();
+  for(i = 0; i < FORMATTEST_NB_BENCH; i++)
+  {
+    sum += *strn_float_to_string(buffer, values[i & 1023], 2, sizeof(buffer), false);
+  }
+  t_utils = (now_ns() - start) / FORMATTEST_NB_BENCH;
+
+  start = now_ns();
+  for(i = 0; i < FORMATTEST_NB_BENCH; i++)
+  {
+    sum += snprintf(buffer, sizeof(buffer), "%.2f", values[i & 1023]);
+  }
+  t_printf = (now_ns() - start) / FORMATTEST_NB_BENCH;
+
+  printf("Floats with 2 decimals, values in [-100..100]:\n");
+  printf("  strn_float_to_string() %6.1f ns per value\n", t_utils);
+  printf("  snprintf(\"%%.2f\")       %6.1f ns per value (%u)\n", t_printf, (unsigned int)(sum & 1));
+
+  start = now_ns();
+  for(i = 0; i < FORMATTEST_NB_BENCH; i++)
+  {
+    sum += *strn_double_to_string(buffer, values[i & 1023], 2, sizeof(buffer), false);
+  }
+  t_utils = (now_ns() - start) / FORMATTEST_NB_BENCH;
+  printf("  strn_double_to_string() %5.1f ns per value (%u)\n", t_utils, (unsigned int)(sum & 1));
+}
+
+int main(int argc, char *argv[])
+{
+  static const float special[] =
+  {
+      0.0f, -0.0f, 0.5f, 1.5f, 2.5f, -0.5f, 0.125f, 0.375f, 1e-10f, -1e-10f, 0.05f, 0.15f, 0.25f, 0.35f,
+      99.995f, 99.9949f, 4294967040.0f, 4294967296.0f, -4294967040.0f, 1e20f, -3.4028235e38f,
+      1.17549435e-38f, 1.4e-45f,
+      INFINITY, -INFINITY, NAN
+  };
+  uint32_t i, d;
+
+  // Particular values: ties, signed zeros, limits, subnormals, infinities and NaN.
+  for(i = 0; i < sizeof(special) / sizeof(*special); i++)
+  {
+    for(d = 0; d <= STR_FIXED_DECIMALS_MAX; d++) { check_float(special[i], d); }
+  }
+
+  // Random bit patterns cover all the exponents; random values in the sensors' ranges,
+  // with up to 3 decimals, are rounded at the last digit, where ties are likely.
+  for(i = 0; i < FORMATTEST_NB_RANDOM; i++)
+  {
+    check_float(float_from_bits(next_rand()),                                 next_rand() % (STR_FIXED_DECIMALS_MAX + 1));
+    check_float((int32_t)(next_rand() % 2000000 - 1000000) / 1000.0f,          next_rand() % 4);
+    check_float((int32_t)(next_rand() % 20000   - 10000)   / (float)(1 << (next_rand() % 12)), next_rand() % 4);
+  }
+  printf("%s  %u floats\n", _nb_failed ? "FAIL" : "ok  ", (unsigned int)_nb_checked);
+
+  // The same for doubles, and the values whose decimals carry into the integer part at 2^32.
+  _nb_checked = 0;
+  for(i = 0; i < sizeof(special) / sizeof(*special); i++)
+  {
+    for(d = 0; d <= STR_FIXED_DECIMALS_MAX; d++) { check_double(special[i], d); }
+  }
+  for(d = 0; d <= STR_FIXED_DECIMALS_MAX; d++)
+  {
+    check_double(4294967295.5,         d);
+    check_double(4294967295.9999999,   d);
+    check_double(-4294967295.99999999, d);
+    check_double(0.5e-9,               d);
+    check_double(1.0 / 3,              d);
+    check_double(101.32505,            d);
+    check_double(1e300,                d);
+    check_double(4.9e-324,             d);
+  }
+  for(i = 0; i < FORMATTEST_NB_RANDOM; i++)
+  {
+    // Only a few random bit patterns: most are huge, and snprintf() writes their hundreds of digits.
+    if(!(i % 16)) { check_double(double_from_bits(((uint64_t)next_rand() << 32) | next_rand()), next_rand() % 10); }
+    // Magnitudes from 2^-31 to 2^64, where the decimals are extracted by integer operations.
+    check_double(double_from_bits(((uint64_t)(0x3E0 + next_rand() % 0x60) << 52) |
+				  ((((uint64_t)next_rand() << 32) | next_rand()) & 0xFFFFFFFFFFFFFull)),
+		 next_rand() % (STR_FIXED_DECIMALS_MAX + 1));
+    check_double((int32_t)(next_rand() % 2000000 - 1000000) / 10000.0,           next_rand() % 5);
+    check_double((int32_t)(next_rand() % 20000   - 10000)   / (double)(1 << (next_rand() % 12)), next_rand() % 4);
+  }
+  printf("%s  %u doubles\n", _nb_failed ? "FAIL" : "ok  ", (unsigned int)_nb_checked);
+
+  _nb_checked = 0;
+  check_fixed(INT32_MIN, 0);
+  check_fixed(INT32_MAX, 9);
+  for(i = 0; i < FORMATTEST_NB_RANDOM; i++)
+  {
+    check_fixed((int32_t)next_rand(),                   next_rand() % (STR_FIXED_DECIMALS_MAX + 1));
+    check_fixed((int32_t)(next_rand() % 20001) - 10000, next_rand() % 5);
+  }
+  printf("%s  %u fixed point values\n", _nb_failed ? "FAIL" : "ok  ", (unsigned int)_nb_checked);
+
+  if(argc > 1 && !strcmp(argv[1], "--bench")) { bench(); }
+
+  printf("%u failure(s).\n", (unsigned int)_nb_failed);
+  return _nb_failed ? 1 : 0;
+}
@@ -0,0 +1,132 @@
+/**
+ * Host implementation of the HAL, board and peripheral functions called by the firmware modules
+ * built into the host programs. See stubs/hostenv.h.
+ *
+ * All the functions are weak, so that a program can provide its own version, or link the actual module.
+ *
+ * @date   2019
+ */
+#include <string.h>
+#include "hostenv.h"
+#include "gpio.h"
+#include "rtc.h"
+#include "usart.h"
+#include "board.h"
+#include "powerandclocks.h"
+
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+
+  RCC_TypeDef   host_rcc;
+  PWR_TypeDef   host_pwr;
+  SCB_Type      host_scb;
+  SysTick_Type  host_systick;
+  LPTIM_TypeDef host_lptim1;
+  ADC_TypeDef   host_adc1;
+  EXTI_TypeDef  host_exti;
+
+  uint32_t host_primask;
+  uint32_t host_ipsr;
+  uint32_t host_nb_wfi;
+  uint32_t host_tick_ms;
+
+  uint32_t host_rtc_ts2000 = 600000000;
+
+
+  __weak size_t strlcpy(char *ps_dest, const char *ps_src, size_t size)
+  {
+    size_t len = strlen(ps_src);
+
+    if(size)
+    {
+      size_t n = len < size - 1 ? len : size - 1;
+      memcpy(ps_dest, ps_src, n);
+      ps_dest[n] = '\0';
+    }
+    return len;
+  }
+
+  __weak size_t strlcat(char *ps_dest, const char *ps_src, size_t size)
+  {
+    size_t len = strnlen(ps_dest, size);
+
+    if(len == size) { return size + strlen(ps_src); }
+    return len + strlcpy(ps_dest + len, ps_src, size - len);
+  }
+
+
+  __weak LPTIM_TypeDef *host_lptim1_access(void) { return &host_lptim1; }
+
+
+  /*
+   * HAL
+   */
+  __weak uint32_t HAL_GetTick(void)        { return host_tick_ms; }
+  __weak void     HAL_Delay(uint32_t delay) { host_tick_ms += delay; }
+
+  __weak void HAL_NVIC_SetPriority(IRQn_Type irq, uint32_t prio, uint32_t sub) { (void)irq; (void)prio; (void)sub; }
+  __weak void HAL_NVIC_EnableIRQ(  IRQn_Type irq) { (void)irq; }
+  __weak void HAL_NVIC_DisableIRQ( IRQn_Type irq) { (void)irq; }
+
+  __weak void          HAL_GPIO_Init(   GPIO_TypeDef *pv_port, GPIO_InitTypeDef *pv_init) { (void)pv_port; (void)pv_init; }
+  __weak void          HAL_GPIO_DeInit( GPIO_TypeDef *pv_port, uint32_t pin)              { (void)pv_port; (void)pin;     }
+  __weak GPIO_PinState HAL_GPIO_ReadPin(GPIO_TypeDef *pv_port, uint16_t pin)              { (void)pv_port; (void)pin; return GPIO_PIN_RESET; }
+  __weak void          HAL_GPIO_WritePin(GPIO_TypeDef *pv_port, uint16_t pin, GPIO_PinState state)
+  {
+    (void)pv_port; (void)pin; (void)state;
+  }
+
+  __weak HAL_StatusTypeDef HAL_DMA_Init(  DMA_HandleTypeDef *pv_dma) { (void)pv_dma; return HAL_OK; }
+  __weak HAL_StatusTypeDef HAL_DMA_DeInit(DMA_HandleTypeDef *pv_dma) { (void)pv_dma; return HAL_OK; }
+  __weak HAL_StatusTypeDef HAL_DMA_Abort( DMA_HandleTypeDef *pv_dma) { (void)pv_dma; return HAL_OK; }
+  __weak void              HAL_DMA_IRQHandler(DMA_HandleTypeDef *pv_dma) { (void)pv_dma; }
+
+
+  /*
+   * Board and peripherals
+   */
+  __weak void board_watchdog_reset(void) { }
+
+  __weak GPIO_TypeDef *gpio_hal_port_and_pin_from_id(GPIOId gpio_id, uint32_t *pu32_pin)
+  {
+    (void)gpio_id;
+    if(pu32_pin) { *pu32_pin = GPIO_PIN_0; }
+    return GPIOA;
+  }
+  __weak void gpio_use_gpio_with_id(    GPIOId id)  { (void)id;  }
+  __weak void gpio_free_gpio_with_id(   GPIOId id)  { (void)id;  }
+  __weak void _gpio_use_gpios_with_ids( GPIOId ref, ...) { (void)ref; }
+  __weak void _gpio_free_gpios_with_ids(GPIOId ref, ...) { (void)ref; }
+
+  __weak void pwrclk_require(PwrClkRequirement *pv_req, PwrClkClockId clock, uint32_t min_hz)
+  {
+    pv_req->clock  = clock;
+    pv_req->min_hz = min_hz;
+  }
+  __weak void pwrclk_release(PwrClkRequirement *pv_req) { (void)pv_req; }
+
+  __weak ts2000_t rtc_get_date_as_secs_since_2000(void) { return host_rtc_ts2000; }
+  __weak void     rtc_get_date(Datetime *pv_time)       { datetime_from_sec_2000(pv_time, host_rtc_ts2000); }
+
+  __weak USART      *usart_get_by_name(const char *ps_name) { (void)ps_name; return NULL; }
+  __weak const char *usart_name(  USART *pv_usart) { (void)pv_usart; return ""; }
+  __weak void        usart_sleep( USART *pv_usart) { (void)pv_usart; }
+  __weak void        usart_wakeup(USART *pv_usart) { (void)pv_usart; }
+  __weak bool        usart_open(  USART *pv_usart, const char *ps_user_name, uint32_t baudrate, USARTParams params)
+  {
+    (void)pv_usart; (void)ps_user_name; (void)baudrate; (void)params;
+    return false;
+  }
+  __weak bool        usart_write( USART *pv_usart, const uint8_t *pu8_data, uint16_t size, uint32_t timeout_ms)
+  {
+    (void)pv_usart; (void)pu8_data; (void)size; (void)timeout_ms;
+    return true;
+  }
+
+
+#ifdef __cplusplus
+}
+#endif
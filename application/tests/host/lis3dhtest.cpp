@@ -0,0 +1,207 @@
+/**
+ * Checks the statistics computed on the LIS3DH's FIFO stream, Drivers/Sensors/Internal/lis3dhstreamstats.cpp,
+ * against double precision computations on synthetic streams.
+ *
+ * The streams mimic what the accelerometer sees on a structure: gravity on a tilted device,
+ * noise, vibrations and shocks; they are read in FIFO sized batches, at the stream rates,
+ * over a 15 minutes reading period, for each full scale.
+ *
+ * @date   2019
+ */
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <math.h>
+#include "lis3dhstreamstats.hpp"
+
+
+#define LIS3DHTEST_FIFO_SIZE  32
+#define LIS3DHTEST_WATERMARK  24   // The firmware's FIFO level that triggers the reading.
+#define LIS3DHTEST_PERIOD_S   900
+
+/**
+ * Defines a synthetic stream.
+ */
+typedef struct Stream
+{
+  const char *ps_name;       ///< The stream's name.
+  double      tilt_deg;      ///< The device's tilt, from the vertical, in degrees.
+  double      noise_g;       ///< The noise's standard deviation, in g.
+  double      vib_g;         ///< The vibration's amplitude, in g.
+  double      vib_hz;        ///< The vibration's frequency, in Hz.
+  double      shock_g;       ///< The shocks' amplitude, in g.
+  double      shock_rate;    ///< The probability for a sample to be part of a shock.
+}
+Stream;
+
+
+static const Stream   _streams[] =
+{
+    { "at rest",                 0.0, 0.002, 0.0,  0.0,  0.0, 0.0    },
+    { "tilted at rest",         35.0, 0.002, 0.0,  0.0,  0.0, 0.0    },
+    { "vibrating",              10.0, 0.005, 0.3,  7.5,  0.0, 0.0    },
+    { "vibrating, with shocks",  0.0, 0.005, 0.1,  2.0,  3.0, 0.002  },
+    { "saturating shocks",      80.0, 0.01,  0.05, 0.5, 40.0, 0.01   }
+};
+static const uint16_t _rates_hz[]    = { 1, 10, 100, 400 };
+static const uint8_t  _full_scales[] = { 2, 4, 8, 16 };
+static const uint16_t _thresholds[]  = { 0, 50, 500 };
+
+static uint64_t _rand_state = 0x4C495333;
+static bool     _ok         = true;
+
+
+static double next_uniform(void)
+{
+  _rand_state = _rand_state * 6364136223846793005ull + 1442695040888963407ull;
+  return ((_rand_state >> 11) + 0.5) / 9007199254740992.0;  // ]0..1[
+}
+
+static double next_gaussian(void)
+{
+  return sqrt(-2.0 * log(next_uniform())) * cos(2.0 * M_PI * next_uniform());
+}
+
+/**
+ * Convert an acceleration to the device's raw value, 12 bits left aligned, saturating at the full scale.
+ */
+static int16_t to_raw(double g, uint8_t full_scale)
+{
+  double counts = floor(g * 2047.0 / full_scale + 0.5);
+
+  if(counts >  2047.0) { counts =  2047.0; }
+  if(counts < -2048.0) { counts = -2048.0; }
+  return (int16_t)((int32_t)counts * 16);
+}
+
+/**
+ * Report a value's error, and check it against its bound.
+ */
+static bool report(const char *ps_what, double error, double bound)
+{
+  bool ok = error <= bound;
+
+  if(!ok) { printf("  FAIL  %-40s %10.3g  (bound %.3g)\n", ps_what, error, bound); }
+  _ok = _ok && ok;
+  return ok;
+}
+
+/**
+ * Stream a reading period and check the statistics.
+ */
+static bool check_stream(LIS3DHStreamStats *pv_stats, const Stream *pv_stream,
+			 uint16_t rate_hz, uint8_t full_scale, uint16_t threshold_mg)
+{
+  static int16_t fifo[LIS3DHTEST_FIFO_SIZE][3];
+  double   tilt = pv_stream->tilt_deg * M_PI / 180.0;
+  double   g[3], sum_sq[3] = { 0.0, 0.0, 0.0 }, counts, norm_mg, margin_mg;
+  int16_t  min[3] = { INT16_MAX, INT16_MAX, INT16_MAX }, max[3] = { INT16_MIN, INT16_MIN, INT16_MIN };
+  uint32_t n = (uint32_t)rate_hz * LIS3DHTEST_PERIOD_S, nb_sure = 0, nb_possible = 0, shock = 0;
+  uint32_t i, a, level = 0;
+  bool     ok = true;
+
+  pv_stats->setPeakThreshold(threshold_mg, full_scale);
+  pv_stats->reset();
+
+  // The reference does not count the samples whose norm is within about a count of the threshold:
+  // the firmware's limits are truncated to integer squared counts.
+  margin_mg = 1000.0 * full_scale / 2047.0 * 1.8;
+
+  for(i = 0; i < n; i++)
+  {
+    double t = (double)i / rate_hz;
+
+    g[0] = sin(tilt);
+    g[1] = 0.0;
+    g[2] = cos(tilt);
+    g[0] += pv_stream->vib_g * sin(2.0 * M_PI * pv_stream->vib_hz * t);
+    g[2] += pv_stream->vib_g * cos(2.0 * M_PI * pv_stream->vib_hz * t) * 0.5;
+    if(!shock && next_uniform() < pv_stream->shock_rate) { shock = 1 + rate_hz / 50; }
+    if(shock)
+    {
+      shock--;
+      g[next_uniform() * 3 < 1 ? 0 : 2] += pv_stream->shock_g * next_gaussian();
+    }
+
+    counts = 0.0;
+    for(a = 0; a < 3; a++)
+    {
+      fifo[level][a]  = to_raw(g[a] + pv_stream->noise_g * next_gaussian(), full_scale);
+      if(fifo[level][a] < min[a]) { min[a] = fifo[level][a]; }
+      if(fifo[level][a] > max[a]) { max[a] = fifo[level][a]; }
+      sum_sq[a]      += (double)(fifo[level][a] / 16) * (fifo[level][a] / 16);
+      counts         += (double)(fifo[level][a] / 16) * (fifo[level][a] / 16);
+    }
+    norm_mg = sqrt(counts) * full_scale / 2047.0 * 1000.0;
+    if(threshold_mg)
+    {
+      nb_sure     += fabs(norm_mg - 1000.0) > threshold_mg + margin_mg;
+      nb_possible += fabs(norm_mg - 1000.0) > threshold_mg - margin_mg;
+    }
+
+    // Empty the FIFO when it reaches the firmware's watermark, or at the end of the period.
+    if(++level == LIS3DHTEST_WATERMARK || i == n - 1)
+    {
+      for(a = 0; a < level; a++) { pv_stats->add(fifo[a]); }
+      level = 0;
+    }
+  }
+
+  ok = report("number of samples", fabs((double)pv_stats->nbSamples() - n), 0.0) && ok;
+  for(a = 0; a < 3; a++)
+  {
+    double rms = sqrt(sum_sq[a] / n);
+
+    ok = report("min and max", abs(pv_stats->min(a) - min[a]) + abs(pv_stats->max(a) - max[a]), 0.0) && ok;
+    // The sum of squares is exact; only its division and square root are in float.
+    ok = report("RMS, relative error", fabs(pv_stats->rmsCounts(a) - rms) / fmax(rms, 1.0), 2e-7) && ok;
+  }
+  if(pv_stats->nbPeaks() < nb_sure || pv_stats->nbPeaks() > nb_possible)
+  {
+    printf("  FAIL  %u peaks, expected %u to %u\n",
+	   (unsigned int)pv_stats->nbPeaks(), (unsigned int)nb_sure, (unsigned int)nb_possible);
+    _ok = ok = false;
+  }
+
+  printf("%s  %-24s %3u Hz  +/-%2u g  threshold %3u mg: %6u samples, %5u peaks\n",
+	 ok ? "ok  " : "FAIL", pv_stream->ps_name, rate_hz, full_scale, threshold_mg,
+	 (unsigned int)n, (unsigned int)pv_stats->nbPeaks());
+  return ok;
+}
+
+int main()
+{
+  LIS3DHStreamStats stats;
+  uint32_t          s, r, f, t;
+
+  for(s = 0; s < sizeof(_streams) / sizeof(*_streams); s++)
+  {
+    for(r = 0; r < sizeof(_rates_hz) / sizeof(*_rates_hz); r++)
+    {
+      for(f = 0; f < sizeof(_full_scales) / sizeof(*_full_scales); f++)
+      {
+	for(t = 0; t < sizeof(_thresholds) / sizeof(*_thresholds); t++)
+	{
+	  check_stream(&stats, &_streams[s], _rates_hz[r], _full_scales[f], _thresholds[t]);
+	}
+      }
+    }
+  }
+
+  // The statistics are reset, the peak threshold is kept.
+  stats.setPeakThreshold(100, 2);
+  stats.addOverrun();
+  stats.reset();
+  {
+    static const int16_t peak[3] = { 0, 0, 2047 * 16 };
+    stats.add(peak);
+  }
+  if(stats.nbSamples() != 1 || stats.nbPeaks() != 1 || stats.nbOverruns() != 0 || stats.rmsCounts(0) != 0.0f)
+  {
+    printf("FAIL  reset\n");
+    _ok = false;
+  }
+
+  printf("%s\n", _ok ? "ok" : "FAIL");
+  return _ok ? 0 : 1;
+}
@@ -0,0 +1,300 @@
+/**
+ * Checks the extension of LPTIM1's 16 bits counter to a 32 bits count,
+ * Middlewares/Peripherals/pulsecounter.c, against a simulated LPTIM1.
+ *
+ * The simulation counts the pulses between the firmware's register accesses; it sets the compare and
+ * auto-reload match flags when the counter reaches them, and runs the interruption handler just after
+ * an access if a flag is enabled and the interruptions are not masked. A read of the asynchronous
+ * counter while it changes can return a mix of its previous and new values. The counter never changes
+ * at every access: the firmware's reads are much faster than the pulses.
+ *  - the LPTIM is set up to count continuously over 16 bits, and to wake the µC up;
+ *  - the count is exact over several turns of the counter, with slow pulses, and with unreliable reads;
+ *  - the count is exact when it is read while the counter reaches a match value, the interruption
+ *    then being serviced after the read;
+ *  - wherever the count has last been read, the count stays exact when the match interruption is
+ *    serviced up to 32767 pulses late;
+ *  - the counter restarts from 0, and it can only be used once, on PULSE_COUNTER_GPIO.
+ *
+ * @date   2019
+ */
+#include <stdio.h>
+#include "pulsecounter.h"
+#include "board.h"
+
+
+#define PULSECOUNTERTEST_HALF_RANGE  0x7FFF  ///< PULSE_COUNTER_HALF_RANGE
+#define PULSECOUNTERTEST_MAX_LATENCY 32767   ///< The number of pulses the match interruptions can be serviced late.
+
+extern void LPTIM1_IRQHandler(void);
+
+
+static uint32_t _nb_failed;
+
+static uint64_t _rand_state = 0x4C505449;
+static bool     _nvic_enabled;        ///< Is the LPTIM1 interruption enabled in the NVIC?
+static bool     _in_handler;          ///< Is the simulation running the interruption handler?
+static uint16_t _cnt;                 ///< The simulated counter's value.
+static uint64_t _nb_pulses;           ///< The number of pulses counted since the counter has been started.
+static uint32_t _nb_interruptions;    ///< The number of times the interruption handler has run.
+static uint32_t _nb_accesses;         ///< The number of LPTIM1 register accesses.
+static uint32_t _pulse_period;        ///< A pulse occurs every _pulse_period accesses; 0 for none.
+static uint32_t _glitch_period;       ///< 1 in _glitch_period counter changes gives an unreliable read, randomly; 0 for none.
+
+
+static void check(const char *ps_what, bool ok)
+{
+  printf("%s  %s\n", ok ? "ok  " : "FAIL", ps_what);
+  if(!ok) { _nb_failed++; }
+}
+
+static uint32_t next_rand(void)
+{
+  _rand_state = _rand_state * 6364136223846793005ull + 1442695040888963407ull;
+  return (uint32_t)(_rand_state >> 33);
+}
+
+/**
+ * Indicate if nb pulses, from a counter value, reach a value.
+ */
+static bool reaches(uint16_t from, uint32_t nb, uint16_t value)
+{
+  uint32_t distance = (uint16_t)(value - from);
+
+  return nb >= (distance ? distance : 0x10000);
+}
+
+/**
+ * Count pulses, if the counter is started.
+ * ARR is 0xFFFF: the counter goes back to 0 after it.
+ */
+static void sim_pulses(uint32_t nb)
+{
+  LPTIM_TypeDef *pv_lptim = &host_lptim1;
+
+  if((pv_lptim->CR & (LPTIM_CR_ENABLE | LPTIM_CR_CNTSTRT)) != (LPTIM_CR_ENABLE | LPTIM_CR_CNTSTRT)) { return; }
+
+  if(reaches(_cnt, nb, (uint16_t)pv_lptim->ARR)) { pv_lptim->ISR |= LPTIM_ISR_ARRM; }
+  if(reaches(_cnt, nb, (uint16_t)pv_lptim->CMP)) { pv_lptim->ISR |= LPTIM_ISR_CMPM; }
+  _cnt        = (uint16_t)(_cnt + nb);
+  _nb_pulses += nb;
+}
+
+/**
+ * Run the interruption handler if a match interruption is pending, enabled and not masked.
+ */
+static void sim_service_interruption(void)
+{
+  LPTIM_TypeDef *pv_lptim = &host_lptim1;
+
+  if(host_primask || _in_handler || !_nvic_enabled ||
+     !(pv_lptim->ISR & pv_lptim->IER & (LPTIM_ISR_ARRM | LPTIM_ISR_CMPM))) { return; }
+
+  _in_handler = true;
+  host_ipsr   = 16 + LPTIM1_IRQn;
+  LPTIM1_IRQHandler();
+  host_ipsr   = 0;
+  _in_handler = false;
+  _nb_interruptions++;
+}
+
+/**
+ * The simulated LPTIM1, called at each of the firmware's register accesses.
+ */
+LPTIM_TypeDef *host_lptim1_access(void)
+{
+  LPTIM_TypeDef *pv_lptim = &host_lptim1;
+  uint32_t       mask, cnt;
+
+  // The flags cleared by the previous access; the register writes complete immediately
+  pv_lptim->ISR &= ~pv_lptim->ICR;
+  pv_lptim->ICR  = 0;
+  if(pv_lptim->CR & LPTIM_CR_ENABLE) { pv_lptim->ISR |= LPTIM_ISR_ARROK | LPTIM_ISR_CMPOK; }
+  else                               { _cnt           = 0;                                 }
+
+  // A read while the counter changes gets some bits of the previous value, and the others from the new one
+  _nb_accesses++;
+  cnt = _cnt;
+  if(_pulse_period && !(_nb_accesses % _pulse_period))
+  {
+    sim_pulses(1);
+    mask = _glitch_period && !(next_rand() % _glitch_period) ? next_rand() & 0xFFFF : 0;
+    cnt  = (cnt & mask) | (_cnt & ~mask);
+  }
+
+  // The interruption preempts the code just after the access, which gets the value read before
+  sim_service_interruption();
+  pv_lptim->CNT = cnt;
+
+  return pv_lptim;
+}
+
+void HAL_NVIC_EnableIRQ( IRQn_Type irq) { if(irq == LPTIM1_IRQn) { _nvic_enabled = true;  } }
+void HAL_NVIC_DisableIRQ(IRQn_Type irq) { if(irq == LPTIM1_IRQn) { _nvic_enabled = false; } }
+
+
+/**
+ * Check that a count is the number of pulses at some point during the read.
+ * A match interruption that occurred during the read is then serviced, as when the read unmasks them.
+ */
+static bool read_is_exact(void)
+{
+  uint64_t before = _nb_pulses;
+  uint32_t count  = pulsecounter_count(PULSE_COUNTER_GPIO);
+  bool     exact  = (uint32_t)(count - (uint32_t)before) <= _nb_pulses - before;
+
+  sim_service_interruption();
+  return exact;
+}
+
+/**
+ * Read the count repeatedly, while pulses occur.
+ */
+static void check_reads(const char *ps_what, uint32_t pulse_period, uint32_t glitch_period, uint32_t nb_reads)
+{
+  uint64_t start          = _nb_pulses;
+  uint32_t nb_errors      = 0;
+  uint32_t nb_interrupts  = _nb_interruptions;
+  char     what[128];
+
+  _pulse_period  = pulse_period;
+  _glitch_period = glitch_period;
+  for(uint32_t i = 0; i < nb_reads; i++)
+  {
+    if(!read_is_exact()) { nb_errors++; }
+  }
+  _pulse_period  = 0;
+  _glitch_period = 0;
+
+  snprintf(what, sizeof(what), "%s: %u pulses, %u interruptions", ps_what,
+	   (unsigned int)(_nb_pulses - start), (unsigned int)(_nb_interruptions - nb_interrupts));
+  check(what, !nb_errors && _nb_pulses - start > 3 * 0x10000 &&
+	_nb_interruptions - nb_interrupts >= 2 * ((_nb_pulses - start) >> 16));
+}
+
+/**
+ * Read the count while the counter reaches a match value: the pulses occur during the reads,
+ * at each of their register accesses in turn; the interruption is then serviced after the read.
+ */
+static void check_reads_racing_matches(void)
+{
+  static const uint16_t matches[] = { PULSECOUNTERTEST_HALF_RANGE, 0xFFFF };
+  uint32_t              nb_errors = 0, nb_reads_with_match = 0, nb_interrupts;
+
+  for(uint8_t m = 0; m < sizeof(matches) / sizeof(matches[0]); m++)
+  {
+    for(uint16_t offset = 1; offset <= 2; offset++)
+    {
+      for(uint32_t period = 3; period <= 5; period += 2)
+      {
+	for(uint32_t phase = 0; phase < period; phase++)
+	{
+	  // Bring the counter just before the match, without any pending interruption
+	  pulsecounter_count(PULSE_COUNTER_GPIO);
+	  sim_pulses((uint16_t)(matches[m] - offset - _cnt));
+	  sim_service_interruption();
+	  if(!read_is_exact()) { nb_errors++; }
+
+	  _nb_accesses  = phase;
+	  _pulse_period = period;
+	  nb_interrupts = _nb_interruptions;
+	  if(!read_is_exact()) { nb_errors++; }
+	  _pulse_period = 0;
+	  if(_nb_interruptions != nb_interrupts) { nb_reads_with_match++; }
+	  if((uint32_t)_nb_pulses != pulsecounter_count(PULSE_COUNTER_GPIO)) { nb_errors++; }
+	}
+      }
+    }
+  }
+  printf("      %u reads with a pending match interruption\n", (unsigned int)nb_reads_with_match);
+  check("reads while the counter reaches a match value", !nb_errors && nb_reads_with_match);
+}
+
+/**
+ * Service the match interruptions as late as possible, after a read at various counter values.
+ */
+static void check_late_interruptions(void)
+{
+  static const uint16_t last_reads[] =
+  {
+      0, 1, 2, PULSECOUNTERTEST_HALF_RANGE - 1, PULSECOUNTERTEST_HALF_RANGE, PULSECOUNTERTEST_HALF_RANGE + 1,
+      0xFFFE, 0xFFFF
+  };
+  uint32_t nb_errors = 0;
+  char     what[128];
+
+  for(uint32_t i = 0; i < sizeof(last_reads) / sizeof(last_reads[0]) + 100; i++)
+  {
+    uint16_t last_read = i < sizeof(last_reads) / sizeof(last_reads[0]) ? last_reads[i] : (uint16_t)next_rand();
+    uint16_t next_match;
+
+    // Read the count at that value
+    sim_pulses((uint16_t)(last_read - _cnt));
+    sim_service_interruption();
+    pulsecounter_count(PULSE_COUNTER_GPIO);
+
+    // Pulses while the interruptions are masked, up to the latest the match interruption can be serviced
+    next_match = last_read < PULSECOUNTERTEST_HALF_RANGE || last_read == 0xFFFF ? PULSECOUNTERTEST_HALF_RANGE : 0xFFFF;
+    host_primask = 1;
+    sim_pulses((uint16_t)(next_match - last_read) + PULSECOUNTERTEST_MAX_LATENCY);
+    host_primask = 0;
+    sim_service_interruption();
+
+    // The most pulses between two updates, then another interruption, without any read
+    host_primask = 1;
+    sim_pulses(0x8000 + PULSECOUNTERTEST_MAX_LATENCY);
+    host_primask = 0;
+    sim_service_interruption();
+
+    if((uint32_t)_nb_pulses != pulsecounter_count(PULSE_COUNTER_GPIO))
+    {
+      if(!nb_errors)
+      {
+	printf("      last read at 0x%04X: count %u, expected %u\n", (unsigned int)last_read,
+	       (unsigned int)pulsecounter_count(PULSE_COUNTER_GPIO), (unsigned int)_nb_pulses);
+      }
+      nb_errors++;
+    }
+    _nb_pulses = pulsecounter_count(PULSE_COUNTER_GPIO);  // Do not carry the errors to the next case
+  }
+  snprintf(what, sizeof(what), "interruptions serviced %u pulses late, after reads at any counter value",
+	   (unsigned int)PULSECOUNTERTEST_MAX_LATENCY);
+  check(what, !nb_errors);
+}
+
+int main(void)
+{
+  GPIOId other = PULSE_COUNTER_GPIO == ADC_ANA2_GPIO ? ADC_ANA1_GPIO : ADC_ANA2_GPIO;
+
+  check("available on its pin only", pulsecounter_is_available(PULSE_COUNTER_GPIO) &&
+	!pulsecounter_is_available(other) && !pulsecounter_start(other, PULSE_COUNTER_EDGE_RISING, GPIO_NOPULL));
+  check("started", pulsecounter_start(PULSE_COUNTER_GPIO, PULSE_COUNTER_EDGE_FALLING, GPIO_PULLUP));
+  check("counts the external input's edges continuously over 16 bits",
+	(host_lptim1.CFGR & LPTIM_CFGR_COUNTMODE) && (host_lptim1.CR & LPTIM_CR_CNTSTRT) &&
+	host_lptim1.ARR == 0xFFFF && host_lptim1.CMP == PULSECOUNTERTEST_HALF_RANGE);
+  check("match interruptions wake the µC up",
+	host_lptim1.IER == (LPTIM_IER_ARRMIE | LPTIM_IER_CMPMIE) && _nvic_enabled &&
+	(host_exti.IMR2 & EXTI_IMR2_IM32));
+  check("used once only", !pulsecounter_is_available(PULSE_COUNTER_GPIO) &&
+	!pulsecounter_start(PULSE_COUNTER_GPIO, PULSE_COUNTER_EDGE_RISING, GPIO_NOPULL));
+  check("no pulse", pulsecounter_count(PULSE_COUNTER_GPIO) == 0 && !pulsecounter_count(other));
+
+  check_reads("slow pulses",              7, 0, 1000000);
+  check_reads("a pulse every 3 accesses", 3, 0,  400000);
+  check_reads("unreliable reads",         5, 2,  600000);
+  check_reads_racing_matches();
+  check_late_interruptions();
+
+  // Stop, then start again
+  pulsecounter_stop(PULSE_COUNTER_GPIO);
+  check("stopped", !_nvic_enabled && !host_lptim1.CR && !pulsecounter_count(PULSE_COUNTER_GPIO) &&
+	pulsecounter_is_available(PULSE_COUNTER_GPIO));
+  _nb_pulses = 0;
+  check("restarted from 0", pulsecounter_start(PULSE_COUNTER_GPIO, PULSE_COUNTER_EDGE_BOTH, GPIO_NOPULL) &&
+	pulsecounter_count(PULSE_COUNTER_GPIO) == 0);
+  sim_pulses(1234);
+  check("counts after a restart", pulsecounter_count(PULSE_COUNTER_GPIO) == 1234);
+  pulsecounter_stop(PULSE_COUNTER_GPIO);
+
+  printf("%u failure(s).\n", (unsigned int)_nb_failed);
+  return _nb_failed ? 1 : 0;
+}
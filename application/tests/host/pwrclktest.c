@@ -0,0 +1,356 @@
+/**
+ * Checks the clock requirements of the power and clocks management, Middlewares/Environment/powerandclocks.c,
+ * on stubbed RCC and PWR HAL functions:
+ *  - requirements set before pwrclk_init() do not switch the clocks;
+ *  - the slowest clock configuration that satisfies all the active requirements is used:
+ *    the CPU's one, an opened USART's, for its baudrate, and the SD card's, for the MSI;
+ *  - I/O waits release the CPU's requirement, and can be nested;
+ *  - requirements can be updated, and released in any order; releasing an inactive one does nothing;
+ *  - the low-power run mode is used, and only used, by the LPRun configuration;
+ *  - the listeners are told about each clock configuration change.
+ *
+ * And the idle waits, pwrclk_idle_ms() and HAL_Delay(), with a simulated RTC alarm:
+ *  - Stop 2 is used for waits of PWRCLK_IDLE_STOP_MIN_MS or more without any active requirement,
+ *    entered in LPRun and left for the Run configuration, with the clocks set up again in between;
+ *  - Sleep, or LPSleep in LPRun, is used for shorter waits, or with an active requirement,
+ *    at the slowest configuration the requirements allow;
+ *  - the wake reason tells the deadline from another interruption; HAL_Delay() then idles again;
+ *  - HAL_Delay() busy waits in interruption handlers and before pwrclk_init().
+ *
+ * @date   2019
+ */
+#include <stdio.h>
+#include <string.h>
+#include "powerandclocks.h"
+#include "timer.h"
+
+
+#define PWRCLKTEST_USART_SYSCLK_HZ_PER_BAUD  100       ///< USART_SYSCLK_HZ_PER_BAUD
+#define PWRCLKTEST_SD_MSI_HZ                 48000000  ///< sdcard_periph_clock_freq_hz()
+
+
+static uint32_t _nb_failed;
+static uint32_t _nb_clock_changes;  ///< The number of clock configuration changes signalled.
+static bool     _bad_clock_change;  ///< Has a clock configuration change been signalled with wrong modes or frequencies?
+static uint32_t _signalled_hz;      ///< The system clock frequency at the last clock configuration change signalled.
+static uint32_t _nb_clock_configs;  ///< The number of calls to HAL_RCC_ClockConfig().
+
+static Timer   *_pv_idle_timer;     ///< The running idle timer, the RTC alarm. NULL if none.
+static uint32_t _idle_deadline_ms;  ///< The idle timer's deadline.
+static uint32_t _interruption_ms;   ///< If not 0, another interruption wakes us up after this many milliseconds.
+static bool     _tick_runs;         ///< Does each tick read take a millisecond? For the busy waits.
+static uint32_t _nb_sleeps;         ///< The number of Sleep mode entries, with the main regulator.
+static uint32_t _nb_lpsleeps;       ///< The number of LPSleep mode entries.
+static uint32_t _nb_stops;          ///< The number of Stop 2 mode entries.
+static uint32_t _idle_hz;           ///< The system clock frequency when the last idle mode was entered.
+static bool     _idle_lpr;          ///< Was the low-power run mode used when the last idle mode was entered?
+static PwrClkPowerMode _idle_mode;  ///< The last idle mode signalled.
+
+
+/*
+ * RCC and PWR
+ */
+uint32_t HAL_GetTick(void) { return _tick_runs ? host_tick_ms++ : host_tick_ms; }
+
+/**
+ * Idle until the idle timer's deadline, or until another interruption.
+ */
+static void idle(void)
+{
+  _idle_hz  = SystemCoreClock;
+  _idle_lpr = READ_BIT(PWR->CR1, PWR_CR1_LPR) != 0;
+  if(!_pv_idle_timer) { return; }
+
+  if(_interruption_ms && host_tick_ms + _interruption_ms < _idle_deadline_ms)
+  {
+    host_tick_ms    += _interruption_ms;
+    _interruption_ms = 0;
+    return;
+  }
+  host_tick_ms             = _idle_deadline_ms;
+  _pv_idle_timer->status  |= TIMER_STATUS_HAS_TIMED_OUT;
+}
+
+HAL_StatusTypeDef HAL_RCC_OscConfig(RCC_OscInitTypeDef *pv_init) { (void)pv_init; return HAL_OK; }
+HAL_StatusTypeDef HAL_RCCEx_PeriphCLKConfig(RCC_PeriphCLKInitTypeDef *pv_init) { (void)pv_init; return HAL_OK; }
+HAL_StatusTypeDef HAL_RCC_ClockConfig(RCC_ClkInitTypeDef *pv_init, uint32_t latency)
+{
+  (void)pv_init; (void)latency;
+  _nb_clock_configs++;
+  return HAL_OK;
+}
+void              HAL_RCC_MCOConfig(uint32_t mco, uint32_t source, uint32_t div) { (void)mco; (void)source; (void)div; }
+void              HAL_PWREx_EnableVddIO2(void) { }
+HAL_StatusTypeDef HAL_PWREx_ControlVoltageScaling(uint32_t scale) { (void)scale; return HAL_OK; }
+void              HAL_PWREx_EnableLowPowerRunMode(void)  { SET_BIT(  PWR->CR1, PWR_CR1_LPR); }
+HAL_StatusTypeDef HAL_PWREx_DisableLowPowerRunMode(void) { CLEAR_BIT(PWR->CR1, PWR_CR1_LPR); return HAL_OK; }
+void              HAL_PWREx_EnterSTOP1Mode(uint8_t entry) { (void)entry; }
+
+void HAL_PWR_EnterSLEEPMode(uint32_t regulator, uint8_t entry)
+{
+  (void)entry;
+  if(regulator == PWR_LOWPOWERREGULATOR_ON) { _nb_lpsleeps++; }
+  else                                      { _nb_sleeps++;   }
+  idle();
+}
+
+void HAL_PWREx_EnterSTOP2Mode(uint8_t entry)
+{
+  (void)entry;
+  _nb_stops++;
+  idle();
+  // Stop 2 is left with the main regulator.
+  CLEAR_BIT(PWR->CR1, PWR_CR1_LPR);
+}
+
+
+/*
+ * The idle timer, on the RTC alarm.
+ */
+void timer_init(Timer *pv_timer, TimerTime period, TimerOptions options)
+{
+  (void)options;
+  memset(pv_timer, 0, sizeof(*pv_timer));
+  pv_timer->period = period;
+}
+
+void timer_start(Timer *pv_timer)
+{
+  _pv_idle_timer    = pv_timer;
+  _idle_deadline_ms = host_tick_ms + pv_timer->period;
+  if(!pv_timer->period) { pv_timer->status |= TIMER_STATUS_HAS_TIMED_OUT; }
+}
+
+void timer_stop(Timer *pv_timer) { if(pv_timer == _pv_idle_timer) { _pv_idle_timer = NULL; } }
+
+
+static void signal_power_mode_change(PwrClkPowerMode current_mode, PwrClkPowerMode previous_mode)
+{
+  uint32_t hz;
+
+  if(current_mode > PWRCLK_POWER_MODE_LPRUN) { _idle_mode = current_mode; }
+  if(!pwrclk_is_clock_config_change(current_mode, previous_mode)) { return; }
+
+  // The new frequencies are already set, and the mode is the new configuration's.
+  hz                = pwrclk_clock_frequency_hz(PWRCLK_CLOCK_SYSCLK);
+  _bad_clock_change = _bad_clock_change || hz == _signalled_hz || SystemCoreClock != hz ||
+      (current_mode == PWRCLK_POWER_MODE_LPRUN) != (hz == 2000000);
+  _signalled_hz     = hz;
+  _nb_clock_changes++;
+}
+
+static PwrClkPowerModeChangeListener _listener = { "test", signal_power_mode_change, NULL };
+
+
+static void check(const char *ps_what, bool ok)
+{
+  printf("%s  %s\n", ok ? "ok  " : "FAIL", ps_what);
+  if(!ok) { _nb_failed++; }
+}
+
+/**
+ * Check the current clock configuration, using its system clock frequency.
+ * The low-power run mode MUST be used if, and only if, it is 2 MHz.
+ */
+static void check_sysclk(const char *ps_what, uint32_t expected_hz)
+{
+  uint32_t hz = pwrclk_clock_frequency_hz(PWRCLK_CLOCK_SYSCLK);
+  bool     ok = hz == expected_hz && SystemCoreClock == hz &&
+      (READ_BIT(PWR->CR1, PWR_CR1_LPR) != 0) == (hz == 2000000);
+
+  printf("%s  %s: %u Hz\n", ok ? "ok  " : "FAIL", ps_what, (unsigned int)hz);
+  if(!ok) { _nb_failed++; }
+}
+
+static uint32_t nb_idles(void) { return _nb_sleeps + _nb_lpsleeps + _nb_stops; }
+
+static void reset_idle_counts(void)
+{
+  _nb_sleeps = _nb_lpsleeps = _nb_stops = 0;
+  _idle_hz   = 0;
+  _idle_mode = PWRCLK_POWER_MODE_RUN;
+}
+
+/**
+ * Idle until a deadline, and check the mode and the clock configuration used.
+ * The configuration MUST be the Run one before the wait, and MUST be again after.
+ *
+ * @param[in] ps_what     the check's description.
+ * @param[in] ms          the wait's duration, in milliseconds.
+ * @param[in] mode        the idle mode expected.
+ * @param[in] expected_hz the system clock frequency expected when entering the idle mode.
+ */
+static void check_idle(const char *ps_what, uint32_t ms, PwrClkPowerMode mode, uint32_t expected_hz)
+{
+  uint32_t         start      = host_tick_ms;
+  uint32_t         nb_configs = _nb_clock_configs;
+  PwrClkWakeReason reason;
+  bool             ok;
+
+  reset_idle_counts();
+  reason = pwrclk_idle_ms(ms);
+  ok     = reason == PWRCLK_WAKE_REASON_TIMEOUT && host_tick_ms - start == ms && nb_idles() == 1 &&
+      _idle_mode == mode && _idle_hz == expected_hz && _idle_lpr == (expected_hz == 2000000) &&
+      (mode == PWRCLK_POWER_MODE_STOP2   ? _nb_stops    :
+       mode == PWRCLK_POWER_MODE_LPSLEEP ? _nb_lpsleeps : _nb_sleeps) == 1 &&
+      pwrclk_clock_frequency_hz(PWRCLK_CLOCK_SYSCLK) == 48000000 && !READ_BIT(PWR->CR1, PWR_CR1_LPR) &&
+      // LPRun, the clocks set up again after Stop 2, then Run.
+      (mode != PWRCLK_POWER_MODE_STOP2 || _nb_clock_configs - nb_configs == 3);
+
+  printf("%s  %s: %s at %u Hz, %u clock configurations\n", ok ? "ok  " : "FAIL", ps_what,
+	 _nb_stops ? "Stop 2" : _nb_lpsleeps ? "LPSleep" : _nb_sleeps ? "Sleep" : "no idle",
+	 (unsigned int)_idle_hz, (unsigned int)(_nb_clock_configs - nb_configs));
+  if(!ok) { _nb_failed++; }
+}
+
+/**
+ * Call HAL_Delay() and check the time elapsed.
+ *
+ * @return the number of idle mode entries.
+ */
+static uint32_t check_delay(const char *ps_what, uint32_t ms)
+{
+  uint32_t start = host_tick_ms;
+  char     what[96];
+
+  reset_idle_counts();
+  HAL_Delay(ms);
+  snprintf(what, sizeof(what), "%s: the delay has elapsed", ps_what);
+  check(what, host_tick_ms - start >= ms && (_tick_runs || host_tick_ms - start == ms));
+
+  return nb_idles();
+}
+
+int main(void)
+{
+  PwrClkRequirement usart = { "USART", PWRCLK_CLOCK_SYSCLK, 0, NULL };
+  PwrClkRequirement sd    = { "SD",    PWRCLK_CLOCK_MSI,    0, NULL };
+  uint32_t          nb_changes, nb_configs, start;
+  PwrClkWakeReason  reason;
+
+  // Before pwrclk_init(), HAL_Delay() busy waits.
+  _tick_runs = true;
+  check("before initialisation: HAL_Delay() busy waits", check_delay("before initialisation: HAL_Delay()", 10) == 0);
+  _tick_runs = false;
+
+  // Before pwrclk_init(), the requirements are recorded, but the clocks are left as they are.
+  pwrclk_require(&usart, PWRCLK_CLOCK_SYSCLK, 9600 * PWRCLKTEST_USART_SYSCLK_HZ_PER_BAUD);
+  pwrclk_release(&usart);
+  check("before initialisation: the clocks are not configured", _nb_clock_configs == 0);
+
+  pwrclk_register_power_mode_change_listener(&_listener);
+  pwrclk_init();
+  _signalled_hz = pwrclk_clock_frequency_hz(PWRCLK_CLOCK_SYSCLK);
+  check_sysclk("initialisation: the CPU requires the Run configuration", 48000000);
+
+  // I/O waits, without any other requirement.
+  pwrclk_io_wait_begin();
+  check_sysclk("I/O wait: LPRun", 2000000);
+  pwrclk_io_wait_begin();
+  pwrclk_io_wait_end();
+  check_sysclk("nested I/O wait ended: still LPRun", 2000000);
+  pwrclk_io_wait_end();
+  check_sysclk("I/O waits ended: Run", 48000000);
+  nb_changes = _nb_clock_changes;
+  pwrclk_io_wait_end();
+  check_sysclk("unmatched I/O wait end: Run", 48000000);
+  check("unmatched I/O wait end: no clock change", _nb_clock_changes == nb_changes);
+
+  // The USART requires 100 Hz of system clock per baud.
+  pwrclk_require(&usart, PWRCLK_CLOCK_SYSCLK, 9600 * PWRCLKTEST_USART_SYSCLK_HZ_PER_BAUD);
+  pwrclk_io_wait_begin();
+  check_sysclk("I/O wait, USART at 9600 bauds: LPRun", 2000000);
+  pwrclk_require(&usart, PWRCLK_CLOCK_SYSCLK, 38400 * PWRCLKTEST_USART_SYSCLK_HZ_PER_BAUD);
+  check_sysclk("I/O wait, USART at 38400 bauds: Run 4 MHz", 4000000);
+  pwrclk_require(&usart, PWRCLK_CLOCK_SYSCLK, 115200 * PWRCLKTEST_USART_SYSCLK_HZ_PER_BAUD);
+  check_sysclk("I/O wait, USART at 115200 bauds: Run", 48000000);
+  pwrclk_require(&usart, PWRCLK_CLOCK_SYSCLK, 38400 * PWRCLKTEST_USART_SYSCLK_HZ_PER_BAUD);
+  check_sysclk("I/O wait, USART back to 38400 bauds: Run 4 MHz", 4000000);
+
+  // The SD card requires the MSI at 48 MHz; the release order does not matter.
+  pwrclk_require(&sd, PWRCLK_CLOCK_MSI, PWRCLKTEST_SD_MSI_HZ);
+  check_sysclk("I/O wait, USART and SD card: Run", 48000000);
+  pwrclk_release(&sd);
+  check_sysclk("SD card released: Run 4 MHz", 4000000);
+  pwrclk_release(&usart);
+  check_sysclk("USART released: LPRun", 2000000);
+
+  pwrclk_require(&usart, PWRCLK_CLOCK_SYSCLK, 38400 * PWRCLKTEST_USART_SYSCLK_HZ_PER_BAUD);
+  pwrclk_require(&sd,    PWRCLK_CLOCK_MSI,    PWRCLKTEST_SD_MSI_HZ);
+  pwrclk_release(&usart);
+  check_sysclk("USART released first: Run, for the SD card", 48000000);
+  pwrclk_release(&sd);
+  check_sysclk("SD card released: LPRun", 2000000);
+
+  nb_changes = _nb_clock_changes;
+  nb_configs = _nb_clock_configs;
+  pwrclk_release(&sd);
+  pwrclk_release(&usart);
+  check("inactive requirements released: no clock change",
+	_nb_clock_changes == nb_changes && _nb_clock_configs == nb_configs);
+
+  // The SD card's requirement does not end with the I/O wait.
+  pwrclk_require(&sd, PWRCLK_CLOCK_MSI, PWRCLKTEST_SD_MSI_HZ);
+  pwrclk_io_wait_end();
+  check_sysclk("I/O wait ended with the SD card's requirement: Run", 48000000);
+  pwrclk_io_wait_begin();
+  check_sysclk("I/O wait with the SD card's requirement: Run", 48000000);
+  pwrclk_release(&sd);
+  check_sysclk("SD card released during the I/O wait: LPRun", 2000000);
+  pwrclk_io_wait_end();
+  check_sysclk("I/O wait ended: Run", 48000000);
+
+  check("each clock configuration change is signalled once, with the new frequencies",
+	_nb_clock_changes + 1 == _nb_clock_configs && !_bad_clock_change);
+
+  // Idle waits without any requirement: Stop 2, entered in LPRun, or LPSleep for short ones.
+  check_idle("idle, no requirement",                  PWRCLK_IDLE_STOP_MIN_MS,     PWRCLK_POWER_MODE_STOP2,   2000000);
+  check_idle("short idle, no requirement",            PWRCLK_IDLE_STOP_MIN_MS - 1, PWRCLK_POWER_MODE_LPSLEEP, 2000000);
+  check_idle("long idle, no requirement",             60000,                       PWRCLK_POWER_MODE_STOP2,   2000000);
+
+  // With an active requirement, whatever the wait's duration: Sleep, as slow as possible.
+  pwrclk_require(&usart, PWRCLK_CLOCK_SYSCLK, 115200 * PWRCLKTEST_USART_SYSCLK_HZ_PER_BAUD);
+  check_idle("idle, USART at 115200 bauds",           100,                         PWRCLK_POWER_MODE_SLEEP,   48000000);
+  pwrclk_require(&usart, PWRCLK_CLOCK_SYSCLK, 38400 * PWRCLKTEST_USART_SYSCLK_HZ_PER_BAUD);
+  check_idle("idle, USART at 38400 bauds",            100,                         PWRCLK_POWER_MODE_SLEEP,   4000000);
+  pwrclk_require(&usart, PWRCLK_CLOCK_SYSCLK, 9600 * PWRCLKTEST_USART_SYSCLK_HZ_PER_BAUD);
+  check_idle("idle, USART at 9600 bauds",             100,                         PWRCLK_POWER_MODE_LPSLEEP, 2000000);
+  pwrclk_release(&usart);
+  pwrclk_require(&sd, PWRCLK_CLOCK_MSI, PWRCLKTEST_SD_MSI_HZ);
+  check_idle("idle, SD card",                         100,                         PWRCLK_POWER_MODE_SLEEP,   48000000);
+  pwrclk_release(&sd);
+
+  // Woken up by another interruption.
+  start            = host_tick_ms;
+  _interruption_ms = 3;
+  reason           = pwrclk_idle_ms(100);
+  check("idle, woken up by another interruption",
+	reason == PWRCLK_WAKE_REASON_INTERRUPTION && host_tick_ms - start == 3 && !_pv_idle_timer);
+
+  // HAL_Delay(): idles for the remaining time after another interruption.
+  nb_changes = _nb_clock_changes;
+  nb_configs = _nb_clock_configs;
+  check("HAL_Delay(PWRCLK_IDLE_STOP_MIN_MS): Stop 2",
+	check_delay("HAL_Delay(PWRCLK_IDLE_STOP_MIN_MS)", PWRCLK_IDLE_STOP_MIN_MS) == 1 && _nb_stops == 1);
+  printf("      HAL_Delay(PWRCLK_IDLE_STOP_MIN_MS): %u clock configurations, %u changes\n",
+	 (unsigned int)(_nb_clock_configs - nb_configs), (unsigned int)(_nb_clock_changes - nb_changes));
+  check("HAL_Delay(PWRCLK_IDLE_STOP_MIN_MS): LPRun, clocks set up again after Stop 2, then Run",
+	_nb_clock_configs - nb_configs == 3 && _nb_clock_changes - nb_changes == 2);
+  check("HAL_Delay(PWRCLK_IDLE_STOP_MIN_MS - 1): LPSleep",
+	check_delay("HAL_Delay(PWRCLK_IDLE_STOP_MIN_MS - 1)", PWRCLK_IDLE_STOP_MIN_MS - 1) == 1 && _nb_lpsleeps == 1);
+  _interruption_ms = 3;
+  check("HAL_Delay(20), another interruption after 3 ms: Stop 2 twice",
+	check_delay("HAL_Delay(20), another interruption after 3 ms", 20) == 2 && _nb_stops == 2);
+  check("HAL_Delay(0): no idle", check_delay("HAL_Delay(0)", 0) == 0);
+
+  // In an interruption handler, HAL_Delay() busy waits.
+  host_ipsr  = 16;
+  _tick_runs = true;
+  check("interruption handler: HAL_Delay() busy waits",
+	check_delay("interruption handler: HAL_Delay()", 10) == 0);
+  _tick_runs = false;
+  host_ipsr  = 0;
+
+  printf("%u failure(s).\n", (unsigned int)_nb_failed);
+  return _nb_failed ? 1 : 0;
+}
@@ -0,0 +1,134 @@
+/**
+ * Checks the platinum RTD conversion of Drivers/Sensors/rtd/rtd_pt.cpp against the
+ * IEC 60751 Callendar-Van Dusen equation, over [-200..850] degC, for PT100, PT500 and PT1000 sensors,
+ * and measures its speed.
+ *
+ * The program is built twice: with the default table conversion and with the rational polynomial.
+ *
+ * @date   2019
+ */
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <math.h>
+#include <time.h>
+#include "rtd_pt.hpp"
+
+
+#define RTDTEST_STEP_DEGC  0.01
+#define RTDTEST_NB_BENCH   10000000u
+
+// IEC 60751 coefficients
+#define CVD_A   3.9083e-3
+#define CVD_B  -5.775e-7
+#define CVD_C  -4.183e-12
+
+
+/**
+ * Compute a platinum RTD's resistance ratio, R / R0, for a temperature, using the IEC 60751 equation.
+ *
+ * @param[in] t the temperature, in degC.
+ *
+ * @return the ratio.
+ */
+static double cvd_ratio(double t)
+{
+  return 1.0 + CVD_A * t + CVD_B * t * t + (t < 0 ? CVD_C * (t - 100.0) * t * t * t : 0.0);
+}
+
+static double now_ns(void)
+{
+  struct timespec ts;
+
+  clock_gettime(CLOCK_MONOTONIC, &ts);
+  return ts.tv_sec * 1e9 + ts.tv_nsec;
+}
+
+int main(int argc, char *argv[])
+{
+  static const char *names[] = { "PT100", "PT500", "PT1000" };
+  double   max_error = 0.0;
+  double   worst     = 0.0;
+  bool     ok        = true;
+  bool     do_bench  = false;
+  uint32_t i, n;
+  int      a;
+
+  for(a = 1; a < argc; a++)
+  {
+    if(     !strcmp(argv[a], "--bench"))                     { do_bench  = true; }
+    else if(!strcmp(argv[a], "--max-error") && a + 1 < argc) { max_error = atof(argv[++a]); }
+    else
+    {
+      fprintf(stderr, "Usage: %s [--max-error DEGC] [--bench]\n", argv[0]);
+      return 2;
+    }
+  }
+
+  for(i = 0; i < sizeof(names) / sizeof(*names); i++)
+  {
+    RTDPT  rtd;
+    double r0, t, error, sensor_worst = 0.0, worst_t = 0.0;
+
+    if(!rtd.setOhmsAt0DegCUsingName(names[i]))
+    {
+      printf("FAIL  %s: name not recognised\n", names[i]);
+      ok = false;
+      continue;
+    }
+    r0 = atof(names[i] + 2);
+
+    for(n = 0, t = -200.0; t <= 850.0 + RTDTEST_STEP_DEGC / 2; t = -200.0 + ++n * RTDTEST_STEP_DEGC)
+    {
+      if(!rtd.updateTemperatureUsingResistance((float)(r0 * cvd_ratio(t))))
+      {
+	// The conversion error, or the rounding to float, can put temperatures close to -200 degC
+	// just below the range, where they are rejected.
+	if(t > -200.0 + (max_error ? max_error : RTDTEST_STEP_DEGC / 2))
+	{
+	  printf("FAIL  %s: no temperature for %.2f degC\n", names[i], t);
+	  ok = false;
+	}
+	continue;
+      }
+      error = fabs(rtd.temperatureDegC() - t);
+      if(error > sensor_worst) { sensor_worst = error; worst_t = t; }
+    }
+    printf("%s  %-6s  %u temperatures, largest error %.4f degC at %.2f degC\n",
+	   max_error && sensor_worst > max_error ? "FAIL" : "ok  ",
+	   names[i], (unsigned int)n, sensor_worst, worst_t);
+    if(sensor_worst > worst) { worst = sensor_worst; }
+  }
+  if(max_error && worst > max_error) { ok = false; }
+
+  // Out of range resistances
+  {
+    RTDPT rtd(100.0f);
+    if(rtd.updateTemperatureUsingResistance(100.0f * cvd_ratio(-201.0)) ||
+       rtd.updateTemperatureUsingResistance(0.0f))
+    {
+      printf("FAIL  resistances below -200 degC give a temperature\n");
+      ok = false;
+    }
+  }
+
+  if(do_bench)
+  {
+    static float ohms[1024];
+    RTDPT  rtd(100.0f);
+    float  sum = 0.0f;
+    double start;
+
+    for(i = 0; i < 1024; i++) { ohms[i] = 100.0 * cvd_ratio(-200.0 + 1050.0 * i / 1024); }
+    start = now_ns();
+    for(i = 0; i < RTDTEST_NB_BENCH; i++)
+    {
+      rtd.updateTemperatureUsingResistance(ohms[i & 1023]);
+      sum += rtd.temperatureDegC();
+    }
+    printf("  %.1f ns per conversion (%d)\n", (now_ns() - start) / RTDTEST_NB_BENCH, sum > 0.0f);
+  }
+
+  printf("%s\n", ok ? "ok" : "FAIL");
+  return ok ? 0 : 1;
+}
@@ -0,0 +1,143 @@
+/**
+ * Checks the write ordering of the SD card sector cache, Drivers/Modules/SD/sdcache.c:
+ *  - a flush writes the epochs in order and, in an epoch, the sectors in increasing address order;
+ *  - a barrier writes nothing;
+ *  - evicting a dirty sector first writes the dirty sectors of the previous epochs;
+ *  - multiple sector writes go to the card after the dirty sectors of the previous epochs;
+ *  - a sector written again after a barrier is written once, with the later epoch;
+ *  - reads evict clean sectors before dirty ones.
+ *
+ * The card is a log of the write commands.
+ *
+ * @date   2019
+ */
+#include <stdio.h>
+#include <string.h>
+#include "sdcache.h"
+
+
+#define SDCACHETEST_LOG_SIZE  64
+
+
+static DWORD    _log[SDCACHETEST_LOG_SIZE];  ///< The sectors written to the card, in order.
+static BYTE     _log_tag[SDCACHETEST_LOG_SIZE];  ///< The first byte of each sector written.
+static uint32_t _log_len;
+static uint32_t _nb_failed;
+
+
+static DRESULT card_read(BYTE *pu8_buffer, DWORD sector, UINT count)
+{
+  (void)sector;
+  memset(pu8_buffer, 0, count * SDCACHE_SECTOR_SIZE);
+  return RES_OK;
+}
+
+static DRESULT card_write(const BYTE *pu8_data, DWORD sector, UINT count)
+{
+  for(UINT i = 0; i < count && _log_len < SDCACHETEST_LOG_SIZE; i++, _log_len++)
+  {
+    _log[    _log_len] = sector + i;
+    _log_tag[_log_len] = pu8_data[i * SDCACHE_SECTOR_SIZE];
+  }
+  return RES_OK;
+}
+
+static void reset(void)
+{
+  sdcache_init(card_read, card_write);
+  _log_len = 0;
+}
+
+static void write_sector(DWORD sector, BYTE tag)
+{
+  BYTE data[SDCACHE_SECTOR_SIZE];
+
+  memset(data, tag, sizeof(data));
+  sdcache_write(data, sector, 1);
+}
+
+static void read_sector(DWORD sector)
+{
+  BYTE data[SDCACHE_SECTOR_SIZE];
+
+  sdcache_read(data, sector, 1);
+}
+
+/**
+ * Compare the card's write log with the expected sectors.
+ */
+static void check(const char *ps_what, const DWORD *pu32_expected, uint32_t nb_expected)
+{
+  bool ok = _log_len == nb_expected && !memcmp(_log, pu32_expected, nb_expected * sizeof(DWORD));
+
+  printf("%s  %s: written", ok ? "ok  " : "FAIL", ps_what);
+  for(uint32_t i = 0; i < _log_len; i++) { printf(" %u", (unsigned int)_log[i]); }
+  if(!ok)
+  {
+    printf("; expected");
+    for(uint32_t i = 0; i < nb_expected; i++) { printf(" %u", (unsigned int)pu32_expected[i]); }
+    _nb_failed++;
+  }
+  printf("\n");
+}
+
+#define CHECK(what, ...) \
+  do { const DWORD expected[] = { __VA_ARGS__ }; check(what, expected, sizeof(expected) / sizeof(DWORD)); } while(0)
+#define CHECK_NONE(what)  check(what, NULL, 0)
+
+
+int main(void)
+{
+  BYTE data[3 * SDCACHE_SECTOR_SIZE];
+
+  reset();
+  write_sector(30, 0); write_sector(10, 0);
+  sdcache_barrier();
+  write_sector(20, 0); write_sector(5, 0);
+  CHECK_NONE("barrier");
+  sdcache_flush();
+  CHECK("flush", 10, 30, 5, 20);
+
+  reset();
+  write_sector(100, 1);
+  sdcache_barrier();
+  write_sector(200, 2);
+  write_sector(100, 3);
+  sdcache_flush();
+  CHECK("sector written again after a barrier", 100, 200);
+  if(_log_tag[0] != 3)
+  {
+    printf("FAIL  sector written again after a barrier: its later content has not been written\n");
+    _nb_failed++;
+  }
+
+  reset();
+  write_sector(6, 0); write_sector(5, 0);
+  sdcache_barrier();
+  for(DWORD s = 0; s < SDCACHE_NB_SECTORS - 2; s++) { write_sector(20 + s, 0); }
+  read_sector(5); read_sector(6);
+  read_sector(1);  // All the sectors are dirty: evicts the least recently used one, 20.
+  CHECK("eviction of a dirty sector", 5, 6, 20);
+  sdcache_flush();
+
+  reset();
+  write_sector(7, 0);
+  read_sector(1); read_sector(2);
+  for(DWORD s = 0; s < SDCACHE_NB_SECTORS - 3; s++) { write_sector(500 + s, 0); }
+  read_sector(3);  // Evicts a clean sector, not sector 7.
+  CHECK_NONE("reads evict clean sectors first");
+  sdcache_flush();
+
+  reset();
+  write_sector(9, 0);
+  sdcache_barrier();
+  write_sector(8, 0);
+  memset(data, 0, sizeof(data));
+  sdcache_write(data, 300, 3);
+  CHECK("multiple sector write", 9, 300, 301, 302);
+  sdcache_flush();
+
+  printf("%u failure(s).\n", (unsigned int)_nb_failed);
+
+  return _nb_failed ? 1 : 0;
+}
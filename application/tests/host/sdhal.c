@@ -0,0 +1,110 @@
+/**
+ * The SD HAL functions used by the firmware's SD card driver, Drivers/Modules/SD/sdcard.c,
+ * implemented on the RAM disk image of sdimage.c.
+ *
+ * The transfers complete at once; the DMA completion callbacks are called before the
+ * functions return. The HAL's tick is advanced by the time the latency model gives to each access,
+ * so that the driver's timings, e.g. its seek statistics, reflect it.
+ *
+ * @date   2019
+ */
+#include <string.h>
+#include "hostenv.h"
+#include "sdimage.h"
+
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+
+  static uint64_t _sdhal_busy_us;  ///< The image's busy time already added to the HAL's tick.
+
+
+  /**
+   * Advance the HAL's tick by the time taken by the last accesses.
+   */
+  static void sdhal_advance_tick(void)
+  {
+    uint64_t busy_us = sdimage_stats()->busy_us;
+
+    // The image's statistics may have been reset.
+    if(busy_us < _sdhal_busy_us) { _sdhal_busy_us = 0; }
+    host_tick_ms   += (uint32_t)((busy_us - _sdhal_busy_us) / 1000);
+    _sdhal_busy_us  = busy_us - (busy_us - _sdhal_busy_us) % 1000;
+  }
+
+  HAL_StatusTypeDef HAL_SD_Init(SD_HandleTypeDef *hsd)
+  {
+    hsd->State = HAL_SD_STATE_READY;
+    return sdimage_nb_sectors() ? HAL_OK : HAL_ERROR;
+  }
+
+  HAL_StatusTypeDef HAL_SD_ConfigWideBusOperation(SD_HandleTypeDef *hsd, uint32_t WideMode)
+  {
+    hsd->Init.BusWide = WideMode;
+    return HAL_OK;
+  }
+
+  HAL_SD_CardStateTypedef HAL_SD_GetCardState(SD_HandleTypeDef *hsd)
+  {
+    (void)hsd;
+    return HAL_SD_CARD_TRANSFER;
+  }
+
+  HAL_StatusTypeDef HAL_SD_GetCardInfo(SD_HandleTypeDef *hsd, HAL_SD_CardInfoTypeDef *pCardInfo)
+  {
+    (void)hsd;
+    memset(pCardInfo, 0, sizeof(*pCardInfo));
+    pCardInfo->BlockNbr     = pCardInfo->LogBlockNbr  = sdimage_nb_sectors();
+    pCardInfo->BlockSize    = pCardInfo->LogBlockSize = SDIMAGE_SECTOR_SIZE;
+    return HAL_OK;
+  }
+
+  HAL_StatusTypeDef HAL_SD_ReadBlocks(SD_HandleTypeDef *hsd, uint8_t *pData,
+				      uint32_t BlockAdd, uint32_t NumberOfBlocks, uint32_t Timeout)
+  {
+    DRESULT res;
+
+    (void)hsd; (void)Timeout;
+    res = sdimage_read(pData, BlockAdd, NumberOfBlocks);
+    sdhal_advance_tick();
+    return res == RES_OK ? HAL_OK : HAL_ERROR;
+  }
+
+  HAL_StatusTypeDef HAL_SD_WriteBlocks(SD_HandleTypeDef *hsd, uint8_t *pData,
+				       uint32_t BlockAdd, uint32_t NumberOfBlocks, uint32_t Timeout)
+  {
+    DRESULT res;
+
+    (void)hsd; (void)Timeout;
+    res = sdimage_write(pData, BlockAdd, NumberOfBlocks);
+    sdhal_advance_tick();
+    return res == RES_OK ? HAL_OK : HAL_ERROR;
+  }
+
+  HAL_StatusTypeDef HAL_SD_ReadBlocks_DMA(SD_HandleTypeDef *hsd, uint8_t *pData,
+					  uint32_t BlockAdd, uint32_t NumberOfBlocks)
+  {
+    if(HAL_SD_ReadBlocks(hsd, pData, BlockAdd, NumberOfBlocks, 0) != HAL_OK) { return HAL_ERROR; }
+    HAL_SD_RxCpltCallback(hsd);
+    return HAL_OK;
+  }
+
+  HAL_StatusTypeDef HAL_SD_WriteBlocks_DMA(SD_HandleTypeDef *hsd, uint8_t *pData,
+					   uint32_t BlockAdd, uint32_t NumberOfBlocks)
+  {
+    if(HAL_SD_WriteBlocks(hsd, pData, BlockAdd, NumberOfBlocks, 0) != HAL_OK) { return HAL_ERROR; }
+    HAL_SD_TxCpltCallback(hsd);
+    return HAL_OK;
+  }
+
+  void HAL_SD_IRQHandler(SD_HandleTypeDef *hsd)
+  {
+    (void)hsd;
+  }
+
+
+#ifdef __cplusplus
+}
+#endif
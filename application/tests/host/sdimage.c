@@ -0,0 +1,326 @@
+/**
+ * Host storage backend for the SD card sector cache: a disk image held in RAM.
+ *
+ * The image is sparse: an erase block's memory is only allocated when it is first written to;
+ * the sectors never written to read as zeros.
+ *
+ * @date   2019
+ */
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include "sdimage.h"
+
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+
+#define SDIMAGE_NO_BLOCK  0xFFFFFFFFu
+
+
+  static BYTE         **_sdimage_blocks;              ///< The erase blocks' data; NULL for the blocks never written to.
+  static uint32_t       _sdimage_nb_sectors;           ///< The image's size, in sectors.
+  static uint32_t       _sdimage_block_nb_sectors;     ///< The erase block's size, in sectors.
+  static uint32_t      *_sdimage_block_programs;       ///< The number of programs of each erase block.
+  static uint32_t       _sdimage_last_block = SDIMAGE_NO_BLOCK;  ///< The erase block last written to.
+  static SDImageStats   _sdimage_stats;                ///< The counters.
+  static SDImageLatency _sdimage_latency =
+  {
+      .read_command_us    = 500,
+      .write_command_us   = 1000,
+      .sector_transfer_us = 45,
+      .sector_program_us  = 250,
+      .block_switch_us    = 3000
+  };
+
+
+  /**
+   * Create an empty disk image.
+   *
+   * @param[in] nb_sectors             the image's size, in sectors.
+   * @param[in] erase_block_nb_sectors the card's erase block size, in sectors.
+   *
+   * @return true  on success.
+   * @return false otherwise.
+   */
+  bool sdimage_open(uint32_t nb_sectors, uint32_t erase_block_nb_sectors)
+  {
+    uint32_t nb_blocks = nb_sectors / erase_block_nb_sectors + 1;
+
+    sdimage_close();
+
+    _sdimage_nb_sectors       = nb_sectors;
+    _sdimage_block_nb_sectors = erase_block_nb_sectors;
+    _sdimage_blocks           = calloc(nb_blocks, sizeof(BYTE *));
+    _sdimage_block_programs   = calloc(nb_blocks, sizeof(uint32_t));
+    memset(&_sdimage_stats, 0, sizeof(_sdimage_stats));
+
+    if(!_sdimage_blocks || !_sdimage_block_programs)
+    {
+      fprintf(stderr, "Not enough memory for the disk image.\n");
+      sdimage_close();
+      return false;
+    }
+    return true;
+  }
+
+  /**
+   * Free the disk image.
+   */
+  void sdimage_close(void)
+  {
+    if(_sdimage_blocks)
+    {
+      for(uint32_t b = 0; b <= _sdimage_nb_sectors / _sdimage_block_nb_sectors; b++) { free(_sdimage_blocks[b]); }
+    }
+    free(_sdimage_blocks);
+    free(_sdimage_block_programs);
+    _sdimage_blocks         = NULL;
+    _sdimage_block_programs = NULL;
+  }
+
+  /**
+   * Copy sectors from or to the image.
+   *
+   * @param[in,out] pu8_data the host side data. MUST be NOT NULL.
+   * @param[in]     sector   the first sector's address.
+   * @param[in]     count    the number of sectors.
+   * @param[in]     write    copy to the image? From the image otherwise.
+   *
+   * @return true  on success.
+   * @return false if a block could not be allocated.
+   */
+  static bool sdimage_copy(BYTE *pu8_data, DWORD sector, UINT count, bool write)
+  {
+    uint32_t b, offset;
+
+    for(; count; count--, sector++, pu8_data += SDIMAGE_SECTOR_SIZE)
+    {
+      b      = sector / _sdimage_block_nb_sectors;
+      offset = sector % _sdimage_block_nb_sectors * SDIMAGE_SECTOR_SIZE;
+      if(!_sdimage_blocks[b])
+      {
+	if(!write) { memset(pu8_data, 0, SDIMAGE_SECTOR_SIZE); continue; }
+	if(!(_sdimage_blocks[b] = calloc(_sdimage_block_nb_sectors, SDIMAGE_SECTOR_SIZE))) { return false; }
+      }
+      if(write) { memcpy(_sdimage_blocks[b] + offset, pu8_data, SDIMAGE_SECTOR_SIZE); }
+      else      { memcpy(pu8_data, _sdimage_blocks[b] + offset, SDIMAGE_SECTOR_SIZE); }
+    }
+
+    return true;
+  }
+
+  /**
+   * Get the image's size.
+   *
+   * @return the size, in sectors.
+   */
+  uint32_t sdimage_nb_sectors(void)
+  {
+    return _sdimage_nb_sectors;
+  }
+
+
+  /**
+   * Write a little endian 16 bits value.
+   */
+  static void sdimage_st16(BYTE *pu8, uint16_t v) { pu8[0] = v; pu8[1] = v >> 8; }
+
+  /**
+   * Write a little endian 32 bits value.
+   */
+  static void sdimage_st32(BYTE *pu8, uint32_t v) { sdimage_st16(pu8, v); sdimage_st16(pu8 + 2, v >> 16); }
+
+  /**
+   * Format the image with a FAT32 file system, like a SD card formatted by a computer.
+   * The firmware's FatFs configuration cannot format a volume, so this is done here.
+   *
+   * The statistics are reset afterwards.
+   *
+   * @param[in] cluster_nb_sectors the cluster's size, in sectors. A power of 2.
+   *
+   * @return true  on success.
+   * @return false if the image is too small for FAT32 with this cluster size, or on write error.
+   */
+  bool sdimage_format(uint8_t cluster_nb_sectors)
+  {
+    BYTE     sector[SDIMAGE_SECTOR_SIZE];
+    uint32_t reserved = 32;
+    uint32_t fat_size, nb_clusters, i, f;
+    bool     ok = true;
+
+    // The FAT's size depends on the number of clusters, which depends on the FAT's size.
+    fat_size    = ((_sdimage_nb_sectors - reserved) / cluster_nb_sectors + 2) * 4 / SDIMAGE_SECTOR_SIZE + 1;
+    nb_clusters = (_sdimage_nb_sectors - reserved - 2 * fat_size) / cluster_nb_sectors;
+    if(nb_clusters < 65525)
+    {
+      fprintf(stderr, "Image too small for FAT32 with %u sectors per cluster.\n", cluster_nb_sectors);
+      return false;
+    }
+
+    // Boot sector, and its backup
+    memset(sector, 0, sizeof(sector));
+    memcpy(sector, "\xEB\x58\x90" "MSDOS5.0", 11);
+    sdimage_st16(sector + 11, SDIMAGE_SECTOR_SIZE);
+    sector[13] = cluster_nb_sectors;
+    sdimage_st16(sector + 14, reserved);
+    sector[16] = 2;                              // Number of FATs
+    sector[21] = 0xF8;                           // Media
+    sdimage_st16(sector + 24, 63);               // Sectors per track
+    sdimage_st16(sector + 26, 255);              // Number of heads
+    sdimage_st32(sector + 32, _sdimage_nb_sectors);
+    sdimage_st32(sector + 36, fat_size);
+    sdimage_st32(sector + 44, 2);                // Root directory's cluster
+    sdimage_st16(sector + 48, 1);                // FSInfo sector
+    sdimage_st16(sector + 50, 6);                // Backup boot sector
+    sector[64] = 0x80;                           // Drive number
+    sector[66] = 0x29;                           // Extended boot signature
+    sdimage_st32(sector + 67, 0x434E5353);       // Volume serial number
+    memcpy(sector + 71, "NO NAME    FAT32   ", 19);
+    sdimage_st16(sector + 510, 0xAA55);
+    ok &= sdimage_write(sector, 0, 1) == RES_OK && sdimage_write(sector, 6, 1) == RES_OK;
+
+    // FSInfo sector, and its backup; the free clusters count is unknown
+    memset(sector, 0, sizeof(sector));
+    sdimage_st32(sector,       0x41615252);
+    sdimage_st32(sector + 484, 0x61417272);
+    sdimage_st32(sector + 488, 0xFFFFFFFF);
+    sdimage_st32(sector + 492, 0xFFFFFFFF);
+    sdimage_st32(sector + 508, 0xAA550000);
+    ok &= sdimage_write(sector, 1, 1) == RES_OK && sdimage_write(sector, 7, 1) == RES_OK;
+
+    // Both FATs: media, end of chain and the root directory's cluster
+    for(f = 0; f < 2; f++)
+    {
+      memset(sector, 0, sizeof(sector));
+      sdimage_st32(sector,     0x0FFFFFF8);
+      sdimage_st32(sector + 4, 0x0FFFFFFF);
+      sdimage_st32(sector + 8, 0x0FFFFFFF);
+      ok &= sdimage_write(sector, reserved + f * fat_size, 1) == RES_OK;
+      memset(sector, 0, sizeof(sector));
+      for(i = 1; i < fat_size; i++) { ok &= sdimage_write(sector, reserved + f * fat_size + i, 1) == RES_OK; }
+    }
+
+    // Empty root directory
+    for(i = 0; i < cluster_nb_sectors; i++)
+    {
+      ok &= sdimage_write(sector, reserved + 2 * fat_size + i, 1) == RES_OK;
+    }
+
+    memset(_sdimage_block_programs, 0,
+	   (_sdimage_nb_sectors / _sdimage_block_nb_sectors + 1) * sizeof(uint32_t));
+    sdimage_stats_reset();
+
+    return ok;
+  }
+
+
+  /**
+   * Read sectors from the image.
+   *
+   * @param[out] pu8_buffer where the data are written to. MUST be NOT NULL.
+   * @param[in]  sector     the first sector's address.
+   * @param[in]  count      the number of sectors to read.
+   *
+   * @return RES_OK     on success.
+   * @return RES_PARERR if the sectors are out of the image.
+   * @return RES_ERROR  on read error.
+   */
+  DRESULT sdimage_read(BYTE *pu8_buffer, DWORD sector, UINT count)
+  {
+    if(!count || sector + count > _sdimage_nb_sectors) { return RES_PARERR; }
+    if(!sdimage_copy(pu8_buffer, sector, count, false)) { return RES_ERROR; }
+
+    _sdimage_stats.nb_read_commands++;
+    _sdimage_stats.nb_sectors_read += count;
+    _sdimage_stats.busy_us         += _sdimage_latency.read_command_us +
+	(uint64_t)count * _sdimage_latency.sector_transfer_us;
+
+    return RES_OK;
+  }
+
+  /**
+   * Write sectors to the image.
+   *
+   * @param[in] pu8_data the data to write. MUST be NOT NULL.
+   * @param[in] sector   the first sector's address.
+   * @param[in] count    the number of sectors to write.
+   *
+   * @return RES_OK     on success.
+   * @return RES_PARERR if the sectors are out of the image.
+   * @return RES_ERROR  on write error.
+   */
+  DRESULT sdimage_write(const BYTE *pu8_data, DWORD sector, UINT count)
+  {
+    uint32_t first = sector               / _sdimage_block_nb_sectors;
+    uint32_t last  = (sector + count - 1) / _sdimage_block_nb_sectors;
+    uint32_t b;
+
+    if(!count || sector + count > _sdimage_nb_sectors) { return RES_PARERR; }
+    if(!sdimage_copy((BYTE *)pu8_data, sector, count, true)) { return RES_ERROR; }
+
+    // Each erase block touched by the command is programmed once.
+    for(b = first; b <= last; b++)
+    {
+      if(!_sdimage_block_programs[b]++) { _sdimage_stats.nb_blocks_programmed++; }
+      if(_sdimage_block_programs[b] > _sdimage_stats.max_block_programs)
+      {
+	_sdimage_stats.max_block_programs = _sdimage_block_programs[b];
+      }
+      _sdimage_stats.nb_block_programs++;
+    }
+    if(first != _sdimage_last_block)
+    {
+      _sdimage_stats.nb_block_switches++;
+      _sdimage_stats.busy_us += _sdimage_latency.block_switch_us;
+    }
+    _sdimage_last_block = last;
+
+    _sdimage_stats.nb_write_commands++;
+    _sdimage_stats.nb_sectors_written += count;
+    _sdimage_stats.busy_us            += _sdimage_latency.write_command_us +
+	(uint64_t)count * (_sdimage_latency.sector_transfer_us + _sdimage_latency.sector_program_us);
+
+    return RES_OK;
+  }
+
+
+  /**
+   * Set the latency model.
+   *
+   * @param[in] pv_latency the model. MUST be NOT NULL.
+   */
+  void sdimage_set_latency(const SDImageLatency *pv_latency)
+  {
+    _sdimage_latency = *pv_latency;
+  }
+
+  /**
+   * Get the counters.
+   *
+   * @return the counters.
+   */
+  const SDImageStats *sdimage_stats(void)
+  {
+    return &_sdimage_stats;
+  }
+
+  /**
+   * Reset the counters. The erase blocks' program counts are kept.
+   */
+  void sdimage_stats_reset(void)
+  {
+    uint32_t max = _sdimage_stats.max_block_programs;
+    uint32_t nb  = _sdimage_stats.nb_blocks_programmed;
+
+    memset(&_sdimage_stats, 0, sizeof(_sdimage_stats));
+    _sdimage_stats.max_block_programs   = max;
+    _sdimage_stats.nb_blocks_programmed = nb;
+  }
+
+
+#ifdef __cplusplus
+}
+#endif
@@ -0,0 +1,74 @@
+/**
+ * Host storage backend for the SD card sector cache: a disk image held in RAM.
+ *
+ * It provides the read and write functions given to sdcache_init(), like the firmware's
+ * SD card driver does, or used by the SD HAL functions of sdhal.c; and accounts for:
+ *  - the time the accesses would take on a card, using a simple latency model;
+ *  - the card's wear: the sectors written and the number of times each erase block is programmed.
+ *
+ * The latency model's default figures are orders of magnitude for a SD card on a 4 bits bus;
+ * they are meant to compare runs, not to predict absolute durations.
+ *
+ * @date   2019
+ */
+#ifndef TESTS_HOST_SDIMAGE_H_
+#define TESTS_HOST_SDIMAGE_H_
+
+#include "defs.h"
+#include "diskio.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+
+#define SDIMAGE_SECTOR_SIZE  512
+
+
+  /**
+   * Defines the latency model, in microseconds.
+   */
+  typedef struct SDImageLatency
+  {
+    uint32_t read_command_us;     ///< The time taken by each read command.
+    uint32_t write_command_us;    ///< The time taken by each write command, including the card's busy time.
+    uint32_t sector_transfer_us;  ///< The time taken to transfer one sector over the bus.
+    uint32_t sector_program_us;   ///< The time taken by the card to program one sector.
+    uint32_t block_switch_us;     ///< The extra time taken when a write goes to another erase block than the previous write.
+  }
+  SDImageLatency;
+
+  /**
+   * Defines the access and wear counters.
+   */
+  typedef struct SDImageStats
+  {
+    uint64_t nb_read_commands;      ///< The number of read commands.
+    uint64_t nb_write_commands;     ///< The number of write commands.
+    uint64_t nb_sectors_read;       ///< The number of sectors read.
+    uint64_t nb_sectors_written;    ///< The number of sectors written.
+    uint64_t nb_block_programs;     ///< The number of times an erase block has been programmed, all blocks included.
+    uint64_t nb_block_switches;     ///< The number of writes that went to another erase block than the previous one.
+    uint32_t max_block_programs;    ///< The highest number of programs of a single erase block.
+    uint32_t nb_blocks_programmed;  ///< The number of distinct erase blocks that have been programmed.
+    uint64_t busy_us;               ///< The total time the accesses would have taken.
+  }
+  SDImageStats;
+
+
+  extern bool    sdimage_open(  uint32_t nb_sectors, uint32_t erase_block_nb_sectors);
+  extern void    sdimage_close( void);
+  extern bool    sdimage_format(uint8_t cluster_nb_sectors);
+  extern DRESULT sdimage_read(  BYTE       *pu8_buffer, DWORD sector, UINT count);
+  extern DRESULT sdimage_write( const BYTE *pu8_data,   DWORD sector, UINT count);
+  extern uint32_t sdimage_nb_sectors(void);
+
+  extern void                sdimage_set_latency(const SDImageLatency *pv_latency);
+  extern const SDImageStats *sdimage_stats(      void);
+  extern void                sdimage_stats_reset(void);
+
+
+#ifdef __cplusplus
+}
+#endif
+#endif /* TESTS_HOST_SDIMAGE_H_ */
@@ -0,0 +1,353 @@
+/**
+ * Replays a month of the station's wakeups on a RAM disk, through the firmware's own SD card
+ * driver, sector cache, FatFs, data log, system log and sensor state store; and reports the
+ * card's accesses per wakeup, its access time and its wear.
+ *
+ * Each wakeup does what ConnecSenS does on the card:
+ *  - wakes the card up and writes the wakeup's system log lines;
+ *  - saves the sensors' states;
+ *  - appends a line to the CSV output file;
+ *  - adds the wakeup's CNSSRF data frame to the data log;
+ *  - gets the frame to send from the data log and marks it as sent;
+ *  - synchronises the data log and the state store, writes the sleep's log line
+ *    and puts the card to sleep.
+ *
+ * Thresholds can be given for the counters; the program then fails if one of them is exceeded,
+ * so that it can be used as a regression gate.
+ *
+ * @date   2019
+ */
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include "config.h"
+#include "rtc.h"
+#include "logger.h"
+#include "cnsslog.h"
+#include "sdcard.h"
+#include "sdcache.h"
+#include "datalog-cnssrf.h"
+#include "cnssrf-dataframe.h"
+#include "cnssrf-dt_timestamp.h"
+#include "cnssrf-dt_temperature.h"
+#include "cnssrf-dt_humidity.h"
+#include "cnssrf-dt_battvoltage.h"
+#include "sensorstatestore.hpp"
+#include "sdimage.h"
+
+
+  CREATE_LOGGER(sdreplay);
+#undef  logger
+#define logger  sdreplay
+
+
+#define SDREPLAY_IMAGE_NB_SECTORS     (4u * 1024 * 1024 * 2)  ///< 4 GiB
+#define SDREPLAY_CLUSTER_NB_SECTORS   64
+#define SDREPLAY_DEFAULT_NB_DAYS      30
+#define SDREPLAY_WAKEUP_PERIOD_S      600
+
+#define SDREPLAY_NB_SENSORS           4   ///< The number of sensors; each one saves a state at each wakeup.
+#define SDREPLAY_STATE_SIZE           24  ///< The size of a sensor's state.
+#define SDREPLAY_MAX_PAYLOAD_SIZE     51  ///< The network's maximum payload size; LoRaWAN's at SF12.
+#define SDREPLAY_CSV_FILE             OUTPUT_DATA_CSV_DIR "/3a2b1c0d.csv"
+#define SDREPLAY_DATALOG_FILE         DATALOG_DIR "/" DATALOG_CNSSRF_FILENAME
+
+
+/**
+ * Defines the accesses made during a wakeup.
+ */
+typedef struct SDReplayWakeupStats
+{
+  uint64_t nb_read_commands;    ///< The number of read commands.
+  uint64_t nb_sectors_read;     ///< The number of sectors read.
+  uint64_t nb_write_commands;   ///< The number of write commands.
+  uint64_t nb_sectors_written;  ///< The number of sectors written.
+  uint64_t nb_seeks;            ///< The number of seeks.
+  uint64_t busy_us;             ///< The time the accesses would have taken.
+}
+SDReplayWakeupStats;
+
+static SDReplayWakeupStats _sdreplay_total;  ///< The accesses of all the wakeups.
+static SDReplayWakeupStats _sdreplay_max;    ///< The accesses of the busiest wakeup, counter by counter.
+
+static CNSSRFDataFrame _sdreplay_frame;       ///< The frame built at each wakeup.
+static CNSSRFDataFrame _sdreplay_send_frame;  ///< The frame got from the data log to be sent.
+static uint8_t        _sdreplay_frame_buffer[     250];
+static CNSSRFMetaData _sdreplay_frame_meta[       120];
+static uint8_t        _sdreplay_send_frame_buffer[250];
+static CNSSRFMetaData _sdreplay_send_frame_meta[  120];
+
+
+/**
+ * Account for a wakeup's accesses.
+ *
+ * @param[in] pv_before the card's counters when the wakeup started. MUST be NOT NULL.
+ * @param[in] nb_seeks  the number of seeks made during the wakeup.
+ */
+static void sdreplay_account(const SDImageStats *pv_before, uint32_t nb_seeks)
+{
+  const SDImageStats *pv_after = sdimage_stats();
+  SDReplayWakeupStats wakeup;
+
+  wakeup.nb_read_commands   = pv_after->nb_read_commands   - pv_before->nb_read_commands;
+  wakeup.nb_sectors_read    = pv_after->nb_sectors_read    - pv_before->nb_sectors_read;
+  wakeup.nb_write_commands  = pv_after->nb_write_commands  - pv_before->nb_write_commands;
+  wakeup.nb_sectors_written = pv_after->nb_sectors_written - pv_before->nb_sectors_written;
+  wakeup.nb_seeks           = nb_seeks;
+  wakeup.busy_us            = pv_after->busy_us            - pv_before->busy_us;
+
+#define SDREPLAY_ACCOUNT(field) \
+  _sdreplay_total.field += wakeup.field; \
+  if(wakeup.field > _sdreplay_max.field) { _sdreplay_max.field = wakeup.field; }
+
+  SDREPLAY_ACCOUNT(nb_read_commands);
+  SDREPLAY_ACCOUNT(nb_sectors_read);
+  SDREPLAY_ACCOUNT(nb_write_commands);
+  SDREPLAY_ACCOUNT(nb_sectors_written);
+  SDREPLAY_ACCOUNT(nb_seeks);
+  SDREPLAY_ACCOUNT(busy_us);
+}
+
+/**
+ * Build a wakeup's data frame, as the sensors would.
+ *
+ * @param[out] pv_frame the frame. MUST be NOT NULL.
+ * @param[in]  wakeup   the wakeup's index.
+ *
+ * @return true  on success.
+ * @return false otherwise.
+ */
+static bool sdreplay_build_frame(CNSSRFDataFrame *pv_frame, uint32_t wakeup)
+{
+  cnssrf_data_frame_clear(pv_frame);
+
+  return
+      cnssrf_data_frame_set_current_data_channel(pv_frame, CNSSRF_DATA_CHANNEL_NODE) &&
+      cnssrf_dt_timestamp_utc_write_secs_to_frame(pv_frame, rtc_get_date_as_secs_since_2000()) &&
+      cnssrf_dt_battvoltage_write_millivolts_to_frame(pv_frame, 3600 + wakeup % 100) &&
+      cnssrf_data_frame_set_current_data_channel(pv_frame, CNSSRF_DATA_CHANNEL_1) &&
+      cnssrf_dt_temperature_write_degc_to_frame(pv_frame, 21.0f + (wakeup % 100) / 100.0f,
+						CNSSRF_DT_TEMPERATURE_DEGC_FLAG_NONE) &&
+      cnssrf_dt_humidity_write_air_relpercents_to_frame(pv_frame, 48.0f + wakeup % 10);
+}
+
+/**
+ * Set up the card like a station that has already been running: the directories and the
+ * data log exist.
+ *
+ * @return true  on success.
+ * @return false otherwise.
+ */
+static bool sdreplay_setup(void)
+{
+  if(!sdimage_open(SDREPLAY_IMAGE_NB_SECTORS, SDCACHE_ERASE_BLOCK_NB_SECTORS) ||
+     !sdimage_format(SDREPLAY_CLUSTER_NB_SECTORS) ||
+     !sdcard_init() ||
+     !sdcard_check_and_mkdir(ENV_DIRECTORY_NAME)          ||
+     !sdcard_check_and_mkdir(DATALOG_DIR)                 ||
+     !sdcard_check_and_mkdir(PRIVATE_DATA_DIRECTORY_NAME) ||
+     !sdcard_check_and_mkdir(SENSOR_STATE_DIR)            ||
+     !sdcard_check_and_mkdir(LOG_DIRECTORY_NAME)          ||
+     !sdcard_check_and_mkdir(SYSLOG_DIRECTORY_NAME)       ||
+     !sdcard_check_and_mkdir(OUTPUT_DIR)                  ||
+     !sdcard_check_and_mkdir(OUTPUT_DATA_CSV_DIR))
+  {
+    fprintf(stderr, "Failed to set up the card.\n");
+    return false;
+  }
+  cnsslog_init();
+  if(!datalog_cnssrf_init(SDREPLAY_DATALOG_FILE))
+  {
+    fprintf(stderr, "Failed to open the data log.\n");
+    return false;
+  }
+  cnssrf_data_frame_init(&_sdreplay_frame,
+			 _sdreplay_frame_buffer,      sizeof(_sdreplay_frame_buffer),
+			 _sdreplay_frame_meta,        sizeof(_sdreplay_frame_meta)      / sizeof(CNSSRFMetaData));
+  cnssrf_data_frame_init(&_sdreplay_send_frame,
+			 _sdreplay_send_frame_buffer, sizeof(_sdreplay_send_frame_buffer),
+			 _sdreplay_send_frame_meta,   sizeof(_sdreplay_send_frame_meta) / sizeof(CNSSRFMetaData));
+
+  return true;
+}
+
+/**
+ * Replay the wakeups.
+ *
+ * @param[in] nb_wakeups the number of wakeups to replay.
+ *
+ * @return true  on success.
+ * @return false on file system error.
+ */
+static bool sdreplay_run(uint32_t nb_wakeups)
+{
+  SensorStateStore *pvStore = SensorStateStore::instance();
+  SDImageStats      before;
+  File              csv;
+  char              line[160];
+  uint8_t           state[SDREPLAY_STATE_SIZE];
+  uint32_t          wakeup, i;
+  ts2000_t          since;
+  bool              has_more;
+  bool              res;
+
+  if(!sdcard_fopen(&csv, SDREPLAY_CSV_FILE, FILE_APPEND | FILE_WRITE) ||
+     !sdcard_fwrite_string(&csv, "Date;Battery (V);Temperature (degC);Humidity (%)\r\n") ||
+     !sdcard_fsync(&csv))
+  {
+    fprintf(stderr, "Failed to create the CSV output file.\n");
+    return false;
+  }
+
+  // Only count the wakeups' accesses, not the set up.
+  cnsslog_sleep();
+
+  res = true;
+  for(wakeup = 0; res && wakeup < nb_wakeups; wakeup++)
+  {
+    host_rtc_ts2000 += SDREPLAY_WAKEUP_PERIOD_S;
+    host_tick_ms    += SDREPLAY_WAKEUP_PERIOD_S * 1000;
+    before           = *sdimage_stats();
+
+    cnsslog_wakeup();
+    log_info(logger, "Wake up.");
+    log_info(logger, "Battery voltage: 3.%03u V", (unsigned int)(600 + wakeup % 100));
+
+    // Sensors
+    for(i = 0; res && i < SDREPLAY_NB_SENSORS; i++)
+    {
+      memset(state, (int)(wakeup + i), sizeof(state));
+      res = pvStore->save(0x5e45020u + i, (uint8_t)(i + 1), 0, state, sizeof(state));
+    }
+
+    // CSV output
+    snprintf(line, sizeof(line), "%u;3.%03u;21.%02u;%u.0\r\n",
+	     (unsigned int)rtc_get_date_as_secs_since_2000(), (unsigned int)(600 + wakeup % 100),
+	     (unsigned int)(wakeup % 100), (unsigned int)(48 + wakeup % 10));
+    res = res && sdcard_fwrite_string(&csv, line) && sdcard_fsync(&csv);
+
+    // Data log
+    res = res && sdreplay_build_frame(&_sdreplay_frame, wakeup) && datalog_cnssrf_add(&_sdreplay_frame);
+
+    // Send
+    since = rtc_get_date_as_secs_since_2000() - NB_SECS_IN_A_WEEK;
+    res   = res && datalog_cnssrf_get_frame(&_sdreplay_send_frame, SDREPLAY_MAX_PAYLOAD_SIZE, since, &has_more);
+    if(res && !cnssrf_data_frame_is_empty(&_sdreplay_send_frame))
+    {
+      log_info(logger, "Amount of data to send: %d bytes.", cnssrf_data_frame_size(&_sdreplay_send_frame));
+      datalog_cnssrf_frame_has_been_sent();
+    }
+
+    // Sleep
+    datalog_cnssrf_sync();
+    res = res && pvStore->flush() && sdcard_flush();
+    log_info(logger, "Next wakeup is scheduled in %u seconds.", SDREPLAY_WAKEUP_PERIOD_S);
+    i = sdcard_seek_stats()->nb_seeks;
+    cnsslog_sleep();
+
+    sdreplay_account(&before, i);
+  }
+  if(!res) { fprintf(stderr, "File system error at wakeup %u.\n", (unsigned int)wakeup); }
+
+  sdcard_wakeup();
+  sdcard_fclose(&csv);
+  datalog_cnssrf_deinit();
+  sdcard_deinit();
+
+  return res;
+}
+
+/**
+ * Check a counter against its threshold.
+ *
+ * @param[in] ps_name   the counter's name. MUST be NOT NULL.
+ * @param[in] value     the counter's value.
+ * @param[in] threshold the threshold. 0 for no threshold.
+ *
+ * @return true  if the value does not exceed the threshold.
+ * @return false otherwise.
+ */
+static bool sdreplay_check(const char *ps_name, uint64_t value, uint64_t threshold)
+{
+  if(!threshold || value <= threshold) { return true; }
+
+  fprintf(stderr, "FAIL: %s is %llu, more than %llu.\n",
+	  ps_name, (unsigned long long)value, (unsigned long long)threshold);
+  return false;
+}
+
+/**
+ * Print a counter: its total, its mean per wakeup and its maximum for a wakeup.
+ *
+ * @param[in] ps_name    the counter's name. MUST be NOT NULL.
+ * @param[in] total      the counter's total.
+ * @param[in] max        the counter's highest value for a wakeup.
+ * @param[in] nb_wakeups the number of wakeups.
+ */
+static void sdreplay_print(const char *ps_name, uint64_t total, uint64_t max, uint32_t nb_wakeups)
+{
+  printf("  %-16s %10llu  %8.2f  %6llu\n",
+	 ps_name, (unsigned long long)total, (double)total / nb_wakeups, (unsigned long long)max);
+}
+
+static void sdreplay_usage(const char *ps_prog)
+{
+  fprintf(stderr,
+	  "Usage: %s [--days N]\n"
+	  "          [--max-sectors-written N] [--max-write-commands N] [--max-block-programs N]\n"
+	  "          [--max-busy-ms N] [--max-seeks N]\n",
+	  ps_prog);
+}
+
+int main(int argc, char *argv[])
+{
+  uint32_t            nb_days = SDREPLAY_DEFAULT_NB_DAYS;
+  uint32_t            nb_wakeups;
+  uint64_t            max_sectors_written = 0, max_write_commands = 0, max_block_programs = 0;
+  uint64_t            max_busy_ms = 0, max_seeks = 0;
+  const SDImageStats *pv_stats;
+  bool                ok;
+  int                 i;
+
+  for(i = 1; i < argc; i++)
+  {
+    if(     !strcmp(argv[i], "--days")                && i + 1 < argc) { nb_days             = strtoul( argv[++i], NULL, 0); }
+    else if(!strcmp(argv[i], "--max-sectors-written") && i + 1 < argc) { max_sectors_written = strtoull(argv[++i], NULL, 0); }
+    else if(!strcmp(argv[i], "--max-write-commands")  && i + 1 < argc) { max_write_commands  = strtoull(argv[++i], NULL, 0); }
+    else if(!strcmp(argv[i], "--max-block-programs")  && i + 1 < argc) { max_block_programs  = strtoull(argv[++i], NULL, 0); }
+    else if(!strcmp(argv[i], "--max-busy-ms")         && i + 1 < argc) { max_busy_ms         = strtoull(argv[++i], NULL, 0); }
+    else if(!strcmp(argv[i], "--max-seeks")           && i + 1 < argc) { max_seeks           = strtoull(argv[++i], NULL, 0); }
+    else { sdreplay_usage(argv[0]); return 2; }
+  }
+  nb_wakeups = nb_days * 24 * 3600 / SDREPLAY_WAKEUP_PERIOD_S;
+  if(!nb_wakeups || !sdreplay_setup()) { return 2; }
+  sdimage_stats_reset();
+
+  ok = sdreplay_run(nb_wakeups);
+
+  pv_stats = sdimage_stats();
+  printf("Replayed %u days, %u wakeups, with a %u sectors cache.\n",
+	 (unsigned int)nb_days, (unsigned int)nb_wakeups, SDCACHE_NB_SECTORS);
+  printf("  %-16s %10s  %8s  %6s\n", "", "total", "/wakeup", "max");
+  sdreplay_print("read commands",   _sdreplay_total.nb_read_commands,   _sdreplay_max.nb_read_commands,   nb_wakeups);
+  sdreplay_print("sectors read",    _sdreplay_total.nb_sectors_read,    _sdreplay_max.nb_sectors_read,    nb_wakeups);
+  sdreplay_print("write commands",  _sdreplay_total.nb_write_commands,  _sdreplay_max.nb_write_commands,  nb_wakeups);
+  sdreplay_print("sectors written", _sdreplay_total.nb_sectors_written, _sdreplay_max.nb_sectors_written, nb_wakeups);
+  sdreplay_print("seeks",           _sdreplay_total.nb_seeks,           _sdreplay_max.nb_seeks,           nb_wakeups);
+  sdreplay_print("busy time (ms)",  _sdreplay_total.busy_us / 1000,     _sdreplay_max.busy_us / 1000,     nb_wakeups);
+  printf("  erase block programs:  %llu\n", (unsigned long long)pv_stats->nb_block_programs);
+  printf("  erase block switches:  %llu\n", (unsigned long long)pv_stats->nb_block_switches);
+  printf("  erase blocks used:     %u\n",   (unsigned int)pv_stats->nb_blocks_programmed);
+  printf("  most programmed block: %u times\n", (unsigned int)pv_stats->max_block_programs);
+
+  ok = ok &&
+      sdreplay_check("sectors written",      pv_stats->nb_sectors_written, max_sectors_written) &
+      sdreplay_check("write commands",       pv_stats->nb_write_commands,  max_write_commands)  &
+      sdreplay_check("erase block programs", pv_stats->nb_block_programs,  max_block_programs)  &
+      sdreplay_check("busy time (ms)",       pv_stats->busy_us / 1000,     max_busy_ms)         &
+      sdreplay_check("seeks",                _sdreplay_total.nb_seeks,     max_seeks);
+
+  sdimage_close();
+
+  return ok ? 0 : 1;
+}
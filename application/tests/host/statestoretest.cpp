@@ -0,0 +1,178 @@
+/**
+ * Checks that the sensors' state store, Drivers/Sensors/sensorstatestore.cpp, holds the states of a fully
+ * configured node, through the firmware's own SD card driver and FatFs on a RAM disk:
+ * CONNECSENS_NB_SENSOR_MAX sensors, each one with a state and a report on change reference.
+ *
+ *  - all the slots are claimed by the configuration, none is released;
+ *  - all the states are saved, and one more state does not fit;
+ *  - after a reset, the states are restored from the retained memory;
+ *  - after a power loss, they are read back from the card.
+ *
+ * @date   2019
+ */
+#include <stdio.h>
+#include <string.h>
+#include "config.h"
+#include "sdcard.h"
+#include "sdcache.h"
+#include "sdimage.h"
+#include "murmur3.h"
+#include "cnssrf-dataframe.h"
+// Access the store's instance and retained slots, to simulate resets and power losses.
+#define private public
+#include "sensorstatestore.hpp"
+#undef  private
+
+
+#define STATESTORETEST_IMAGE_NB_SECTORS    (512u * 1024 * 2)        ///< 512 MiB
+#define STATESTORETEST_CLUSTER_NB_SECTORS  8
+#define STATESTORETEST_NB_SENSORS          CNSSRF_DATA_CHANNEL_15  ///< CONNECSENS_NB_SENSOR_MAX
+#define STATESTORETEST_STATE_SIZE          40
+#define STATESTORETEST_REPORT_STATE_SIZE   28
+#define STATESTORETEST_REPORT_SEED         0x52505254               ///< SENSOR_REPORT_STATE_SEED
+
+
+static uint32_t _nb_failed;
+
+
+static void check(const char *ps_what, bool ok)
+{
+  printf("%s  %s\n", ok ? "ok  " : "FAIL", ps_what);
+  if(!ok) { _nb_failed++; }
+}
+
+/**
+ * Get the type hash of a sensor's state, or of its report on change reference.
+ */
+static uint32_t type_hash(uint8_t sensor, bool report)
+{
+  char type[16];
+
+  snprintf(type, sizeof(type), "type-%u", (unsigned int)sensor);
+  return mm3_32((const uint8_t *)type, strlen(type), report ? STATESTORETEST_REPORT_SEED : 0);
+}
+
+static uint32_t state_size(bool report)
+{
+  return report ? STATESTORETEST_REPORT_STATE_SIZE : STATESTORETEST_STATE_SIZE;
+}
+
+/**
+ * Fill a state with a pattern specific to its sensor and to the wakeup.
+ */
+static void fill(uint8_t *pu8_state, uint8_t sensor, bool report, uint8_t wakeup)
+{
+  for(uint32_t i = 0; i < state_size(report); i++) { pu8_state[i] = (uint8_t)(sensor * 16 + report * 8 + wakeup + i); }
+}
+
+/**
+ * Check that all the sensors' states are the ones saved at a wakeup.
+ */
+static bool all_loaded(uint8_t wakeup)
+{
+  SensorStateStore *pvStore = SensorStateStore::instance();
+  uint8_t           expected[SENSOR_STATE_STORE_SLOT_DATA_SIZE_MAX], state[SENSOR_STATE_STORE_SLOT_DATA_SIZE_MAX];
+
+  for(uint8_t s = 1; s <= STATESTORETEST_NB_SENSORS; s++)
+  {
+    for(int r = 0; r < 2; r++)
+    {
+      fill(expected, s, r, wakeup);
+      if(!pvStore->load(type_hash(s, r), s, 0, state, state_size(r)) ||
+	 memcmp(state, expected, state_size(r))) { return false; }
+    }
+  }
+
+  return true;
+}
+
+/**
+ * Reset the node: a new store instance, with the retained slots kept or not.
+ */
+static void reset(bool power_loss)
+{
+  delete SensorStateStore::_pvInstance;
+  SensorStateStore::_pvInstance = NULL;
+  if(power_loss)
+  {
+    retention_invalidate(&SensorStateStore::_retained.header);
+    memset(SensorStateStore::_retained.slots, 0, sizeof(SensorStateStore::_retained.slots));
+  }
+}
+
+int main(void)
+{
+  SensorStateStore *pvStore;
+  uint8_t           state[SENSOR_STATE_STORE_SLOT_DATA_SIZE_MAX];
+  uint32_t          nb_released = 0;
+  bool              ok;
+
+  if(!sdimage_open(STATESTORETEST_IMAGE_NB_SECTORS, SDCACHE_ERASE_BLOCK_NB_SECTORS) ||
+     !sdimage_format(STATESTORETEST_CLUSTER_NB_SECTORS) ||
+     !sdcard_init() ||
+     !sdcard_check_and_mkdir(ENV_DIRECTORY_NAME) ||
+     !sdcard_check_and_mkdir(PRIVATE_DATA_DIRECTORY_NAME) ||
+     !sdcard_check_and_mkdir(SENSOR_STATE_DIR))
+  {
+    fprintf(stderr, "Failed to set up the card.\n");
+    return 2;
+  }
+  printf("      %u slots for %u sensors\n", (unsigned int)SENSOR_STATE_STORE_NB_SLOTS,
+	 (unsigned int)STATESTORETEST_NB_SENSORS);
+
+  // First wakeup: every sensor saves its state and its report on change reference.
+  pvStore = SensorStateStore::instance();
+  ok      = true;
+  for(uint8_t s = 1; s <= STATESTORETEST_NB_SENSORS; s++)
+  {
+    for(int r = 0; r < 2; r++)
+    {
+      fill(state, s, r, 0);
+      ok = pvStore->save(type_hash(s, r), s, 0, state, state_size(r)) && ok;
+    }
+  }
+  check("fully configured node: all the states are saved", ok);
+  check("fully configured node: all the states are loaded", all_loaded(0));
+  fill(state, 0, false, 0);
+  check("one more state does not fit",
+	!pvStore->save(type_hash(STATESTORETEST_NB_SENSORS + 1, false), CNSSRF_DATA_CHANNEL_15, 0,
+		       state, STATESTORETEST_STATE_SIZE));
+  check("flush", pvStore->flush() && sdcard_flush());
+
+  // The configuration is loaded again: every sensor claims its slots.
+  reset(false);
+  pvStore = SensorStateStore::instance();
+  pvStore->startClaims();
+  for(uint8_t s = 1; s <= STATESTORETEST_NB_SENSORS; s++)
+  {
+    pvStore->claim(type_hash(s, false), s, 0);
+    pvStore->claim(type_hash(s, true),  s, 0);
+  }
+  pvStore->releaseUnclaimed();
+  for(uint32_t i = 0; i < SENSOR_STATE_STORE_NB_SLOTS; i++)
+  {
+    nb_released += SensorStateStore::_retained.slots[i].stale;
+  }
+  check("reset: no slot claimed by the configuration is released", nb_released == 0);
+  check("reset: the states are restored from the retained memory", all_loaded(0));
+
+  // Second wakeup, then a power loss: the states are read from the card.
+  ok = true;
+  for(uint8_t s = 1; s <= STATESTORETEST_NB_SENSORS; s++)
+  {
+    for(int r = 0; r < 2; r++)
+    {
+      fill(state, s, r, 1);
+      ok = pvStore->save(type_hash(s, r), s, 0, state, state_size(r)) && ok;
+    }
+  }
+  ok = ok && pvStore->flush() && sdcard_flush();
+  reset(true);
+  check("power loss: the states are read from the card", ok && all_loaded(1));
+
+  sdcard_deinit();
+  sdimage_close();
+
+  printf("%u failure(s).\n", (unsigned int)_nb_failed);
+  return _nb_failed ? 1 : 0;
+}
@@ -0,0 +1,22 @@
+/**
+ * Host replacement for FatFS/integer.h, forced before it with -include.
+ *
+ * FatFs needs 32 bits DWORDs; the embedded definition uses unsigned long,
+ * that is 64 bits wide on the host.
+ */
+#ifndef FF_INTEGER
+#define FF_INTEGER
+
+#include <stdint.h>
+
+typedef int            INT;
+typedef unsigned int   UINT;
+typedef unsigned char  BYTE;
+typedef short          SHORT;
+typedef unsigned short WORD;
+typedef unsigned short WCHAR;
+typedef int32_t        LONG;
+typedef uint32_t       DWORD;
+typedef uint64_t       QWORD;
+
+#endif
@@ -0,0 +1,118 @@
+/**
+ * Host environment for the firmware modules built into the host programs;
+ * forced before their sources with -include.
+ *
+ * The modules are built with the device's actual headers. Then:
+ *  - the peripherals they access through the register definitions are redirected to host variables;
+ *    LPTIM1 is reached through host_lptim1_access(), that a program can override to simulate its counter;
+ *  - the core instructions they use, which only exist as ARM assembly, are replaced with C;
+ *  - the HAL, board and peripheral functions they call are provided by hostenv.c,
+ *    as weak definitions that a program can override.
+ *
+ * @date   2019
+ */
+#ifndef TESTS_HOST_HOSTENV_H_
+#define TESTS_HOST_HOSTENV_H_
+
+#include <stddef.h>
+#include <stdint.h>
+#include "stm32l4xx_hal.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+
+  // newlib functions missing from the host's C library
+  extern size_t strlcpy(char *ps_dest, const char *ps_src, size_t size);
+  extern size_t strlcat(char *ps_dest, const char *ps_src, size_t size);
+
+
+  // Peripherals
+  extern RCC_TypeDef   host_rcc;
+  extern PWR_TypeDef   host_pwr;
+  extern SCB_Type      host_scb;
+  extern SysTick_Type  host_systick;
+  extern LPTIM_TypeDef host_lptim1;
+  extern ADC_TypeDef   host_adc1;
+  extern EXTI_TypeDef  host_exti;
+
+  extern LPTIM_TypeDef *host_lptim1_access(void);  ///< Called at each LPTIM1 register access; returns &host_lptim1.
+
+#undef  RCC
+#define RCC      (&host_rcc)
+#undef  PWR
+#define PWR      (&host_pwr)
+#undef  SCB
+#define SCB      (&host_scb)
+#undef  SysTick
+#define SysTick  (&host_systick)
+#undef  LPTIM1
+#define LPTIM1   (host_lptim1_access())
+#undef  ADC1
+#define ADC1     (&host_adc1)
+#undef  EXTI
+#define EXTI     (&host_exti)
+
+
+  // Core instructions
+  extern uint32_t host_primask;  ///< 1 while the interruptions are disabled.
+  extern uint32_t host_ipsr;     ///< The exception number; not 0 to run the code as if it were in an interruption handler.
+  extern uint32_t host_nb_wfi;   ///< The number of WFI instructions executed.
+
+#undef  __disable_irq
+#define __disable_irq()     (host_primask = 1)
+#undef  __enable_irq
+#define __enable_irq()      (host_primask = 0)
+#undef  __get_PRIMASK
+#define __get_PRIMASK()     (host_primask)
+#undef  __set_PRIMASK
+#define __set_PRIMASK(v)    (host_primask = (v))
+#undef  __get_IPSR
+#define __get_IPSR()        (host_ipsr)
+#undef  __WFI
+#define __WFI()             (host_nb_wfi++)
+#undef  __WFE
+#define __WFE()             ((void)0)
+#undef  __SEV
+#define __SEV()             ((void)0)
+#undef  __DSB
+#define __DSB()             __sync_synchronize()
+#undef  __ISB
+#define __ISB()             __sync_synchronize()
+#undef  __DMB
+#define __DMB()             __sync_synchronize()
+#undef  __NOP
+#define __NOP()             ((void)0)
+#undef  __CLZ
+#define __CLZ(v)            ((v) ? (uint8_t)__builtin_clz(v) : 32u)
+#undef  __RBIT
+#define __RBIT(v)           host_rbit(v)
+#undef  __REV
+#define __REV(v)            __builtin_bswap32(v)
+#undef  __REV16
+#define __REV16(v)          host_rev16(v)
+
+  static inline uint32_t host_rbit(uint32_t v)
+  {
+    v = ((v >> 1) & 0x55555555u) | ((v & 0x55555555u) << 1);
+    v = ((v >> 2) & 0x33333333u) | ((v & 0x33333333u) << 2);
+    v = ((v >> 4) & 0x0F0F0F0Fu) | ((v & 0x0F0F0F0Fu) << 4);
+    return __builtin_bswap32(v);
+  }
+
+  static inline uint32_t host_rev16(uint32_t v)
+  {
+    return ((v >> 8) & 0x00FF00FFu) | ((v & 0x00FF00FFu) << 8);
+  }
+
+
+  // The HAL's millisecond tick
+  extern uint32_t host_tick_ms;     ///< The value returned by HAL_GetTick().
+  extern uint32_t host_rtc_ts2000;  ///< The RTC date, in seconds since 2000-01-01.
+
+
+#ifdef __cplusplus
+}
+#endif
+#endif /* TESTS_HOST_HOSTENV_H_ */
@@ -0,0 +1,4 @@
+/**
+ * Host replacement for the newlib header included by defs.h.
+ */
+#include <endian.h>
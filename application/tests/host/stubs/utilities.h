@@ -0,0 +1,20 @@
+/**
+ * Host replacement for the LoRaWAN stack's utilities.h.
+ *
+ * Only provides what the crypto modules use; the embedded header pulls in the board support.
+ */
+#ifndef __UTILITIES_H__
+#define __UTILITIES_H__
+
+#include <stdint.h>
+#include <stdbool.h>
+#include <string.h>
+
+#ifndef MIN
+#define MIN(a, b) (((a) < (b)) ? (a) : (b))
+#endif
+
+#define memset1(s, c, n)       memset((s), (c), (n))
+#define memcpy1(dest, src, n)  memcpy((dest), (src), (n))
+
+#endif /* __UTILITIES_H__ */
@@ -0,0 +1,375 @@
+/**
+ * Checks the register shadow of the SX1272 driver, Middlewares/Network/LoRaWAN/Lora/Phy/sx1272/sx1272.c,
+ * on a fake radio behind the driver's SPI interface; and counts the SPI transactions of an uplink.
+ *
+ * With the shadow:
+ *  - writing a LoRa configuration register with the value it holds, and reading it, cost no transaction;
+ *  - the registers that the radio changes on its own, like the IRQ flags, are always accessed;
+ *  - the copy is dropped when the radio is reset, when the OPMODE LoRa bit changes and when the
+ *    radio's power is cut (IoDeInit);
+ *  - after a wake and uplinks, every register the driver reads is the radio's.
+ *
+ * Built with SX1272_REG_SHADOW=0 (sx1272noshadowtest), it only counts the transactions, for comparison.
+ * With --max-transactions, the test fails if an uplink takes more transactions.
+ *
+ * The fake radio has the FSK and the LoRa registers from 0x0D to 0x3F in separate banks, selected by
+ * the OPMODE LoRa bit; the other registers are shared. A reset or a power cut restores the defaults.
+ *
+ * @date   2019
+ */
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include "sx1272/sx1272.h"
+
+
+#define SX1272TEST_NB_REGS        0x80
+#define SX1272TEST_BANK_FIRST     0x0D
+#define SX1272TEST_BANK_LAST      0x3F
+#define SX1272TEST_NB_UPLINKS     100
+#define SX1272TEST_FRAME_SIZE     24
+
+
+// The radio's reset and interruption handlers, not in sx1272.h.
+extern void SX1272OnDio0Irq(void);
+extern void SX1272OnDio1Irq(void);
+extern void SX1272Reset(void);
+
+
+typedef enum SX1272TestBank
+{
+  BANK_FSK,
+  BANK_LORA
+}
+SX1272TestBank;
+
+
+static uint8_t  _regs[2][SX1272TEST_NB_REGS];  ///< The radio's registers, by bank.
+static uint32_t _nb_transactions;               ///< The number of SPI transactions so far.
+static bool     _in_command;                    ///< Is the next byte written the command?
+static bool     _is_write;                      ///< Does the current transaction write the registers?
+static uint8_t  _addr;                          ///< The current register address.
+static uint32_t _nb_failed;
+
+
+/**
+ * Get the bank in use.
+ */
+static SX1272TestBank bank(void)
+{
+  return (_regs[BANK_FSK][REG_OPMODE] & RFLR_OPMODE_LONGRANGEMODE_ON) ? BANK_LORA : BANK_FSK;
+}
+
+/**
+ * Get a register's location, in the bank in use.
+ */
+static uint8_t *reg(uint8_t addr)
+{
+  return (addr >= SX1272TEST_BANK_FIRST && addr <= SX1272TEST_BANK_LAST) ? &_regs[bank()][addr] :
+                                                                           &_regs[BANK_FSK][addr];
+}
+
+/**
+ * Put the registers back to their default values, as after a reset or a power up.
+ */
+static void fake_reset(void)
+{
+  static const uint8_t lora_defaults[][2] =
+  {
+    { REG_LR_FIFOTXBASEADDR,    0x80 }, { REG_LR_MODEMCONFIG1,       0x08 },
+    { REG_LR_MODEMCONFIG2,      0x70 }, { REG_LR_SYMBTIMEOUTLSB,     0x64 },
+    { REG_LR_PREAMBLELSB,       0x08 }, { REG_LR_PAYLOADLENGTH,      0x01 },
+    { REG_LR_PAYLOADMAXLENGTH,  0xFF }, { REG_LR_DETECTOPTIMIZE,     0xC3 },
+    { REG_LR_INVERTIQ,          0x27 }, { REG_LR_DETECTIONTHRESHOLD, 0x0A },
+    { REG_LR_SYNCWORD,          0x12 }, { REG_LR_INVERTIQ2,          0x1D }
+  };
+  uint32_t i;
+
+  memset(_regs, 0, sizeof(_regs));
+  _regs[BANK_FSK][REG_OPMODE]   = 0x01;
+  _regs[BANK_FSK][REG_FRFMSB]   = 0xE4;
+  _regs[BANK_FSK][REG_FRFMID]   = 0xC0;
+  _regs[BANK_FSK][REG_PACONFIG] = 0x0F;
+  _regs[BANK_FSK][REG_PARAMP]   = 0x19;
+  _regs[BANK_FSK][REG_OCP]      = 0x2B;
+  _regs[BANK_FSK][REG_LNA]      = 0x20;
+  _regs[BANK_FSK][REG_PADAC]    = 0x84;
+  for(i = 0; i < sizeof(lora_defaults) / sizeof(lora_defaults[0]); i++)
+  {
+    _regs[BANK_LORA][lora_defaults[i][0]] = lora_defaults[i][1];
+  }
+}
+
+static void fake_apply_reset_signal(bool reset)
+{
+  if(reset) { fake_reset(); }
+}
+
+static void fake_start(void)
+{
+  _nb_transactions++;
+  _in_command = true;
+}
+
+static void fake_stop(void)
+{
+  _in_command = false;
+}
+
+static bool fake_write(const uint8_t *pu8_data, uint16_t size)
+{
+  for( ; size; size--, pu8_data++)
+  {
+    if(_in_command)
+    {
+      _in_command = false;
+      _is_write   = (*pu8_data & 0x80) != 0;
+      _addr       = *pu8_data & 0x7F;
+      continue;
+    }
+    if(!_is_write) { return false; }
+
+    // The FIFO's data are not kept; a burst to the FIFO stays at its address.
+    if(_addr == REG_LR_FIFO) { continue; }
+    *reg(_addr) = *pu8_data;
+    _addr       = (_addr + 1) % SX1272TEST_NB_REGS;
+  }
+
+  return true;
+}
+
+static uint8_t *fake_read(uint8_t *pu8_buffer, uint16_t size)
+{
+  uint16_t i;
+
+  if(_in_command || _is_write) { return NULL; }
+  for(i = 0; i < size; i++)
+  {
+    pu8_buffer[i] = _addr == REG_LR_FIFO ? 0 : *reg(_addr);
+    if(_addr != REG_LR_FIFO) { _addr = (_addr + 1) % SX1272TEST_NB_REGS; }
+  }
+
+  return pu8_buffer;
+}
+
+static LoRaRadioCom _fake_com =
+{
+  fake_apply_reset_signal,
+  fake_start,
+  fake_stop,
+  fake_read,
+  fake_write
+};
+
+
+static void     board_set_xo(uint8_t state)                  { (void)state; }
+static uint32_t board_get_wake_time(void)                    { return 0; }
+static void     board_io_irq_init(DioIrqHandler **handlers)  { (void)handlers; }
+static void     board_set_ant_sw_low_power(bool status)      { (void)status; }
+static void     board_set_ant_sw(uint8_t op_mode)            { (void)op_mode; }
+
+/**
+ * Set the output power on the RFO pin, like the board's callback in LoRaWAN.cpp.
+ */
+static void board_set_rf_tx_power(int8_t power)
+{
+  uint8_t pa_config = SX1272Read(REG_PACONFIG);
+  uint8_t pa_dac    = SX1272Read(REG_PADAC);
+
+  if(power < -1) { power = -1; }
+  if(power > 14) { power = 14; }
+  pa_config = (pa_config & RF_PACONFIG_PASELECT_MASK & RFLR_PACONFIG_OUTPUTPOWER_MASK) |
+    RF_PACONFIG_PASELECT_RFO | (uint8_t)((power + 1) & 0x0F);
+  SX1272Write(REG_PACONFIG, pa_config);
+  SX1272Write(REG_PADAC,    pa_dac);
+}
+
+static LoRaBoardCallback_t _board =
+{
+  board_set_xo,
+  board_get_wake_time,
+  board_io_irq_init,
+  board_set_rf_tx_power,
+  board_set_ant_sw_low_power,
+  board_set_ant_sw
+};
+
+/**
+ * The MAC puts the radio to sleep at the end of each transmission and reception, for class A.
+ */
+static LoRaRadioEvents _events =
+{
+  .TxDone    = SX1272SetSleep,
+  .RxTimeout = SX1272SetSleep
+};
+
+
+// The driver's timers and clock; the test drives the radio's interruptions itself.
+void        timer_init(Timer *pv_timer, TimerTime period, TimerOptions options)   { (void)pv_timer; (void)period; (void)options; }
+void        timer_set_callback_no_arg(Timer *pv_timer, void (pf_cb)(void))        { (void)pv_timer; (void)pf_cb; }
+void        timer_set_period(Timer *pv_timer, TimerTime p, TimerTimeUnit unit)    { (void)pv_timer; (void)p; (void)unit; }
+void        timer_start(Timer *pv_timer)                                          { (void)pv_timer; }
+void        timer_stop( Timer *pv_timer)                                          { (void)pv_timer; }
+RTCTicks    rtc_get_date_as_ticks_since_2000(void)                                { return host_tick_ms; }
+uint32_t    rtc_ticks_to_ms(RTCTicks ticks)                                       { return (uint32_t)ticks; }
+TimerTime_t TimerGetElapsedTime(TimerTime_t saved_time)                           { return host_tick_ms - saved_time; }
+
+
+/**
+ * Wake the radio up, as ClassLoRaWAN::wakeupSpecific() does after a sleep.
+ */
+static void wakeup(void)
+{
+  SX1272ReInit();
+}
+
+/**
+ * Cut the radio's power, as ClassLoRaWAN::sleepSpecific() does through lorawan_SX1272IoDeInit().
+ */
+static void io_deinit(void)
+{
+  fake_reset();
+  SX1272InvalidateRegisterShadow();
+}
+
+/**
+ * Do an unconfirmed EU868 uplink at DR5 with no downlink, the calls of LoRaMac.c and RegionEU868.c:
+ * the transmission, then the RX1 and RX2 windows, each ended by a timeout.
+ */
+static void uplink(void)
+{
+  uint8_t frame[SX1272TEST_FRAME_SIZE];
+
+  memset(frame, 0x5A, sizeof(frame));
+
+  SX1272SetChannel(868100000);
+  SX1272SetTxConfig(MODEM_LORA, 14, 0, 0, 7, 1, 8, false, true, false, 0, false, 3000);
+  SX1272SetMaxPayloadLength(MODEM_LORA, sizeof(frame));
+  SX1272Send(frame, sizeof(frame));
+  SX1272OnDio0Irq();
+
+  SX1272SetChannel(868100000);
+  SX1272SetRxConfig(MODEM_LORA, 0, 7, 1, 0, 8, 8, false, 0, false, false, 0, true, false);
+  SX1272SetMaxPayloadLength(MODEM_LORA, 242 + 13);
+  SX1272SetRx(3000);
+  SX1272OnDio1Irq();
+
+  SX1272SetChannel(869525000);
+  SX1272SetRxConfig(MODEM_LORA, 0, 12, 1, 0, 8, 8, false, 0, false, false, 0, true, false);
+  SX1272SetMaxPayloadLength(MODEM_LORA, 51 + 13);
+  SX1272SetRx(3000);
+  SX1272OnDio1Irq();
+}
+
+static void check(const char *ps_what, bool ok)
+{
+  printf("%s  %s\n", ok ? "ok  " : "FAIL", ps_what);
+  if(!ok) { _nb_failed++; }
+}
+
+/**
+ * Check that the driver reads every register as the radio holds it.
+ */
+static void check_coherence(const char *ps_what)
+{
+  uint8_t addr;
+  bool    ok = true;
+
+  for(addr = 1; addr < SX1272TEST_NB_REGS; addr++)
+  {
+    if(SX1272Read(addr) != *reg(addr))
+    {
+      printf("      register 0x%02X: read 0x%02X, radio 0x%02X\n",
+	     (unsigned int)addr, (unsigned int)SX1272Read(addr), (unsigned int)*reg(addr));
+      ok = false;
+    }
+  }
+  check(ps_what, ok);
+}
+
+/**
+ * Count the transactions of a call sequence.
+ */
+#define TRANSACTIONS(calls)  ({ uint32_t _n = _nb_transactions; calls; _nb_transactions - _n; })
+
+
+#if SX1272_REG_SHADOW
+static void check_shadow(void)
+{
+  uint32_t n;
+  uint8_t  frf_mid;
+
+  wakeup();
+  SX1272SetModem(MODEM_LORA);
+  SX1272SetPublicNetwork(true);
+
+  n = TRANSACTIONS(SX1272Write(REG_LR_SYNCWORD, LORA_MAC_PUBLIC_SYNCWORD); SX1272Read(REG_LR_SYNCWORD));
+  check("shadow hit: writing a register with its value and reading it cost no transaction", n == 0);
+
+  n = TRANSACTIONS(SX1272Read(REG_LR_IRQFLAGS); SX1272Write(REG_LR_IRQFLAGS, 0xFF); SX1272Write(REG_LR_IRQFLAGS, 0xFF));
+  check("the IRQ flags are always accessed", n == 3);
+
+  n = TRANSACTIONS(SX1272Write(REG_LR_MODEMCONFIG1, 0x72); SX1272Write(REG_LR_MODEMCONFIG1, 0x72));
+  check("a changed register is written once", n == 1 && *reg(REG_LR_MODEMCONFIG1) == 0x72);
+
+  SX1272Reset();
+  SX1272SetModem(MODEM_LORA);
+  n = TRANSACTIONS(SX1272Read(REG_LR_SYNCWORD));
+  check("reset: the shadow is dropped", n == 1 && SX1272Read(REG_LR_SYNCWORD) == 0x12);
+
+  // In FSK mode, SetModem() writes DIOMAPPING2 to 0x30 and SetChannel() the shared FRF registers;
+  // back in LoRa mode, writing them with their former LoRa values must reach the radio.
+  SX1272Write(REG_LR_DIOMAPPING2, 0x00);
+  SX1272SetChannel(868100000);
+  frf_mid = *reg(REG_LR_FRFMID);
+  SX1272SetModem(MODEM_FSK);
+  SX1272SetChannel(869525000);
+  SX1272SetModem(MODEM_LORA);
+  SX1272SetChannel(868100000);
+  check("OPMODE LoRa bit change: the shadow is dropped",
+	*reg(REG_LR_DIOMAPPING2) == 0x00 && *reg(REG_LR_FRFMID) == frf_mid && SX1272Read(REG_LR_FRFMID) == frf_mid);
+  check_coherence("OPMODE LoRa bit change: the registers read are the radio's");
+
+  SX1272Write(REG_LR_SYNCWORD, 0x34);
+  io_deinit();
+  n = TRANSACTIONS(SX1272Read(REG_LR_SYNCWORD));
+  check("IoDeInit: the shadow is dropped", n == 1 && SX1272Read(REG_LR_SYNCWORD) == *reg(REG_LR_SYNCWORD));
+
+}
+#endif
+
+int main(int argc, char *argv[])
+{
+  uint32_t max_transactions = 0, n_wake, n_uplink, i;
+
+  for(i = 1; i < (uint32_t)argc; i++)
+  {
+    if(!strcmp(argv[i], "--max-transactions") && i + 1 < (uint32_t)argc)
+    {
+      max_transactions = strtoul(argv[++i], NULL, 10);
+    }
+  }
+
+  fake_reset();
+  SX1272BoardInit(&_board, &_fake_com);
+  SX1272Init(&_events);
+  SX1272SetPublicNetwork(true);
+  SX1272SetSleep();
+
+#if SX1272_REG_SHADOW
+  check_shadow();
+#endif
+
+  // A wake, as after each sleep, then its first uplink; then the other uplinks of the same wake.
+  io_deinit();
+  n_wake   = TRANSACTIONS(wakeup(); uplink());
+  n_uplink = TRANSACTIONS(for(i = 0; i < SX1272TEST_NB_UPLINKS; i++) { uplink(); }) / SX1272TEST_NB_UPLINKS;
+  printf("%s  SPI transactions: %u for a wake and its first uplink, %u per following uplink\n",
+	 !max_transactions || n_wake <= max_transactions ? "ok  " : "FAIL",
+	 (unsigned int)n_wake, (unsigned int)n_uplink);
+  if(max_transactions && n_wake > max_transactions) { _nb_failed++; }
+  check_coherence("wake and uplinks: the registers read are the radio's");
+
+  printf("%u failure(s).\n", (unsigned int)_nb_failed);
+  return _nb_failed ? 1 : 0;
+}